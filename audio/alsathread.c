@@ -20,7 +20,7 @@
 #include <alsa/asoundlib.h>
 #include "../general.h"
 #include <rthreads/rthreads.h>
-#include "../fifo_buffer.h"
+#include "../spsc_buffer.h"
 
 #define TRY_ALSA(x) if (x < 0) { \
                   goto error; \
@@ -38,11 +38,11 @@ typedef struct alsa_thread
    size_t period_size;
    snd_pcm_uframes_t period_frames;
 
-   fifo_buffer_t *buffer;
+   spsc_buffer_t *buffer;
    sthread_t *worker_thread;
-   slock_t *fifo_lock;
    scond_t *cond;
    slock_t *cond_lock;
+   int64_t period_usec;
 } alsa_thread_t;
 
 static void alsa_worker_thread(void *data)
@@ -58,12 +58,12 @@ static void alsa_worker_thread(void *data)
 
    while (!alsa->thread_dead)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_read_avail(alsa->buffer);
+      /* No lock here, a blocked writer waits with a timeout
+       * in case it misses this wakeup. */
+      size_t avail = spsc_read_avail(alsa->buffer);
       size_t fifo_size = min(alsa->period_size, avail);
-      fifo_read(alsa->buffer, buf, fifo_size);
+      spsc_read(alsa->buffer, buf, fifo_size);
       scond_signal(alsa->cond);
-      slock_unlock(alsa->fifo_lock);
 
       /* If underrun, fill rest with silence. */
       memset(buf + fifo_size, 0, alsa->period_size - fifo_size);
@@ -129,11 +129,9 @@ static void alsa_thread_free(void *data)
          sthread_join(alsa->worker_thread);
       }
       if (alsa->buffer)
-         fifo_free(alsa->buffer);
+         spsc_free(alsa->buffer);
       if (alsa->cond)
          scond_free(alsa->cond);
-      if (alsa->fifo_lock)
-         slock_free(alsa->fifo_lock);
       if (alsa->cond_lock)
          slock_free(alsa->cond_lock);
       if (alsa->pcm)
@@ -208,11 +206,12 @@ static void *alsa_thread_init(const char *device,
    snd_pcm_hw_params_free(params);
    snd_pcm_sw_params_free(sw_params);
 
-   alsa->fifo_lock = slock_new();
+   alsa->period_usec = (int64_t)alsa->period_frames * 1000000 / rate;
+
    alsa->cond_lock = slock_new();
    alsa->cond = scond_new();
-   alsa->buffer = fifo_new(alsa->buffer_size);
-   if (!alsa->fifo_lock || !alsa->cond_lock || !alsa->cond || !alsa->buffer)
+   alsa->buffer = spsc_new(alsa->buffer_size);
+   if (!alsa->cond_lock || !alsa->cond || !alsa->buffer)
       goto error;
 
    alsa->worker_thread = sthread_create(alsa_worker_thread, alsa);
@@ -246,11 +245,9 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
 
    if (alsa->nonblock)
    {
-      slock_lock(alsa->fifo_lock);
-      size_t avail = fifo_write_avail(alsa->buffer);
+      size_t avail = spsc_write_avail(alsa->buffer);
       size_t write_amt = min(avail, size);
-      fifo_write(alsa->buffer, buf, write_amt);
-      slock_unlock(alsa->fifo_lock);
+      spsc_write(alsa->buffer, buf, write_amt);
       return write_amt;
    }
    else
@@ -258,22 +255,20 @@ static ssize_t alsa_thread_write(void *data, const void *buf, size_t size)
       size_t written = 0;
       while (written < size && !alsa->thread_dead)
       {
-         slock_lock(alsa->fifo_lock);
-         size_t avail = fifo_write_avail(alsa->buffer);
+         size_t avail = spsc_write_avail(alsa->buffer);
 
          if (avail == 0)
          {
-            slock_unlock(alsa->fifo_lock);
             slock_lock(alsa->cond_lock);
-            if (!alsa->thread_dead)
-               scond_wait(alsa->cond, alsa->cond_lock);
+            if (!alsa->thread_dead && spsc_write_avail(alsa->buffer) == 0)
+               scond_wait_timeout(alsa->cond, alsa->cond_lock,
+                     alsa->period_usec);
             slock_unlock(alsa->cond_lock);
          }
          else
          {
             size_t write_amt = min(size - written, avail);
-            fifo_write(alsa->buffer, (const char*)buf + written, write_amt);
-            slock_unlock(alsa->fifo_lock);
+            spsc_write(alsa->buffer, (const char*)buf + written, write_amt);
             written += write_amt;
          }
       }
@@ -319,10 +314,7 @@ static size_t alsa_thread_write_avail(void *data)
 
    if (alsa->thread_dead)
       return 0;
-   slock_lock(alsa->fifo_lock);
-   size_t val = fifo_write_avail(alsa->buffer);
-   slock_unlock(alsa->fifo_lock);
-   return val;
+   return spsc_write_avail(alsa->buffer);
 }
 
 static size_t alsa_thread_buffer_size(void *data)
@@ -331,6 +323,23 @@ static size_t alsa_thread_buffer_size(void *data)
    return alsa->buffer_size;
 }
 
+static size_t alsa_thread_write_acquire(void *data,
+      audio_write_region_t *region)
+{
+   alsa_thread_t *alsa = (alsa_thread_t*)data;
+
+   if (alsa->thread_dead)
+      return 0;
+   return spsc_write_acquire(alsa->buffer, &region->chunk1, &region->size1,
+         &region->chunk2, &region->size2);
+}
+
+static void alsa_thread_write_commit(void *data, size_t size)
+{
+   alsa_thread_t *alsa = (alsa_thread_t*)data;
+   spsc_write_commit(alsa->buffer, size);
+}
+
 audio_driver_t audio_alsathread = {
    alsa_thread_init,
    alsa_thread_write,
@@ -343,4 +352,6 @@ audio_driver_t audio_alsathread = {
    "alsathread",
    alsa_thread_write_avail,
    alsa_thread_buffer_size,
+   alsa_thread_write_acquire,
+   alsa_thread_write_commit,
 };
@@ -0,0 +1,219 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio_dsp_thread.h"
+#include <rthreads/rthreads.h>
+#include "../spsc_buffer.h"
+#include <stdlib.h>
+#include <string.h>
+
+struct audio_dsp_thread
+{
+   sthread_t *thread;
+   spsc_buffer_t *queue;
+
+   /* Samples move through the queue lock-free. The lock and
+    * conditions are only there to sleep on an empty or full queue. */
+   slock_t *lock;
+   scond_t *work_cond;  /* Queue got data, or we are shutting down. */
+   scond_t *space_cond; /* Worker finished a chunk. */
+
+   bool alive;
+   bool busy;   /* Worker holds a chunk it hasn't written out yet. */
+   bool failed;
+
+   audio_dsp_thread_process_t process;
+   size_t queue_samples;
+   size_t block_samples;
+
+   float *chunk;
+   size_t max_samples;
+   void *scratch;
+};
+
+static void audio_dsp_thread_loop(void *data)
+{
+   audio_dsp_thread_t *thr = (audio_dsp_thread_t*)data;
+
+   for (;;)
+   {
+      bool ret      = true;
+      size_t avail  = 0;
+
+      slock_lock(thr->lock);
+      while (thr->alive &&
+            !(avail = spsc_read_avail(thr->queue) / sizeof(float)))
+         scond_wait(thr->work_cond, thr->lock);
+
+      if (!thr->alive)
+      {
+         slock_unlock(thr->lock);
+         break;
+      }
+      thr->busy = true;
+      slock_unlock(thr->lock);
+
+      /* The producer only ever writes whole frames. */
+      if (avail > thr->max_samples)
+         avail = thr->max_samples;
+
+      spsc_read(thr->queue, thr->chunk, avail * sizeof(float));
+
+      if (!thr->failed)
+         ret = thr->process(thr->chunk, avail, thr->scratch);
+
+      slock_lock(thr->lock);
+      if (!ret)
+         thr->failed = true;
+      thr->busy = false;
+      scond_signal(thr->space_cond);
+      slock_unlock(thr->lock);
+   }
+}
+
+audio_dsp_thread_t *audio_dsp_thread_new(size_t queue_samples,
+      size_t block_samples, size_t max_samples, size_t scratch_size,
+      audio_dsp_thread_process_t process)
+{
+   audio_dsp_thread_t *thr = (audio_dsp_thread_t*)calloc(1, sizeof(*thr));
+   if (!thr)
+      return NULL;
+
+   /* Keep sizes to whole stereo frames. */
+   queue_samples &= ~(size_t)1;
+   block_samples &= ~(size_t)1;
+   max_samples   &= ~(size_t)1;
+   if (block_samples > queue_samples)
+      block_samples = queue_samples;
+
+   thr->process       = process;
+   thr->queue_samples = queue_samples;
+   thr->block_samples = block_samples;
+   thr->max_samples   = max_samples;
+   thr->alive         = true;
+
+   thr->queue         = spsc_new(queue_samples * sizeof(float));
+   thr->chunk         = (float*)malloc(max_samples * sizeof(float));
+   thr->scratch       = malloc(scratch_size);
+   thr->lock          = slock_new();
+   thr->work_cond     = scond_new();
+   thr->space_cond    = scond_new();
+
+   if (!thr->queue || !thr->chunk || !thr->scratch || !thr->lock
+         || !thr->work_cond || !thr->space_cond
+         || !block_samples || !max_samples)
+      goto error;
+
+   thr->thread = sthread_create(audio_dsp_thread_loop, thr);
+   if (!thr->thread)
+      goto error;
+
+   return thr;
+
+error:
+   audio_dsp_thread_free(thr);
+   return NULL;
+}
+
+void audio_dsp_thread_free(audio_dsp_thread_t *thr)
+{
+   if (!thr)
+      return;
+
+   if (thr->thread)
+   {
+      slock_lock(thr->lock);
+      thr->alive = false;
+      scond_signal(thr->work_cond);
+      slock_unlock(thr->lock);
+
+      sthread_join(thr->thread);
+   }
+
+   if (thr->lock)
+      slock_free(thr->lock);
+   if (thr->work_cond)
+      scond_free(thr->work_cond);
+   if (thr->space_cond)
+      scond_free(thr->space_cond);
+
+   spsc_free(thr->queue);
+   free(thr->chunk);
+   free(thr->scratch);
+   free(thr);
+}
+
+/* Room for whole frames, counting only up to limit samples. */
+static size_t audio_dsp_thread_space(audio_dsp_thread_t *thr, size_t limit)
+{
+   size_t queued = thr->queue_samples -
+      spsc_write_avail(thr->queue) / sizeof(float);
+   return queued < limit ? (limit - queued) & ~(size_t)1 : 0;
+}
+
+bool audio_dsp_thread_push(audio_dsp_thread_t *thr,
+      const float *data, size_t samples, bool block)
+{
+   bool failed  = false;
+   /* Whatever sits in the queue is latency added on top of the
+    * driver's own buffer. When blocking the driver paces us anyway,
+    * so there's no point in running further ahead than block_samples. */
+   size_t limit = block ? thr->block_samples : thr->queue_samples;
+
+   while (samples)
+   {
+      size_t avail = audio_dsp_thread_space(thr, limit);
+
+      if (!avail)
+      {
+         if (!block)
+            break;
+
+         /* The worker signals after every chunk, so rechecking
+          * under the lock can't miss the wakeup. */
+         slock_lock(thr->lock);
+         while (!audio_dsp_thread_space(thr, limit))
+            scond_wait(thr->space_cond, thr->lock);
+         slock_unlock(thr->lock);
+         continue;
+      }
+
+      if (avail > samples)
+         avail = samples;
+
+      spsc_write(thr->queue, data, avail * sizeof(float));
+      data    += avail;
+      samples -= avail;
+
+      slock_lock(thr->lock);
+      failed = thr->failed;
+      scond_signal(thr->work_cond);
+      slock_unlock(thr->lock);
+   }
+
+   return !failed;
+}
+
+void audio_dsp_thread_flush(audio_dsp_thread_t *thr)
+{
+   if (!thr)
+      return;
+
+   slock_lock(thr->lock);
+   while (thr->busy ||
+         spsc_write_avail(thr->queue) / sizeof(float) != thr->queue_samples)
+      scond_wait(thr->space_cond, thr->lock);
+   slock_unlock(thr->lock);
+}
@@ -0,0 +1,61 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RARCH_AUDIO_DSP_THREAD_H__
+#define RARCH_AUDIO_DSP_THREAD_H__
+
+#include <boolean.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Runs the back half of the audio path (DSP, resampler, driver
+ * write) on its own thread. The emulation thread hands over
+ * interleaved stereo float samples through a bounded SPSC queue
+ * of queue_samples. Blocking pushes only fill it up to
+ * block_samples, which bounds the latency the thread adds.
+ *
+ * process() is called on the worker with at most max_samples
+ * samples, which it may modify in place, plus a scratch area of scratch_size bytes that only
+ * the worker touches. Returning false marks the thread as failed,
+ * which audio_dsp_thread_push() reports from then on. */
+typedef bool (*audio_dsp_thread_process_t)(float *data,
+      size_t samples, void *scratch);
+
+typedef struct audio_dsp_thread audio_dsp_thread_t;
+
+audio_dsp_thread_t *audio_dsp_thread_new(size_t queue_samples,
+      size_t block_samples, size_t max_samples, size_t scratch_size,
+      audio_dsp_thread_process_t process);
+
+void audio_dsp_thread_free(audio_dsp_thread_t *thr);
+
+/* Queues samples for the worker. If block is set, waits for the
+ * worker to make room, otherwise drops whatever does not fit. */
+bool audio_dsp_thread_push(audio_dsp_thread_t *thr,
+      const float *data, size_t samples, bool block);
+
+/* Waits until the worker has written out everything queued.
+ * Call before touching the audio driver, DSP or resampler
+ * from the emulation thread. */
+void audio_dsp_thread_flush(audio_dsp_thread_t *thr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
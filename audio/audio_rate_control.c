@@ -0,0 +1,50 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include "audio_rate_control.h"
+
+double audio_rate_control_update(audio_rate_control_t *rc,
+      double delta, bool integral, bool hold,
+      size_t avail, size_t size, double half_time, double dt)
+{
+   double half_size = size / 2;
+   double direction = ((double)avail - half_size) / half_size;
+   double tau, drift;
+
+   if (!integral || delta <= 0.0 || half_time <= 0.0)
+      return 1.0 + delta * direction;
+
+   /* With a ratio off by delta, the buffer drains from half full in
+    * half_time / delta, which is the time constant of the
+    * proportional loop. */
+   tau = half_time / delta;
+
+   /* Drivers which only report whole periods make avail jump
+    * around. Smooth that out well inside the loop bandwidth. */
+   rc->error += (direction - rc->error) * dt / (dt + tau / 8.0);
+
+   if (!hold)
+   {
+      drift = rc->drift + delta * rc->error * dt / (4.0 * tau);
+
+      if (drift > delta)
+         drift = delta;
+      else if (drift < -delta)
+         drift = -delta;
+      rc->drift = drift;
+   }
+
+   return 1.0 + delta * rc->error + rc->drift;
+}
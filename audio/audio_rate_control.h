@@ -0,0 +1,60 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef RARCH_AUDIO_RATE_CONTROL_H__
+#define RARCH_AUDIO_RATE_CONTROL_H__
+
+#include <boolean.h>
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Dynamic rate control. The driver buffer works as the phase
+ * detector of a PLL, with the resampling ratio as its oscillator.
+ * The proportional term is what we've always had. The integral
+ * term slowly soaks up the constant part of the mismatch between
+ * emulated and real audio clock, so the buffer settles at half full
+ * instead of wherever the proportional term balances that drift out.
+ *
+ * Zero-initialize, and again whenever the nominal ratio changes. */
+typedef struct audio_rate_control
+{
+   /* Low-passed buffer error. -1 is full, 1 is empty. */
+   double error;
+   /* Integral term, relative to the nominal ratio. */
+   double drift;
+} audio_rate_control_t;
+
+/* One controller step, run before every resampler call.
+ *
+ * avail and size are the driver's write_avail() and buffer_size(),
+ * half_time is how many seconds of audio half of the buffer holds,
+ * and dt how many seconds of audio this step covers. hold freezes
+ * the drift estimate, for while the buffer is being drained or
+ * flooded on purpose. Without integral this is the old purely
+ * proportional controller.
+ *
+ * Returns the factor to apply to the nominal resampling ratio. */
+double audio_rate_control_update(audio_rate_control_t *rc,
+      double delta, bool integral, bool hold,
+      size_t avail, size_t size, double half_time, double dt);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
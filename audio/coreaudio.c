@@ -17,7 +17,7 @@
 
 #include "../driver.h"
 #include "../general.h"
-#include "../fifo_buffer.h"
+#include "../spsc_buffer.h"
 #include <stdlib.h>
 #include <boolean.h>
 #include <pthread.h>
@@ -45,7 +45,7 @@ typedef struct coreaudio
    bool dev_alive;
    bool is_paused;
 
-   fifo_buffer_t *buffer;
+   spsc_buffer_t *buffer;
    bool nonblock;
    size_t buffer_size;
 } coreaudio_t;
@@ -69,7 +69,7 @@ static void coreaudio_free(void *data)
    }
 
    if (dev->buffer)
-      fifo_free(dev->buffer);
+      spsc_free(dev->buffer);
 
    pthread_mutex_destroy(&dev->lock);
    pthread_cond_destroy(&dev->cond);
@@ -95,24 +95,22 @@ static OSStatus audio_write_cb(void *userdata,
    unsigned write_avail = io_data->mBuffers[0].mDataByteSize;
    void *outbuf = io_data->mBuffers[0].mData;
 
-   pthread_mutex_lock(&dev->lock);
-   if (fifo_read_avail(dev->buffer) < write_avail)
+   if (spsc_read_avail(dev->buffer) < write_avail)
    {
       *action_flags = kAudioUnitRenderAction_OutputIsSilence;
 
       /* Seems to be needed. */
       memset(outbuf, 0, write_avail);
-
-      pthread_mutex_unlock(&dev->lock);
-
-      /* Technically possible to deadlock without. */
-      pthread_cond_signal(&dev->cond); 
-      return noErr;
    }
+   else
+      spsc_read(dev->buffer, outbuf, write_avail);
 
-   fifo_read(dev->buffer, outbuf, write_avail);
-   pthread_mutex_unlock(&dev->lock);
+   /* The ring needs no lock. Taking it for the signal only makes
+    * sure a writer that just found the ring full doesn't miss it.
+    * Technically possible to deadlock without the signal. */
+   pthread_mutex_lock(&dev->lock);
    pthread_cond_signal(&dev->cond);
+   pthread_mutex_unlock(&dev->lock);
    return noErr;
 }
 
@@ -296,7 +294,7 @@ static void *coreaudio_init(const char *device,
    fifo_size *= 2 * sizeof(float);
    dev->buffer_size = fifo_size;
 
-   dev->buffer = fifo_new(fifo_size);
+   dev->buffer = spsc_new(fifo_size);
    if (!dev->buffer)
       goto error;
 
@@ -333,29 +331,28 @@ static ssize_t coreaudio_write(void *data, const void *buf_, size_t size)
 
    while (!g_interrupted && size > 0)
    {
-      pthread_mutex_lock(&dev->lock);
-
-      size_t write_avail = fifo_write_avail(dev->buffer);
+      size_t write_avail = spsc_write_avail(dev->buffer);
       if (write_avail > size)
          write_avail = size;
 
-      fifo_write(dev->buffer, buf, write_avail);
+      spsc_write(dev->buffer, buf, write_avail);
       buf += write_avail;
       written += write_avail;
       size -= write_avail;
 
       if (dev->nonblock)
-      {
-         pthread_mutex_unlock(&dev->lock);
          break;
-      }
 
+      if (write_avail != 0)
+         continue;
+
+      pthread_mutex_lock(&dev->lock);
 #ifdef IOS
-      if (write_avail == 0 && pthread_cond_timedwait(
+      if (spsc_write_avail(dev->buffer) == 0 && pthread_cond_timedwait(
                &dev->cond, &dev->lock, &timeout) == ETIMEDOUT)
          g_interrupted = true;
 #else
-      if (write_avail == 0)
+      if (spsc_write_avail(dev->buffer) == 0)
          pthread_cond_wait(&dev->cond, &dev->lock);
 #endif
       pthread_mutex_unlock(&dev->lock);
@@ -402,10 +399,7 @@ static bool coreaudio_use_float(void *data)
 static size_t coreaudio_write_avail(void *data)
 {
    coreaudio_t *dev = (coreaudio_t*)data;
-   pthread_mutex_lock(&dev->lock);
-   size_t avail = fifo_write_avail(dev->buffer);
-   pthread_mutex_unlock(&dev->lock);
-   return avail;
+   return spsc_write_avail(dev->buffer);
 }
 
 static size_t coreaudio_buffer_size(void *data)
@@ -414,6 +408,20 @@ static size_t coreaudio_buffer_size(void *data)
    return dev->buffer_size;
 }
 
+static size_t coreaudio_write_acquire(void *data,
+      audio_write_region_t *region)
+{
+   coreaudio_t *dev = (coreaudio_t*)data;
+   return spsc_write_acquire(dev->buffer, &region->chunk1, &region->size1,
+         &region->chunk2, &region->size2);
+}
+
+static void coreaudio_write_commit(void *data, size_t size)
+{
+   coreaudio_t *dev = (coreaudio_t*)data;
+   spsc_write_commit(dev->buffer, size);
+}
+
 audio_driver_t audio_coreaudio = {
    coreaudio_init,
    coreaudio_write,
@@ -426,4 +434,6 @@ audio_driver_t audio_coreaudio = {
    "coreaudio",
    coreaudio_write_avail,
    coreaudio_buffer_size,
+   coreaudio_write_acquire,
+   coreaudio_write_commit,
 };
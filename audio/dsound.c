@@ -52,7 +52,7 @@ static DSMIXBINS dsmb;
 #include <mmsystem.h>
 #endif
 #include <dsound.h>
-#include "../fifo_buffer.h"
+#include "../spsc_buffer.h"
 #include "../general.h"
 
 typedef struct dsound
@@ -60,8 +60,7 @@ typedef struct dsound
    LPDIRECTSOUND ds;
    LPDIRECTSOUNDBUFFER dsb;
 
-   fifo_buffer_t *buffer;
-   CRITICAL_SECTION crit;
+   spsc_buffer_t *buffer;
 
    HANDLE event;
    HANDLE thread;
@@ -157,9 +156,7 @@ static DWORD CALLBACK dsound_thread(PVOID data)
       
       DWORD avail = write_avail(read_ptr, write_ptr, ds->buffer_size);
 
-      EnterCriticalSection(&ds->crit);
-      DWORD fifo_avail = fifo_read_avail(ds->buffer);
-      LeaveCriticalSection(&ds->crit);
+      DWORD fifo_avail = spsc_read_avail(ds->buffer);
 
       // No space to write, or we don't have data in our fifo, but we can wait some time before it underruns ...
       if (avail < CHUNK_SIZE || ((fifo_avail < CHUNK_SIZE) && (avail < ds->buffer_size / 2)))
@@ -194,12 +191,10 @@ static DWORD CALLBACK dsound_thread(PVOID data)
             break;
          }
 
-         EnterCriticalSection(&ds->crit);
          if (region.chunk1)
-            fifo_read(ds->buffer, region.chunk1, region.size1);
+            spsc_read(ds->buffer, region.chunk1, region.size1);
          if (region.chunk2)
-            fifo_read(ds->buffer, region.chunk2, region.size2);
-         LeaveCriticalSection(&ds->crit);
+            spsc_read(ds->buffer, region.chunk2, region.size2);
 
          release_region(ds, &region);
          write_ptr = (write_ptr + region.size1 + region.size2) % ds->buffer_size;
@@ -260,8 +255,6 @@ static void dsound_free(void *data)
          CloseHandle(ds->thread);
       }
 
-      DeleteCriticalSection(&ds->crit);
-
       if (ds->dsb)
       {
          IDirectSoundBuffer_Stop(ds->dsb);
@@ -275,7 +268,7 @@ static void dsound_free(void *data)
          CloseHandle(ds->event);
 
       if (ds->buffer)
-         fifo_free(ds->buffer);
+         spsc_free(ds->buffer);
 
       free(ds);
    }
@@ -308,8 +301,6 @@ static void *dsound_init(const char *device, unsigned rate, unsigned latency)
    if (!ds)
       goto error;
 
-   InitializeCriticalSection(&ds->crit);
-
    if (device)
       dev.device = strtoul(device, NULL, 0);
 
@@ -355,7 +346,7 @@ static void *dsound_init(const char *device, unsigned rate, unsigned latency)
    if (!ds->event)
       goto error;
 
-   ds->buffer = fifo_new(4 * 1024);
+   ds->buffer = spsc_new(4 * 1024);
    if (!ds->buffer)
       goto error;
 
@@ -426,13 +417,11 @@ static ssize_t dsound_write(void *data, const void *buf_, size_t size)
    size_t written = 0;
    while (size > 0)
    {
-      EnterCriticalSection(&ds->crit);
-      size_t avail = fifo_write_avail(ds->buffer);
+      size_t avail = spsc_write_avail(ds->buffer);
       if (avail > size)
          avail = size;
 
-      fifo_write(ds->buffer, buf, avail);
-      LeaveCriticalSection(&ds->crit);
+      spsc_write(ds->buffer, buf, avail);
 
       buf += avail;
       size -= avail;
@@ -451,10 +440,7 @@ static ssize_t dsound_write(void *data, const void *buf_, size_t size)
 static size_t dsound_write_avail(void *data)
 {
    dsound_t *ds = (dsound_t*)data;
-   EnterCriticalSection(&ds->crit);
-   size_t avail = fifo_write_avail(ds->buffer);
-   LeaveCriticalSection(&ds->crit);
-   return avail;
+   return spsc_write_avail(ds->buffer);
 }
 
 static size_t dsound_buffer_size(void *data)
@@ -468,6 +454,22 @@ static bool dsound_use_float(void *data)
    return false;
 }
 
+static size_t dsound_write_acquire(void *data, audio_write_region_t *region)
+{
+   dsound_t *ds = (dsound_t*)data;
+
+   if (!ds->thread_alive)
+      return 0;
+   return spsc_write_acquire(ds->buffer, &region->chunk1, &region->size1,
+         &region->chunk2, &region->size2);
+}
+
+static void dsound_write_commit(void *data, size_t size)
+{
+   dsound_t *ds = (dsound_t*)data;
+   spsc_write_commit(ds->buffer, size);
+}
+
 audio_driver_t audio_dsound = {
    dsound_init,
    dsound_write,
@@ -480,4 +482,6 @@ audio_driver_t audio_dsound = {
    "dsound",
    dsound_write_avail,
    dsound_buffer_size,
+   dsound_write_acquire,
+   dsound_write_commit,
 };
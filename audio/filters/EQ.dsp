@@ -7,11 +7,17 @@ filter0 = eq
 # Lower values will allow better frequency resolution, but more ripple.
 # eq_window_beta = 4.0
 
-# The block size on which FFT is done.
-# Too high value requires more processing as well as longer latency but
-# allows finer-grained control over the spectrum.
+# The length of the filter.
+# Higher values allow finer-grained control over the spectrum,
+# at the cost of more processing.
 # eq_block_size_log2 = 8
 
+# The block size on which FFT is done. The filter is split into partitions
+# of this size, so this, not the filter length, sets the latency.
+# Smaller partitions lower latency but cost more processing for long filters.
+# Defaults to eq_block_size_log2, but at most 8. Can't exceed 11.
+# eq_partition_size_log2 = 8
+
 # An array of which frequencies to control.
 # You can create an arbitrary amount of these sampling points.
 # The EQ will try to create a frequency response which fits well to these points.
@@ -91,6 +91,155 @@ static void echo_process(void *data, struct dspfilter_output *output,
    }
 }
 
+/* SIMD versions. Within a stretch where no delay line wraps around,
+ * every frame reads and then overwrites its own slot in each line,
+ * so frames are independent and two of them fit in a register. */
+#if __SSE2__
+#include <emmintrin.h>
+
+static void echo_process_sse2(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i, c;
+   struct echo_data *echo = (struct echo_data*)data;
+
+   output->samples = input->samples;
+   output->frames  = input->frames;
+
+   float *out      = output->samples;
+   unsigned frames = input->frames;
+   __m128 amp      = _mm_set1_ps(echo->amp);
+
+   while (frames)
+   {
+      unsigned n = frames;
+      for (c = 0; c < echo->num_channels; c++)
+         n = min(n, echo->channels[c].frames - echo->channels[c].ptr);
+
+      for (i = 0; i + 2 <= n; i += 2)
+      {
+         __m128 in = _mm_loadu_ps(out + (i << 1));
+         __m128 e  = _mm_setzero_ps();
+
+         for (c = 0; c < echo->num_channels; c++)
+            e = _mm_add_ps(e, _mm_loadu_ps(echo->channels[c].buffer +
+                     ((echo->channels[c].ptr + i) << 1)));
+         e = _mm_mul_ps(e, amp);
+
+         for (c = 0; c < echo->num_channels; c++)
+            _mm_storeu_ps(echo->channels[c].buffer +
+                  ((echo->channels[c].ptr + i) << 1),
+                  _mm_add_ps(in, _mm_mul_ps(
+                        _mm_set1_ps(echo->channels[c].feedback), e)));
+
+         _mm_storeu_ps(out + (i << 1), _mm_add_ps(in, e));
+      }
+
+      for (; i < n; i++)
+      {
+         __m128 in = _mm_loadl_pi(_mm_setzero_ps(), (const __m64*)(out + (i << 1)));
+         __m128 e  = _mm_setzero_ps();
+
+         for (c = 0; c < echo->num_channels; c++)
+            e = _mm_add_ps(e, _mm_loadl_pi(_mm_setzero_ps(),
+                     (const __m64*)(echo->channels[c].buffer +
+                        ((echo->channels[c].ptr + i) << 1))));
+         e = _mm_mul_ps(e, amp);
+
+         for (c = 0; c < echo->num_channels; c++)
+            _mm_storel_pi((__m64*)(echo->channels[c].buffer +
+                     ((echo->channels[c].ptr + i) << 1)),
+                  _mm_add_ps(in, _mm_mul_ps(
+                        _mm_set1_ps(echo->channels[c].feedback), e)));
+
+         _mm_storel_pi((__m64*)(out + (i << 1)), _mm_add_ps(in, e));
+      }
+
+      for (c = 0; c < echo->num_channels; c++)
+      {
+         echo->channels[c].ptr += n;
+         if (echo->channels[c].ptr == echo->channels[c].frames)
+            echo->channels[c].ptr = 0;
+      }
+
+      out    += n << 1;
+      frames -= n;
+   }
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__)
+#define HAVE_ECHO_NEON
+#include <arm_neon.h>
+
+static void echo_process_neon(void *data, struct dspfilter_output *output,
+      const struct dspfilter_input *input)
+{
+   unsigned i, c;
+   struct echo_data *echo = (struct echo_data*)data;
+
+   output->samples = input->samples;
+   output->frames  = input->frames;
+
+   float *out      = output->samples;
+   unsigned frames = input->frames;
+   float32x4_t amp = vdupq_n_f32(echo->amp);
+
+   while (frames)
+   {
+      unsigned n = frames;
+      for (c = 0; c < echo->num_channels; c++)
+         n = min(n, echo->channels[c].frames - echo->channels[c].ptr);
+
+      for (i = 0; i + 2 <= n; i += 2)
+      {
+         float32x4_t in = vld1q_f32(out + (i << 1));
+         float32x4_t e  = vdupq_n_f32(0.0f);
+
+         for (c = 0; c < echo->num_channels; c++)
+            e = vaddq_f32(e, vld1q_f32(echo->channels[c].buffer +
+                     ((echo->channels[c].ptr + i) << 1)));
+         e = vmulq_f32(e, amp);
+
+         for (c = 0; c < echo->num_channels; c++)
+            vst1q_f32(echo->channels[c].buffer +
+                  ((echo->channels[c].ptr + i) << 1),
+                  vaddq_f32(in, vmulq_n_f32(e, echo->channels[c].feedback)));
+
+         vst1q_f32(out + (i << 1), vaddq_f32(in, e));
+      }
+
+      for (; i < n; i++)
+      {
+         float32x2_t in = vld1_f32(out + (i << 1));
+         float32x2_t e  = vdup_n_f32(0.0f);
+
+         for (c = 0; c < echo->num_channels; c++)
+            e = vadd_f32(e, vld1_f32(echo->channels[c].buffer +
+                     ((echo->channels[c].ptr + i) << 1)));
+         e = vmul_f32(e, vget_low_f32(amp));
+
+         for (c = 0; c < echo->num_channels; c++)
+            vst1_f32(echo->channels[c].buffer +
+                  ((echo->channels[c].ptr + i) << 1),
+                  vadd_f32(in, vmul_n_f32(e, echo->channels[c].feedback)));
+
+         vst1_f32(out + (i << 1), vadd_f32(in, e));
+      }
+
+      for (c = 0; c < echo->num_channels; c++)
+      {
+         echo->channels[c].ptr += n;
+         if (echo->channels[c].ptr == echo->channels[c].frames)
+            echo->channels[c].ptr = 0;
+      }
+
+      out    += n << 1;
+      frames -= n;
+   }
+}
+#endif
+
 static void *echo_init(const struct dspfilter_info *info,
       const struct dspfilter_config *config, void *userdata)
 {
@@ -153,15 +302,46 @@ static const struct dspfilter_implementation echo_plug = {
    "echo",
 };
 
+#if __SSE2__
+static const struct dspfilter_implementation echo_plug_sse2 = {
+   echo_init,
+   echo_process_sse2,
+   echo_free,
+
+   DSPFILTER_API_VERSION,
+   "Multi-Echo (SSE2)",
+   "echo",
+};
+#endif
+
+#ifdef HAVE_ECHO_NEON
+static const struct dspfilter_implementation echo_plug_neon = {
+   echo_init,
+   echo_process_neon,
+   echo_free,
+
+   DSPFILTER_API_VERSION,
+   "Multi-Echo (NEON)",
+   "echo",
+};
+#endif
+
 #ifdef HAVE_FILTERS_BUILTIN
 #define dspfilter_get_implementation echo_dspfilter_get_implementation
 #endif
 
 const struct dspfilter_implementation *dspfilter_get_implementation(dspfilter_simd_mask_t mask)
 {
+#if __SSE2__
+   if (mask & DSPFILTER_SIMD_SSE2)
+      return &echo_plug_sse2;
+#endif
+#ifdef HAVE_ECHO_NEON
+   if (mask & DSPFILTER_SIMD_NEON)
+      return &echo_plug_neon;
+#endif
    (void)mask;
    return &echo_plug;
 }
 
 #undef dspfilter_get_implementation
-
@@ -28,17 +28,31 @@
 #define min(a, b) ((a) < (b) ? (a) : (b))
 #endif
 
+/* Uniformly partitioned overlap-save convolution. The filter is
+ * split into partitions of block_size taps, each transformed once
+ * at init. Every block_size frames of input, the last two blocks
+ * are transformed and pushed into a delay line of spectra, and the
+ * output block is the inverse of sum(filter[p] * spectra[now - p]).
+ * Latency is one partition rather than the whole filter, and cost
+ * per sample grows linearly with filter length.
+ *
+ * The filter is real, so left and right ride through the same
+ * complex FFT as real and imaginary parts. Interleaved stereo
+ * already has that layout. */
 struct eq_data
 {
    fft_t *fft;
    float buffer[8 * 1024];
 
-   float *save;
-   float *block;
-   fft_complex_t *filter;
-   fft_complex_t *fftblock;
+   fft_complex_t *block;    /* Previous and current block, 2 * block_size frames. */
+   fft_complex_t *filter;   /* partitions spectra of 2 * block_size bins. */
+   fft_complex_t *fdl;      /* Frequency-domain delay line, same layout. */
+   fft_complex_t *accum;
+   fft_complex_t *time;
    unsigned block_size;
    unsigned block_ptr;
+   unsigned partitions;
+   unsigned fdl_ptr;
 };
 
 struct eq_gain
@@ -54,10 +68,11 @@ static void eq_free(void *data)
       return;
 
    fft_free(eq->fft);
-   free(eq->save);
    free(eq->block);
-   free(eq->fftblock);
    free(eq->filter);
+   free(eq->fdl);
+   free(eq->accum);
+   free(eq->time);
    free(eq);
 }
 
@@ -72,6 +87,7 @@ static void eq_process(void *data, struct dspfilter_output *output,
    float *out = eq->buffer;
    const float *in = input->samples;
    unsigned input_frames = input->frames;
+   unsigned bins = 2 * eq->block_size;
 
    while (input_frames)
    {
@@ -79,7 +95,8 @@ static void eq_process(void *data, struct dspfilter_output *output,
       if (input_frames < write_avail)
          write_avail = input_frames;
 
-      memcpy(eq->block + eq->block_ptr * 2, in, write_avail * 2 * sizeof(float));
+      memcpy(eq->block + eq->block_size + eq->block_ptr, in,
+            write_avail * 2 * sizeof(float));
 
       in += write_avail * 2;
       input_frames -= write_avail;
@@ -88,22 +105,29 @@ static void eq_process(void *data, struct dspfilter_output *output,
       // Convolve a new block.
       if (eq->block_ptr == eq->block_size)
       {
-         unsigned i, c;
+         unsigned p;
+         fft_complex_t *spectrum = eq->fdl + eq->fdl_ptr * bins;
+
+         fft_process_forward_complex(eq->fft, spectrum, eq->block, 1);
 
-         for (c = 0; c < 2; c++)
+         memset(eq->accum, 0, bins * sizeof(*eq->accum));
+         for (p = 0; p < eq->partitions; p++)
          {
-            fft_process_forward(eq->fft, eq->fftblock, eq->block + c, 2);
-            for (i = 0; i < 2 * eq->block_size; i++)
-               eq->fftblock[i] = fft_complex_mul(eq->fftblock[i], eq->filter[i]);
-            fft_process_inverse(eq->fft, out + c, eq->fftblock, 2);
+            unsigned index = (eq->fdl_ptr + eq->partitions - p) % eq->partitions;
+            fft_complex_mul_accumulate(eq->accum, eq->filter + p * bins,
+                  eq->fdl + index * bins, bins);
          }
 
-         // Overlap add method, so add in saved block now.
-         for (i = 0; i < 2 * eq->block_size; i++)
-            out[i] += eq->save[i];
+         fft_process_inverse_complex(eq->fft, eq->time, eq->accum, 1);
+
+         // Overlap save, the first half wrapped around and is thrown away.
+         memcpy(out, eq->time + eq->block_size,
+               eq->block_size * sizeof(fft_complex_t));
+         memcpy(eq->block, eq->block + eq->block_size,
+               eq->block_size * sizeof(fft_complex_t));
 
-         // Save block for later.
-         memcpy(eq->save, out + 2 * eq->block_size, 2 * eq->block_size * sizeof(float));
+         if (++eq->fdl_ptr == eq->partitions)
+            eq->fdl_ptr = 0;
 
          out += eq->block_size * 2;
          output->frames += eq->block_size;
@@ -220,22 +244,26 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
       struct eq_gain *gains, unsigned num_gains, double beta, const char *filter_path)
 {
    int i;
-   int half_block_size = eq->block_size >> 1;
+   unsigned p;
+   int filter_size = 1 << size_log2;
+   int half_block_size = filter_size >> 1;
    double window_mod = 1.0 / kaiser_window(0.0, beta);
 
    fft_t *fft = fft_new(size_log2);
-   float *time_filter = (float*)calloc(eq->block_size * 2 + 1, sizeof(*time_filter));
-   if (!fft || !time_filter)
+   fft_complex_t *response = (fft_complex_t*)calloc(filter_size + 1, sizeof(*response));
+   float *time_filter = (float*)calloc(filter_size * 2 + 1, sizeof(*time_filter));
+   float *partition = (float*)calloc(eq->block_size * 2, sizeof(*partition));
+   if (!fft || !response || !time_filter || !partition)
       goto end;
 
    // Make sure bands are in correct order.
    qsort(gains, num_gains, sizeof(*gains), gains_cmp);
 
    // Compute desired filter response.
-   generate_response(eq->filter, gains, num_gains, half_block_size);
+   generate_response(response, gains, num_gains, half_block_size);
 
    // Get equivalent time-domain filter.
-   fft_process_inverse(fft, time_filter, eq->filter, 1);
+   fft_process_inverse(fft, time_filter, response, 1);
 
    // ifftshift() to create the correct linear phase filter.
    // The filter response was designed with zero phase, which won't work unless we compensate
@@ -248,10 +276,10 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
    }
 
    // Apply a window to smooth out the frequency repsonse.
-   for (i = 0; i < (int)eq->block_size; i++)
+   for (i = 0; i < filter_size; i++)
    {
       // Kaiser window.
-      double phase = (double)i / eq->block_size;
+      double phase = (double)i / filter_size;
       phase = 2.0 * (phase - 0.5);
       time_filter[i] *= window_mod * kaiser_window(phase, beta);
    }
@@ -262,20 +290,33 @@ static void create_filter(struct eq_data *eq, unsigned size_log2,
       FILE *file = fopen(filter_path, "w");
       if (file)
       {
-         for (i = 0; i < (int)eq->block_size - 1; i++)
+         for (i = 0; i < filter_size - 1; i++)
             fprintf(file, "%.8f\n", time_filter[i + 1]);
          fclose(file);
       }
    }
 
-   // Padded FFT to create our FFT filter.
+   // Padded FFT of every partition to create our FFT filter.
    // Make our even-length filter odd by discarding the first coefficient.
    // For some interesting reason, this allows us to design an odd-length linear phase filter.
-   fft_process_forward(eq->fft, eq->filter, time_filter + 1, 1);
+   for (p = 0; p < eq->partitions; p++)
+   {
+      unsigned taps = filter_size - p * eq->block_size;
+      if (taps > eq->block_size)
+         taps = eq->block_size;
+
+      memset(partition, 0, eq->block_size * 2 * sizeof(*partition));
+      memcpy(partition, time_filter + 1 + p * eq->block_size,
+            taps * sizeof(*partition));
+      fft_process_forward(eq->fft, eq->filter + p * 2 * eq->block_size,
+            partition, 1);
+   }
 
 end:
    fft_free(fft);
+   free(response);
    free(time_filter);
+   free(partition);
 }
 
 static void *eq_init(const struct dspfilter_info *info,
@@ -294,7 +335,18 @@ static void *eq_init(const struct dspfilter_info *info,
 
    int size_log2;
    config->get_int(userdata, "block_size_log2", &size_log2, 8);
-   unsigned size = 1 << size_log2;
+
+   // Long filters don't have to mean long latency.
+   int partition_log2;
+   config->get_int(userdata, "partition_size_log2", &partition_log2, min(size_log2, 8));
+   if (partition_log2 > size_log2)
+      partition_log2 = size_log2;
+   // A block of output has to fit in eq->buffer.
+   if (partition_log2 > 11)
+      partition_log2 = 11;
+   if (partition_log2 < 2)
+      partition_log2 = 2;
+   unsigned size = 1 << partition_log2;
 
    struct eq_gain *gains = NULL;
    float *frequencies, *gain;
@@ -324,17 +376,20 @@ static void *eq_init(const struct dspfilter_info *info,
    config->free(gain);
 
    eq->block_size = size;
+   eq->partitions = ((1u << size_log2) + size - 1) / size;
 
-   eq->save     = (float*)calloc(    size, 2 * sizeof(*eq->save));
-   eq->block    = (float*)calloc(2 * size, 2 * sizeof(*eq->block));
-   eq->fftblock = (fft_complex_t*)calloc(2 * size, sizeof(*eq->fftblock));
-   eq->filter   = (fft_complex_t*)calloc(2 * size, sizeof(*eq->filter));
+   eq->block    = (fft_complex_t*)calloc(2 * size, sizeof(*eq->block));
+   eq->filter   = (fft_complex_t*)calloc(2 * size * eq->partitions, sizeof(*eq->filter));
+   eq->fdl      = (fft_complex_t*)calloc(2 * size * eq->partitions, sizeof(*eq->fdl));
+   eq->accum    = (fft_complex_t*)calloc(2 * size, sizeof(*eq->accum));
+   eq->time     = (fft_complex_t*)calloc(2 * size, sizeof(*eq->time));
 
-   // Use an FFT which is twice the block size with zero-padding
+   // Use an FFT which is twice the partition size with zero-padding
    // to make circular convolution => proper convolution.
-   eq->fft = fft_new(size_log2 + 1);
+   eq->fft = fft_new(partition_log2 + 1);
 
-   if (!eq->fft || !eq->fftblock || !eq->save || !eq->block || !eq->filter)
+   if (!eq->fft || !eq->block || !eq->filter || !eq->fdl
+         || !eq->accum || !eq->time)
       goto error;
 
    create_filter(eq, size_log2, gains, num_gain, beta, filter_path);
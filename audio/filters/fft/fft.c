@@ -17,6 +17,10 @@
 #include <math.h>
 #include <stdlib.h>
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
 #ifndef M_PI
 #define M_PI 3.1415926535897932384626433832795
 #endif
@@ -24,9 +28,10 @@
 struct fft
 {
    fft_complex_t *interleave_buffer;
-   fft_complex_t *phase_lut;
+   fft_complex_t *twiddles;
    unsigned *bitinverse_buffer;
    unsigned size;
+   unsigned size_log2;
 };
 
 static unsigned bitswap(unsigned x, unsigned size_log2)
@@ -52,12 +57,41 @@ static fft_complex_t exp_imag(double phase)
    return out;
 }
 
-static void build_phase_lut(fft_complex_t *out, int size)
+/* Butterflies run as radix-4 passes, each doing the work of two
+ * radix-2 stages in one sweep over the data. An odd log2 size
+ * starts with a single radix-2 stage, which needs no twiddles.
+ *
+ * Input is still in radix-2 bit-reversed order, so a pass over
+ * four DFTs D0..D3 of size s computes
+ *    X[k] = D0[k] + W^2k D1[k] + W^k D2[k] + W^3k D3[k]
+ * with W = exp(-2 pi i / 4s). For every pass, the forward twiddles
+ * W^2k, W^k and W^3k are stored as three runs of s values so the
+ * SIMD path can load them without gathers. Inverse uses conjugates. */
+static unsigned twiddle_count(unsigned size_log2)
 {
-   int i;
-   out += size;
-   for (i = -size; i <= size; i++)
-      out[i] = exp_imag((M_PI * i) / size);
+   unsigned step_size;
+   unsigned count = 0;
+   for (step_size = (size_log2 & 1) ? 2 : 1;
+         (step_size << 2) <= (1u << size_log2); step_size <<= 2)
+      count += 3 * step_size;
+   return count;
+}
+
+static void build_twiddles(fft_complex_t *out, unsigned size_log2)
+{
+   unsigned step_size, k;
+   for (step_size = (size_log2 & 1) ? 2 : 1;
+         (step_size << 2) <= (1u << size_log2); step_size <<= 2)
+   {
+      for (k = 0; k < step_size; k++)
+      {
+         double phase = -M_PI * k / (2.0 * step_size);
+         out[k]                 = exp_imag(2.0 * phase);
+         out[k + step_size]     = exp_imag(phase);
+         out[k + 2 * step_size] = exp_imag(3.0 * phase);
+      }
+      out += 3 * step_size;
+   }
 }
 
 static void interleave_complex(const unsigned *bitinverse,
@@ -90,6 +124,17 @@ static void resolve_float(float *out, const fft_complex_t *in, unsigned samples,
       *out = gain * in->real;
 }
 
+static void resolve_complex(fft_complex_t *out, const fft_complex_t *in,
+      unsigned samples, float gain, unsigned step)
+{
+   unsigned i;
+   for (i = 0; i < samples; i++, in++, out += step)
+   {
+      out->real = gain * in->real;
+      out->imag = gain * in->imag;
+   }
+}
+
 fft_t *fft_new(unsigned block_size_log2)
 {
    fft_t *fft = (fft_t*)calloc(1, sizeof(*fft));
@@ -100,15 +145,17 @@ fft_t *fft_new(unsigned block_size_log2)
 
    fft->interleave_buffer = (fft_complex_t*)calloc(size, sizeof(*fft->interleave_buffer));
    fft->bitinverse_buffer = (unsigned*)calloc(size, sizeof(*fft->bitinverse_buffer));
-   fft->phase_lut         = (fft_complex_t*)calloc(2 * size + 1, sizeof(*fft->phase_lut));
+   fft->twiddles          = (fft_complex_t*)calloc(twiddle_count(block_size_log2) + 1,
+         sizeof(*fft->twiddles));
 
-   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->phase_lut)
+   if (!fft->interleave_buffer || !fft->bitinverse_buffer || !fft->twiddles)
       goto error;
 
-   fft->size = size;
+   fft->size      = size;
+   fft->size_log2 = block_size_log2;
 
    build_bitinverse(fft->bitinverse_buffer, block_size_log2);
-   build_phase_lut(fft->phase_lut, size);
+   build_twiddles(fft->twiddles, block_size_log2);
    return fft;
 
 error:
@@ -123,74 +170,197 @@ void fft_free(fft_t *fft)
 
    free(fft->interleave_buffer);
    free(fft->bitinverse_buffer);
-   free(fft->phase_lut);
+   free(fft->twiddles);
    free(fft);
 }
 
-static void butterfly(fft_complex_t *a, fft_complex_t *b, fft_complex_t mod)
+static void butterflies_radix2(fft_complex_t *buf, unsigned samples)
 {
-   mod = fft_complex_mul(mod, *b);
-   *b = fft_complex_sub(*a, mod);
-   *a = fft_complex_add(*a, mod);
+   unsigned i;
+   for (i = 0; i < samples; i += 2)
+   {
+      fft_complex_t a = buf[i];
+      buf[i]     = fft_complex_add(a, buf[i + 1]);
+      buf[i + 1] = fft_complex_sub(a, buf[i + 1]);
+   }
 }
 
-static void butterflies(fft_complex_t *butterfly_buf,
-      const fft_complex_t *phase_lut,
-      int phase_dir, unsigned step_size, unsigned samples)
+static void butterflies_radix4_C(fft_complex_t *buf,
+      const fft_complex_t *twiddles, int inverse,
+      unsigned step_size, unsigned samples)
 {
-   unsigned i, j;
-   for (i = 0; i < samples; i += step_size << 1)
+   unsigned i, k;
+   for (i = 0; i < samples; i += step_size << 2)
    {
-      int phase_step = (int)samples * phase_dir / (int)step_size;
-      for (j = i; j < i + step_size; j++)
-         butterfly(&butterfly_buf[j], &butterfly_buf[j + step_size], phase_lut[phase_step * (int)(j - i)]);
+      fft_complex_t *a = buf + i;
+      for (k = 0; k < step_size; k++, a++)
+      {
+         fft_complex_t w1 = twiddles[k];
+         fft_complex_t w2 = twiddles[k + step_size];
+         fft_complex_t w3 = twiddles[k + 2 * step_size];
+         fft_complex_t c0, c1, c2, c3, t0, t1, t2, t3, d;
+
+         if (inverse)
+         {
+            w1 = fft_complex_conj(w1);
+            w2 = fft_complex_conj(w2);
+            w3 = fft_complex_conj(w3);
+         }
+
+         c0 = a[0];
+         c1 = fft_complex_mul(w1, a[step_size]);
+         c2 = fft_complex_mul(w2, a[2 * step_size]);
+         c3 = fft_complex_mul(w3, a[3 * step_size]);
+
+         t0 = fft_complex_add(c0, c1);
+         t1 = fft_complex_sub(c0, c1);
+         t2 = fft_complex_add(c2, c3);
+         d  = fft_complex_sub(c2, c3);
+
+         /* W^s is -i going forward, i going back. */
+         t3.real = inverse ? -d.imag :  d.imag;
+         t3.imag = inverse ?  d.real : -d.real;
+
+         a[0]             = fft_complex_add(t0, t2);
+         a[step_size]     = fft_complex_add(t1, t3);
+         a[2 * step_size] = fft_complex_sub(t0, t2);
+         a[3 * step_size] = fft_complex_sub(t1, t3);
+      }
    }
 }
 
-void fft_process_forward_complex(fft_t *fft,
-      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+#if defined(__SSE2__)
+/* Two complex numbers per register, { re0, im0, re1, im1 }. */
+static inline __m128 fft_complex_mul_sse(__m128 a, __m128 w)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_complex(fft->bitinverse_buffer, out, in, samples, step);
+   const __m128 sign_even = _mm_castsi128_ps(
+         _mm_set_epi32(0, 0x80000000, 0, 0x80000000));
+   __m128 w_real = _mm_shuffle_ps(w, w, _MM_SHUFFLE(2, 2, 0, 0));
+   __m128 w_imag = _mm_shuffle_ps(w, w, _MM_SHUFFLE(3, 3, 1, 1));
+   __m128 a_swap = _mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 3, 0, 1));
+
+   return _mm_add_ps(_mm_mul_ps(a, w_real),
+         _mm_xor_ps(_mm_mul_ps(a_swap, w_imag), sign_even));
+}
+
+/* Needs step_size >= 2. */
+static void butterflies_radix4_sse(fft_complex_t *buf,
+      const fft_complex_t *twiddles, int inverse,
+      unsigned step_size, unsigned samples)
+{
+   unsigned i, k;
+   const __m128 sign_even = _mm_castsi128_ps(
+         _mm_set_epi32(0, 0x80000000, 0, 0x80000000));
+   const __m128 sign_odd  = _mm_castsi128_ps(
+         _mm_set_epi32(0x80000000, 0, 0x80000000, 0));
+   /* Conjugates the twiddles for inverse. */
+   const __m128 conj      = inverse ? sign_odd : _mm_setzero_ps();
+   /* Multiplying by -i is { im, -re }, by i it is { -im, re }. */
+   const __m128 rot_sign  = inverse ? sign_even : sign_odd;
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+   for (i = 0; i < samples; i += step_size << 2)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+      float *a = (float*)(buf + i);
+      for (k = 0; k < step_size; k += 2, a += 4)
+      {
+         const float *w = (const float*)(twiddles + k);
+         __m128 w1 = _mm_xor_ps(_mm_loadu_ps(w), conj);
+         __m128 w2 = _mm_xor_ps(_mm_loadu_ps(w + 2 * step_size), conj);
+         __m128 w3 = _mm_xor_ps(_mm_loadu_ps(w + 4 * step_size), conj);
+
+         __m128 c0 = _mm_loadu_ps(a);
+         __m128 c1 = fft_complex_mul_sse(_mm_loadu_ps(a + 2 * step_size), w1);
+         __m128 c2 = fft_complex_mul_sse(_mm_loadu_ps(a + 4 * step_size), w2);
+         __m128 c3 = fft_complex_mul_sse(_mm_loadu_ps(a + 6 * step_size), w3);
+
+         __m128 t0 = _mm_add_ps(c0, c1);
+         __m128 t1 = _mm_sub_ps(c0, c1);
+         __m128 t2 = _mm_add_ps(c2, c3);
+         __m128 d  = _mm_sub_ps(c2, c3);
+         __m128 t3 = _mm_xor_ps(_mm_shuffle_ps(d, d,
+                  _MM_SHUFFLE(2, 3, 0, 1)), rot_sign);
+
+         _mm_storeu_ps(a,                 _mm_add_ps(t0, t2));
+         _mm_storeu_ps(a + 2 * step_size, _mm_add_ps(t1, t3));
+         _mm_storeu_ps(a + 4 * step_size, _mm_sub_ps(t0, t2));
+         _mm_storeu_ps(a + 6 * step_size, _mm_sub_ps(t1, t3));
+      }
    }
 }
+#endif
 
-void fft_process_forward(fft_t *fft,
-      fft_complex_t *out, const float *in, unsigned step)
+static void butterflies(fft_t *fft, fft_complex_t *buf, int inverse)
 {
-   unsigned step_size;
-   unsigned samples = fft->size;
-   interleave_float(fft->bitinverse_buffer, out, in, samples, step);
+   unsigned step_size = 1;
+   unsigned samples   = fft->size;
+   const fft_complex_t *twiddles = fft->twiddles;
 
-   for (step_size = 1; step_size < fft->size; step_size <<= 1)
+   if (fft->size_log2 & 1)
    {
-      butterflies(out,
-            fft->phase_lut + samples,
-            -1, step_size, samples);
+      butterflies_radix2(buf, samples);
+      step_size = 2;
    }
+
+   for (; step_size < samples; step_size <<= 2)
+   {
+#if defined(__SSE2__)
+      if (step_size >= 2)
+         butterflies_radix4_sse(buf, twiddles, inverse, step_size, samples);
+      else
+#endif
+         butterflies_radix4_C(buf, twiddles, inverse, step_size, samples);
+
+      twiddles += 3 * step_size;
+   }
+}
+
+void fft_process_forward_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   interleave_complex(fft->bitinverse_buffer, out, in, fft->size, step);
+   butterflies(fft, out, 0);
+}
+
+void fft_process_forward(fft_t *fft,
+      fft_complex_t *out, const float *in, unsigned step)
+{
+   interleave_float(fft->bitinverse_buffer, out, in, fft->size, step);
+   butterflies(fft, out, 0);
 }
 
 void fft_process_inverse(fft_t *fft,
       float *out, const fft_complex_t *in, unsigned step)
 {
-   unsigned step_size;
    unsigned samples = fft->size;
    interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer, in, samples, 1);
+   butterflies(fft, fft->interleave_buffer, 1);
+   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
 
-   for (step_size = 1; step_size < samples; step_size <<= 1)
+void fft_process_inverse_complex(fft_t *fft,
+      fft_complex_t *out, const fft_complex_t *in, unsigned step)
+{
+   unsigned samples = fft->size;
+   interleave_complex(fft->bitinverse_buffer, fft->interleave_buffer, in, samples, 1);
+   butterflies(fft, fft->interleave_buffer, 1);
+   resolve_complex(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+}
+
+void fft_complex_mul_accumulate(fft_complex_t *out,
+      const fft_complex_t *a, const fft_complex_t *b, unsigned samples)
+{
+   unsigned i = 0;
+
+#if defined(__SSE2__)
+   for (; i + 2 <= samples; i += 2)
    {
-      butterflies(fft->interleave_buffer,
-            fft->phase_lut + samples,
-            1, step_size, samples);
+      __m128 prod = fft_complex_mul_sse(_mm_loadu_ps((const float*)(a + i)),
+            _mm_loadu_ps((const float*)(b + i)));
+      _mm_storeu_ps((float*)(out + i),
+            _mm_add_ps(_mm_loadu_ps((const float*)(out + i)), prod));
    }
+#endif
 
-   resolve_float(out, fft->interleave_buffer, samples, 1.0f / samples, step);
+   for (; i < samples; i++)
+      out[i] = fft_complex_add(out[i], fft_complex_mul(a[i], b[i]));
 }
-
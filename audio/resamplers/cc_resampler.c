@@ -24,10 +24,27 @@
 #if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
 #include "../../general.h"
 #else
+#include <stdio.h>
 /* FIXME - variadic macros not supported for MSVC 2003 */
 #define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
 #endif
 
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/* The AVX path is built with a target attribute so the rest of the
+ * file keeps the baseline ISA, and picked from the SIMD mask. */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_CC_AVX
+#define CC_TARGET_AVX __attribute__((target("avx")))
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define HAVE_CC_AVX
+#define CC_TARGET_AVX
+#endif
+
 
 /* since SSE and NEON don't provide support for trigonometric functions
  * we approximate those with polynoms
@@ -37,7 +54,7 @@
  * setting 0 doesn't use a polynom
  * setting 1 uses P(X) = X - (3/4)*X^3 + (1/4)*X^5
  *
- * only 0 and 1 are implemented for SSE and NEON currently
+ * only 0 and 1 are implemented for SSE, AVX and NEON currently
  *
  * the MIPS_ARCH_ALLEGREX target doesnt require this setting since it has
  * native support for the required functions so it will always use full precision.
@@ -188,11 +205,12 @@ static void resampler_CC_free(void *re_)
 }
 
 static void *resampler_CC_init(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      void *userdata, double bandwidth_mod, resampler_simd_mask_t mask)
 {
    (void)mask;
    (void)bandwidth_mod;
    (void)config;
+   (void)userdata;
 
    __asm__ (
          ".set      push\n"
@@ -211,14 +229,8 @@ static void *resampler_CC_init(const struct resampler_config *config,
 }
 #else
 
-
 #if defined(__SSE__)
-
-#include <xmmintrin.h>
-
-#define CC_RESAMPLER_IDENT "SSE"
-
-static void resampler_CC_downsample(void *re_, struct resampler_data *data)
+static void resampler_CC_downsample_sse(void *re_, struct resampler_data *data)
 {
    __m128 vec_previous, vec_current;
    float ratio, b;
@@ -304,7 +316,7 @@ static void resampler_CC_downsample(void *re_, struct resampler_data *data)
    data->output_frames = outp - (audio_frame_float_t*)data->data_out;
 }
 
-static void resampler_CC_upsample(void *re_, struct resampler_data *data)
+static void resampler_CC_upsample_sse(void *re_, struct resampler_data *data)
 {
    __m128 vec_previous, vec_current;
    float b, ratio;
@@ -387,34 +399,176 @@ static void resampler_CC_upsample(void *re_, struct resampler_data *data)
 
    data->output_frames = outp - (audio_frame_float_t*)data->data_out;
 }
+#endif
+
+#ifdef HAVE_CC_AVX
+/* Same as the SSE versions, but both ends of each tap's kernel,
+ * w + 0.5 in the low half and w - 0.5 in the high half, go
+ * through the polynom together in one 256-bit register. */
+static CC_TARGET_AVX __m128 resampler_CC_kernel_avx(__m256 vec_w, __m256 vec_b)
+{
+   vec_w = _mm256_add_ps(vec_w, _mm256_set_ps(
+            -0.5, -0.5, -0.5, -0.5, 0.5, 0.5, 0.5, 0.5));
+   vec_w = _mm256_mul_ps(vec_w, vec_b);
+
+#if (CC_RESAMPLER_PRECISION > 0)
+   {
+      __m256 vec_ww = _mm256_mul_ps(vec_w, vec_w);
+      vec_ww = _mm256_mul_ps(vec_ww, _mm256_sub_ps(_mm256_set1_ps(3.0), vec_ww));
+      vec_ww = _mm256_mul_ps(_mm256_set1_ps(1.0 / 4.0), vec_ww);
+      vec_w  = _mm256_mul_ps(vec_w, _mm256_sub_ps(_mm256_set1_ps(1.0), vec_ww));
+   }
+#endif
+
+   vec_w = _mm256_min_ps(vec_w, _mm256_set1_ps( 0.5));
+   vec_w = _mm256_max_ps(vec_w, _mm256_set1_ps(-0.5));
+
+   return _mm_sub_ps(_mm256_castps256_ps128(vec_w),
+         _mm256_extractf128_ps(vec_w, 1));
+}
+
+static CC_TARGET_AVX void resampler_CC_downsample_avx(void *re_,
+      struct resampler_data *data)
+{
+   __m128 vec_previous, vec_current;
+   __m256 vec_ratio, vec_b;
+   float ratio, b;
+   rarch_CC_resampler_t *re     = (rarch_CC_resampler_t*)re_;
+
+   audio_frame_float_t *inp     = (audio_frame_float_t*)data->data_in;
+   audio_frame_float_t *inp_max = (audio_frame_float_t*)(inp + data->input_frames);
+   audio_frame_float_t *outp    = (audio_frame_float_t*)data->data_out;
+
+   ratio = 1.0 / data->ratio;
+   b = data->ratio; /* cutoff frequency. */
+
+   vec_ratio = _mm256_mul_ps(_mm256_set1_ps(ratio),
+         _mm256_set_ps(3.0, 2.0, 1.0, 0.0, 3.0, 2.0, 1.0, 0.0));
+   vec_b     = _mm256_set1_ps(b);
+
+   vec_previous = _mm_loadu_ps((float*)&re->buffer[0]);
+   vec_current  = _mm_loadu_ps((float*)&re->buffer[2]);
 
+   while (inp != inp_max)
+   {
+      __m128 vec_w = resampler_CC_kernel_avx(
+            _mm256_sub_ps(_mm256_set1_ps(re->distance), vec_ratio), vec_b);
+      __m128 vec_w_previous =
+         _mm_shuffle_ps(vec_w,vec_w,_MM_SHUFFLE(1, 1, 0, 0));
+      __m128 vec_w_current  =
+         _mm_shuffle_ps(vec_w,vec_w,_MM_SHUFFLE(3, 3, 2, 2));
 
-#elif defined (__ARM_NEON__)
+      __m128 vec_in = _mm_loadl_pi(_mm_setzero_ps(),(__m64*)inp);
+      vec_in = _mm_shuffle_ps(vec_in,vec_in,_MM_SHUFFLE(1, 0, 1, 0));
 
-#define CC_RESAMPLER_IDENT "NEON"
+      vec_previous =
+         _mm_add_ps(vec_previous, _mm_mul_ps(vec_in, vec_w_previous));
+      vec_current  =
+         _mm_add_ps(vec_current, _mm_mul_ps(vec_in, vec_w_current));
 
+      re->distance++;
+      inp++;
+
+      if (re->distance > (ratio + 0.5))
+      {
+         _mm_storel_pi((__m64*)outp, vec_previous);
+         vec_previous =
+            _mm_shuffle_ps(vec_previous,vec_current,_MM_SHUFFLE(1, 0, 3, 2));
+         vec_current  =
+            _mm_shuffle_ps(vec_current,_mm_setzero_ps(),_MM_SHUFFLE(1, 0, 3, 2));
+
+         re->distance -= ratio;
+         outp++;
+      }
+   }
+
+   _mm_storeu_ps((float*)&re->buffer[0], vec_previous);
+   _mm_storeu_ps((float*)&re->buffer[2],  vec_current);
+
+   data->output_frames = outp - (audio_frame_float_t*)data->data_out;
+}
+
+static CC_TARGET_AVX void resampler_CC_upsample_avx(void *re_,
+      struct resampler_data *data)
+{
+   __m128 vec_previous, vec_current;
+   __m256 vec_taps, vec_b;
+   float b, ratio;
+   rarch_CC_resampler_t *re = (rarch_CC_resampler_t*)re_;
+
+   audio_frame_float_t *inp     = (audio_frame_float_t*)data->data_in;
+   audio_frame_float_t *inp_max = (audio_frame_float_t*)(inp + data->input_frames);
+   audio_frame_float_t *outp    = (audio_frame_float_t*)data->data_out;
+
+   b = min(data->ratio, 1.00); /* cutoff frequency. */
+   ratio = 1.0 / data->ratio;
+
+   vec_taps = _mm256_set_ps(-2.0, -1.0, 0.0, 1.0, -2.0, -1.0, 0.0, 1.0);
+   vec_b    = _mm256_set1_ps(b);
+
+   vec_previous = _mm_loadu_ps((float*)&re->buffer[0]);
+   vec_current  = _mm_loadu_ps((float*)&re->buffer[2]);
+
+   while (inp != inp_max)
+   {
+      __m128 vec_in = _mm_loadl_pi(_mm_setzero_ps(),(__m64*)inp);
+      vec_previous =
+         _mm_shuffle_ps(vec_previous,vec_current,_MM_SHUFFLE(1, 0, 3, 2));
+      vec_current  =
+         _mm_shuffle_ps(vec_current,vec_in,_MM_SHUFFLE(1, 0, 3, 2));
+
+      while (re->distance < 1.0)
+      {
+         __m128 vec_w = resampler_CC_kernel_avx(
+               _mm256_add_ps(_mm256_set1_ps(re->distance), vec_taps), vec_b);
+         __m128 vec_w_previous =
+            _mm_shuffle_ps(vec_w,vec_w,_MM_SHUFFLE(1, 1, 0, 0));
+         __m128 vec_w_current  =
+            _mm_shuffle_ps(vec_w,vec_w,_MM_SHUFFLE(3, 3, 2, 2));
+
+         __m128 vec_out =  _mm_mul_ps(vec_previous, vec_w_previous);
+         vec_out = _mm_add_ps(vec_out, _mm_mul_ps(vec_current, vec_w_current));
+         vec_out =
+            _mm_add_ps(vec_out, _mm_shuffle_ps(vec_out,vec_out,_MM_SHUFFLE(3, 2, 3, 2)));
+
+         _mm_storel_pi((__m64*)outp,vec_out);
+
+         re->distance += ratio;
+         outp++;
+      }
+
+      re->distance -= 1.0;
+      inp++;
+   }
+
+   _mm_storeu_ps((float*)&re->buffer[0], vec_previous);
+   _mm_storeu_ps((float*)&re->buffer[2],  vec_current);
+
+   data->output_frames = outp - (audio_frame_float_t*)data->data_out;
+}
+#endif
+
+#if defined(__ARM_NEON__)
 size_t resampler_CC_downsample_neon(float *outp, const float *inp,
       rarch_CC_resampler_t* re_, size_t input_frames, float ratio);
 size_t resampler_CC_upsample_neon  (float *outp, const float *inp,
       rarch_CC_resampler_t* re_, size_t input_frames, float ratio);
 
-static void resampler_CC_downsample(void *re_, struct resampler_data *data)
+static void resampler_CC_downsample_neon_wrap(void *re_, struct resampler_data *data)
 {
    data->output_frames = resampler_CC_downsample_neon(
          data->data_out, data->data_in, re_, data->input_frames, data->ratio);
 }
 
-static void resampler_CC_upsample(void *re_, struct resampler_data *data)
+static void resampler_CC_upsample_neon_wrap(void *re_, struct resampler_data *data)
 {
    data->output_frames = resampler_CC_upsample_neon(
          data->data_out, data->data_in, re_, data->input_frames, data->ratio);
 }
+#endif
 
-#else
-
-/* C reference version. Not optimized. */
-
-#define CC_RESAMPLER_IDENT "C"
+/* C reference version. Not optimized, but always built so there
+ * is something to fall back on when the CPU lacks the SIMD paths. */
 
 #if (CC_RESAMPLER_PRECISION > 4)
 static inline float cc_int(float x, float b)
@@ -450,7 +604,7 @@ static inline void add_to(const audio_frame_float_t *source,
    target->r += source->r * ratio;
 }
 
-static void resampler_CC_downsample(void *re_, struct resampler_data *data)
+static void resampler_CC_downsample_c(void *re_, struct resampler_data *data)
 {
    float ratio, b;
    rarch_CC_resampler_t *re     = (rarch_CC_resampler_t*)re_;
@@ -490,7 +644,7 @@ static void resampler_CC_downsample(void *re_, struct resampler_data *data)
    data->output_frames = outp - (audio_frame_float_t*)data->data_out;
 }
 
-static void resampler_CC_upsample(void *re_, struct resampler_data *data)
+static void resampler_CC_upsample_c(void *re_, struct resampler_data *data)
 {
    float b, ratio;
    rarch_CC_resampler_t *re = (rarch_CC_resampler_t*)re_;
@@ -534,7 +688,6 @@ static void resampler_CC_upsample(void *re_, struct resampler_data *data)
 
    data->output_frames = outp - (audio_frame_float_t*)data->data_out;
 }
-#endif
 
 static void resampler_CC_process(void *re_, struct resampler_data *data)
 {
@@ -551,18 +704,19 @@ static void resampler_CC_free(void *re_)
 }
 
 static void *resampler_CC_init(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      void *userdata, double bandwidth_mod, resampler_simd_mask_t mask)
 {
    int i;
+   const char *simd = "C";
+   void (*downsample)(void *re, struct resampler_data *data) =
+      resampler_CC_downsample_c;
+   void (*upsample)(void *re, struct resampler_data *data) =
+      resampler_CC_upsample_c;
    rarch_CC_resampler_t *re = (rarch_CC_resampler_t*)
       memalign_alloc__(32, sizeof(rarch_CC_resampler_t));
 
-   /* TODO: lookup if NEON support can be detected at 
-    * runtime and a funcptr set at runtime for either
-    * C codepath or NEON codepath. This will help out
-    * Android. */
-   (void)mask;
    (void)config;
+   (void)userdata;
 
    if (!re)
       return NULL;
@@ -573,20 +727,52 @@ static void *resampler_CC_init(const struct resampler_config *config,
       re->buffer[i].r = 0.0;
    }
 
-   RARCH_LOG("Convoluted Cosine resampler (" CC_RESAMPLER_IDENT ") - precision = %i : ", CC_RESAMPLER_PRECISION);
+#ifdef HAVE_CC_AVX
+   if (mask & RESAMPLER_SIMD_AVX)
+   {
+      downsample = resampler_CC_downsample_avx;
+      upsample   = resampler_CC_upsample_avx;
+      simd       = "AVX";
+   }
+   else
+#endif
+#if defined(__SSE__)
+   if (mask & RESAMPLER_SIMD_SSE)
+   {
+      downsample = resampler_CC_downsample_sse;
+      upsample   = resampler_CC_upsample_sse;
+      simd       = "SSE";
+   }
+   else
+#endif
+#if defined(__ARM_NEON__)
+   if (mask & RESAMPLER_SIMD_NEON)
+   {
+      downsample = resampler_CC_downsample_neon_wrap;
+      upsample   = resampler_CC_upsample_neon_wrap;
+      simd       = "NEON";
+   }
+   else
+#endif
+   {
+      (void)mask;
+   }
+
+   RARCH_LOG("Convoluted Cosine resampler (%s) - precision = %i : ",
+         simd, CC_RESAMPLER_PRECISION);
 
    /* Variations of data->ratio around 0.75 are safer
     * than around 1.0 for both up/downsampler. */
    if (bandwidth_mod < 0.75)
    {
       RARCH_LOG("CC_downsample @%f \n", bandwidth_mod);
-      re->process = resampler_CC_downsample;
+      re->process = downsample;
       re->distance = 0.0;
    }
    else
    {
       RARCH_LOG("CC_upsample @%f \n", bandwidth_mod);
-      re->process = resampler_CC_upsample;
+      re->process = upsample;
       re->distance = 2.0;
    }
 
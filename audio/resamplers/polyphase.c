@@ -0,0 +1,442 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Polyphase resampler working directly on int16 with a Q15
+ * filter bank. Meant for hosts where the float conversions and
+ * float math are the largest audio cost, e.g. ARM and PPC boxes.
+ * Quality is in the range of the "lower" sinc. */
+
+#include "resampler.h"
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
+#include "../../general.h"
+#else
+#include <stdio.h>
+#define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
+#endif
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__)
+#include <arm_neon.h>
+#define HAVE_POLYPHASE_NEON
+#endif
+
+#define POLYPHASE_SIDELOBES     8
+#define POLYPHASE_CUTOFF        0.90
+#define POLYPHASE_KAISER_BETA   7.0
+#define POLYPHASE_PHASE_BITS    9
+#define POLYPHASE_SUBPHASE_BITS 15
+#define POLYPHASE_PHASES (1 << (POLYPHASE_PHASE_BITS + POLYPHASE_SUBPHASE_BITS))
+
+typedef void (*polyphase_filter_t)(int16_t *out,
+      const int16_t *buffer_l, const int16_t *buffer_r,
+      const int16_t *phase_table, unsigned taps);
+
+typedef struct rarch_polyphase_resampler
+{
+   polyphase_filter_t filter;
+
+   int16_t *phase_table;
+   void *table_alloc;
+   int16_t *buffer_l;
+   int16_t *buffer_r;
+
+   unsigned taps;
+
+   unsigned ptr;
+   uint32_t time;
+
+   /* Scratch for the float interface. */
+   int16_t *conv_in;
+   int16_t *conv_out;
+   size_t conv_in_frames;
+   size_t conv_out_frames;
+} rarch_polyphase_resampler_t;
+
+static double polyphase_sinc(double val)
+{
+   if (fabs(val) < 0.00001)
+      return 1.0;
+   return sin(val) / val;
+}
+
+static double polyphase_besseli0(double x)
+{
+   unsigned i;
+   double sum = 0.0;
+   double factorial = 1.0;
+   double factorial_mult = 0.0;
+   double x_pow = 1.0;
+   double two_div_pow = 1.0;
+   double x_sqr = x * x;
+
+   for (i = 0; i < 18; i++)
+   {
+      sum += x_pow * two_div_pow / (factorial * factorial);
+
+      factorial_mult += 1.0;
+      x_pow *= x_sqr;
+      two_div_pow *= 0.25;
+      factorial *= factorial_mult;
+   }
+
+   return sum;
+}
+
+/* Every phase is normalized to unity DC gain before it is rounded,
+ * and the rounding error is put on the largest tap. Otherwise the
+ * gain would wobble from phase to phase, which ends up as noise. */
+static bool polyphase_init_table(rarch_polyphase_resampler_t *re,
+      double cutoff)
+{
+   int i, j;
+   unsigned phases  = 1 << POLYPHASE_PHASE_BITS;
+   unsigned taps    = re->taps;
+   double sidelobes = taps / 2.0;
+   double window_mod = polyphase_besseli0(POLYPHASE_KAISER_BETA);
+   double *row = (double*)malloc(taps * sizeof(double));
+
+   if (!row)
+      return false;
+
+   for (i = 0; i < (int)phases; i++)
+   {
+      int16_t *dst = re->phase_table + i * taps;
+      double sum   = 0.0;
+      int isum     = 0;
+      int peak     = 0;
+
+      for (j = 0; j < (int)taps; j++)
+      {
+         int n = j * phases + i;
+         double window_phase = (double)n / (phases * taps);
+         window_phase = 2.0 * window_phase - 1.0;
+
+         row[j] = cutoff * polyphase_sinc(M_PI * sidelobes * window_phase * cutoff) *
+            polyphase_besseli0(POLYPHASE_KAISER_BETA *
+                  sqrt(1 - window_phase * window_phase)) / window_mod;
+         sum += row[j];
+      }
+
+      for (j = 0; j < (int)taps; j++)
+      {
+         int val = (int)floor(row[j] / sum * 0x8000 + 0.5);
+         if (val > 0x7fff)
+            val = 0x7fff;
+         else if (val < -0x8000)
+            val = -0x8000;
+
+         dst[j] = val;
+         isum  += val;
+         if (abs(val) > abs(dst[peak]))
+            peak = j;
+      }
+
+      if (dst[peak] + (0x8000 - isum) <= 0x7fff)
+         dst[peak] += 0x8000 - isum;
+   }
+
+   free(row);
+   return true;
+}
+
+static inline int16_t polyphase_clamp(int32_t val)
+{
+   if (val > 0x7fff)
+      return 0x7fff;
+   if (val < -0x8000)
+      return -0x8000;
+   return val;
+}
+
+/* The table has unity gain in Q15 and the taps of a phase add
+ * up to less than 2.0 in magnitude, so 32-bit accumulators
+ * can't overflow. Taps is a multiple of 8. */
+static void polyphase_filter_C(int16_t *out,
+      const int16_t *buffer_l, const int16_t *buffer_r,
+      const int16_t *phase_table, unsigned taps)
+{
+   unsigned i;
+   int32_t sum_l = 1 << 14;
+   int32_t sum_r = 1 << 14;
+
+   for (i = 0; i < taps; i += 4)
+   {
+      sum_l += buffer_l[i + 0] * phase_table[i + 0];
+      sum_r += buffer_r[i + 0] * phase_table[i + 0];
+      sum_l += buffer_l[i + 1] * phase_table[i + 1];
+      sum_r += buffer_r[i + 1] * phase_table[i + 1];
+      sum_l += buffer_l[i + 2] * phase_table[i + 2];
+      sum_r += buffer_r[i + 2] * phase_table[i + 2];
+      sum_l += buffer_l[i + 3] * phase_table[i + 3];
+      sum_r += buffer_r[i + 3] * phase_table[i + 3];
+   }
+
+   out[0] = polyphase_clamp(sum_l >> 15);
+   out[1] = polyphase_clamp(sum_r >> 15);
+}
+
+#if defined(__SSE2__)
+static void polyphase_filter_sse2(int16_t *out,
+      const int16_t *buffer_l, const int16_t *buffer_r,
+      const int16_t *phase_table, unsigned taps)
+{
+   unsigned i;
+   __m128i sum_l = _mm_setzero_si128();
+   __m128i sum_r = _mm_setzero_si128();
+
+   for (i = 0; i < taps; i += 8)
+   {
+      __m128i coeff = _mm_load_si128((const __m128i*)(phase_table + i));
+      sum_l = _mm_add_epi32(sum_l, _mm_madd_epi16(
+               _mm_loadu_si128((const __m128i*)(buffer_l + i)), coeff));
+      sum_r = _mm_add_epi32(sum_r, _mm_madd_epi16(
+               _mm_loadu_si128((const __m128i*)(buffer_r + i)), coeff));
+   }
+
+   /* { l0 + l2, r0 + r2, l1 + l3, r1 + r3 } */
+   sum_l = _mm_add_epi32(_mm_unpacklo_epi32(sum_l, sum_r),
+         _mm_unpackhi_epi32(sum_l, sum_r));
+   /* { L, R, X, X } */
+   sum_l = _mm_add_epi32(sum_l, _mm_srli_si128(sum_l, 8));
+   sum_l = _mm_add_epi32(sum_l, _mm_set1_epi32(1 << 14));
+   sum_l = _mm_srai_epi32(sum_l, 15);
+   sum_l = _mm_packs_epi32(sum_l, sum_l);
+
+   *(uint32_t*)out = (uint32_t)_mm_cvtsi128_si32(sum_l);
+}
+#endif
+
+#ifdef HAVE_POLYPHASE_NEON
+static void polyphase_filter_neon(int16_t *out,
+      const int16_t *buffer_l, const int16_t *buffer_r,
+      const int16_t *phase_table, unsigned taps)
+{
+   unsigned i;
+   int32x2_t sum;
+   int32x4_t sum_l = vdupq_n_s32(0);
+   int32x4_t sum_r = vdupq_n_s32(0);
+
+   for (i = 0; i < taps; i += 8)
+   {
+      int16x8_t coeff = vld1q_s16(phase_table + i);
+      int16x8_t in_l  = vld1q_s16(buffer_l + i);
+      int16x8_t in_r  = vld1q_s16(buffer_r + i);
+
+      sum_l = vmlal_s16(sum_l, vget_low_s16(in_l), vget_low_s16(coeff));
+      sum_l = vmlal_s16(sum_l, vget_high_s16(in_l), vget_high_s16(coeff));
+      sum_r = vmlal_s16(sum_r, vget_low_s16(in_r), vget_low_s16(coeff));
+      sum_r = vmlal_s16(sum_r, vget_high_s16(in_r), vget_high_s16(coeff));
+   }
+
+   sum = vpadd_s32(
+         vadd_s32(vget_low_s32(sum_l), vget_high_s32(sum_l)),
+         vadd_s32(vget_low_s32(sum_r), vget_high_s32(sum_r)));
+
+   /* Rounding, saturating narrow of { L, R }. */
+   vst1_lane_s32((int32_t*)out,
+         vreinterpret_s32_s16(vqrshrn_n_s32(vcombine_s32(sum, sum), 15)), 0);
+}
+#endif
+
+static void resampler_polyphase_process_s16(void *re_,
+      struct resampler_data_s16 *data)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+
+   uint32_t ratio = POLYPHASE_PHASES / data->ratio;
+
+   const int16_t *input = data->data_in;
+   int16_t *output      = data->data_out;
+   size_t frames        = data->input_frames;
+   size_t out_frames    = 0;
+   unsigned taps        = re->taps;
+
+   while (frames)
+   {
+      while (frames && re->time >= POLYPHASE_PHASES)
+      {
+         /* Push in reverse, same layout as the sinc resampler. */
+         if (!re->ptr)
+            re->ptr = taps;
+         re->ptr--;
+
+         re->buffer_l[re->ptr + taps] = re->buffer_l[re->ptr] = *input++;
+         re->buffer_r[re->ptr + taps] = re->buffer_r[re->ptr] = *input++;
+
+         re->time -= POLYPHASE_PHASES;
+         frames--;
+      }
+
+      while (re->time < POLYPHASE_PHASES)
+      {
+         re->filter(output,
+               re->buffer_l + re->ptr, re->buffer_r + re->ptr,
+               re->phase_table + (re->time >> POLYPHASE_SUBPHASE_BITS) * taps,
+               taps);
+         output += 2;
+         out_frames++;
+         re->time += ratio;
+      }
+   }
+
+   data->output_frames = out_frames;
+}
+
+/* Float entry point for when a DSP plugin or a float driver sits
+ * in the chain. Rounds to int16 and back, which is what the audio
+ * driver would have done anyway. */
+static void resampler_polyphase_process(void *re_, struct resampler_data *data)
+{
+   size_t i;
+   struct resampler_data_s16 s16 = {0};
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+   /* Output can run up to one input frame's worth ahead. */
+   size_t max_out = (size_t)((data->input_frames + 1) * data->ratio) + 2;
+
+   if (data->input_frames > re->conv_in_frames)
+   {
+      int16_t *conv_in = (int16_t*)realloc(re->conv_in,
+            data->input_frames * 2 * sizeof(int16_t));
+      if (!conv_in)
+      {
+         data->output_frames = 0;
+         return;
+      }
+      re->conv_in        = conv_in;
+      re->conv_in_frames = data->input_frames;
+   }
+
+   if (max_out > re->conv_out_frames)
+   {
+      int16_t *conv_out = (int16_t*)realloc(re->conv_out,
+            max_out * 2 * sizeof(int16_t));
+      if (!conv_out)
+      {
+         data->output_frames = 0;
+         return;
+      }
+      re->conv_out        = conv_out;
+      re->conv_out_frames = max_out;
+   }
+
+   for (i = 0; i < data->input_frames * 2; i++)
+      re->conv_in[i] = polyphase_clamp(
+            (int32_t)floor(data->data_in[i] * 0x8000 + 0.5f));
+
+   s16.data_in      = re->conv_in;
+   s16.data_out     = re->conv_out;
+   s16.input_frames = data->input_frames;
+   s16.ratio        = data->ratio;
+   resampler_polyphase_process_s16(re, &s16);
+
+   for (i = 0; i < s16.output_frames * 2; i++)
+      data->data_out[i] = re->conv_out[i] * (1.0f / 0x8000);
+
+   data->output_frames = s16.output_frames;
+}
+
+static void resampler_polyphase_free(void *re_)
+{
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)re_;
+   if (!re)
+      return;
+
+   free(re->table_alloc);
+   free(re->buffer_l);
+   free(re->conv_in);
+   free(re->conv_out);
+   free(re);
+}
+
+static void *resampler_polyphase_init(const struct resampler_config *config,
+      void *userdata, double bandwidth_mod, resampler_simd_mask_t mask)
+{
+   const char *kernel = "C";
+   double cutoff = POLYPHASE_CUTOFF;
+   rarch_polyphase_resampler_t *re = (rarch_polyphase_resampler_t*)
+      calloc(1, sizeof(*re));
+
+   (void)config;
+   (void)userdata;
+   if (!re)
+      return NULL;
+
+   re->filter = polyphase_filter_C;
+#if defined(__SSE2__)
+   if (mask & RESAMPLER_SIMD_SSE2)
+   {
+      re->filter = polyphase_filter_sse2;
+      kernel     = "SSE2";
+   }
+#endif
+#ifdef HAVE_POLYPHASE_NEON
+   if (mask & RESAMPLER_SIMD_NEON)
+   {
+      re->filter = polyphase_filter_neon;
+      kernel     = "NEON";
+   }
+#endif
+   (void)mask;
+
+   re->taps = POLYPHASE_SIDELOBES * 2;
+
+   /* Downsampling, lower the cutoff and widen the filter
+    * like the sinc resampler does. */
+   if (bandwidth_mod < 1.0)
+   {
+      cutoff  *= bandwidth_mod;
+      re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
+   }
+   re->taps = (re->taps + 7) & ~7;
+
+   /* 16-byte aligned rows for the SIMD filters. */
+   re->table_alloc = malloc((1 << POLYPHASE_PHASE_BITS) *
+         re->taps * sizeof(int16_t) + 15);
+   re->buffer_l    = (int16_t*)calloc(4 * re->taps, sizeof(int16_t));
+   if (!re->table_alloc || !re->buffer_l)
+      goto error;
+   re->phase_table = (int16_t*)(((uintptr_t)re->table_alloc + 15) &
+         ~(uintptr_t)15);
+   re->buffer_r    = re->buffer_l + 2 * re->taps;
+
+   if (!polyphase_init_table(re, cutoff))
+      goto error;
+
+   RARCH_LOG("Polyphase resampler [%s] (Q15, %u phase bits, %u taps).\n",
+         kernel, POLYPHASE_PHASE_BITS, re->taps);
+   return re;
+
+error:
+   resampler_polyphase_free(re);
+   return NULL;
+}
+
+rarch_resampler_t polyphase_resampler = {
+   resampler_polyphase_init,
+   resampler_polyphase_process,
+   resampler_polyphase_free,
+   RESAMPLER_API_VERSION,
+   "Polyphase",
+   "polyphase",
+   resampler_polyphase_process_s16
+};
@@ -16,6 +16,32 @@
 #include "resampler.h"
 #ifdef RARCH_INTERNAL
 #include "../../performance.h"
+#else
+/* Standalone builds (audio/test) only get what the compiler targets. */
+static resampler_simd_mask_t rarch_get_cpu_features(void)
+{
+   resampler_simd_mask_t mask = 0;
+#ifdef RESAMPLER_SIMD_MASK
+   /* Pins the resamplers to one code path for comparing them. */
+   return RESAMPLER_SIMD_MASK;
+#endif
+#ifdef __SSE__
+   mask |= RESAMPLER_SIMD_SSE;
+#endif
+#ifdef __AVX__
+   mask |= RESAMPLER_SIMD_AVX;
+#endif
+#ifdef __AVX2__
+   mask |= RESAMPLER_SIMD_AVX2;
+#endif
+#ifdef __FMA__
+   mask |= RESAMPLER_SIMD_FMA;
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+   mask |= RESAMPLER_SIMD_NEON;
+#endif
+   return mask;
+}
 #endif
 #include <file/config_file_userdata.h>
 #include <string.h>
@@ -24,6 +50,7 @@ static const rarch_resampler_t *resampler_drivers[] = {
    &sinc_resampler,
    &CC_resampler,
    &nearest_resampler,
+   &polyphase_resampler,
    NULL,
 };
 
@@ -95,13 +122,45 @@ static const rarch_resampler_t *find_resampler_driver(const char *ident)
    }
 }
 
+/* Resamplers read their options through resampler_config,
+ * e.g. "sinc_quality", falling back to "resampler_quality".
+ * Feed them from the frontend settings. */
+static config_file_t *resampler_new_config(void)
+{
+   config_file_t *conf = config_file_new(NULL);
+   if (!conf)
+      return NULL;
+
+#if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
+   if (*g_settings.audio.resampler_quality)
+      config_set_string(conf, "resampler_quality",
+            g_settings.audio.resampler_quality);
+   if (g_settings.audio.sinc_taps)
+      config_set_int(conf, "sinc_taps", g_settings.audio.sinc_taps);
+#elif defined(RESAMPLER_QUALITY)
+   config_set_string(conf, "resampler_quality", RESAMPLER_QUALITY);
+#endif
+
+   return conf;
+}
+
 static bool resampler_append_plugs(void **re,
       const rarch_resampler_t **backend,
       double bw_ratio)
 {
+   struct config_file_userdata userdata;
    resampler_simd_mask_t mask = rarch_get_cpu_features();
+   config_file_t *conf = resampler_new_config();
+
+   if (!conf)
+      return false;
+
+   userdata.conf      = conf;
+   userdata.prefix[0] = (*backend)->short_ident;
+   userdata.prefix[1] = "resampler";
 
-   *re = (*backend)->init(&resampler_config, bw_ratio, mask);
+   *re = (*backend)->init(&resampler_config, &userdata, bw_ratio, mask);
+   config_file_free(conf);
 
    if (!*re)
       return false;
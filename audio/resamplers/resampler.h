@@ -46,6 +46,8 @@ extern "C" {
 #define RESAMPLER_SIMD_AVX2     (1 << 12)
 #define RESAMPLER_SIMD_VFPU     (1 << 13)
 #define RESAMPLER_SIMD_PS       (1 << 14)
+/* Frontend-private, same bit as RARCH_SIMD_FMA. */
+#define RESAMPLER_SIMD_FMA      (1U << 31)
 
 /* A bit-mask of all supported SIMD instruction sets.
  * Allows an implementation to pick different 
@@ -53,7 +55,7 @@ extern "C" {
  */
 typedef unsigned resampler_simd_mask_t;
 
-#define RESAMPLER_API_VERSION 1
+#define RESAMPLER_API_VERSION 2
 
 struct resampler_data
 {
@@ -66,6 +68,18 @@ struct resampler_data
    double ratio;
 };
 
+/* Same as resampler_data, but interleaved int16 stereo. */
+struct resampler_data_s16
+{
+   const int16_t *data_in;
+   int16_t *data_out;
+
+   size_t input_frames;
+   size_t output_frames;
+
+   double ratio;
+};
+
 /* Returns true if config key was found. Otherwise, 
  * returns false, and sets value to default value.
  */
@@ -106,9 +120,10 @@ struct resampler_config
 };
 
 /* Bandwidth factor. Will be < 1.0 for downsampling, > 1.0 for upsampling. 
- * Corresponds to expected resampling ratio. */
+ * Corresponds to expected resampling ratio.
+ * userdata is passed along to the config callbacks. */
 typedef void *(*resampler_init_t)(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask);
+      void *userdata, double bandwidth_mod, resampler_simd_mask_t mask);
 
 /* Frees the handle. */
 typedef void (*resampler_free_t)(void *data);
@@ -116,6 +131,10 @@ typedef void (*resampler_free_t)(void *data);
 /* Processes input data. */
 typedef void (*resampler_process_t)(void *_data, struct resampler_data *data);
 
+/* Processes int16 input data without going through float. */
+typedef void (*resampler_process_s16_t)(void *_data,
+      struct resampler_data_s16 *data);
+
 typedef struct rarch_resampler
 {
    resampler_init_t     init;
@@ -131,6 +150,9 @@ typedef struct rarch_resampler
    /* Computer-friendly short version of ident.
     * Lower case, no spaces and special characters, etc. */
    const char *short_ident; 
+
+   /* Optional, NULL if the resampler only works on float. */
+   resampler_process_s16_t process_s16;
 } rarch_resampler_t;
 
 typedef struct audio_frame_float
@@ -142,6 +164,7 @@ typedef struct audio_frame_float
 extern rarch_resampler_t sinc_resampler;
 extern rarch_resampler_t CC_resampler;
 extern rarch_resampler_t nearest_resampler;
+extern rarch_resampler_t polyphase_resampler;
 
 /* Reallocs resampler. Will free previous handle before 
  * allocating a new one. If ident is NULL, first resampler will be used. */
@@ -162,6 +185,10 @@ bool rarch_resampler_realloc(void **re, const rarch_resampler_t **backend,
    (backend)->process(handle, data); \
 } while(0)
 
+#define rarch_resampler_process_s16(backend, handle, data) do { \
+   (backend)->process_s16(handle, data); \
+} while(0)
+
 #ifdef __cplusplus
 }
 #endif
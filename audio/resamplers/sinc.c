@@ -25,6 +25,7 @@
 #if !defined(RESAMPLER_TEST) && defined(RARCH_INTERNAL)
 #include "../../general.h"
 #else
+#include <stdio.h>
 #define RARCH_LOG(...) fprintf(stderr, __VA_ARGS__)
 #endif
 
@@ -32,77 +33,81 @@
 #include <xmmintrin.h>
 #endif
 
-/* Rough SNR values for upsampling:
- * LOWEST: 40 dB
- * LOWER: 55 dB
- * NORMAL: 70 dB
- * HIGHER: 110 dB
- * HIGHEST: 140 dB
- */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_SINC_AVX
+#define HAVE_SINC_AVX2
+#define SINC_TARGET_AVX  __attribute__((target("avx")))
+#define SINC_TARGET_AVX2 __attribute__((target("avx2,fma")))
+#elif defined(__AVX__)
+#include <immintrin.h>
+#define HAVE_SINC_AVX
+#define SINC_TARGET_AVX
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__)
+#include <arm_neon.h>
+#define HAVE_SINC_NEON
+#endif
 
-/* TODO, make all this more configurable. */
+/* Default quality when the config doesn't ask for one. */
 #if defined(SINC_LOWEST_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SINC_COEFF_LERP 0
-#define SUBPHASE_BITS 10
-#define SIDELOBES 2
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY "lowest"
 #elif defined(SINC_LOWER_QUALITY)
-#define SINC_WINDOW_LANCZOS
-#define CUTOFF 0.98
-#define PHASE_BITS 12
-#define SINC_COEFF_LERP 0
-#define SUBPHASE_BITS 10
-#define SIDELOBES 4
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY "lower"
 #elif defined(SINC_HIGHER_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 10.5
-#define CUTOFF 0.90
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 32
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY "higher"
 #elif defined(SINC_HIGHEST_QUALITY)
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 14.5
-#define CUTOFF 0.962
-#define PHASE_BITS 10
-#define SUBPHASE_BITS 14
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 128
-#define ENABLE_AVX 1
+#define SINC_DEFAULT_QUALITY "highest"
 #else
-#define SINC_WINDOW_KAISER
-#define SINC_WINDOW_KAISER_BETA 5.5
-#define CUTOFF 0.825
-#define PHASE_BITS 8
-#define SUBPHASE_BITS 16
-#define SINC_COEFF_LERP 1
-#define SIDELOBES 8
-#define ENABLE_AVX 0
+#define SINC_DEFAULT_QUALITY "normal"
 #endif
 
-/* For the little amount of taps we're using,
- * SSE1 is faster than AVX for some reason.
- * AVX code is kept here though as by increasing number
- * of sinc taps, the AVX code is clearly faster than SSE1.
- */
+/* For the little amount of taps the lower qualities use,
+ * SSE1 is faster than AVX. With more taps the wider
+ * kernels clearly win, a bit earlier with FMA. */
+#define SINC_AVX_MIN_TAPS  64
+#define SINC_AVX2_MIN_TAPS 32
 
-#if defined(__AVX__) && ENABLE_AVX
-#include <immintrin.h>
-#endif
+enum sinc_window
+{
+   SINC_WINDOW_LANCZOS = 0,
+   SINC_WINDOW_KAISER
+};
 
-#define PHASES (1 << (PHASE_BITS + SUBPHASE_BITS))
+struct sinc_quality
+{
+   const char *ident;
+   enum sinc_window window;
+   double kaiser_beta;
+   double cutoff;
+   unsigned phase_bits;
+   unsigned subphase_bits;
+   unsigned sidelobes;
+   bool coeff_lerp;
+};
 
-#define TAPS (SIDELOBES * 2)
-#define SUBPHASE_MASK ((1 << SUBPHASE_BITS) - 1)
-#define SUBPHASE_MOD (1.0f / (1 << SUBPHASE_BITS))
+/* Rough SNR values for upsampling:
+ * LOWEST: 40 dB
+ * LOWER: 55 dB
+ * NORMAL: 70 dB
+ * HIGHER: 110 dB
+ * HIGHEST: 140 dB
+ */
+static const struct sinc_quality sinc_qualities[] = {
+   { "lowest",  SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10, 2,   false },
+   { "lower",   SINC_WINDOW_LANCZOS, 0.0,  0.98,  12, 10, 4,   false },
+   { "normal",  SINC_WINDOW_KAISER,  5.5,  0.825, 8,  16, 8,   true  },
+   { "higher",  SINC_WINDOW_KAISER,  10.5, 0.90,  10, 14, 32,  true  },
+   { "highest", SINC_WINDOW_KAISER,  14.5, 0.962, 10, 14, 128, true  },
+};
 
-typedef struct rarch_sinc_resampler
+typedef struct rarch_sinc_resampler rarch_sinc_resampler_t;
+
+typedef void (*sinc_process_t)(rarch_sinc_resampler_t *resamp,
+      float *out_buffer);
+
+struct rarch_sinc_resampler
 {
    float *phase_table;
    float *buffer_l;
@@ -113,11 +118,19 @@ typedef struct rarch_sinc_resampler
    unsigned ptr;
    uint32_t time;
 
+   const struct sinc_quality *quality;
+   unsigned subphase_bits;
+   uint32_t subphase_mask;
+   float subphase_mod;
+   uint32_t phases;
+
+   sinc_process_t process;
+
    /* A buffer for phase_table, buffer_l and buffer_r 
     * are created in a single calloc().
     * Ensure that we get as good cache locality as we can hope for. */
    float *main_buffer;
-} rarch_sinc_resampler_t;
+};
 
 static inline double sinc(double val)
 {
@@ -126,12 +139,6 @@ static inline double sinc(double val)
    return sin(val) / val;
 }
 
-#if defined(SINC_WINDOW_LANCZOS)
-static inline double window_function(double idx)
-{
-   return sinc(M_PI * idx);
-}
-#elif defined(SINC_WINDOW_KAISER)
 /* Modified Bessel function of first order.
  * Check Wiki for mathematical definition ... */
 static inline double besseli0(double x)
@@ -160,19 +167,27 @@ static inline double besseli0(double x)
    return sum;
 }
 
-static inline double window_function(double idx)
+static inline double window_function(const struct sinc_quality *quality,
+      double idx)
 {
-   return besseli0(SINC_WINDOW_KAISER_BETA * sqrt(1 - idx * idx));
+   switch (quality->window)
+   {
+      case SINC_WINDOW_LANCZOS:
+         return sinc(M_PI * idx);
+      case SINC_WINDOW_KAISER:
+         return besseli0(quality->kaiser_beta * sqrt(1 - idx * idx));
+   }
+
+   return 0.0;
 }
-#else
-#error "No SINC window function defined."
-#endif
 
 static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
       float *phase_table, int phases, int taps, bool calculate_delta)
 {
    int i, j, p;
-   double window_mod = window_function(0.0); /* Need to normalize w(0) to 1.0. */
+   const struct sinc_quality *quality = resamp->quality;
+   /* Need to normalize w(0) to 1.0. */
+   double window_mod = window_function(quality, 0.0);
    int stride = calculate_delta ? 2 : 1;
    double sidelobes = taps / 2.0;
 
@@ -188,7 +203,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          sinc_phase = sidelobes * window_phase;
 
          val = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
+            window_function(quality, window_phase) / window_mod;
          phase_table[i * stride * taps + j] = val;
       }
    }
@@ -217,7 +232,7 @@ static void init_sinc_table(rarch_sinc_resampler_t *resamp, double cutoff,
          sinc_phase = sidelobes * window_phase;
 
          val = cutoff * sinc(M_PI * sinc_phase * cutoff) * 
-            window_function(window_phase) / window_mod;
+            window_function(quality, window_phase) / window_mod;
          delta = (val - phase_table[phase * stride * taps + j]);
          phase_table[(phase * stride + 1) * taps + j] = delta;
       }
@@ -248,8 +263,11 @@ static void aligned_free__(void *ptr)
    free(p[-1]);
 }
 
-#if !(defined(__AVX__) && ENABLE_AVX) && !defined(__SSE__)
-static inline void process_sinc_C(rarch_sinc_resampler_t *resamp,
+/* All kernels below read taps coefficients for the current phase,
+ * followed by taps deltas when the quality interpolates between
+ * phases. */
+
+static void process_sinc_C(rarch_sinc_resampler_t *resamp,
       float *out_buffer)
 {
    unsigned i;
@@ -259,36 +277,43 @@ static inline void process_sinc_C(rarch_sinc_resampler_t *resamp,
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
    unsigned taps  = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   float delta = (float)(resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD;
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   unsigned phase = resamp->time >> resamp->subphase_bits;
 
-   for (i = 0; i < taps; i++)
+   if (resamp->quality->coeff_lerp)
    {
-#if SINC_COEFF_LERP
-      float sinc_val = phase_table[i] + delta_table[i] * delta;
-#else
-      float sinc_val = phase_table[i];
-#endif
-      sum_l         += buffer_l[i] * sinc_val;
-      sum_r         += buffer_r[i] * sinc_val;
+      const float *phase_table = resamp->phase_table + phase * taps * 2;
+      const float *delta_table = phase_table + taps;
+      float delta = (float)(resamp->time & resamp->subphase_mask) *
+         resamp->subphase_mod;
+
+      for (i = 0; i < taps; i++)
+      {
+         float sinc_val = phase_table[i] + delta_table[i] * delta;
+         sum_l         += buffer_l[i] * sinc_val;
+         sum_r         += buffer_r[i] * sinc_val;
+      }
+   }
+   else
+   {
+      const float *phase_table = resamp->phase_table + phase * taps;
+
+      for (i = 0; i < taps; i++)
+      {
+         sum_l += buffer_l[i] * phase_table[i];
+         sum_r += buffer_r[i] * phase_table[i];
+      }
    }
 
    out_buffer[0] = sum_l;
    out_buffer[1] = sum_r;
 }
-#endif
 
-#if defined(__AVX__) && ENABLE_AVX
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+#ifdef HAVE_SINC_AVX
+static SINC_TARGET_AVX void process_sinc_avx(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
 {
    unsigned i;
+   __m256 res_l, res_r;
    __m256 sum_l = _mm256_setzero_ps();
    __m256 sum_r = _mm256_setzero_ps();
 
@@ -296,36 +321,46 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
    unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m256 delta = _mm256_set1_ps((float)
-         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   unsigned phase = resamp->time >> resamp->subphase_bits;
 
-   for (i = 0; i < taps; i += 8)
+   if (resamp->quality->coeff_lerp)
    {
-      __m256 buf_l = _mm256_loadu_ps(buffer_l + i);
-      __m256 buf_r = _mm256_loadu_ps(buffer_r + i);
+      const float *phase_table = resamp->phase_table + phase * taps * 2;
+      const float *delta_table = phase_table + taps;
+      __m256 delta = _mm256_set1_ps((float)
+            (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
 
-#if SINC_COEFF_LERP
-      __m256 deltas = _mm256_load_ps(delta_table + i);
-      __m256 sinc = _mm256_add_ps(_mm256_load_ps(phase_table + i),
-            _mm256_mul_ps(deltas, delta));
-#else
-      __m256 sinc = _mm256_load_ps(phase_table + i);
-#endif
-      sum_l       = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
-      sum_r       = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
+      for (i = 0; i < taps; i += 8)
+      {
+         __m256 buf_l  = _mm256_loadu_ps(buffer_l + i);
+         __m256 buf_r  = _mm256_loadu_ps(buffer_r + i);
+         __m256 deltas = _mm256_load_ps(delta_table + i);
+         __m256 sinc   = _mm256_add_ps(_mm256_load_ps(phase_table + i),
+               _mm256_mul_ps(deltas, delta));
+
+         sum_l         = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
+         sum_r         = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
+      }
+   }
+   else
+   {
+      const float *phase_table = resamp->phase_table + phase * taps;
+
+      for (i = 0; i < taps; i += 8)
+      {
+         __m256 buf_l = _mm256_loadu_ps(buffer_l + i);
+         __m256 buf_r = _mm256_loadu_ps(buffer_r + i);
+         __m256 sinc  = _mm256_load_ps(phase_table + i);
+
+         sum_l        = _mm256_add_ps(sum_l, _mm256_mul_ps(buf_l, sinc));
+         sum_r        = _mm256_add_ps(sum_r, _mm256_mul_ps(buf_r, sinc));
+      }
    }
 
    /* hadd on AVX is weird, and acts on low-lanes 
     * and high-lanes separately. */
-   __m256 res_l = _mm256_hadd_ps(sum_l, sum_l);
-   __m256 res_r = _mm256_hadd_ps(sum_r, sum_r);
+   res_l = _mm256_hadd_ps(sum_l, sum_l);
+   res_r = _mm256_hadd_ps(sum_r, sum_r);
    res_l = _mm256_hadd_ps(res_l, res_l);
    res_r = _mm256_hadd_ps(res_r, res_r);
    res_l = _mm256_add_ps(_mm256_permute2f128_ps(res_l, res_l, 1), res_l);
@@ -336,11 +371,72 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    _mm_store_ss(out_buffer + 0, _mm256_extractf128_ps(res_l, 0));
    _mm_store_ss(out_buffer + 1, _mm256_extractf128_ps(res_r, 0));
 }
-#elif defined(__SSE__)
-#define process_sinc_func process_sinc
-static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
+#endif
+
+#ifdef HAVE_SINC_AVX2
+/* Same as AVX, but folds the coefficient lerp and the multiply-adds
+ * into FMAs. FMA3 is a separate CPUID bit, so it's checked too. */
+static SINC_TARGET_AVX2 void process_sinc_avx2(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
+{
+   unsigned i;
+   __m128 lo, hi;
+   __m256 sum_l = _mm256_setzero_ps();
+   __m256 sum_r = _mm256_setzero_ps();
+
+   const float *buffer_l = resamp->buffer_l + resamp->ptr;
+   const float *buffer_r = resamp->buffer_r + resamp->ptr;
+
+   unsigned taps = resamp->taps;
+   unsigned phase = resamp->time >> resamp->subphase_bits;
+
+   if (resamp->quality->coeff_lerp)
+   {
+      const float *phase_table = resamp->phase_table + phase * taps * 2;
+      const float *delta_table = phase_table + taps;
+      __m256 delta = _mm256_set1_ps((float)
+            (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
+
+      for (i = 0; i < taps; i += 8)
+      {
+         __m256 sinc = _mm256_fmadd_ps(_mm256_load_ps(delta_table + i),
+               delta, _mm256_load_ps(phase_table + i));
+
+         sum_l = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_l + i), sinc, sum_l);
+         sum_r = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_r + i), sinc, sum_r);
+      }
+   }
+   else
+   {
+      const float *phase_table = resamp->phase_table + phase * taps;
+
+      for (i = 0; i < taps; i += 8)
+      {
+         __m256 sinc = _mm256_load_ps(phase_table + i);
+
+         sum_l = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_l + i), sinc, sum_l);
+         sum_r = _mm256_fmadd_ps(_mm256_loadu_ps(buffer_r + i), sinc, sum_r);
+      }
+   }
+
+   /* Fold both sums down to { X, X, R, L } in one go. */
+   lo = _mm_add_ps(_mm256_castps256_ps128(sum_l),
+         _mm256_extractf128_ps(sum_l, 1));
+   hi = _mm_add_ps(_mm256_castps256_ps128(sum_r),
+         _mm256_extractf128_ps(sum_r, 1));
+   lo = _mm_hadd_ps(lo, hi);
+   lo = _mm_hadd_ps(lo, lo);
+
+   _mm_storel_pi((__m64*)out_buffer, lo);
+}
+#endif
+
+#ifdef __SSE__
+static void process_sinc_sse(rarch_sinc_resampler_t *resamp,
+      float *out_buffer)
 {
    unsigned i;
+   __m128 sum;
    __m128 sum_l = _mm_setzero_ps();
    __m128 sum_r = _mm_setzero_ps();
 
@@ -348,30 +444,40 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
    unsigned taps = resamp->taps;
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
-#if SINC_COEFF_LERP
-   const float *phase_table = resamp->phase_table + phase * taps * 2;
-   const float *delta_table = phase_table + taps;
-   __m128 delta = _mm_set1_ps((float)
-         (resamp->time & SUBPHASE_MASK) * SUBPHASE_MOD);
-#else
-   const float *phase_table = resamp->phase_table + phase * taps;
-#endif
+   unsigned phase = resamp->time >> resamp->subphase_bits;
 
-   for (i = 0; i < taps; i += 4)
+   if (resamp->quality->coeff_lerp)
    {
-      __m128 buf_l = _mm_loadu_ps(buffer_l + i);
-      __m128 buf_r = _mm_loadu_ps(buffer_r + i);
+      const float *phase_table = resamp->phase_table + phase * taps * 2;
+      const float *delta_table = phase_table + taps;
+      __m128 delta = _mm_set1_ps((float)
+            (resamp->time & resamp->subphase_mask) * resamp->subphase_mod);
 
-#if SINC_COEFF_LERP
-      __m128 deltas = _mm_load_ps(delta_table + i);
-      __m128 _sinc = _mm_add_ps(_mm_load_ps(phase_table + i),
-            _mm_mul_ps(deltas, delta));
-#else
-      __m128 _sinc = _mm_load_ps(phase_table + i);
-#endif
-      sum_l       = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
-      sum_r       = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      for (i = 0; i < taps; i += 4)
+      {
+         __m128 buf_l  = _mm_loadu_ps(buffer_l + i);
+         __m128 buf_r  = _mm_loadu_ps(buffer_r + i);
+         __m128 deltas = _mm_load_ps(delta_table + i);
+         __m128 _sinc  = _mm_add_ps(_mm_load_ps(phase_table + i),
+               _mm_mul_ps(deltas, delta));
+
+         sum_l         = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
+         sum_r         = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      }
+   }
+   else
+   {
+      const float *phase_table = resamp->phase_table + phase * taps;
+
+      for (i = 0; i < taps; i += 4)
+      {
+         __m128 buf_l = _mm_loadu_ps(buffer_l + i);
+         __m128 buf_r = _mm_loadu_ps(buffer_r + i);
+         __m128 _sinc = _mm_load_ps(phase_table + i);
+
+         sum_l        = _mm_add_ps(sum_l, _mm_mul_ps(buf_l, _sinc));
+         sum_r        = _mm_add_ps(sum_r, _mm_mul_ps(buf_r, _sinc));
+      }
    }
 
    /* Them annoying shuffles.
@@ -379,7 +485,7 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
     * sum_r = { r3, r2, r1, r0 }
     */
 
-   __m128 sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
+   sum = _mm_add_ps(_mm_shuffle_ps(sum_l, sum_r,
             _MM_SHUFFLE(1, 0, 1, 0)),
          _mm_shuffle_ps(sum_l, sum_r, _MM_SHUFFLE(3, 2, 3, 2)));
 
@@ -399,43 +505,68 @@ static void process_sinc(rarch_sinc_resampler_t *resamp, float *out_buffer)
    /* movehl { X, R, X, L } == { X, R, X, R } */
    _mm_store_ss(out_buffer + 1, _mm_movehl_ps(sum, sum));
 }
-#elif defined(__ARM_NEON__)
-
-#if SINC_COEFF_LERP
-#error "NEON asm does not support SINC lerp."
 #endif
 
-/* Need to make this function pointer as Android doesn't 
- * have built-in targets for NEON and plain ARMv7a.
- */
-static void (*process_sinc_func)(rarch_sinc_resampler_t *resamp,
-      float *out_buffer);
-
-/* Assumes that taps >= 8, and that taps is a multiple of 8. */
-void process_sinc_neon_asm(float *out, const float *left, 
-      const float *right, const float *coeff, unsigned taps);
-
+#ifdef HAVE_SINC_NEON
 static void process_sinc_neon(rarch_sinc_resampler_t *resamp,
       float *out_buffer)
 {
+   unsigned i;
+   float32x2_t sum;
+   float32x4_t sum_l = vdupq_n_f32(0.0f);
+   float32x4_t sum_r = vdupq_n_f32(0.0f);
+
    const float *buffer_l = resamp->buffer_l + resamp->ptr;
    const float *buffer_r = resamp->buffer_r + resamp->ptr;
 
-   unsigned phase = resamp->time >> SUBPHASE_BITS;
    unsigned taps = resamp->taps;
-   const float *phase_table = resamp->phase_table + phase * taps;
+   unsigned phase = resamp->time >> resamp->subphase_bits;
+
+   if (resamp->quality->coeff_lerp)
+   {
+      const float *phase_table = resamp->phase_table + phase * taps * 2;
+      const float *delta_table = phase_table + taps;
+      float delta = (float)(resamp->time & resamp->subphase_mask) *
+         resamp->subphase_mod;
+
+      for (i = 0; i < taps; i += 4)
+      {
+         float32x4_t sinc = vmlaq_n_f32(vld1q_f32(phase_table + i),
+               vld1q_f32(delta_table + i), delta);
 
-   process_sinc_neon_asm(out_buffer, buffer_l, buffer_r, phase_table, taps);
+         sum_l = vmlaq_f32(sum_l, vld1q_f32(buffer_l + i), sinc);
+         sum_r = vmlaq_f32(sum_r, vld1q_f32(buffer_r + i), sinc);
+      }
+   }
+   else
+   {
+      const float *phase_table = resamp->phase_table + phase * taps;
+
+      for (i = 0; i < taps; i += 4)
+      {
+         float32x4_t sinc = vld1q_f32(phase_table + i);
+
+         sum_l = vmlaq_f32(sum_l, vld1q_f32(buffer_l + i), sinc);
+         sum_r = vmlaq_f32(sum_r, vld1q_f32(buffer_r + i), sinc);
+      }
+   }
+
+   /* { l0 + l2, l1 + l3 } and { r0 + r2, r1 + r3 },
+    * then pairwise to { L, R }. */
+   sum = vpadd_f32(
+         vadd_f32(vget_low_f32(sum_l), vget_high_f32(sum_l)),
+         vadd_f32(vget_low_f32(sum_r), vget_high_f32(sum_r)));
+
+   vst1_f32(out_buffer, sum);
 }
-#else /* Plain ol' C99 */
-#define process_sinc_func process_sinc_C
 #endif
 
 static void resampler_sinc_process(void *re_, struct resampler_data *data)
 {
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)re_;
 
-   uint32_t ratio = PHASES / data->ratio;
+   uint32_t phases = re->phases;
+   uint32_t ratio  = phases / data->ratio;
 
    const float *input = data->data_in;
    float *output      = data->data_out;
@@ -444,7 +575,7 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
 
    while (frames)
    {
-      while (frames && re->time >= PHASES)
+      while (frames && re->time >= phases)
       {
          /* Push in reverse to make filter more obvious. */
          if (!re->ptr)
@@ -454,13 +585,13 @@ static void resampler_sinc_process(void *re_, struct resampler_data *data)
          re->buffer_l[re->ptr + re->taps] = re->buffer_l[re->ptr] = *input++;
          re->buffer_r[re->ptr + re->taps] = re->buffer_r[re->ptr] = *input++;
 
-         re->time -= PHASES;
+         re->time -= phases;
          frames--;
       }
 
-      while (re->time < PHASES)
+      while (re->time < phases)
       {
-         process_sinc_func(re, output);
+         re->process(re, output);
          output += 2;
          out_frames++;
          re->time += ratio;
@@ -478,22 +609,111 @@ static void resampler_sinc_free(void *re)
    free(resampler);
 }
 
+static const struct sinc_quality *sinc_find_quality(
+      const struct resampler_config *config, void *userdata)
+{
+   unsigned i;
+   char *ident = NULL;
+   const struct sinc_quality *quality = NULL;
+
+   config->get_string(userdata, "quality", &ident, SINC_DEFAULT_QUALITY);
+
+   for (i = 0; i < sizeof(sinc_qualities) / sizeof(sinc_qualities[0]); i++)
+   {
+      if (ident && strcasecmp(ident, sinc_qualities[i].ident) == 0)
+      {
+         quality = &sinc_qualities[i];
+         break;
+      }
+   }
+
+   if (!quality)
+   {
+      RARCH_LOG("Unknown SINC quality \"%s\", using \"%s\".\n",
+            ident ? ident : "", SINC_DEFAULT_QUALITY);
+      for (i = 0; i < sizeof(sinc_qualities) / sizeof(sinc_qualities[0]); i++)
+         if (strcmp(SINC_DEFAULT_QUALITY, sinc_qualities[i].ident) == 0)
+            quality = &sinc_qualities[i];
+   }
+
+   config->free(ident);
+   return quality;
+}
+
+/* Picks a kernel for the host and returns how many taps
+ * it processes at once. */
+static unsigned sinc_find_kernel(rarch_sinc_resampler_t *re,
+      resampler_simd_mask_t mask, const char **ident)
+{
+#ifdef HAVE_SINC_AVX2
+   if ((mask & RESAMPLER_SIMD_AVX2) && (mask & RESAMPLER_SIMD_FMA) &&
+         re->taps >= SINC_AVX2_MIN_TAPS)
+   {
+      re->process = process_sinc_avx2;
+      *ident      = "AVX2";
+      return 8;
+   }
+#endif
+#ifdef HAVE_SINC_AVX
+   if ((mask & RESAMPLER_SIMD_AVX) && re->taps >= SINC_AVX_MIN_TAPS)
+   {
+      re->process = process_sinc_avx;
+      *ident      = "AVX";
+      return 8;
+   }
+#endif
+#ifdef __SSE__
+   if (mask & RESAMPLER_SIMD_SSE)
+   {
+      re->process = process_sinc_sse;
+      *ident      = "SSE";
+      return 4;
+   }
+#endif
+#ifdef HAVE_SINC_NEON
+   if (mask & RESAMPLER_SIMD_NEON)
+   {
+      re->process = process_sinc_neon;
+      *ident      = "NEON";
+      return 4;
+   }
+#endif
+
+   (void)mask;
+   re->process = process_sinc_C;
+   *ident      = "C";
+   return 1;
+}
+
 static void *resampler_sinc_new(const struct resampler_config *config,
-      double bandwidth_mod, resampler_simd_mask_t mask)
+      void *userdata, double bandwidth_mod, resampler_simd_mask_t mask)
 {
+   int taps;
+   unsigned align;
    size_t phase_elems, elems;
    double cutoff;
+   const char *kernel = NULL;
+   const struct sinc_quality *quality = NULL;
    rarch_sinc_resampler_t *re = (rarch_sinc_resampler_t*)
       calloc(1, sizeof(*re));
-   (void)config;
 
    if (!re)
       return NULL;
 
-   memset(re, 0, sizeof(*re));
+   quality = sinc_find_quality(config, userdata);
+
+   /* An explicit tap count overrides the one of the quality level. */
+   config->get_int(userdata, "taps", &taps, quality->sidelobes * 2);
+   if (taps < 2)
+      taps = quality->sidelobes * 2;
 
-   re->taps = g_settings.audio.sinc_taps;
-   cutoff = CUTOFF;
+   re->quality       = quality;
+   re->taps          = taps;
+   re->subphase_bits = quality->subphase_bits;
+   re->subphase_mask = (1 << quality->subphase_bits) - 1;
+   re->subphase_mod  = 1.0f / (1 << quality->subphase_bits);
+   re->phases        = 1 << (quality->phase_bits + quality->subphase_bits);
+   cutoff            = quality->cutoff;
 
    /* Downsampling, must lower cutoff, and extend number of 
     * taps accordingly to keep same stopband attenuation. */
@@ -503,46 +723,34 @@ static void *resampler_sinc_new(const struct resampler_config *config,
       re->taps = (unsigned)ceil(re->taps / bandwidth_mod);
    }
 
-   /* Be SIMD-friendly. */
-#if (defined(__AVX__) && ENABLE_AVX) || defined(__ARM_NEON__)
-   re->taps = (re->taps + 7) & ~7;
-#else
-   re->taps = (re->taps + 3) & ~3;
-#endif
+   /* Be SIMD-friendly. Rounding to 4 keeps the coefficient rows
+    * 16-byte aligned even for the C kernel. */
+   align = sinc_find_kernel(re, mask, &kernel);
+   if (align < 4)
+      align = 4;
+   re->taps = (re->taps + align - 1) & ~(align - 1);
 
-   phase_elems = (1 << PHASE_BITS) * re->taps;
-#if SINC_COEFF_LERP
-   phase_elems *= 2;
-#endif
+   phase_elems = (1 << quality->phase_bits) * re->taps;
+   if (quality->coeff_lerp)
+      phase_elems *= 2;
    elems = phase_elems + 4 * re->taps;
 
    re->main_buffer = (float*)
       aligned_alloc__(128, sizeof(float) * elems);
    if (!re->main_buffer)
       goto error;
+   memset(re->main_buffer, 0, sizeof(float) * elems);
 
    re->phase_table = re->main_buffer;
    re->buffer_l = re->main_buffer + phase_elems;
    re->buffer_r = re->buffer_l + 2 * re->taps;
 
    init_sinc_table(re, cutoff, re->phase_table,
-         1 << PHASE_BITS, re->taps, SINC_COEFF_LERP);
-
-#if defined(__AVX__) && ENABLE_AVX
-   RARCH_LOG("Sinc resampler [AVX]\n");
-#elif defined(__SSE__)
-   RARCH_LOG("Sinc resampler [SSE]\n");
-#elif defined(__ARM_NEON__)
-   process_sinc_func = mask & RESAMPLER_SIMD_NEON 
-      ? process_sinc_neon : process_sinc_C;
-   RARCH_LOG("Sinc resampler [%s]\n",
-         mask & RESAMPLER_SIMD_NEON ? "NEON" : "C");
-#else
-   RARCH_LOG("Sinc resampler [C]\n");
-#endif
+         1 << quality->phase_bits, re->taps, quality->coeff_lerp);
 
-   RARCH_LOG("SINC params (%u phase bits, %u taps).\n",
-         PHASE_BITS, re->taps);
+   RARCH_LOG("Sinc resampler [%s]\n", kernel);
+   RARCH_LOG("SINC params (%s quality, %u phase bits, %u taps).\n",
+         quality->ident, quality->phase_bits, re->taps);
    return re;
 
 error:
@@ -26,7 +26,7 @@
 #include <rthreads/rthreads.h>
 
 #include "../general.h"
-#include "../fifo_buffer.h"
+#include "../spsc_buffer.h"
 
 typedef struct sdl_audio
 {
@@ -35,16 +35,18 @@ typedef struct sdl_audio
 
    slock_t *lock;
    scond_t *cond;
-   fifo_buffer_t *buffer;
+   spsc_buffer_t *buffer;
+   int64_t period_usec;
 } sdl_audio_t;
 
 static void sdl_audio_cb(void *data, Uint8 *stream, int len)
 {
    sdl_audio_t *sdl = (sdl_audio_t*)data;
 
-   size_t avail = fifo_read_avail(sdl->buffer);
+   // Lock-free, a blocked writer waits with a timeout in case it misses the signal.
+   size_t avail = spsc_read_avail(sdl->buffer);
    size_t write_size = len > (int)avail ? avail : len;
-   fifo_read(sdl->buffer, stream, write_size);
+   spsc_read(sdl->buffer, stream, write_size);
    scond_signal(sdl->cond);
 
    // If underrun, fill rest with silence.
@@ -96,16 +98,17 @@ static void *sdl_audio_init(const char *device, unsigned rate, unsigned latency)
 
    sdl->lock = slock_new();
    sdl->cond = scond_new();
+   sdl->period_usec = (int64_t)out.samples * 1000000 / out.freq;
 
    RARCH_LOG("SDL audio: Requested %u ms latency, got %d ms\n", latency, (int)(out.samples * 4 * 1000 / g_settings.audio.out_rate));
 
    // Create a buffer twice as big as needed and prefill the buffer.
    size_t bufsize = out.samples * 4 * sizeof(int16_t);
    void *tmp = calloc(1, bufsize);
-   sdl->buffer = fifo_new(bufsize);
-   if (tmp)
+   sdl->buffer = spsc_new(bufsize);
+   if (tmp && sdl->buffer)
    {
-      fifo_write(sdl->buffer, tmp, bufsize);
+      spsc_write(sdl->buffer, tmp, bufsize);
       free(tmp);
    }
 
@@ -120,11 +123,9 @@ static ssize_t sdl_audio_write(void *data, const void *buf, size_t size)
    ssize_t ret = 0;
    if (sdl->nonblock)
    {
-      SDL_LockAudio();
-      size_t avail = fifo_write_avail(sdl->buffer);
+      size_t avail = spsc_write_avail(sdl->buffer);
       size_t write_amt = avail > size ? size : avail;
-      fifo_write(sdl->buffer, buf, write_amt);
-      SDL_UnlockAudio();
+      spsc_write(sdl->buffer, buf, write_amt);
       ret = write_amt;
    }
    else
@@ -132,21 +133,19 @@ static ssize_t sdl_audio_write(void *data, const void *buf, size_t size)
       size_t written = 0;
       while (written < size)
       {
-         SDL_LockAudio();
-         size_t avail = fifo_write_avail(sdl->buffer);
+         size_t avail = spsc_write_avail(sdl->buffer);
 
          if (avail == 0)
          {
-            SDL_UnlockAudio();
             slock_lock(sdl->lock);
-            scond_wait(sdl->cond, sdl->lock);
+            if (spsc_write_avail(sdl->buffer) == 0)
+               scond_wait_timeout(sdl->cond, sdl->lock, sdl->period_usec);
             slock_unlock(sdl->lock);
          }
          else
          {
             size_t write_amt = size - written > avail ? avail : size - written;
-            fifo_write(sdl->buffer, (const char*)buf + written, write_amt);
-            SDL_UnlockAudio();
+            spsc_write(sdl->buffer, (const char*)buf + written, write_amt);
             written += write_amt;
          }
       }
@@ -195,7 +194,7 @@ static void sdl_audio_free(void *data)
    sdl_audio_t *sdl = (sdl_audio_t*)data;
    if (sdl)
    {
-      fifo_free(sdl->buffer);
+      spsc_free(sdl->buffer);
       slock_free(sdl->lock);
       scond_free(sdl->cond);
    }
@@ -208,6 +207,19 @@ static bool sdl_use_float(void *data)
    return false;
 }
 
+static size_t sdl_audio_write_acquire(void *data, audio_write_region_t *region)
+{
+   sdl_audio_t *sdl = (sdl_audio_t*)data;
+   return spsc_write_acquire(sdl->buffer, &region->chunk1, &region->size1,
+         &region->chunk2, &region->size2);
+}
+
+static void sdl_audio_write_commit(void *data, size_t size)
+{
+   sdl_audio_t *sdl = (sdl_audio_t*)data;
+   spsc_write_commit(sdl->buffer, size);
+}
+
 audio_driver_t audio_sdl = {
    sdl_audio_init,
    sdl_audio_write,
@@ -223,5 +235,7 @@ audio_driver_t audio_sdl = {
    "sdl",
 #endif
    NULL,
-   NULL
+   NULL,
+   sdl_audio_write_acquire,
+   sdl_audio_write_commit
 };
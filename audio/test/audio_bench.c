@@ -0,0 +1,409 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Headless benchmark of the audio path behind audio_flush().
+ *
+ * A fake core produces 32040 Hz stereo at 60 fps, in a few batches
+ * per frame. Each batch goes through the same steps as audio_flush():
+ * s16 -> float, DSP chain, rate control, resampler, float -> s16, or
+ * the int16 resampler path when there is no DSP. The result goes to a
+ * sink which plays at 48 kHz on its own simulated clock, only reports
+ * free space in whole periods, and blocks when full, like a typical
+ * driver. Nothing sleeps, time is simulated.
+ *
+ * Two sweeps:
+ * - Resampler x DSP chain: CPU time per second of audio, and how many
+ *   times faster than real time that is.
+ * - Rate control mode x clock drift: where the buffer settles, how
+ *   much it wobbles, how long it takes to get there, under/overruns.
+ *
+ * Usage: test-audio-bench [chain.dsp ...]
+ * The DSP chains default to a few of the presets in ../filters. */
+
+#include "../resamplers/resampler.h"
+#include "../dsp_filter.h"
+#include "../audio_rate_control.h"
+#include "../utils.h"
+#include "../../libretro.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <math.h>
+#include <time.h>
+
+#define IN_RATE       32040.0
+#define OUT_RATE      48000.0
+#define FPS           60.0
+#define LATENCY       0.064
+#define PERIOD_FRAMES 256
+/* Same bound audio_sample_batch() puts on one flush. */
+#define MAX_SAMPLES   2048
+
+/* What the resampled, DSP'd audio is allowed to grow to. */
+#define OUT_SAMPLES   (MAX_SAMPLES * 16)
+
+/* The builtin DSP plugs ask the host what the CPU can do. */
+uint64_t rarch_get_cpu_features(void)
+{
+   uint64_t cpu = 0;
+#ifdef __SSE__
+   cpu |= RETRO_SIMD_SSE;
+#endif
+#ifdef __SSE2__
+   cpu |= RETRO_SIMD_SSE2;
+#endif
+#ifdef __AVX__
+   cpu |= RETRO_SIMD_AVX;
+#endif
+#ifdef __AVX2__
+   cpu |= RETRO_SIMD_AVX2;
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+   cpu |= RETRO_SIMD_NEON;
+#endif
+   return cpu;
+}
+
+/* Stands in for the audio driver. Sizes are in bytes of s16 stereo. */
+struct sink
+{
+   double fill;
+   double size;
+   double rate;
+   double period;
+   double time;
+
+   unsigned underruns;
+   unsigned blocks;
+};
+
+static void sink_init(struct sink *sink, double drift)
+{
+   memset(sink, 0, sizeof(*sink));
+   sink->size   = floor(LATENCY * OUT_RATE) * 4;
+   sink->rate   = OUT_RATE * 4 * (1.0 + drift);
+   sink->period = PERIOD_FRAMES * 4;
+}
+
+static void sink_advance(struct sink *sink, double dt)
+{
+   sink->time += dt;
+   sink->fill -= sink->rate * dt;
+   if (sink->fill < 0.0)
+   {
+      sink->fill = 0.0;
+      sink->underruns++;
+   }
+}
+
+static size_t sink_write_avail(const struct sink *sink)
+{
+   return (size_t)(floor((sink->size - sink->fill) / sink->period) *
+         sink->period);
+}
+
+static void sink_write(struct sink *sink, size_t bytes)
+{
+   double over = sink->fill + bytes - sink->size;
+
+   /* Blocks until the device made room. */
+   if (over > 0.0)
+   {
+      sink_advance(sink, over / sink->rate);
+      sink->blocks++;
+   }
+   sink->fill += bytes;
+}
+
+struct scenario
+{
+   const char *resampler;
+   const char *dsp;
+   int rate_control; /* 0: off, 1: proportional, 2: PI. */
+   double drift;
+   double seconds;
+};
+
+struct result
+{
+   double cpu;   /* Seconds spent in the audio path. */
+   double audio; /* Seconds of audio produced by the core. */
+
+   double fill_mean;
+   double fill_stddev;
+   double settle_time;
+   double drift_estimate;
+   unsigned underruns;
+   unsigned blocks;
+};
+
+static double get_cpu_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* Two tones and a bit of noise, continuous across calls. */
+static void gen_core_audio(int16_t *out, size_t frames, uint64_t *pos)
+{
+   size_t i;
+
+   for (i = 0; i < frames; i++, (*pos)++)
+   {
+      double t     = *pos / IN_RATE;
+      double noise = (rand() / (double)RAND_MAX - 0.5) * 0.05;
+      out[2 * i + 0] = (int16_t)(0x7fff *
+            (0.4 * sin(2.0 * M_PI * 440.0 * t) + noise));
+      out[2 * i + 1] = (int16_t)(0x7fff *
+            (0.4 * sin(2.0 * M_PI * 659.25 * t) - noise));
+   }
+}
+
+static int run(const struct scenario *sc, struct result *res)
+{
+   const rarch_resampler_t *backend = NULL;
+   void *resampler                  = NULL;
+   rarch_dsp_filter_t *dsp          = NULL;
+   audio_rate_control_t rc          = {0};
+   struct sink sink;
+   uint64_t pos                     = 0;
+   double   frame_acc               = 0.0;
+   double   orig_ratio              = OUT_RATE / IN_RATE;
+   double   half_time               = 0.0;
+   double   var                     = 0.0;
+   unsigned frame, frames, tail;
+   int16_t *core_buf = NULL, *out_s16 = NULL;
+   float   *in_float = NULL, *out_float = NULL;
+   /* Average fill during each video frame. */
+   float   *history  = NULL;
+
+   memset(res, 0, sizeof(*res));
+   sink_init(&sink, sc->drift);
+   half_time = (sink.size / 2) / (OUT_RATE * 4);
+
+   frames   = (unsigned)(sc->seconds * FPS);
+   core_buf = (int16_t*)malloc(MAX_SAMPLES * sizeof(int16_t));
+   out_s16  = (int16_t*)malloc(OUT_SAMPLES * sizeof(int16_t));
+   in_float = (float*)malloc(MAX_SAMPLES * sizeof(float));
+   out_float = (float*)malloc(OUT_SAMPLES * sizeof(float));
+   history  = (float*)calloc(frames, sizeof(float));
+
+   if (!core_buf || !out_s16 || !in_float || !out_float || !history)
+      goto error;
+
+   if (!rarch_resampler_realloc(&resampler, &backend,
+            sc->resampler, orig_ratio))
+   {
+      fprintf(stderr, "Failed to create resampler \"%s\".\n", sc->resampler);
+      goto error;
+   }
+
+   if (sc->dsp && !(dsp = rarch_dsp_filter_new(sc->dsp, IN_RATE)))
+   {
+      fprintf(stderr, "Failed to create DSP chain \"%s\".\n", sc->dsp);
+      goto error;
+   }
+
+   srand(1);
+
+   for (frame = 0; frame < frames; frame++)
+   {
+      /* Cores typically hand over a frame of audio in a few pieces. */
+      unsigned batch;
+      size_t   core_frames;
+
+      frame_acc  += IN_RATE / FPS;
+      core_frames = (size_t)frame_acc;
+      frame_acc  -= core_frames;
+
+      for (batch = 0; batch < 4; batch++)
+      {
+         double   start, ratio = orig_ratio;
+         size_t   bytes, batch_frames = core_frames / 4 +
+            (batch == 3 ? core_frames % 4 : 0);
+         size_t   avail = sink_write_avail(&sink);
+
+         gen_core_audio(core_buf, batch_frames, &pos);
+
+         start = get_cpu_time();
+
+         if (sc->rate_control)
+            ratio *= audio_rate_control_update(&rc, 0.005,
+                  sc->rate_control == 2, false, avail, (size_t)sink.size,
+                  half_time, batch_frames / IN_RATE);
+
+         if (!dsp && backend->process_s16)
+         {
+            struct resampler_data_s16 src = {0};
+            src.data_in      = core_buf;
+            src.input_frames = batch_frames;
+            src.data_out     = out_s16;
+            src.ratio        = ratio;
+            backend->process_s16(resampler, &src);
+            bytes = src.output_frames * 4;
+         }
+         else
+         {
+            struct resampler_data src    = {0};
+            struct rarch_dsp_data dsp_data = {0};
+
+            audio_convert_s16_to_float(in_float, core_buf,
+                  batch_frames * 2, 1.0f);
+
+            dsp_data.input        = in_float;
+            dsp_data.input_frames = batch_frames;
+            if (dsp)
+               rarch_dsp_filter_process(dsp, &dsp_data);
+
+            src.data_in      = dsp_data.output ? dsp_data.output : in_float;
+            src.input_frames = dsp_data.output ?
+               dsp_data.output_frames : batch_frames;
+            src.data_out     = out_float;
+            src.ratio        = ratio;
+            rarch_resampler_process(backend, resampler, &src);
+
+            audio_convert_float_to_s16(out_s16, out_float,
+                  src.output_frames * 2);
+            bytes = src.output_frames * 4;
+         }
+
+         res->cpu += get_cpu_time() - start;
+         sink_write(&sink, bytes);
+      }
+
+      /* The core ran in no time, so the buffer drains linearly
+       * from here until the next frame. Take the average. */
+      history[frame] = (sink.fill - sink.rate / (2.0 * FPS)) / sink.size;
+      sink_advance(&sink, 1.0 / FPS);
+   }
+
+   res->audio          = pos / IN_RATE;
+   res->underruns      = sink.underruns;
+   res->blocks         = sink.blocks;
+   res->drift_estimate = rc.drift;
+
+   /* Where the buffer ends up over the last fifth of the run, and
+    * the last time it was further than 5 points away from that. */
+   tail = frames / 5;
+   for (frame = frames - tail; frame < frames; frame++)
+      res->fill_mean += history[frame];
+   res->fill_mean /= tail;
+
+   for (frame = frames - tail; frame < frames; frame++)
+      var += (history[frame] - res->fill_mean) *
+         (history[frame] - res->fill_mean);
+   res->fill_stddev = sqrt(var / tail);
+
+   for (frame = frames; frame > 0; frame--)
+      if (fabs(history[frame - 1] - res->fill_mean) > 0.05)
+         break;
+   res->settle_time = frame / FPS;
+
+   free(core_buf);
+   free(out_s16);
+   free(in_float);
+   free(out_float);
+   free(history);
+   rarch_dsp_filter_free(dsp);
+   rarch_resampler_freep(&backend, &resampler);
+   return 1;
+
+error:
+   free(core_buf);
+   free(out_s16);
+   free(in_float);
+   free(out_float);
+   free(history);
+   rarch_dsp_filter_free(dsp);
+   if (backend)
+      rarch_resampler_freep(&backend, &resampler);
+   return 0;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, j;
+   int ok = 1;
+   static const char *resamplers[] = { "sinc", "polyphase", "CC", "nearest" };
+   static const char *default_chains[] = {
+      NULL,
+      "../filters/IIR.dsp",
+      "../filters/EQ.dsp",
+      "../filters/Chorus.dsp",
+   };
+   static const double drifts[] = { 0.0, 0.001, -0.003 };
+   static const char *rc_names[] = { "off", "P", "PI" };
+   const char **chains = default_chains;
+   unsigned num_chains = sizeof(default_chains) / sizeof(default_chains[0]);
+
+   if (argc > 1)
+   {
+      chains     = (const char**)argv + 1;
+      num_chains = argc - 1;
+   }
+
+   audio_convert_init_simd();
+
+   printf("Core %.0f Hz at %.0f fps, sink %.0f Hz, %.0f ms in %u-frame periods.\n\n",
+         IN_RATE, FPS, OUT_RATE, LATENCY * 1000.0, PERIOD_FRAMES);
+
+   printf("%-10s %-24s %12s %10s\n",
+         "resampler", "dsp", "cpu ms/s", "realtime");
+   for (i = 0; i < sizeof(resamplers) / sizeof(resamplers[0]); i++)
+   {
+      for (j = 0; j < num_chains; j++)
+      {
+         struct result res;
+         struct scenario sc = { resamplers[i], chains[j], 1, 0.0, 30.0 };
+
+         if (!run(&sc, &res))
+         {
+            ok = 0;
+            continue;
+         }
+
+         printf("%-10s %-24s %12.3f %9.0fx\n", sc.resampler,
+               sc.dsp ? sc.dsp : "none",
+               1000.0 * res.cpu / res.audio, res.audio / res.cpu);
+      }
+   }
+
+   printf("\n%-4s %9s %8s %8s %10s %10s %6s %6s\n",
+         "rc", "drift", "fill %", "stddev", "settle s", "est. ppm",
+         "under", "block");
+   for (i = 0; i < sizeof(rc_names) / sizeof(rc_names[0]); i++)
+   {
+      for (j = 0; j < sizeof(drifts) / sizeof(drifts[0]); j++)
+      {
+         struct result res;
+         struct scenario sc = { "CC", NULL, (int)i, drifts[j], 180.0 };
+
+         if (!run(&sc, &res))
+         {
+            ok = 0;
+            continue;
+         }
+
+         printf("%-4s %6.0f ppm %8.1f %8.2f %10.1f %10.0f %6u %6u\n",
+               rc_names[i], sc.drift * 1e6, 100.0 * res.fill_mean,
+               100.0 * res.fill_stddev, res.settle_time,
+               res.drift_estimate * 1e6, res.underruns, res.blocks);
+      }
+   }
+
+   return ok ? 0 : 1;
+}
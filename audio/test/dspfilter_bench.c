@@ -0,0 +1,250 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs a few seconds of stereo noise and tones through the DSP
+ * filters that have SIMD versions, in the block sizes audio_flush()
+ * hands them, and reports ns per stereo frame. The SIMD versions
+ * reorder a few float operations, so they are compared against the
+ * generic output with a tolerance instead of bit for bit. */
+
+#include "../filters/dspfilter.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <time.h>
+#include <stdbool.h>
+
+#define RATE    48000.0f
+#define FRAMES  (48000 * 4)
+/* About one video frame worth of audio. */
+#define BLOCK   800
+#define BATCHES 5
+/* Relative to the peak of the generic output. */
+#define TOLERANCE 1e-4
+
+extern const struct dspfilter_implementation *iir_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *phaser_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *wahwah_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+extern const struct dspfilter_implementation *echo_dspfilter_get_implementation(dspfilter_simd_mask_t mask);
+
+static const dspfilter_get_implementation_t filters[] = {
+   iir_dspfilter_get_implementation,
+   phaser_dspfilter_get_implementation,
+   wahwah_dspfilter_get_implementation,
+   echo_dspfilter_get_implementation,
+};
+
+static const struct
+{
+   const char *name;
+   dspfilter_simd_mask_t simd;
+} impls[] = {
+   { "generic", 0 },
+#if defined(__x86_64__) || defined(__i386__)
+   { "sse2",    DSPFILTER_SIMD_SSE2 },
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+   { "neon",    DSPFILTER_SIMD_NEON },
+#endif
+};
+
+/* Every key falls back to the filter's default. */
+static int config_get_float(void *userdata, const char *key,
+      float *value, float default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+static int config_get_int(void *userdata, const char *key,
+      int *value, int default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+static int config_get_float_array(void *userdata, const char *key,
+      float **values, unsigned *out_num_values,
+      const float *default_values, unsigned num_default_values)
+{
+   *values = (float*)calloc(num_default_values, sizeof(float));
+   memcpy(*values, default_values, num_default_values * sizeof(float));
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+static int config_get_int_array(void *userdata, const char *key,
+      int **values, unsigned *out_num_values,
+      const int *default_values, unsigned num_default_values)
+{
+   *values = (int*)calloc(num_default_values, sizeof(int));
+   memcpy(*values, default_values, num_default_values * sizeof(int));
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+static int config_get_string(void *userdata, const char *key,
+      char **output, const char *default_output)
+{
+   *output = strdup(default_output);
+   return 0;
+}
+
+static const struct dspfilter_config config = {
+   config_get_float,
+   config_get_int,
+   config_get_float_array,
+   config_get_int_array,
+   config_get_string,
+   free,
+};
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* Two detuned tones plus some noise, different on each side. */
+static void gen_signal(float *out, size_t frames)
+{
+   size_t i;
+
+   srand(1);
+   for (i = 0; i < frames; i++)
+   {
+      float noise = (rand() / (float)RAND_MAX - 0.5f) * 0.2f;
+      out[2 * i + 0] = 0.4f * sin(i * 2.0 * M_PI * 440.0 / RATE) + noise;
+      out[2 * i + 1] = 0.4f * sin(i * 2.0 * M_PI * 554.0 / RATE) - noise;
+   }
+}
+
+/* Processes the whole signal once per batch on a fresh instance, and
+ * leaves the output of the last batch in out. Returns ns per frame. */
+static double run(const struct dspfilter_implementation *impl,
+      dspfilter_simd_mask_t simd, const float *signal, float *out)
+{
+   unsigned batch;
+   size_t i;
+   double best = 0.0;
+   struct dspfilter_info info = { RATE };
+   float *buf = (float*)malloc(FRAMES * 2 * sizeof(float));
+
+   if (!buf)
+      return 0.0;
+
+   for (batch = 0; batch < BATCHES; batch++)
+   {
+      double start;
+      void *data = impl->init(&info, &config, NULL);
+      if (!data)
+         break;
+
+      memcpy(buf, signal, FRAMES * 2 * sizeof(float));
+      start = get_time();
+
+      for (i = 0; i < FRAMES; i += BLOCK)
+      {
+         struct dspfilter_output output = {0};
+         struct dspfilter_input input   = {0};
+
+         input.samples = buf + 2 * i;
+         input.frames  = FRAMES - i < BLOCK ? FRAMES - i : BLOCK;
+         impl->process(data, &output, &input);
+
+         /* All of these work in place. */
+         if (output.samples != input.samples || output.frames != input.frames)
+            memcpy(input.samples, output.samples,
+                  output.frames * 2 * sizeof(float));
+      }
+
+      start = get_time() - start;
+      if (!batch || start < best)
+         best = start;
+
+      impl->free(data);
+   }
+
+   memcpy(out, buf, FRAMES * 2 * sizeof(float));
+   free(buf);
+   return best * 1e9 / FRAMES;
+}
+
+int main(void)
+{
+   unsigned i, j;
+   size_t k;
+   bool ok       = true;
+   float *signal = (float*)malloc(FRAMES * 2 * sizeof(float));
+   float *ref    = (float*)malloc(FRAMES * 2 * sizeof(float));
+   float *out    = (float*)malloc(FRAMES * 2 * sizeof(float));
+
+   if (!signal || !ref || !out)
+      return 1;
+
+   gen_signal(signal, FRAMES);
+   printf("%u frames at %.0f Hz, %u frames per call.\n",
+         FRAMES, RATE, BLOCK);
+
+   for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+   {
+      const struct dspfilter_implementation *last = NULL;
+      double peak = 0.0;
+
+      for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++)
+      {
+         double ns, diff = 0.0;
+         const struct dspfilter_implementation *impl =
+            filters[i](impls[j].simd);
+
+         if (j && impl == last)
+            continue;
+
+         last = impl;
+         ns   = run(impl, impls[j].simd, signal, j ? out : ref);
+
+         if (!j)
+         {
+            for (k = 0; k < FRAMES * 2; k++)
+               if (fabs(ref[k]) > peak)
+                  peak = fabs(ref[k]);
+            printf("%-20s %-7s %7.2f ns/frame\n", impl->ident,
+                  impls[j].name, ns);
+            continue;
+         }
+
+         for (k = 0; k < FRAMES * 2; k++)
+            if (fabs(out[k] - ref[k]) > diff)
+               diff = fabs(out[k] - ref[k]);
+
+         printf("%-20s %-7s %7.2f ns/frame, max diff %.3g\n", impl->ident,
+               impls[j].name, ns, diff);
+
+         if (diff > TOLERANCE * peak)
+         {
+            fprintf(stderr, "%s (%s): output differs from generic.\n",
+                  impl->ident, impls[j].name);
+            ok = false;
+         }
+      }
+   }
+
+   free(signal);
+   free(ref);
+   free(out);
+   return ok ? 0 : 1;
+}
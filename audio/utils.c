@@ -46,6 +46,23 @@ void audio_convert_float_to_s16_C(int16_t *out,
    }
 }
 
+void audio_convert_s16_gain(int16_t *out,
+      const int16_t *in, size_t samples, float gain)
+{
+   size_t i;
+   /* Q12, the volume setting tops out at +12 dB. */
+   int32_t gain_fixed = (int32_t)(gain * 0x1000 + 0.5f);
+   if (gain_fixed > 0x7fff)
+      gain_fixed = 0x7fff;
+
+   for (i = 0; i < samples; i++)
+   {
+      int32_t val = (in[i] * gain_fixed + 0x800) >> 12;
+      out[i] = (val > 0x7FFF) ? 0x7FFF :
+         (val < -0x8000 ? -0x8000 : (int16_t)val);
+   }
+}
+
 #if defined(__SSE2__)
 void audio_convert_s16_to_float_SSE2(float *out,
       const int16_t *in, size_t samples, float gain)
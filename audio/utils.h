@@ -73,6 +73,10 @@ void audio_convert_s16_to_float_C(float *out,
 void audio_convert_float_to_s16_C(int16_t *out,
       const float *in, size_t samples);
 
+/* Volume for the int16 path, in and out may alias. */
+void audio_convert_s16_gain(int16_t *out,
+      const int16_t *in, size_t samples, float gain);
+
 void audio_convert_init_simd(void);
 
 #ifdef __cplusplus
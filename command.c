@@ -45,6 +45,9 @@ struct rarch_cmd
 
 #if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
    int net_fd;
+   /* Sender of the packet being parsed, queries answer there. */
+   struct sockaddr_storage reply_addr;
+   socklen_t reply_addr_len;
 #endif
 
    bool state[RARCH_BIND_LIST_END];
@@ -190,6 +193,7 @@ static const struct cmd_map map[] = {
    { "STATE_SLOT_PLUS",        RARCH_STATE_SLOT_PLUS },
    { "STATE_SLOT_MINUS",       RARCH_STATE_SLOT_MINUS },
    { "REWIND",                 RARCH_REWIND },
+   { "REWIND_SCRUB",           RARCH_REWIND_SCRUB },
   // { "PAUSE_TOGGLE",           RARCH_PAUSE_TOGGLE },
   // { "FRAMEADVANCE",           RARCH_FRAMEADVANCE },
    { "RESET",                  RARCH_RESET },
@@ -250,6 +254,55 @@ static const struct cmd_action_map action_map[] = {
    { "SET_SHADER", cmd_set_shader, "<shader path>" },
 };
 
+/* Queries write a one line reply, which goes back to whoever
+ * asked: the sending socket, or stdout for stdin commands. */
+struct cmd_query_map
+{
+   const char *str;
+   void (*query)(char *buf, size_t size);
+};
+
+static void cmd_get_audio_stats(char *buf, size_t size)
+{
+   audio_statistics_t stats = {0};
+   unsigned underruns, overruns;
+   double ratio, drift;
+
+   if (!g_extern.audio_data.rate_control)
+   {
+      snprintf(buf, size, "GET_AUDIO_STATS rate_control=0\n");
+      return;
+   }
+
+   /* The audio DSP thread may be updating these right now. */
+#ifdef HAVE_THREADS
+   if (g_extern.audio_data.stats_lock)
+      slock_lock(g_extern.audio_data.stats_lock);
+#endif
+   driver_audio_buffer_statistics(&stats);
+   underruns = g_extern.measure_data.audio_underruns;
+   overruns  = g_extern.measure_data.audio_overruns;
+   ratio     = g_extern.audio_data.src_ratio /
+      g_extern.audio_data.orig_src_ratio;
+   drift     = g_extern.audio_data.rate_controller.drift;
+#ifdef HAVE_THREADS
+   if (g_extern.audio_data.stats_lock)
+      slock_unlock(g_extern.audio_data.stats_lock);
+#endif
+
+   snprintf(buf, size,
+         "GET_AUDIO_STATS rate_control=1 fill=%.2f fill_stddev=%.2f "
+         "near_underrun=%.2f near_blocking=%.2f samples=%u "
+         "underruns=%u overruns=%u ratio=%.8f drift_ppm=%.2f\n",
+         stats.average_buffer_saturation, stats.std_deviation_percentage,
+         stats.close_to_underrun, stats.close_to_blocking, stats.samples,
+         underruns, overruns, ratio, drift * 1e6);
+}
+
+static const struct cmd_query_map query_map[] = {
+   { "GET_AUDIO_STATS", cmd_get_audio_stats },
+};
+
 static bool command_get_arg(const char *tok,
       const char **arg, unsigned *index)
 {
@@ -291,11 +344,48 @@ static bool command_get_arg(const char *tok,
    return false;
 }
 
+static void cmd_reply(rarch_cmd_t *handle, const char *reply)
+{
+#if defined(HAVE_NETWORK_CMD) && defined(HAVE_NETPLAY)
+   if (handle->reply_addr_len)
+   {
+      sendto(handle->net_fd, reply, strlen(reply), 0,
+            (struct sockaddr*)&handle->reply_addr, handle->reply_addr_len);
+      return;
+   }
+#endif
+
+   fputs(reply, stdout);
+   fflush(stdout);
+}
+
+static bool parse_query(rarch_cmd_t *handle, const char *tok)
+{
+   unsigned i;
+
+   for (i = 0; i < ARRAY_SIZE(query_map); i++)
+   {
+      char reply[512];
+
+      if (strcmp(tok, query_map[i].str) != 0)
+         continue;
+
+      query_map[i].query(reply, sizeof(reply));
+      cmd_reply(handle, reply);
+      return true;
+   }
+
+   return false;
+}
+
 static void parse_sub_msg(rarch_cmd_t *handle, const char *tok)
 {
    const char *arg = NULL;
    unsigned index  = 0;
 
+   if (parse_query(handle, tok))
+      return;
+
    if (command_get_arg(tok, &arg, &index))
    {
       if (arg)
@@ -354,8 +444,11 @@ static void network_cmd_poll(rarch_cmd_t *handle)
    for (;;)
    {
       char buf[1024];
-      ssize_t ret = recvfrom(handle->net_fd, buf,
-            sizeof(buf) - 1, 0, NULL, NULL);
+      ssize_t ret;
+
+      handle->reply_addr_len = sizeof(handle->reply_addr);
+      ret = recvfrom(handle->net_fd, buf, sizeof(buf) - 1, 0,
+            (struct sockaddr*)&handle->reply_addr, &handle->reply_addr_len);
 
       if (ret <= 0)
          break;
@@ -363,6 +456,8 @@ static void network_cmd_poll(rarch_cmd_t *handle)
       buf[ret] = '\0';
       parse_msg(handle, buf);
    }
+
+   handle->reply_addr_len = 0;
 }
 #endif
 
@@ -592,6 +687,10 @@ static bool verify_command(const char *cmd)
    if (command_get_arg(cmd, NULL, NULL))
       return true;
 
+   for (i = 0; i < ARRAY_SIZE(query_map); i++)
+      if (strcmp(cmd, query_map[i].str) == 0)
+         return true;
+
    RARCH_ERR("Command \"%s\" is not recognized.\n", cmd);
    RARCH_ERR("\tValid commands:\n");
    for (i = 0; i < sizeof(map) / sizeof(map[0]); i++)
@@ -600,6 +699,9 @@ static bool verify_command(const char *cmd)
    for (i = 0; i < sizeof(action_map) / sizeof(action_map[0]); i++)
       RARCH_ERR("\t\t%s %s\n", action_map[i].str, action_map[i].arg_desc);
 
+   for (i = 0; i < ARRAY_SIZE(query_map); i++)
+      RARCH_ERR("\t\t%s\n", query_map[i].str);
+
    return false;
 }
 
@@ -600,6 +600,10 @@ static const float message_pos_offset_y = 0.05;
  * RGB hex value. */
 static const uint32_t message_color = 0xffff00;
 
+/* Number of threads used to run CPU video filters. 
+ * 0 uses one thread per CPU core. */
+static const unsigned video_filter_threads = 0;
+
 /* Record post-filtered (CPU filter) video,
  * rather than raw game output. */
 static const bool post_filter_record = false;
@@ -636,7 +640,8 @@ static const bool allow_rotate = true;
 
 /* AUDIO */
 
-/* Number of taps for the sinc resampler. Higher sound better but slower. */
+/* Number of taps for the sinc resampler. Higher sound better but slower.
+ * 0 uses the tap count of the resampler quality level. */
 static const unsigned sinc_taps = 8;
 
 /* Will enable audio or not. */
@@ -669,6 +674,18 @@ static const bool rate_control = false;
  * is allowed to adjust input rate. */
 static const float rate_control_delta = 0.005;
 
+/* Adds an integral term to rate control, which estimates the
+ * long term clock drift so the audio buffer stays half full. */
+static const bool rate_control_pi = true;
+
+/* Collects the audio of a whole frame and converts,
+ * resamples and writes it in one go after the core ran. */
+static const bool audio_frame_batch = false;
+
+/* Runs DSP filter and resampler on a thread of their own,
+ * at the cost of a few milliseconds of latency. */
+static const bool audio_dsp_thread = false;
+
 /* Default audio volume in dB. (0.0 dB == unity gain). */
 static const float audio_volume = 0.0;
 
@@ -700,6 +717,35 @@ static const unsigned rewind_buffer_size = 20 << 20; /* 20MiB */
 /* How many frames to rewind at a time. */
 static const unsigned rewind_granularity = 1;
 
+/* Compress rewind states on a separate thread. */
+static const bool rewind_threaded = false;
+
+/* Run rewind deltas through an extra LZ pass. Costs CPU time per 
+ * frame, but fits more history into rewind_buffer_size for cores 
+ * whose state changes a lot. */
+static const bool rewind_lz = false;
+
+/* Keep the rewind buffer in a sparse file next to the save states 
+ * instead of RAM. Allows for very large rewind_buffer_size values, and 
+ * history is picked up again the next time the same content runs. */
+static const bool rewind_file_backed = false;
+
+/* Keep a full copy of every Nth rewind state, so jumping back
+ * (see rewind_scrub_seconds) doesn't have to step through every frame.
+ * 0 disables keyframes. Each keyframe costs one save state of memory. */
+static const unsigned rewind_keyframe_interval = 0;
+static const unsigned rewind_keyframes = 8;
+
+/* How far back a rewind scrub jumps. */
+static const unsigned rewind_scrub_seconds = 10;
+
+/* Runs the core this many frames ahead every frame and shows the 
+ * last one, rolling back afterwards. Removes that many frames of 
+ * input lag built into the emulated game, at the cost of running 
+ * the core N + 1 times per frame. Requires save state support. 
+ * 0 disables run-ahead. */
+static const unsigned run_ahead_frames = 0;
+
 /* Pause gameplay when gameplay loses focus. */
 //static const bool pause_nonactive = false;
 
@@ -832,6 +878,7 @@ static const struct retro_keybind retro_keybinds_1[] = {
    { true, RARCH_STATE_SLOT_PLUS,          RETRO_LBL_STATE_SLOT_PLUS,      RETROK_F7,      NO_BTN, 0, AXIS_NONE },
    { true, RARCH_STATE_SLOT_MINUS,         RETRO_LBL_STATE_SLOT_MINUS,     RETROK_F6,      NO_BTN, 0, AXIS_NONE },
    { true, RARCH_REWIND,                   RETRO_LBL_REWIND,               RETROK_r,       NO_BTN, 0, AXIS_NONE },
+   { true, RARCH_REWIND_SCRUB,             RETRO_LBL_REWIND_SCRUB,         RETROK_UNKNOWN, NO_BTN, 0, AXIS_NONE },
   // { true, RARCH_PAUSE_TOGGLE,             RETRO_LBL_PAUSE_TOGGLE,         RETROK_p,       NO_BTN, 0, AXIS_NONE },
   // { true, RARCH_FRAMEADVANCE,             RETRO_LBL_FRAMEADVANCE,         RETROK_k,       NO_BTN, 0, AXIS_NONE },
    { true, RARCH_RESET,                    RETRO_LBL_RESET,                RETROK_h,       NO_BTN, 0, AXIS_NONE },
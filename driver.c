@@ -23,6 +23,7 @@
 #include <math.h>
 #include "compat/posix_string.h"
 #include "audio/utils.h"
+#include "retro.h"
 #include "gfx/video_thread_wrapper.h"
 #include "audio/audio_thread_wrapper.h"
 #include "gfx/gfx_common.h"
@@ -687,15 +688,24 @@ void driver_set_monitor_refresh_rate(float hz)
    //RARCH_LOG("%s\n", msg);
 
    g_settings.video.refresh_rate = hz;
+#ifdef HAVE_THREADS
+   audio_dsp_thread_flush(g_extern.audio_data.dsp_thread);
+#endif
    adjust_system_rates();
 
    g_extern.audio_data.orig_src_ratio =
       g_extern.audio_data.src_ratio =
       (double)g_settings.audio.out_rate / g_extern.audio_data.in_rate;
+   memset(&g_extern.audio_data.rate_controller, 0,
+         sizeof(g_extern.audio_data.rate_controller));
 }
 
 void driver_set_nonblock_state(bool nonblock)
 {
+#ifdef HAVE_THREADS
+   audio_dsp_thread_flush(g_extern.audio_data.dsp_thread);
+#endif
+
    /* Only apply non-block-state for video if we're using vsync. */
    if (driver.video_active && driver.video_data)
    {
@@ -823,6 +833,7 @@ static void init_audio(void)
    g_extern.audio_data.nonblock_chunk_size = AUDIO_CHUNK_SIZE_NONBLOCKING;
    g_extern.audio_data.chunk_size          = 
       g_extern.audio_data.block_chunk_size;
+   g_extern.audio_data.frame_batch         = g_settings.audio.frame_batch;
 
    /* Needs to be able to hold full content of a full max_bufsamples
     * in addition to its own. */
@@ -923,6 +934,10 @@ static void init_audio(void)
    rarch_main_command(RARCH_CMD_DSP_FILTER_DEINIT);
 
    g_extern.measure_data.buffer_free_samples_count = 0;
+   g_extern.measure_data.audio_underruns           = 0;
+   g_extern.measure_data.audio_overruns            = 0;
+   memset(&g_extern.audio_data.rate_controller, 0,
+         sizeof(g_extern.audio_data.rate_controller));
 
    if (driver.audio_active && !g_extern.audio_data.mute &&
          g_extern.system.audio_callback.callback)
@@ -930,6 +945,31 @@ static void init_audio(void)
       /* Threaded driver is initially stopped. */
       driver.audio->start(driver.audio_data);
    }
+
+#ifdef HAVE_THREADS
+   if (g_settings.audio.dsp_thread && driver.audio_active &&
+         !g_extern.system.audio_callback.callback)
+   {
+      RARCH_LOG("Starting audio DSP thread ...\n");
+
+      /* Room for a full nonblocking chunk, but blocking writes only
+       * run one blocking chunk ahead of the driver. The worker takes
+       * at most that much at once, outsamples is sized for more. */
+      g_extern.audio_data.stats_lock = slock_new();
+      if (g_extern.audio_data.stats_lock)
+         g_extern.audio_data.dsp_thread = audio_dsp_thread_new(
+               max_bufsamples, g_extern.audio_data.block_chunk_size,
+               g_extern.audio_data.block_chunk_size,
+               outsamples_max * sizeof(int16_t), retro_process_audio);
+
+      if (!g_extern.audio_data.dsp_thread)
+      {
+         RARCH_WARN("Failed to start audio DSP thread. Will process audio inline.\n");
+         slock_free(g_extern.audio_data.stats_lock);
+         g_extern.audio_data.stats_lock = NULL;
+      }
+   }
+#endif
 }
 
 static void deinit_pixel_converter(void)
@@ -999,7 +1039,8 @@ static void init_video_filter(enum retro_pixel_format colfmt)
    height  = geom->max_height;
 
    g_extern.filter.filter = rarch_softfilter_new(
-         g_settings.video.softfilter_plugin, colfmt, width, height);
+         g_settings.video.softfilter_plugin, g_settings.video.filter_threads,
+         colfmt, width, height);
 
    if (!g_extern.filter.filter)
    {
@@ -1331,17 +1372,16 @@ static void compute_monitor_fps_statistics(void)
    }
 }
 
-static void compute_audio_buffer_statistics(void)
+bool driver_audio_buffer_statistics(audio_statistics_t *stats)
 {
    unsigned i, low_water_size, high_water_size, avg, stddev;
-   float avg_filled, deviation;
    uint64_t accum = 0, accum_var = 0;
    unsigned low_water_count = 0, high_water_count = 0;
    unsigned samples = min(g_extern.measure_data.buffer_free_samples_count,
          AUDIO_BUFFER_FREE_SAMPLES_COUNT);
 
    if (samples < 3)
-      return;
+      return false;
 
    for (i = 1; i < samples; i++)
       accum += g_extern.measure_data.buffer_free_samples[i];
@@ -1356,9 +1396,6 @@ static void compute_audio_buffer_statistics(void)
 
    stddev = (unsigned)sqrt((double)accum_var / (samples - 2));
 
-   avg_filled = 1.0f - (float)avg / g_extern.audio_data.driver_buffer_size;
-   deviation = (float)stddev / g_extern.audio_data.driver_buffer_size;
-
    low_water_size = g_extern.audio_data.driver_buffer_size * 3 / 4;
    high_water_size = g_extern.audio_data.driver_buffer_size / 4;
 
@@ -1370,15 +1407,43 @@ static void compute_audio_buffer_statistics(void)
          high_water_count++;
    }
 
+   stats->average_buffer_saturation = (1.0f -
+         (float)avg / g_extern.audio_data.driver_buffer_size) * 100.0;
+   stats->std_deviation_percentage  =
+      (float)stddev / g_extern.audio_data.driver_buffer_size * 100.0;
+   stats->close_to_underrun         = (100.0 * low_water_count) / (samples - 1);
+   stats->close_to_blocking         = (100.0 * high_water_count) / (samples - 1);
+   stats->samples                   = samples;
+   return true;
+}
+
+static void compute_audio_buffer_statistics(void)
+{
+   audio_statistics_t stats;
+
+   if (!driver_audio_buffer_statistics(&stats))
+      return;
+
    RARCH_LOG("Average audio buffer saturation: %.2f %%, standard deviation (percentage points): %.2f %%.\n",
-         avg_filled * 100.0, deviation * 100.0);
+         stats.average_buffer_saturation, stats.std_deviation_percentage);
    RARCH_LOG("Amount of time spent close to underrun: %.2f %%. Close to blocking: %.2f %%.\n",
-         (100.0 * low_water_count) / (samples - 1),
-         (100.0 * high_water_count) / (samples - 1));
+         stats.close_to_underrun, stats.close_to_blocking);
+   RARCH_LOG("Audio buffer ran empty %u times, full %u times. Estimated clock drift: %.1f ppm.\n",
+         g_extern.measure_data.audio_underruns,
+         g_extern.measure_data.audio_overruns,
+         g_extern.audio_data.rate_controller.drift * 1e6);
 }
 
 static void uninit_audio(void)
 {
+#ifdef HAVE_THREADS
+   /* Must be gone before the driver, DSP and resampler it uses. */
+   audio_dsp_thread_free(g_extern.audio_data.dsp_thread);
+   g_extern.audio_data.dsp_thread = NULL;
+   slock_free(g_extern.audio_data.stats_lock);
+   g_extern.audio_data.stats_lock = NULL;
+#endif
+
    if (driver.audio_data && driver.audio)
       driver.audio->free(driver.audio_data);
 
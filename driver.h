@@ -105,6 +105,7 @@ enum
    RARCH_STATE_SLOT_PLUS,
    RARCH_STATE_SLOT_MINUS,
    RARCH_REWIND,
+   RARCH_REWIND_SCRUB,
   // RARCH_PAUSE_TOGGLE,
   // RARCH_FRAMEADVANCE,
    RARCH_RESET,
@@ -209,6 +210,15 @@ typedef struct video_info
    bool rgb32;
 } video_info_t;
 
+/* Free space in an audio driver's ring, see write_acquire. */
+typedef struct audio_write_region
+{
+   void *chunk1;
+   size_t size1;
+   void *chunk2; /* Where the free space continues after wrapping. */
+   size_t size2;
+} audio_write_region_t;
+
 typedef struct audio_driver
 {
    void *(*init)(const char *device, unsigned rate, unsigned latency);
@@ -231,6 +241,14 @@ typedef struct audio_driver
    /* Optional. */
    size_t (*write_avail)(void *data);
    size_t (*buffer_size)(void *data);
+
+   /* Optional. Lets the frontend resample or convert straight into
+    * the driver's ring instead of handing write() a buffer to copy.
+    * write_acquire() fills in the free space and returns its size
+    * without ever blocking, write_commit() queues the first size
+    * bytes of it for playback. Called from the same thread as write(). */
+   size_t (*write_acquire)(void *data, audio_write_region_t *region);
+   void (*write_commit)(void *data, size_t size);
 } audio_driver_t;
 
 #define AXIS_NEG(x) (((uint32_t)(x) << 16) | UINT16_C(0xFFFF))
@@ -619,6 +637,20 @@ void find_next_resampler_driver(void);
 void driver_set_monitor_refresh_rate(float hz);
 bool driver_monitor_fps_statistics(double *refresh_rate,
       double *deviation, unsigned *sample_points);
+
+typedef struct audio_statistics
+{
+   /* All in percent of the driver buffer, or of the samples taken. */
+   float average_buffer_saturation;
+   float std_deviation_percentage;
+   float close_to_underrun;
+   float close_to_blocking;
+   unsigned samples;
+} audio_statistics_t;
+
+/* Buffer fill statistics over the last AUDIO_BUFFER_FREE_SAMPLES_COUNT
+ * audio writes. Only collected while rate control is active. */
+bool driver_audio_buffer_statistics(audio_statistics_t *stats);
 void driver_set_nonblock_state(bool nonblock);
 
 /* Used by RETRO_ENVIRONMENT_SET_HW_RENDER. */
@@ -30,6 +30,10 @@
 #include "libretro_private.h"
 #include "dynamic_dummy.h"
 
+#ifdef HAVE_THREADS
+#include "gfx/video_thread_wrapper.h"
+#endif
+
 #ifdef NEED_DYNAMIC
 #ifdef _WIN32
 #include <windows.h>
@@ -630,6 +634,19 @@ bool rarch_environment_cb(unsigned cmd, void *data)
                g_settings.user_language);
          break;
 
+      case RETRO_ENVIRONMENT_GET_CURRENT_SOFTWARE_FRAMEBUFFER:
+#ifdef HAVE_THREADS
+         /* Only the threaded video wrapper has a buffer to lend, and
+          * only if the frame reaches the driver as the core wrote it. */
+         if (g_settings.video.threaded && driver.video_data &&
+               !g_extern.system.hw_render_callback.context_type &&
+               !g_extern.filter.filter &&
+               g_extern.system.pix_fmt != RETRO_PIXEL_FORMAT_0RGB1555)
+            return rarch_threaded_video_get_framebuffer(
+                  (struct retro_framebuffer*)data);
+#endif
+         return false;
+
       case RETRO_ENVIRONMENT_SET_PIXEL_FORMAT:
       {
          enum retro_pixel_format pix_fmt = 
@@ -917,7 +934,7 @@ bool rarch_environment_cb(unsigned cmd, void *data)
          RARCH_LOG("Environ GET_PERF_INTERFACE.\n");
          struct retro_perf_callback *cb = (struct retro_perf_callback*)data;
          cb->get_time_usec    = rarch_get_time_usec;
-         cb->get_cpu_features = rarch_get_cpu_features;
+         cb->get_cpu_features = rarch_get_core_cpu_features;
          cb->get_perf_counter = rarch_get_perf_counter;
          cb->perf_register    = retro_perf_register; /* libretro specific path. */
          cb->perf_start       = rarch_perf_start;
@@ -28,6 +28,11 @@
 #include "autosave.h"
 //#include "cheats.h"
 #include "audio/dsp_filter.h"
+#include "audio/audio_dsp_thread.h"
+#include "audio/audio_rate_control.h"
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 #include <compat/strl.h>
 #include "core_options.h"
 #include "core_info.h"
@@ -99,6 +104,9 @@ enum basic_event
    RARCH_CMD_REWIND_DEINIT,
    RARCH_CMD_REWIND_INIT,
    RARCH_CMD_REWIND_TOGGLE,
+   RARCH_CMD_REWIND_SCRUB,
+   RARCH_CMD_RUNAHEAD_DEINIT,
+   RARCH_CMD_RUNAHEAD_INIT,
    RARCH_CMD_AUTOSAVE_DEINIT,
    RARCH_CMD_AUTOSAVE_INIT,
    RARCH_CMD_AUTOSAVE_STATE,
@@ -284,6 +292,7 @@ struct settings
       bool shader_enable;
 
       char softfilter_plugin[PATH_MAX];
+      unsigned filter_threads;
       float refresh_rate;
       bool threaded;
 
@@ -360,8 +369,12 @@ struct settings
 
       bool rate_control;
       float rate_control_delta;
+      bool rate_control_pi;
+      bool frame_batch;
+      bool dsp_thread;
       float volume; /* dB scale. */
       char resampler[32];
+      char resampler_quality[32];
 	  unsigned sinc_taps;
 	  //unsigned mute_frames;
    } audio;
@@ -453,6 +466,13 @@ struct settings
    bool rewind_enable;
    size_t rewind_buffer_size;
    unsigned rewind_granularity;
+   bool rewind_threaded;
+   bool rewind_lz;
+   bool rewind_file_backed;
+   unsigned rewind_keyframe_interval;
+   unsigned rewind_keyframes;
+   unsigned rewind_scrub_seconds;
+   unsigned run_ahead_frames;
 
    float slowmotion_ratio;
    float fastforward_ratio;
@@ -649,6 +669,7 @@ struct global
 
       size_t data_ptr;
       size_t chunk_size;
+      bool frame_batch;
       size_t nonblock_chunk_size;
       size_t block_chunk_size;
 
@@ -666,11 +687,19 @@ struct global
       size_t rewind_size;
 
       rarch_dsp_filter_t *dsp;
+      audio_dsp_thread_t *dsp_thread;
+#ifdef HAVE_THREADS
+      /* Guards the rate control state and buffer statistics
+       * while dsp_thread updates them. */
+      slock_t *stats_lock;
+#endif
 
       bool rate_control; 
       double orig_src_ratio;
       size_t driver_buffer_size;
 
+      audio_rate_control_t rate_controller;
+
       float volume_gain;
    } audio_data;
 
@@ -678,6 +707,8 @@ struct global
    {
       unsigned buffer_free_samples[AUDIO_BUFFER_FREE_SAMPLES_COUNT];
       uint64_t buffer_free_samples_count;
+      unsigned audio_underruns;
+      unsigned audio_overruns;
 
       retro_time_t frame_time_samples[MEASURE_FRAME_TIME_SAMPLES_COUNT];
       uint64_t frame_time_samples_count;
@@ -710,6 +741,13 @@ struct global
    size_t state_size;
    bool frame_is_reverse;
 
+   /* Run-ahead support. */
+   struct
+   {
+      void *state;
+      size_t state_size;
+   } runahead;
+
    /* Movie playback/recording support. */
    struct
    {
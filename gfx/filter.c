@@ -23,6 +23,50 @@
 #include "../performance.h"
 #include <stdlib.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+
+struct filter_thread_data
+{
+   sthread_t *thread;
+   const struct softfilter_work_packet *packet;
+   void *userdata;
+   slock_t *lock;
+   scond_t *cond;
+   bool done;
+   bool die;
+};
+
+/* Packet 0 always runs on the calling thread, so a filter using
+ * N threads only needs N - 1 of these. */
+static void filter_thread_loop(void *data)
+{
+   struct filter_thread_data *thr = (struct filter_thread_data*)data;
+
+   for (;;)
+   {
+      bool die;
+
+      slock_lock(thr->lock);
+      while (thr->done && !thr->die)
+         scond_wait(thr->cond, thr->lock);
+      die = thr->die;
+      slock_unlock(thr->lock);
+
+      if (die)
+         break;
+
+      if (thr->packet && thr->packet->work)
+         thr->packet->work(thr->userdata, thr->packet->thread_data);
+
+      slock_lock(thr->lock);
+      thr->done = true;
+      scond_signal(thr->cond);
+      slock_unlock(thr->lock);
+   }
+}
+#endif
+
 struct rarch_soft_plug
 {
 #ifdef HAVE_DYLIB
@@ -45,6 +89,11 @@ struct rarch_softfilter
    enum retro_pixel_format pix_fmt, out_pix_fmt;
 
    struct softfilter_work_packet *packets;
+   unsigned threads;
+
+#ifdef HAVE_THREADS
+   struct filter_thread_data *thread_data;
+#endif
 };
 
 static const struct softfilter_implementation *
@@ -134,21 +183,61 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_height = max_height;
 
    filt->impl_data = filt->impl->create(
-         &softfilter_config, input_fmt, input_fmt, max_width, max_height, 1, cpu_features, &userdata);
-   //filt->impl_data = filt->impl->create(input_fmt, input_fmt, max_width, max_height, 1, cpu_features);
+         &softfilter_config, input_fmt, input_fmt, max_width, max_height,
+         threads, cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
       return false;
    }
 
-   filt->packets = (struct softfilter_work_packet*)calloc(1, sizeof(*filt->packets));
+   /* The filter may have picked fewer threads than we asked for. */
+   filt->threads = filt->impl->query_num_threads ?
+      filt->impl->query_num_threads(filt->impl_data) : 1;
+   if (!filt->threads)
+   {
+      RARCH_ERR("Invalid number of threads.\n");
+      return false;
+   }
+
+   RARCH_LOG("[SoftFilter]: Using %u threads.\n", filt->threads);
+
+   filt->packets = (struct softfilter_work_packet*)
+      calloc(filt->threads, sizeof(*filt->packets));
    if (!filt->packets)
    {
       RARCH_ERR("Failed to allocate softfilter packets.\n");
       return false;
    }
 
+#ifdef HAVE_THREADS
+   if (filt->threads > 1)
+   {
+      unsigned i;
+
+      filt->thread_data = (struct filter_thread_data*)
+         calloc(filt->threads - 1, sizeof(*filt->thread_data));
+      if (!filt->thread_data)
+         return false;
+
+      for (i = 0; i < filt->threads - 1; i++)
+      {
+         struct filter_thread_data *thr = &filt->thread_data[i];
+
+         thr->userdata = filt->impl_data;
+         thr->done     = true;
+         thr->lock     = slock_new();
+         thr->cond     = scond_new();
+         if (!thr->lock || !thr->cond)
+            return false;
+
+         thr->thread = sthread_create(filter_thread_loop, thr);
+         if (!thr->thread)
+            return false;
+      }
+   }
+#endif
+
    return true;
 }
 
@@ -256,7 +345,7 @@ static bool append_softfilter_plugs(rarch_softfilter_t *filt)
 #endif
 
 rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
-     // unsigned threads,
+      unsigned threads,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height)
 {
@@ -294,8 +383,15 @@ rarch_softfilter_t *rarch_softfilter_new(const char *filter_config,
       goto error;
 #endif
 
+#ifdef HAVE_THREADS
+   if (!threads)
+      threads = rarch_get_cpu_cores();
+#else
+   threads = 1;
+#endif
+
    if (!create_softfilter_graph(filt, in_pixel_format,
-            max_width, max_height, cpu_features, 1))
+            max_width, max_height, cpu_features, threads))
       goto error;
 
    return filt;
@@ -308,12 +404,36 @@ error:
 
 void rarch_softfilter_free(rarch_softfilter_t *filt)
 {
- //  unsigned i = 0;
-//   (void)i;
+   unsigned i = 0;
+   (void)i;
 
    if (!filt)
       return;
 
+#ifdef HAVE_THREADS
+   if (filt->thread_data)
+   {
+      for (i = 0; i < filt->threads - 1; i++)
+      {
+         struct filter_thread_data *thr = &filt->thread_data[i];
+
+         if (thr->thread)
+         {
+            slock_lock(thr->lock);
+            thr->die = true;
+            scond_signal(thr->cond);
+            slock_unlock(thr->lock);
+            sthread_join(thr->thread);
+         }
+         if (thr->lock)
+            slock_free(thr->lock);
+         if (thr->cond)
+            scond_free(thr->cond);
+      }
+      free(filt->thread_data);
+   }
+#endif
+
    free(filt->packets);
    if (filt->impl && filt->impl_data)
       filt->impl->destroy(filt->impl_data);
@@ -356,14 +476,45 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
       void *output, size_t output_stride,
       const void *input, unsigned width, unsigned height, size_t input_stride)
 {
-   //unsigned i;
+   unsigned i;
 
-   if (filt && filt->impl && filt->impl->get_work_packets)
+   if (!filt || !filt->impl || !filt->impl->get_work_packets)
+      return;
+
+   filt->impl->get_work_packets(filt->impl_data, filt->packets,
+         output, output_stride, input, width, height, input_stride);
+
+#ifdef HAVE_THREADS
+   if (filt->thread_data)
    {
-      filt->impl->get_work_packets(filt->impl_data, filt->packets,
-            output, output_stride, input, width, height, input_stride);
+      /* Fire off the other slices, do ours, then wait for the rest. */
+      for (i = 1; i < filt->threads; i++)
+      {
+         struct filter_thread_data *thr = &filt->thread_data[i - 1];
+
+         slock_lock(thr->lock);
+         thr->packet = &filt->packets[i];
+         thr->done   = false;
+         scond_signal(thr->cond);
+         slock_unlock(thr->lock);
+      }
+
+      filt->packets[0].work(filt->impl_data, filt->packets[0].thread_data);
 
-      filt->packets->work(filt->impl_data, filt->packets->thread_data);
+      for (i = 1; i < filt->threads; i++)
+      {
+         struct filter_thread_data *thr = &filt->thread_data[i - 1];
+
+         slock_lock(thr->lock);
+         while (!thr->done)
+            scond_wait(thr->cond, thr->lock);
+         slock_unlock(thr->lock);
+      }
+      return;
    }
+#endif
+
+   for (i = 0; i < filt->threads; i++)
+      filt->packets[i].work(filt->impl_data, filt->packets[i].thread_data);
 }
 
@@ -23,7 +23,10 @@
 
 typedef struct rarch_softfilter rarch_softfilter_t;
 
+/* threads: number of slices to process in parallel,
+ * 0 picks one per CPU core. */
 rarch_softfilter_t *rarch_softfilter_new(const char *filter_path,
+      unsigned threads,
       enum retro_pixel_format in_pixel_format,
       unsigned max_width, unsigned max_height);
 
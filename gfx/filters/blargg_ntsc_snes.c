@@ -39,8 +39,13 @@ struct softfilter_thread_data
    unsigned height;
    int first;
    int last;
+   int burst;
 };
 
+typedef void (*blargg_ntsc_snes_blit_t)(const uint32_t *table,
+      const uint16_t *input, long in_row_width, int burst,
+      int in_width, int in_height, void *rgb_out, long out_pitch);
+
 struct filter_data
 {
    unsigned threads;
@@ -49,6 +54,8 @@ struct filter_data
    struct snes_ntsc_t *ntsc;
    int burst;
    int burst_toggle;
+   uint32_t *simd_table;
+   blargg_ntsc_snes_blit_t blit;
 };
 
 
@@ -165,31 +172,402 @@ static void blargg_ntsc_snes_generic_destroy(void *data)
    if(filt->ntsc)
       free(filt->ntsc);
 
+   free(filt->simd_table);
    free(filt->workers);
    free(filt);
 }
 
+/* SIMD blitters for the lores (<= 256 pixel) path.
+ *
+ * snes_ntsc_blit() turns 3 input pixels into 7 output pixels, each
+ * of them the sum of 6 kernel entries picked from the current and
+ * the previous two chunks. The entries each output lane needs are
+ * scattered around the kernel, so they get regrouped once at create
+ * time. Per burst phase and palette entry there are 8 rows of 8 lanes,
+ * one row per role the colour can play in a chunk, with lanes it does
+ * not contribute to left at zero. A chunk is then 8 row loads and adds
+ * followed by the usual clamp and pack, and the result is bit-identical
+ * to the scalar blitter. */
+
+enum
+{
+   NTSC_SIMD_ROWS  = 8,
+   NTSC_SIMD_LANES = 8,
+   NTSC_SIMD_ENTRY = NTSC_SIMD_ROWS * NTSC_SIMD_LANES
+};
+
+/* SNES_NTSC_RGB16() as a palette index. */
+#define NTSC_SIMD_INDEX(n) \
+   ((((n) & 0x001E) | ((n) >> 1 & 0x03E0) | ((n) >> 2 & 0x3C00)) >> 1)
+
+#define NTSC_SIMD_CLAMP_MASK ((uint32_t)snes_ntsc_clamp_mask)
+#define NTSC_SIMD_CLAMP_ADD  ((uint32_t)snes_ntsc_clamp_add)
+
+static uint32_t *blargg_ntsc_snes_simd_table(const snes_ntsc_t *ntsc)
+{
+   unsigned burst, entry, x;
+   uint32_t *table = (uint32_t*)calloc(snes_ntsc_burst_count *
+         snes_ntsc_palette_size * NTSC_SIMD_ENTRY, sizeof(uint32_t));
+
+   if (!table)
+      return NULL;
+
+   for (burst = 0; burst < snes_ntsc_burst_count; burst++)
+   {
+      for (entry = 0; entry < snes_ntsc_palette_size; entry++)
+      {
+         const snes_ntsc_rgb_t *k = ntsc->table[entry] +
+            burst * snes_ntsc_burst_size;
+         uint32_t *row = table +
+            (burst * snes_ntsc_palette_size + entry) * NTSC_SIMD_ENTRY;
+
+         for (x = 0; x < 7; x++)
+         {
+            uint32_t k0  = (uint32_t)k[x];
+            uint32_t kx0 = (uint32_t)k[(x + 7) % 14];
+            uint32_t k1  = (uint32_t)k[(x + 12) % 7 + 14];
+            uint32_t kx1 = (uint32_t)k[(x + 5) % 7 + 21];
+            uint32_t k2  = (uint32_t)k[(x + 10) % 7 + 28];
+            uint32_t kx2 = (uint32_t)k[(x + 3) % 7 + 35];
+
+            /* Pixel 0 of a chunk is read before output 0. */
+            row[0 * NTSC_SIMD_LANES + x] = k0;
+            row[1 * NTSC_SIMD_LANES + x] = kx0;
+            /* Pixel 1 is read before output 2, so outputs 0-1 still
+             * see the previous chunk's pixel 1 in its place. */
+            row[2 * NTSC_SIMD_LANES + x] = x >= 2 ? k1 : 0;
+            row[3 * NTSC_SIMD_LANES + x] = x >= 2 ? kx1 : k1;
+            row[4 * NTSC_SIMD_LANES + x] = x >= 2 ? 0 : kx1;
+            /* Pixel 2 is read before output 4. */
+            row[5 * NTSC_SIMD_LANES + x] = x >= 4 ? k2 : 0;
+            row[6 * NTSC_SIMD_LANES + x] = x >= 4 ? kx2 : k2;
+            row[7 * NTSC_SIMD_LANES + x] = x >= 4 ? 0 : kx2;
+         }
+      }
+   }
+
+   return table;
+}
+
+#if __SSE2__
+#include <emmintrin.h>
+
+static inline __m128i blargg_ntsc_snes_sse2_out(__m128i raw)
+{
+   __m128i sub   = _mm_and_si128(_mm_srli_epi32(raw, 8),
+         _mm_set1_epi32(NTSC_SIMD_CLAMP_MASK));
+   __m128i clamp = _mm_sub_epi32(_mm_set1_epi32(NTSC_SIMD_CLAMP_ADD), sub);
+
+   raw   = _mm_or_si128(raw, clamp);
+   clamp = _mm_sub_epi32(clamp, sub);
+   raw   = _mm_and_si128(raw, clamp);
+
+   raw = _mm_or_si128(_mm_or_si128(
+            _mm_and_si128(_mm_srli_epi32(raw, 12), _mm_set1_epi32(0xF800)),
+            _mm_and_si128(_mm_srli_epi32(raw,  7), _mm_set1_epi32(0x07E0))),
+         _mm_and_si128(_mm_srli_epi32(raw,  3), _mm_set1_epi32(0x001F)));
+
+   /* Sign-extend so the signed pack doesn't saturate. */
+   return _mm_srai_epi32(_mm_slli_epi32(raw, 16), 16);
+}
+
+static void blargg_ntsc_snes_blit_sse2(const uint32_t *table,
+      const uint16_t *input, long in_row_width, int burst,
+      int in_width, int in_height, void *rgb_out, long out_pitch)
+{
+   int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
+
+   for (; in_height; --in_height)
+   {
+      int n;
+      const uint16_t *line_in = input + 1;
+      uint16_t *line_out      = (uint16_t*)rgb_out;
+      const uint32_t *ktable  = table +
+         burst * snes_ntsc_palette_size * NTSC_SIMD_ENTRY;
+      /* Kernels of the previous chunk (p) and the one before (pp). */
+      const uint32_t *k0p  = ktable;
+      const uint32_t *k1p  = ktable;
+      const uint32_t *k1pp = ktable;
+      const uint32_t *k2p  = ktable + NTSC_SIMD_INDEX(input[0]) * NTSC_SIMD_ENTRY;
+      const uint32_t *k2pp = ktable;
+
+      for (n = 0; n <= chunk_count; n++)
+      {
+         __m128i lo, hi, out;
+         const uint32_t *k0 = ktable;
+         const uint32_t *k1 = ktable;
+         const uint32_t *k2 = ktable;
+
+         /* The last chunk flushes the kernel with black. */
+         if (n < chunk_count)
+         {
+            k0 = ktable + NTSC_SIMD_INDEX(line_in[0]) * NTSC_SIMD_ENTRY;
+            k1 = ktable + NTSC_SIMD_INDEX(line_in[1]) * NTSC_SIMD_ENTRY;
+            k2 = ktable + NTSC_SIMD_INDEX(line_in[2]) * NTSC_SIMD_ENTRY;
+         }
+
+#define NTSC_SSE2_ROW(k, r, half) \
+         _mm_loadu_si128((const __m128i*)((k) + (r) * NTSC_SIMD_LANES + (half) * 4))
+#define NTSC_SSE2_SUM(half) \
+         _mm_add_epi32( \
+               _mm_add_epi32( \
+                  _mm_add_epi32(NTSC_SSE2_ROW(k0, 0, half), NTSC_SSE2_ROW(k0p, 1, half)), \
+                  _mm_add_epi32(NTSC_SSE2_ROW(k1, 2, half), NTSC_SSE2_ROW(k1p, 3, half))), \
+               _mm_add_epi32( \
+                  _mm_add_epi32(NTSC_SSE2_ROW(k1pp, 4, half), NTSC_SSE2_ROW(k2, 5, half)), \
+                  _mm_add_epi32(NTSC_SSE2_ROW(k2p, 6, half), NTSC_SSE2_ROW(k2pp, 7, half))))
+
+         lo  = blargg_ntsc_snes_sse2_out(NTSC_SSE2_SUM(0));
+         hi  = blargg_ntsc_snes_sse2_out(NTSC_SSE2_SUM(1));
+         out = _mm_packs_epi32(lo, hi);
+
+#undef NTSC_SSE2_SUM
+#undef NTSC_SSE2_ROW
+
+         if (n < chunk_count)
+         {
+            /* Lane 7 spills into the next chunk, which overwrites it. */
+            _mm_storeu_si128((__m128i*)line_out, out);
+         }
+         else
+         {
+            _mm_storel_epi64((__m128i*)line_out, out);
+            line_out[4] = _mm_extract_epi16(out, 4);
+            line_out[5] = _mm_extract_epi16(out, 5);
+            line_out[6] = _mm_extract_epi16(out, 6);
+         }
+
+         k0p  = k0;
+         k1pp = k1p;
+         k1p  = k1;
+         k2pp = k2p;
+         k2p  = k2;
+
+         line_in  += 3;
+         line_out += 7;
+      }
+
+      burst   = (burst + 1) % snes_ntsc_burst_count;
+      input  += in_row_width;
+      rgb_out = (char*)rgb_out + out_pitch;
+   }
+}
+#endif
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__)) && \
+   (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_NTSC_AVX2
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static void blargg_ntsc_snes_blit_avx2(const uint32_t *table,
+      const uint16_t *input, long in_row_width, int burst,
+      int in_width, int in_height, void *rgb_out, long out_pitch)
+{
+   int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
+   const __m256i clamp_mask = _mm256_set1_epi32(NTSC_SIMD_CLAMP_MASK);
+   const __m256i clamp_add  = _mm256_set1_epi32(NTSC_SIMD_CLAMP_ADD);
+
+   for (; in_height; --in_height)
+   {
+      int n;
+      const uint16_t *line_in = input + 1;
+      uint16_t *line_out      = (uint16_t*)rgb_out;
+      const uint32_t *ktable  = table +
+         burst * snes_ntsc_palette_size * NTSC_SIMD_ENTRY;
+      const uint32_t *k0p  = ktable;
+      const uint32_t *k1p  = ktable;
+      const uint32_t *k1pp = ktable;
+      const uint32_t *k2p  = ktable + NTSC_SIMD_INDEX(input[0]) * NTSC_SIMD_ENTRY;
+      const uint32_t *k2pp = ktable;
+
+      for (n = 0; n <= chunk_count; n++)
+      {
+         __m256i raw, sub, clamp;
+         __m128i out;
+         const uint32_t *k0 = ktable;
+         const uint32_t *k1 = ktable;
+         const uint32_t *k2 = ktable;
+
+         if (n < chunk_count)
+         {
+            k0 = ktable + NTSC_SIMD_INDEX(line_in[0]) * NTSC_SIMD_ENTRY;
+            k1 = ktable + NTSC_SIMD_INDEX(line_in[1]) * NTSC_SIMD_ENTRY;
+            k2 = ktable + NTSC_SIMD_INDEX(line_in[2]) * NTSC_SIMD_ENTRY;
+         }
+
+#define NTSC_AVX2_ROW(k, r) \
+         _mm256_loadu_si256((const __m256i*)((k) + (r) * NTSC_SIMD_LANES))
+         raw = _mm256_add_epi32(
+               _mm256_add_epi32(
+                  _mm256_add_epi32(NTSC_AVX2_ROW(k0, 0), NTSC_AVX2_ROW(k0p, 1)),
+                  _mm256_add_epi32(NTSC_AVX2_ROW(k1, 2), NTSC_AVX2_ROW(k1p, 3))),
+               _mm256_add_epi32(
+                  _mm256_add_epi32(NTSC_AVX2_ROW(k1pp, 4), NTSC_AVX2_ROW(k2, 5)),
+                  _mm256_add_epi32(NTSC_AVX2_ROW(k2p, 6), NTSC_AVX2_ROW(k2pp, 7))));
+#undef NTSC_AVX2_ROW
+
+         sub   = _mm256_and_si256(_mm256_srli_epi32(raw, 8), clamp_mask);
+         clamp = _mm256_sub_epi32(clamp_add, sub);
+         raw   = _mm256_or_si256(raw, clamp);
+         clamp = _mm256_sub_epi32(clamp, sub);
+         raw   = _mm256_and_si256(raw, clamp);
+
+         raw = _mm256_or_si256(_mm256_or_si256(
+                  _mm256_and_si256(_mm256_srli_epi32(raw, 12), _mm256_set1_epi32(0xF800)),
+                  _mm256_and_si256(_mm256_srli_epi32(raw,  7), _mm256_set1_epi32(0x07E0))),
+               _mm256_and_si256(_mm256_srli_epi32(raw,  3), _mm256_set1_epi32(0x001F)));
+
+         out = _mm_packus_epi32(_mm256_castsi256_si128(raw),
+               _mm256_extracti128_si256(raw, 1));
+
+         if (n < chunk_count)
+            _mm_storeu_si128((__m128i*)line_out, out);
+         else
+         {
+            _mm_storel_epi64((__m128i*)line_out, out);
+            line_out[4] = _mm_extract_epi16(out, 4);
+            line_out[5] = _mm_extract_epi16(out, 5);
+            line_out[6] = _mm_extract_epi16(out, 6);
+         }
+
+         k0p  = k0;
+         k1pp = k1p;
+         k1p  = k1;
+         k2pp = k2p;
+         k2p  = k2;
+
+         line_in  += 3;
+         line_out += 7;
+      }
+
+      burst   = (burst + 1) % snes_ntsc_burst_count;
+      input  += in_row_width;
+      rgb_out = (char*)rgb_out + out_pitch;
+   }
+}
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__)
+#define HAVE_NTSC_NEON
+#include <arm_neon.h>
+
+static inline uint16x4_t blargg_ntsc_snes_neon_out(uint32x4_t raw)
+{
+   uint32x4_t sub   = vandq_u32(vshrq_n_u32(raw, 8),
+         vdupq_n_u32(NTSC_SIMD_CLAMP_MASK));
+   uint32x4_t clamp = vsubq_u32(vdupq_n_u32(NTSC_SIMD_CLAMP_ADD), sub);
+
+   raw   = vorrq_u32(raw, clamp);
+   clamp = vsubq_u32(clamp, sub);
+   raw   = vandq_u32(raw, clamp);
+
+   raw = vorrq_u32(vorrq_u32(
+            vandq_u32(vshrq_n_u32(raw, 12), vdupq_n_u32(0xF800)),
+            vandq_u32(vshrq_n_u32(raw,  7), vdupq_n_u32(0x07E0))),
+         vandq_u32(vshrq_n_u32(raw,  3), vdupq_n_u32(0x001F)));
+
+   return vmovn_u32(raw);
+}
+
+static void blargg_ntsc_snes_blit_neon(const uint32_t *table,
+      const uint16_t *input, long in_row_width, int burst,
+      int in_width, int in_height, void *rgb_out, long out_pitch)
+{
+   int chunk_count = (in_width - 1) / snes_ntsc_in_chunk;
+
+   for (; in_height; --in_height)
+   {
+      int n;
+      const uint16_t *line_in = input + 1;
+      uint16_t *line_out      = (uint16_t*)rgb_out;
+      const uint32_t *ktable  = table +
+         burst * snes_ntsc_palette_size * NTSC_SIMD_ENTRY;
+      const uint32_t *k0p  = ktable;
+      const uint32_t *k1p  = ktable;
+      const uint32_t *k1pp = ktable;
+      const uint32_t *k2p  = ktable + NTSC_SIMD_INDEX(input[0]) * NTSC_SIMD_ENTRY;
+      const uint32_t *k2pp = ktable;
+
+      for (n = 0; n <= chunk_count; n++)
+      {
+         uint16x8_t out;
+         const uint32_t *k0 = ktable;
+         const uint32_t *k1 = ktable;
+         const uint32_t *k2 = ktable;
+
+         if (n < chunk_count)
+         {
+            k0 = ktable + NTSC_SIMD_INDEX(line_in[0]) * NTSC_SIMD_ENTRY;
+            k1 = ktable + NTSC_SIMD_INDEX(line_in[1]) * NTSC_SIMD_ENTRY;
+            k2 = ktable + NTSC_SIMD_INDEX(line_in[2]) * NTSC_SIMD_ENTRY;
+         }
+
+#define NTSC_NEON_ROW(k, r, half) vld1q_u32((k) + (r) * NTSC_SIMD_LANES + (half) * 4)
+#define NTSC_NEON_SUM(half) \
+         vaddq_u32( \
+               vaddq_u32( \
+                  vaddq_u32(NTSC_NEON_ROW(k0, 0, half), NTSC_NEON_ROW(k0p, 1, half)), \
+                  vaddq_u32(NTSC_NEON_ROW(k1, 2, half), NTSC_NEON_ROW(k1p, 3, half))), \
+               vaddq_u32( \
+                  vaddq_u32(NTSC_NEON_ROW(k1pp, 4, half), NTSC_NEON_ROW(k2, 5, half)), \
+                  vaddq_u32(NTSC_NEON_ROW(k2p, 6, half), NTSC_NEON_ROW(k2pp, 7, half))))
+
+         out = vcombine_u16(blargg_ntsc_snes_neon_out(NTSC_NEON_SUM(0)),
+               blargg_ntsc_snes_neon_out(NTSC_NEON_SUM(1)));
+
+#undef NTSC_NEON_SUM
+#undef NTSC_NEON_ROW
+
+         if (n < chunk_count)
+            vst1q_u16(line_out, out);
+         else
+         {
+            vst1_u16(line_out, vget_low_u16(out));
+            line_out[4] = vgetq_lane_u16(out, 4);
+            line_out[5] = vgetq_lane_u16(out, 5);
+            line_out[6] = vgetq_lane_u16(out, 6);
+         }
+
+         k0p  = k0;
+         k1pp = k1p;
+         k1p  = k1;
+         k2pp = k2p;
+         k2p  = k2;
+
+         line_in  += 3;
+         line_out += 7;
+      }
+
+      burst   = (burst + 1) % snes_ntsc_burst_count;
+      input  += in_row_width;
+      rgb_out = (char*)rgb_out + out_pitch;
+   }
+}
+#endif
+
 static void blargg_ntsc_snes_render_rgb565(void *data, int width, int height,
-      int first, int last,
+      int first, int last, int burst,
       uint16_t *input, int pitch, uint16_t *output, int outpitch)
 {
    struct filter_data *filt = (struct filter_data*)data;
-   if(width <= 256)
-      snes_ntsc_blit(filt->ntsc, input, pitch, filt->burst,
+   if(width <= 256 && filt->blit)
+      filt->blit(filt->simd_table, input, pitch, burst,
+            width, height, output, outpitch * 2);
+   else if(width <= 256)
+      snes_ntsc_blit(filt->ntsc, input, pitch, burst,
             width, height, output, outpitch * 2, first, last);
    else
-      snes_ntsc_blit_hires(filt->ntsc, input, pitch, filt->burst,
+      snes_ntsc_blit_hires(filt->ntsc, input, pitch, burst,
             width, height, output, outpitch * 2, first, last);
-
-   filt->burst ^= filt->burst_toggle;
 }
 
 static void blargg_ntsc_snes_rgb565(void *data, unsigned width, unsigned height,
-      int first, int last, uint16_t *src, 
+      int first, int last, int burst, uint16_t *src, 
       unsigned src_stride, uint16_t *dst, unsigned dst_stride)
 {
    blargg_ntsc_snes_render_rgb565(data, width, height,
-         first, last,
+         first, last, burst,
          src, src_stride,
          dst, dst_stride);
 
@@ -205,7 +583,7 @@ static void blargg_ntsc_snes_work_cb_rgb565(void *data, void *thread_data)
    unsigned height = thr->height;
 
    blargg_ntsc_snes_rgb565(data, width, height,
-         thr->first, thr->last, input,
+         thr->first, thr->last, thr->burst, input,
          thr->in_pitch / SOFTFILTER_BPP_RGB565,
          output,
          thr->out_pitch / SOFTFILTER_BPP_RGB565);
@@ -237,10 +615,16 @@ static void blargg_ntsc_snes_generic_packets(void *data,
       thr->first = y_start;
       thr->last = y_end == height;
 
+      /* The blitter advances the burst phase once per line, so each
+       * slice starts where the one above it would have left off. */
+      thr->burst = (filt->burst + y_start) % snes_ntsc_burst_count;
+
       if (filt->in_fmt == SOFTFILTER_FMT_RGB565)
          packets[i].work = blargg_ntsc_snes_work_cb_rgb565;
       packets[i].thread_data = thr;
    }
+
+   filt->burst ^= filt->burst_toggle;
 }
 
 static const struct softfilter_implementation blargg_ntsc_snes_generic = {
@@ -258,9 +642,123 @@ static const struct softfilter_implementation blargg_ntsc_snes_generic = {
    "blargg_ntsc_snes",
 };
 
+#if __SSE2__ || defined(HAVE_NTSC_AVX2) || defined(HAVE_NTSC_NEON)
+static void *blargg_ntsc_snes_simd_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata,
+      blargg_ntsc_snes_blit_t blit)
+{
+   struct filter_data *filt = (struct filter_data*)
+      blargg_ntsc_snes_generic_create(config, in_fmt, out_fmt,
+            max_width, max_height, threads, simd, userdata);
+   if (!filt)
+      return NULL;
+
+   /* Without the table we just stay on the scalar blitter. */
+   filt->simd_table = blargg_ntsc_snes_simd_table(filt->ntsc);
+   if (filt->simd_table)
+      filt->blit = blit;
+   return filt;
+}
+#endif
+
+#if __SSE2__
+static void *blargg_ntsc_snes_sse2_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
+{
+   return blargg_ntsc_snes_simd_create(config, in_fmt, out_fmt,
+         max_width, max_height, threads, simd, userdata,
+         blargg_ntsc_snes_blit_sse2);
+}
+
+static const struct softfilter_implementation blargg_ntsc_snes_sse2 = {
+   blargg_ntsc_snes_generic_input_fmts,
+   blargg_ntsc_snes_generic_output_fmts,
+
+   blargg_ntsc_snes_sse2_create,
+   blargg_ntsc_snes_generic_destroy,
+
+   blargg_ntsc_snes_generic_threads,
+   blargg_ntsc_snes_generic_output,
+   blargg_ntsc_snes_generic_packets,
+   SOFTFILTER_API_VERSION,
+   "Blargg NTSC SNES (SSE2)",
+   "blargg_ntsc_snes",
+};
+#endif
+
+#ifdef HAVE_NTSC_AVX2
+static void *blargg_ntsc_snes_avx2_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
+{
+   return blargg_ntsc_snes_simd_create(config, in_fmt, out_fmt,
+         max_width, max_height, threads, simd, userdata,
+         blargg_ntsc_snes_blit_avx2);
+}
+
+static const struct softfilter_implementation blargg_ntsc_snes_avx2 = {
+   blargg_ntsc_snes_generic_input_fmts,
+   blargg_ntsc_snes_generic_output_fmts,
+
+   blargg_ntsc_snes_avx2_create,
+   blargg_ntsc_snes_generic_destroy,
+
+   blargg_ntsc_snes_generic_threads,
+   blargg_ntsc_snes_generic_output,
+   blargg_ntsc_snes_generic_packets,
+   SOFTFILTER_API_VERSION,
+   "Blargg NTSC SNES (AVX2)",
+   "blargg_ntsc_snes",
+};
+#endif
+
+#ifdef HAVE_NTSC_NEON
+static void *blargg_ntsc_snes_neon_create(const struct softfilter_config *config,
+      unsigned in_fmt, unsigned out_fmt,
+      unsigned max_width, unsigned max_height,
+      unsigned threads, softfilter_simd_mask_t simd, void *userdata)
+{
+   return blargg_ntsc_snes_simd_create(config, in_fmt, out_fmt,
+         max_width, max_height, threads, simd, userdata,
+         blargg_ntsc_snes_blit_neon);
+}
+
+static const struct softfilter_implementation blargg_ntsc_snes_neon = {
+   blargg_ntsc_snes_generic_input_fmts,
+   blargg_ntsc_snes_generic_output_fmts,
+
+   blargg_ntsc_snes_neon_create,
+   blargg_ntsc_snes_generic_destroy,
+
+   blargg_ntsc_snes_generic_threads,
+   blargg_ntsc_snes_generic_output,
+   blargg_ntsc_snes_generic_packets,
+   SOFTFILTER_API_VERSION,
+   "Blargg NTSC SNES (NEON)",
+   "blargg_ntsc_snes",
+};
+#endif
+
 const struct softfilter_implementation *softfilter_get_implementation(
       softfilter_simd_mask_t simd)
 {
+#ifdef HAVE_NTSC_AVX2
+   if (simd & SOFTFILTER_SIMD_AVX2)
+      return &blargg_ntsc_snes_avx2;
+#endif
+#if __SSE2__
+   if (simd & SOFTFILTER_SIMD_SSE2)
+      return &blargg_ntsc_snes_sse2;
+#endif
+#ifdef HAVE_NTSC_NEON
+   if (simd & SOFTFILTER_SIMD_NEON)
+      return &blargg_ntsc_snes_neon;
+#endif
    (void)simd;
    return &blargg_ntsc_snes_generic;
 }
@@ -25,6 +25,25 @@
 #include <malloc.h>
 #endif
 
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__)
+#include <arm_neon.h>
+#define HAVE_RPNG_NEON
+#endif
+
+#ifdef HAVE_ZLIB_DEFLATE
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef RARCH_INTERNAL
+#include "../../performance.h"
+#endif
+
+#define RPNG_MAX_THREADS 16
+#endif
+
 #ifdef RARCH_INTERNAL
 #include "../../hash.h"
 #else
@@ -41,6 +60,9 @@ static inline uint32_t crc32_calculate(const uint8_t *data, size_t length)
    goto end; \
 } while(0)
 
+/* How much of the file rpng_load_image_argb() reads at a time. */
+#define RPNG_READ_SIZE 4096
+
 #ifndef ARRAY_SIZE
 #define ARRAY_SIZE(a) (sizeof(a) / sizeof((a)[0]))
 #endif
@@ -53,7 +75,6 @@ struct png_chunk
 {
    uint32_t size;
    char type[4];
-   uint8_t *data;
 };
 
 struct png_ihdr
@@ -82,20 +103,6 @@ static uint32_t dword_be(const uint8_t *buf)
    return (buf[0] << 24) | (buf[1] << 16) | (buf[2] << 8) | (buf[3] << 0);
 }
 
-static bool read_chunk_header(FILE *file, struct png_chunk *chunk)
-{
-   uint8_t dword[4] = {0};
-   if (fread(dword, 1, 4, file) != 4)
-      return false;
-
-   chunk->size = dword_be(dword);
-
-   if (fread(chunk->type, 1, 4, file) != 4)
-      return false;
-
-   return true;
-}
-
 struct
 {
    const char *id;
@@ -107,12 +114,6 @@ struct
    { "PLTE", PNG_CHUNK_PLTE },
 };
 
-struct idat_buffer
-{
-   uint8_t *data;
-   size_t size;
-};
-
 static enum png_chunk_type png_chunk_type(const struct png_chunk *chunk)
 {
    unsigned i;
@@ -125,51 +126,22 @@ static enum png_chunk_type png_chunk_type(const struct png_chunk *chunk)
    return PNG_CHUNK_NOOP;
 }
 
-static bool png_read_chunk(FILE *file, struct png_chunk *chunk)
-{
-   free(chunk->data);
-   chunk->data = (uint8_t*)calloc(1, chunk->size + sizeof(uint32_t)); /* CRC32 */
-   if (!chunk->data)
-      return false;
-
-   if (fread(chunk->data, 1, chunk->size + 
-            sizeof(uint32_t), file) != (chunk->size + sizeof(uint32_t)))
-   {
-      free(chunk->data);
-      return false;
-   }
-
-   /* Ignore CRC. */
-   return true;
-}
-
-static void png_free_chunk(struct png_chunk *chunk)
-{
-   if (!chunk)
-      return;
-
-   free(chunk->data);
-   chunk->data = NULL;
-}
-
-static bool png_parse_ihdr(FILE *file,
-      struct png_chunk *chunk, struct png_ihdr *ihdr)
+static bool png_parse_ihdr(const struct png_chunk *chunk,
+      const uint8_t *data, struct png_ihdr *ihdr)
 {
    unsigned i;
    bool ret = true;
-   if (!png_read_chunk(file, chunk))
-      return false;
 
    if (chunk->size != 13)
       GOTO_END_ERROR();
 
-   ihdr->width       = dword_be(chunk->data + 0);
-   ihdr->height      = dword_be(chunk->data + 4);
-   ihdr->depth       = chunk->data[8];
-   ihdr->color_type  = chunk->data[9];
-   ihdr->compression = chunk->data[10];
-   ihdr->filter      = chunk->data[11];
-   ihdr->interlace   = chunk->data[12];
+   ihdr->width       = dword_be(data + 0);
+   ihdr->height      = dword_be(data + 4);
+   ihdr->depth       = data[8];
+   ihdr->color_type  = data[9];
+   ihdr->compression = data[10];
+   ihdr->filter      = data[11];
+   ihdr->interlace   = data[12];
 
    if (ihdr->width == 0 || ihdr->height == 0)
       GOTO_END_ERROR();
@@ -231,7 +203,6 @@ static bool png_parse_ihdr(FILE *file,
    //   GOTO_END_ERROR();
 
 end:
-   png_free_chunk(chunk);
    return ret;
 }
 
@@ -250,6 +221,43 @@ static inline int paeth(int a, int b, int c)
    return c;
 }
 
+#if defined(__SSE2__)
+static inline __m128i abs_epi16_sse2(__m128i v)
+{
+   return _mm_max_epi16(v, _mm_sub_epi16(_mm_setzero_si128(), v));
+}
+
+/* Paeth predictor on 16-bit lanes, with the same tie-breaking as paeth(). */
+static inline __m128i paeth_epi16_sse2(__m128i a, __m128i b, __m128i c)
+{
+   __m128i ac    = _mm_sub_epi16(a, c);
+   __m128i bc    = _mm_sub_epi16(b, c);
+   __m128i pa    = abs_epi16_sse2(bc);
+   __m128i pb    = abs_epi16_sse2(ac);
+   __m128i pc    = abs_epi16_sse2(_mm_add_epi16(ac, bc));
+   __m128i not_a = _mm_or_si128(_mm_cmpgt_epi16(pa, pb),
+         _mm_cmpgt_epi16(pa, pc));
+   __m128i use_c = _mm_cmpgt_epi16(pb, pc);
+   __m128i bc_sel = _mm_or_si128(_mm_and_si128(use_c, c),
+         _mm_andnot_si128(use_c, b));
+   return _mm_or_si128(_mm_and_si128(not_a, bc_sel),
+         _mm_andnot_si128(not_a, a));
+}
+#elif defined(HAVE_RPNG_NEON)
+static inline uint8x8_t paeth_half_neon(uint8x8_t a, uint8x8_t b, uint8x8_t c)
+{
+   int16x8_t ac     = vreinterpretq_s16_u16(vsubl_u8(a, c));
+   int16x8_t bc     = vreinterpretq_s16_u16(vsubl_u8(b, c));
+   int16x8_t pa     = vabsq_s16(bc);
+   int16x8_t pb     = vabsq_s16(ac);
+   int16x8_t pc     = vabsq_s16(vaddq_s16(ac, bc));
+   uint8x8_t not_a  = vmovn_u16(vorrq_u16(vcgtq_s16(pa, pb),
+            vcgtq_s16(pa, pc)));
+   uint8x8_t use_c  = vmovn_u16(vcgtq_s16(pb, pc));
+   return vbsl_u8(not_a, vbsl_u8(use_c, c, b), a);
+}
+#endif
+
 static inline void copy_line_rgb(uint32_t *data,
       const uint8_t *decoded, unsigned width, unsigned bpp)
 {
@@ -397,94 +405,196 @@ static void png_pass_geom(const struct png_ihdr *ihdr,
 }
 
 
-static bool png_reverse_filter(uint32_t *data, const struct png_ihdr *ihdr,
-      const uint8_t *inflate_buf, size_t inflate_buf_size,
-      const uint32_t *palette)
+/* Unfiltering runs in place. line holds the filtered bytes on entry
+ * and the reconstructed ones on return. */
+static void png_unfilter_sub(uint8_t *line, unsigned pitch, unsigned bpp)
 {
-   unsigned i, h;
-   bool ret = true;
+   unsigned i;
+   for (i = bpp; i < pitch; i++)
+      line[i] += line[i - bpp];
+}
 
-   unsigned bpp;
-   unsigned pitch;
-   size_t pass_size;
-   png_pass_geom(ihdr, ihdr->width, ihdr->height, &bpp, &pitch, &pass_size);
+static void png_unfilter_up(uint8_t *line, const uint8_t *prev,
+      unsigned pitch)
+{
+   unsigned i = 0;
+#if defined(__SSE2__)
+   for (; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(line + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(line + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+#elif defined(HAVE_RPNG_NEON)
+   for (; i + 16 <= pitch; i += 16)
+      vst1q_u8(line + i, vaddq_u8(vld1q_u8(line + i), vld1q_u8(prev + i)));
+#endif
+   for (; i < pitch; i++)
+      line[i] += prev[i];
+}
 
-   if (inflate_buf_size < pass_size)
-      return false;
+/* Average and Paeth depend on the pixel just reconstructed to the
+ * left, so they can't be done 16 bytes at a time. For 3 and 4 byte
+ * pixels (8-bit RGB and RGBA) a whole pixel goes through one vector
+ * instead, which also gets rid of the branches in paeth(). */
+#if defined(__SSE2__) || defined(HAVE_RPNG_NEON)
+#define HAVE_RPNG_UNFILTER_SIMD
+
+/* Any byte order does, as long as loads and stores agree. Three
+ * byte pixels are put together by hand, going through memory with
+ * a partial word stalls the next load. */
+static inline uint32_t png_load_pixel(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v;
+   if (bpp == 3)
+      return p[0] | (p[1] << 8) | ((uint32_t)p[2] << 16);
+   memcpy(&v, p, sizeof(v));
+   return v;
+}
+
+static inline void png_store_pixel(uint8_t *p, uint32_t v, unsigned bpp)
+{
+   if (bpp == 3)
+   {
+      p[0] = (uint8_t)(v >>  0);
+      p[1] = (uint8_t)(v >>  8);
+      p[2] = (uint8_t)(v >> 16);
+   }
+   else
+      memcpy(p, &v, sizeof(v));
+}
+#endif
 
-   uint8_t *prev_scanline    = (uint8_t*)calloc(1, pitch);
-   uint8_t *decoded_scanline = (uint8_t*)calloc(1, pitch);
+#if defined(__SSE2__)
+static inline void png_unfilter_avg_simd(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i zero = _mm_setzero_si128();
+   __m128i a    = zero;
 
-   if (!prev_scanline || !decoded_scanline)
-      GOTO_END_ERROR();
+   for (i = 0; i < pitch; i += bpp)
+   {
+      __m128i b = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128(png_load_pixel(prev + i, bpp)), zero);
+      __m128i x = _mm_cvtsi32_si128(png_load_pixel(line + i, bpp));
+      __m128i avg = _mm_srli_epi16(_mm_add_epi16(a, b), 1);
+
+      x = _mm_add_epi8(x, _mm_packus_epi16(avg, avg));
+      png_store_pixel(line + i, _mm_cvtsi128_si32(x), bpp);
+      a = _mm_unpacklo_epi8(x, zero);
+   }
+}
+
+static inline void png_unfilter_paeth_simd(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i zero = _mm_setzero_si128();
+   __m128i a    = zero;
+   __m128i c    = zero;
 
-   for (h = 0; h < ihdr->height;
-         h++, inflate_buf += pitch, data += ihdr->width)
+   for (i = 0; i < pitch; i += bpp)
    {
-      unsigned filter = *inflate_buf++;
-      switch (filter)
-      {
-         case 0: /* None */
-            memcpy(decoded_scanline, inflate_buf, pitch);
-            break;
+      __m128i b = _mm_unpacklo_epi8(
+            _mm_cvtsi32_si128(png_load_pixel(prev + i, bpp)), zero);
+      __m128i x = _mm_cvtsi32_si128(png_load_pixel(line + i, bpp));
+      __m128i pred = paeth_epi16_sse2(a, b, c);
+
+      x = _mm_add_epi8(x, _mm_packus_epi16(pred, pred));
+      png_store_pixel(line + i, _mm_cvtsi128_si32(x), bpp);
+      a = _mm_unpacklo_epi8(x, zero);
+      c = b;
+   }
+}
+#elif defined(HAVE_RPNG_NEON)
+static inline void png_unfilter_avg_simd(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
 
-         case 1: /* Sub */
-            for (i = 0; i < bpp; i++)
-               decoded_scanline[i] = inflate_buf[i];
-            for (i = bpp; i < pitch; i++)
-               decoded_scanline[i] = decoded_scanline[i - bpp] + inflate_buf[i];
-            break;
+   for (i = 0; i < pitch; i += bpp)
+   {
+      uint8x8_t b = vreinterpret_u8_u32(
+            vdup_n_u32(png_load_pixel(prev + i, bpp)));
+      uint8x8_t x = vreinterpret_u8_u32(
+            vdup_n_u32(png_load_pixel(line + i, bpp)));
+
+      a = vadd_u8(x, vhadd_u8(a, b));
+      png_store_pixel(line + i,
+            vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+   }
+}
 
-         case 2: /* Up */
-            for (i = 0; i < pitch; i++)
-               decoded_scanline[i] = prev_scanline[i] + inflate_buf[i];
-            break;
+static inline void png_unfilter_paeth_simd(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t c = vdup_n_u8(0);
 
-         case 3: /* Average */
-            for (i = 0; i < bpp; i++)
-            {
-               uint8_t avg = prev_scanline[i] >> 1;
-               decoded_scanline[i] = avg + inflate_buf[i];
-            }
-            for (i = bpp; i < pitch; i++)
-            {
-               uint8_t avg = (decoded_scanline[i - bpp] + prev_scanline[i]) >> 1;
-               decoded_scanline[i] = avg + inflate_buf[i];
-            }
-            break;
+   for (i = 0; i < pitch; i += bpp)
+   {
+      uint8x8_t b = vreinterpret_u8_u32(
+            vdup_n_u32(png_load_pixel(prev + i, bpp)));
+      uint8x8_t x = vreinterpret_u8_u32(
+            vdup_n_u32(png_load_pixel(line + i, bpp)));
+
+      a = vadd_u8(x, paeth_half_neon(a, b, c));
+      png_store_pixel(line + i,
+            vget_lane_u32(vreinterpret_u32_u8(a), 0), bpp);
+      c = b;
+   }
+}
+#endif
 
-         case 4: /* Paeth */
-            for (i = 0; i < bpp; i++)
-               decoded_scanline[i] = paeth(0, prev_scanline[i], 0) + inflate_buf[i];
-            for (i = bpp; i < pitch; i++)
-               decoded_scanline[i] = paeth(decoded_scanline[i - bpp],
-                     prev_scanline[i], prev_scanline[i - bpp]) + inflate_buf[i];
-            break;
+static void png_unfilter_avg(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#ifdef HAVE_RPNG_UNFILTER_SIMD
+   /* Constant pixel sizes let the compiler turn the pixel
+    * loads and stores into plain moves. */
+   if (bpp == 3)
+   {
+      png_unfilter_avg_simd(line, prev, pitch, 3);
+      return;
+   }
+   if (bpp == 4)
+   {
+      png_unfilter_avg_simd(line, prev, pitch, 4);
+      return;
+   }
+#endif
 
-         default:
-            GOTO_END_ERROR();
-      }
+   for (i = 0; i < bpp; i++)
+      line[i] += prev[i] >> 1;
+   for (i = bpp; i < pitch; i++)
+      line[i] += (line[i - bpp] + prev[i]) >> 1;
+}
 
-      if (ihdr->color_type == 0)
-         copy_line_bw(data, decoded_scanline, ihdr->width, ihdr->depth);
-      else if (ihdr->color_type == 2)
-         copy_line_rgb(data, decoded_scanline, ihdr->width, ihdr->depth);
-      else if (ihdr->color_type == 3)
-         copy_line_plt(data, decoded_scanline, ihdr->width,
-               ihdr->depth, palette);
-      else if (ihdr->color_type == 4)
-         copy_line_gray_alpha(data, decoded_scanline, ihdr->width,
-               ihdr->depth);
-      else if (ihdr->color_type == 6)
-         copy_line_rgba(data, decoded_scanline, ihdr->width, ihdr->depth);
-
-      memcpy(prev_scanline, decoded_scanline, pitch);
+static void png_unfilter_paeth(uint8_t *line, const uint8_t *prev,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+#ifdef HAVE_RPNG_UNFILTER_SIMD
+   /* Constant pixel sizes let the compiler turn the pixel
+    * loads and stores into plain moves. */
+   if (bpp == 3)
+   {
+      png_unfilter_paeth_simd(line, prev, pitch, 3);
+      return;
+   }
+   if (bpp == 4)
+   {
+      png_unfilter_paeth_simd(line, prev, pitch, 4);
+      return;
    }
+#endif
 
-end:
-   free(decoded_scanline);
-   free(prev_scanline);
-   return ret;
+   for (i = 0; i < bpp; i++)
+      line[i] += paeth(0, prev[i], 0);
+   for (i = bpp; i < pitch; i++)
+      line[i] += paeth(line[i - bpp], prev[i], prev[i - bpp]);
 }
 
 struct adam7_pass
@@ -495,112 +605,266 @@ struct adam7_pass
    unsigned stride_y;
 };
 
-static void deinterlace_pass(uint32_t *data, const struct png_ihdr *ihdr,
-      const uint32_t *input, unsigned pass_width, unsigned pass_height,
-      const struct adam7_pass *pass)
+static const struct adam7_pass adam7_passes[] = {
+   { 0, 0, 8, 8 },
+   { 4, 0, 8, 8 },
+   { 0, 4, 4, 8 },
+   { 2, 0, 4, 4 },
+   { 0, 2, 2, 4 },
+   { 1, 0, 2, 2 },
+   { 0, 1, 1, 2 },
+};
+
+/* A non-interlaced image is a single pass covering every pixel. */
+static const struct adam7_pass png_full_pass = { 0, 0, 1, 1 };
+
+enum rpng_decoder_state
 {
-   unsigned x, y;
-   data += pass->y * ihdr->width + pass->x;
-   for (y = 0; y < pass_height;
-         y++, data += ihdr->width * pass->stride_y, input += pass_width)
-   {
-      uint32_t *out = data;
-      for (x = 0; x < pass_width; x++, out += pass->stride_x)
-         *out = input[x];
-   }
-}
+   RPNG_STATE_MAGIC = 0,
+   RPNG_STATE_CHUNK_HEADER,
+   RPNG_STATE_CHUNK_DATA, /* IHDR and PLTE, buffered whole. */
+   RPNG_STATE_IDAT,
+   RPNG_STATE_SKIP,
+   RPNG_STATE_CRC,
+   RPNG_STATE_DONE,
+   RPNG_STATE_ERROR
+};
 
-static bool png_reverse_filter_adam7(uint32_t *data,
-      const struct png_ihdr *ihdr,
-      const uint8_t *inflate_buf, size_t inflate_buf_size,
-      const uint32_t *palette)
+struct rpng_decoder
 {
+   enum rpng_decoder_state state;
+
+   /* Small chunks and headers are gathered here until complete.
+    * Big enough for a full palette. */
+   uint8_t buf[256 * 3];
+   size_t buf_size;
+
+   struct png_chunk chunk;
+   uint32_t chunk_left;
+
+   bool has_ihdr;
+   bool has_idat;
+   bool has_iend;
+   bool has_plte;
+
+   struct png_ihdr ihdr;
+   uint32_t palette[256];
+
+   z_stream stream;
+   bool stream_init;
+   bool stream_end;
+
+   uint32_t *data;
+
+   /* Current pass. pass_count is 1, or 7 for Adam7. */
+   const struct adam7_pass *passes;
+   unsigned pass_count;
    unsigned pass;
-   static const struct adam7_pass passes[] = {
-      { 0, 0, 8, 8 },
-      { 4, 0, 8, 8 },
-      { 0, 4, 4, 8 },
-      { 2, 0, 4, 4 },
-      { 0, 2, 2, 4 },
-      { 1, 0, 2, 2 },
-      { 0, 1, 1, 2 },
-   };
+   unsigned pass_width;
+   unsigned pass_height;
+   unsigned pass_line;
+   unsigned bpp;
+   unsigned pitch;
 
-   for (pass = 0; pass < ARRAY_SIZE(passes); pass++)
+   /* The two scanlines, each filter byte + pitch. Inflate writes
+    * straight into scanline, prev_scanline is the line above. */
+   uint8_t *scanline;
+   uint8_t *prev_scanline;
+   size_t scanline_pos;
+
+   /* Adam7 only, a pass line is converted here before it gets
+    * spread out over the image. */
+   uint32_t *pass_pixels;
+};
+
+/* Moves to the next pass which has pixels in it. */
+static void png_decoder_next_pass(struct rpng_decoder *dec)
+{
+   for (; dec->pass < dec->pass_count; dec->pass++)
    {
-      if (ihdr->width <= passes[pass].x ||
-            ihdr->height <= passes[pass].y) /* Empty pass */
+      const struct adam7_pass *pass = &dec->passes[dec->pass];
+      struct png_ihdr tmp_ihdr = dec->ihdr;
+
+      if (dec->ihdr.width <= pass->x ||
+            dec->ihdr.height <= pass->y) /* Empty pass */
          continue;
 
-      unsigned pass_width  = (ihdr->width - 
-            passes[pass].x + passes[pass].stride_x - 1) / passes[pass].stride_x;
-      unsigned pass_height = (ihdr->height - passes[pass].y + 
-            passes[pass].stride_y - 1) / passes[pass].stride_y;
+      dec->pass_width  = (dec->ihdr.width -
+            pass->x + pass->stride_x - 1) / pass->stride_x;
+      dec->pass_height = (dec->ihdr.height - pass->y +
+            pass->stride_y - 1) / pass->stride_y;
+      dec->pass_line   = 0;
 
-      uint32_t *tmp_data = (uint32_t*)
-         malloc(pass_width * pass_height * sizeof(uint32_t));
+      tmp_ihdr.width   = dec->pass_width;
+      tmp_ihdr.height  = dec->pass_height;
+      png_pass_geom(&tmp_ihdr, dec->pass_width, dec->pass_height,
+            &dec->bpp, &dec->pitch, NULL);
 
-      if (!tmp_data)
-         return false;
+      /* The first line of a pass has nothing above it. */
+      memset(dec->prev_scanline, 0, dec->pitch + 1);
+      return;
+   }
+}
+
+static bool png_decoder_begin_idat(struct rpng_decoder *dec)
+{
+   unsigned pitch;
+   const struct png_ihdr *ihdr = &dec->ihdr;
 
-      struct png_ihdr tmp_ihdr = *ihdr;
-      tmp_ihdr.width = pass_width;
-      tmp_ihdr.height = pass_height;
+   /* No pass has longer lines than the full image. */
+   png_pass_geom(ihdr, ihdr->width, ihdr->height, NULL, &pitch, NULL);
 
-      size_t pass_size;
-      png_pass_geom(&tmp_ihdr, pass_width,
-            pass_height, NULL, NULL, &pass_size);
+   if (inflateInit(&dec->stream) != Z_OK)
+      return false;
+   dec->stream_init = true;
 
-      if (pass_size > inflate_buf_size)
-      {
-         free(tmp_data);
+#ifdef GEKKO
+   /* we often use these in textures, make sure they're 32-byte aligned */
+   dec->data = (uint32_t*)memalign(32, ihdr->width * ihdr->height * sizeof(uint32_t));
+#else
+   dec->data = (uint32_t*)malloc(ihdr->width * ihdr->height * sizeof(uint32_t));
+#endif
+   dec->scanline      = (uint8_t*)malloc(pitch + 1);
+   dec->prev_scanline = (uint8_t*)malloc(pitch + 1);
+   if (!dec->data || !dec->scanline || !dec->prev_scanline)
+      return false;
+
+   if (ihdr->interlace == 1)
+   {
+      dec->passes      = adam7_passes;
+      dec->pass_count  = ARRAY_SIZE(adam7_passes);
+      dec->pass_pixels = (uint32_t*)
+         malloc(ihdr->width * sizeof(uint32_t));
+      if (!dec->pass_pixels)
          return false;
-      }
+   }
+   else
+   {
+      dec->passes      = &png_full_pass;
+      dec->pass_count  = 1;
+   }
 
-      if (!png_reverse_filter(tmp_data,
-               &tmp_ihdr, inflate_buf, pass_size, palette))
-      {
-         free(tmp_data);
+   dec->pass = 0;
+   png_decoder_next_pass(dec);
+   return true;
+}
+
+/* A full scanline of the current pass has been inflated. */
+static bool png_decoder_process_line(struct rpng_decoder *dec)
+{
+   unsigned x;
+   uint8_t *tmp;
+   const struct png_ihdr *ihdr     = &dec->ihdr;
+   const struct adam7_pass *pass   = &dec->passes[dec->pass];
+   unsigned y                      = pass->y + dec->pass_line * pass->stride_y;
+   uint8_t *line                   = dec->scanline + 1;
+   const uint8_t *prev             = dec->prev_scanline + 1;
+   uint32_t *out                   = dec->pass_count == 1 ?
+      dec->data + y * ihdr->width : dec->pass_pixels;
+
+   switch (dec->scanline[0])
+   {
+      case 0: /* None */
+         break;
+
+      case 1: /* Sub */
+         png_unfilter_sub(line, dec->pitch, dec->bpp);
+         break;
+
+      case 2: /* Up */
+         png_unfilter_up(line, prev, dec->pitch);
+         break;
+
+      case 3: /* Average */
+         png_unfilter_avg(line, prev, dec->pitch, dec->bpp);
+         break;
+
+      case 4: /* Paeth */
+         png_unfilter_paeth(line, prev, dec->pitch, dec->bpp);
+         break;
+
+      default:
          return false;
-      }
+   }
 
-      inflate_buf += pass_size;
-      inflate_buf_size -= pass_size;
+   if (ihdr->color_type == 0)
+      copy_line_bw(out, line, dec->pass_width, ihdr->depth);
+   else if (ihdr->color_type == 2)
+      copy_line_rgb(out, line, dec->pass_width, ihdr->depth);
+   else if (ihdr->color_type == 3)
+      copy_line_plt(out, line, dec->pass_width,
+            ihdr->depth, dec->palette);
+   else if (ihdr->color_type == 4)
+      copy_line_gray_alpha(out, line, dec->pass_width, ihdr->depth);
+   else if (ihdr->color_type == 6)
+      copy_line_rgba(out, line, dec->pass_width, ihdr->depth);
+
+   if (dec->pass_count != 1)
+   {
+      uint32_t *dst = dec->data + y * ihdr->width + pass->x;
+      for (x = 0; x < dec->pass_width; x++, dst += pass->stride_x)
+         *dst = out[x];
+   }
 
-      deinterlace_pass(data,
-            ihdr, tmp_data, pass_width, pass_height, &passes[pass]);
-      free(tmp_data);
+   tmp                = dec->prev_scanline;
+   dec->prev_scanline = dec->scanline;
+   dec->scanline      = tmp;
+
+   if (++dec->pass_line == dec->pass_height)
+   {
+      dec->pass++;
+      png_decoder_next_pass(dec);
    }
 
    return true;
 }
 
-static bool png_append_idat(FILE *file,
-      const struct png_chunk *chunk, struct idat_buffer *buf)
+static bool png_decoder_inflate(struct rpng_decoder *dec,
+      const uint8_t *data, size_t size)
 {
-   uint8_t *new_buffer = (uint8_t*)realloc(buf->data, buf->size + chunk->size);
-   if (!new_buffer)
-      return false;
+   dec->stream.next_in  = (uint8_t*)data;
+   dec->stream.avail_in = size;
+
+   while (dec->stream.avail_in && !dec->stream_end)
+   {
+      int ret;
+      size_t line_size;
+      /* Every line is in, anything left is the Adler-32 trailer. */
+      bool finished = dec->pass >= dec->pass_count;
+
+      line_size             = finished ? 1 : dec->pitch + 1;
+      dec->stream.next_out  = dec->scanline + dec->scanline_pos;
+      dec->stream.avail_out = line_size - dec->scanline_pos;
+
+      ret = inflate(&dec->stream, Z_NO_FLUSH);
+      if (ret == Z_STREAM_END)
+         dec->stream_end = true;
+      else if (ret != Z_OK)
+         return false;
+
+      dec->scanline_pos = line_size - dec->stream.avail_out;
+      if (dec->scanline_pos < line_size)
+         continue;
+
+      /* More data than the image has room for. */
+      if (finished)
+         return false;
+
+      dec->scanline_pos = 0;
+      if (!png_decoder_process_line(dec))
+         return false;
+   }
 
-   buf->data  = new_buffer;
-   if (fread(buf->data + buf->size, 1, chunk->size, file) != chunk->size)
-      return false;
-   if (fseek(file, sizeof(uint32_t), SEEK_CUR) < 0)
-      return false;
-   buf->size += chunk->size;
    return true;
 }
 
-static bool png_read_plte(FILE *file, uint32_t *buffer, unsigned entries)
+static bool png_read_plte(const uint8_t *buf, uint32_t *buffer,
+      unsigned entries)
 {
    unsigned i;
    if (entries > 256)
       return false;
 
-   uint8_t buf[256 * 3];
-   if (fread(buf, 3, entries, file) != entries)
-      return false;
-
    for (i = 0; i < entries; i++)
    {
       uint32_t r = buf[3 * i + 0];
@@ -609,166 +873,251 @@ static bool png_read_plte(FILE *file, uint32_t *buffer, unsigned entries)
       buffer[i] = (r << 16) | (g << 8) | (b << 0) | (0xffu << 24);
    }
 
-   if (fseek(file, sizeof(uint32_t), SEEK_CUR) < 0)
+   return true;
+}
+
+/* Collects bytes into dec->buf until it holds size of them. */
+static bool png_decoder_gather(struct rpng_decoder *dec,
+      const uint8_t **data, size_t *size, size_t wanted)
+{
+   size_t copy = wanted - dec->buf_size;
+   if (copy > *size)
+      copy = *size;
+
+   memcpy(dec->buf + dec->buf_size, *data, copy);
+   dec->buf_size += copy;
+   *data         += copy;
+   *size         -= copy;
+
+   if (dec->buf_size < wanted)
       return false;
 
+   dec->buf_size = 0;
    return true;
 }
 
-bool rpng_load_image_argb(const char *path, uint32_t **data,
-      unsigned *width, unsigned *height)
+/* The chunk header is in, check it and decide what to do with
+ * the data that follows. */
+static bool png_decoder_chunk_header(struct rpng_decoder *dec)
 {
-   long pos;
-   *data   = NULL;
-   *width  = 0;
-   *height = 0;
+   struct png_chunk *chunk = &dec->chunk;
 
-   bool ret = true;
-   FILE *file = fopen(path, "rb");
-   if (!file)
-      return false;
+   chunk->size     = dword_be(dec->buf);
+   memcpy(chunk->type, dec->buf + 4, 4);
+   dec->chunk_left = chunk->size;
 
-   fseek(file, 0, SEEK_END);
-   long file_len = ftell(file);
-   rewind(file);
+   switch (png_chunk_type(chunk))
+   {
+      case PNG_CHUNK_NOOP:
+      default:
+         dec->state = RPNG_STATE_SKIP;
+         break;
 
-   bool has_ihdr = false;
-   bool has_idat = false;
-   bool has_iend = false;
-   bool has_plte = false;
-   uint8_t *inflate_buf = NULL;
-   size_t inflate_buf_size = 0;
-   z_stream stream = {0};
+      case PNG_CHUNK_ERROR:
+         return false;
 
-   struct idat_buffer idat_buf = {0};
-   struct png_ihdr ihdr = {0};
-   uint32_t palette[256] = {0};
+      case PNG_CHUNK_IHDR:
+         if (dec->has_ihdr || dec->has_idat || dec->has_iend)
+            return false;
+         if (chunk->size != 13)
+            return false;
+         dec->state = RPNG_STATE_CHUNK_DATA;
+         break;
 
-   char header[8];
-   if (fread(header, 1, sizeof(header), file) != sizeof(header))
-      GOTO_END_ERROR();
+      case PNG_CHUNK_PLTE:
+         if (!dec->has_ihdr || dec->has_plte || dec->has_iend || dec->has_idat)
+            return false;
+         if (chunk->size % 3 || chunk->size > sizeof(dec->buf))
+            return false;
+         dec->state = RPNG_STATE_CHUNK_DATA;
+         break;
 
-   if (memcmp(header, png_magic, sizeof(png_magic)) != 0)
-      GOTO_END_ERROR();
+      case PNG_CHUNK_IDAT:
+         if (!dec->has_ihdr || dec->has_iend ||
+               (dec->ihdr.color_type == 3 && !dec->has_plte))
+            return false;
 
-   /* feof() apparently isn't triggered after a seek (IEND). */
-   for (pos = ftell(file); 
-         pos < file_len && pos >= 0; pos = ftell(file))
-   {
-      struct png_chunk chunk = {0};
-      if (!read_chunk_header(file, &chunk))
-         GOTO_END_ERROR();
+         if (!dec->has_idat && !png_decoder_begin_idat(dec))
+            return false;
 
-      switch (png_chunk_type(&chunk))
-      {
-         case PNG_CHUNK_NOOP:
-         default:
-            if (fseek(file, chunk.size + sizeof(uint32_t), SEEK_CUR) < 0)
-               GOTO_END_ERROR();
-            break;
+         dec->has_idat = true;
+         dec->state    = RPNG_STATE_IDAT;
+         break;
 
-         case PNG_CHUNK_ERROR:
-            GOTO_END_ERROR();
+      case PNG_CHUNK_IEND:
+         if (!dec->has_ihdr || !dec->has_idat)
+            return false;
 
-         case PNG_CHUNK_IHDR:
-            if (has_ihdr || has_idat || has_iend)
-               GOTO_END_ERROR();
+         /* Nothing in IEND or its CRC matters, so there's no
+          * need to wait for them. */
+         dec->has_iend = true;
+         dec->state    = RPNG_STATE_DONE;
+         break;
+   }
 
-            if (!png_parse_ihdr(file, &chunk, &ihdr))
-               GOTO_END_ERROR();
+   return true;
+}
 
-            has_ihdr = true;
-            break;
+rpng_decoder_t *rpng_decoder_new(void)
+{
+   return (rpng_decoder_t*)calloc(1, sizeof(rpng_decoder_t));
+}
 
-         case PNG_CHUNK_PLTE:
-            if (!has_ihdr || has_plte || has_iend || has_idat)
-               GOTO_END_ERROR();
+void rpng_decoder_free(rpng_decoder_t *dec)
+{
+   if (!dec)
+      return;
 
-            if (chunk.size % 3)
-               GOTO_END_ERROR();
+   if (dec->stream_init)
+      inflateEnd(&dec->stream);
+   free(dec->data);
+   free(dec->scanline);
+   free(dec->prev_scanline);
+   free(dec->pass_pixels);
+   free(dec);
+}
 
-            if (!png_read_plte(file, palette, chunk.size / 3))
-               GOTO_END_ERROR();
+bool rpng_decoder_push(rpng_decoder_t *dec, const uint8_t *data, size_t size)
+{
+   while (size)
+   {
+      size_t len;
 
-            has_plte = true;
+      switch (dec->state)
+      {
+         case RPNG_STATE_MAGIC:
+            if (!png_decoder_gather(dec, &data, &size, sizeof(png_magic)))
+               break;
+            if (memcmp(dec->buf, png_magic, sizeof(png_magic)) != 0)
+               goto error;
+            dec->state = RPNG_STATE_CHUNK_HEADER;
             break;
 
-         case PNG_CHUNK_IDAT:
-            if (!has_ihdr || has_iend || (ihdr.color_type == 3 && !has_plte))
-               GOTO_END_ERROR();
+         case RPNG_STATE_CHUNK_HEADER:
+            if (!png_decoder_gather(dec, &data, &size, 8))
+               break;
+            if (!png_decoder_chunk_header(dec))
+               goto error;
+            break;
 
-            if (!png_append_idat(file, &chunk, &idat_buf))
-               GOTO_END_ERROR();
+         case RPNG_STATE_CHUNK_DATA:
+            if (!png_decoder_gather(dec, &data, &size, dec->chunk.size))
+               break;
 
-            has_idat = true;
-            break;
+            if (png_chunk_type(&dec->chunk) == PNG_CHUNK_IHDR)
+            {
+               if (!png_parse_ihdr(&dec->chunk, dec->buf, &dec->ihdr))
+                  goto error;
+               dec->has_ihdr = true;
+            }
+            else
+            {
+               if (!png_read_plte(dec->buf, dec->palette,
+                        dec->chunk.size / 3))
+                  goto error;
+               dec->has_plte = true;
+            }
 
-         case PNG_CHUNK_IEND:
-            if (!has_ihdr || !has_idat)
-               GOTO_END_ERROR();
+            dec->state = RPNG_STATE_CRC;
+            break;
 
-            if (fseek(file, sizeof(uint32_t), SEEK_CUR) < 0)
-               GOTO_END_ERROR();
+         case RPNG_STATE_IDAT:
+         case RPNG_STATE_SKIP:
+            len = dec->chunk_left;
+            if (len > size)
+               len = size;
+
+            if (dec->state == RPNG_STATE_IDAT &&
+                  !png_decoder_inflate(dec, data, len))
+               goto error;
+
+            data            += len;
+            size            -= len;
+            dec->chunk_left -= len;
+            if (!dec->chunk_left)
+               dec->state = RPNG_STATE_CRC;
+            break;
 
-            has_iend = true;
+         case RPNG_STATE_CRC:
+            /* Ignore CRC. */
+            if (!png_decoder_gather(dec, &data, &size, sizeof(uint32_t)))
+               break;
+            dec->state = RPNG_STATE_CHUNK_HEADER;
             break;
+
+         case RPNG_STATE_DONE:
+            /* Whatever trails IEND is none of our business. */
+            return true;
+
+         case RPNG_STATE_ERROR:
+            return false;
       }
    }
 
-   if (!has_ihdr || !has_idat || !has_iend)
-      GOTO_END_ERROR();
+   return true;
 
-   if (inflateInit(&stream) != Z_OK)
-      GOTO_END_ERROR();
+error:
+   dec->state = RPNG_STATE_ERROR;
+   return false;
+}
 
-   png_pass_geom(&ihdr, ihdr.width, ihdr.height, NULL, NULL, &inflate_buf_size);
-   if (ihdr.interlace == 1) /* To be sure. */
-      inflate_buf_size *= 2;
+bool rpng_decoder_done(const rpng_decoder_t *dec)
+{
+   return dec->state == RPNG_STATE_DONE;
+}
 
-   inflate_buf = (uint8_t*)malloc(inflate_buf_size);
-   if (!inflate_buf)
-      GOTO_END_ERROR();
+bool rpng_decoder_get_argb(rpng_decoder_t *dec, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   /* Every line has to be there, and the zlib stream has to
+    * end properly. */
+   if (dec->state != RPNG_STATE_DONE || !dec->stream_end ||
+         dec->pass < dec->pass_count)
+      return false;
+
+   *data     = dec->data;
+   *width    = dec->ihdr.width;
+   *height   = dec->ihdr.height;
+   dec->data = NULL;
+   return true;
+}
 
-   stream.next_in   = idat_buf.data;
-   stream.avail_in  = idat_buf.size;
-   stream.avail_out = inflate_buf_size;
-   stream.next_out  = inflate_buf;
+bool rpng_load_image_argb(const char *path, uint32_t **data,
+      unsigned *width, unsigned *height)
+{
+   bool ret = true;
+   uint8_t buf[RPNG_READ_SIZE];
+   rpng_decoder_t *dec = NULL;
+   FILE *file          = NULL;
 
-   if (inflate(&stream, Z_FINISH) != Z_STREAM_END)
-   {
-      inflateEnd(&stream);
-      GOTO_END_ERROR();
-   }
-   inflateEnd(&stream);
+   *data   = NULL;
+   *width  = 0;
+   *height = 0;
 
-   *width  = ihdr.width;
-   *height = ihdr.height;
-#ifdef GEKKO
-   /* we often use these in textures, make sure they're 32-byte aligned */
-   *data = (uint32_t*)memalign(32, ihdr.width * ihdr.height * sizeof(uint32_t));
-#else
-   *data = (uint32_t*)malloc(ihdr.width * ihdr.height * sizeof(uint32_t));
-#endif
-   if (!*data)
+   file = fopen(path, "rb");
+   if (!file)
+      return false;
+
+   dec = rpng_decoder_new();
+   if (!dec)
       GOTO_END_ERROR();
 
-   if (ihdr.interlace == 1)
+   while (!rpng_decoder_done(dec))
    {
-      if (!png_reverse_filter_adam7(*data,
-               &ihdr, inflate_buf, stream.total_out, palette))
+      size_t size = fread(buf, 1, sizeof(buf), file);
+      if (!size)
+         GOTO_END_ERROR();
+
+      if (!rpng_decoder_push(dec, buf, size))
          GOTO_END_ERROR();
    }
-   else if (!png_reverse_filter(*data,
-            &ihdr, inflate_buf, stream.total_out, palette))
+
+   if (!rpng_decoder_get_argb(dec, data, width, height))
       GOTO_END_ERROR();
 
 end:
-   if (file)
-      fclose(file);
-   if (!ret)
-      free(*data);
-   free(idat_buf.data);
-   free(inflate_buf);
+   fclose(file);
+   rpng_decoder_free(dec);
    return ret;
 }
 
@@ -870,7 +1219,7 @@ static void copy_bgr24_line(uint8_t *dst, const uint8_t *src, unsigned width)
    }
 }
 
-static unsigned count_sad(const uint8_t *data, size_t size)
+static unsigned count_sad_c(const uint8_t *data, size_t size)
 {
    size_t i;
    unsigned cnt = 0;
@@ -879,117 +1228,293 @@ static unsigned count_sad(const uint8_t *data, size_t size)
    return cnt;
 }
 
+/* The SIMD kernels below filter 16 bytes at a time and fold the
+ * sum of absolute differences into the same pass. Whatever doesn't
+ * fill a whole vector, and the first pixel of sub/avg/paeth, goes
+ * through the scalar code. */
+#if defined(__SSE2__)
+/* |(int8_t)x| is min(x, -x) when looking at the bytes as unsigned. */
+static inline __m128i sad_sse2(__m128i acc, __m128i v)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i a    = _mm_min_epu8(v, _mm_sub_epi8(zero, v));
+   return _mm_add_epi64(acc, _mm_sad_epu8(a, zero));
+}
+
+static inline unsigned sad_sse2_sum(__m128i acc)
+{
+   return _mm_cvtsi128_si32(acc) +
+      _mm_cvtsi128_si32(_mm_srli_si128(acc, 8));
+}
+
+/* (a + b) >> 1 without overflowing 8 bits. _mm_avg_epu8 rounds up. */
+static inline __m128i avg_floor_sse2(__m128i a, __m128i b)
+{
+   __m128i odd = _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1));
+   return _mm_sub_epi8(_mm_avg_epu8(a, b), odd);
+}
+
+static inline __m128i paeth_sse2(__m128i a, __m128i b, __m128i c)
+{
+   __m128i zero = _mm_setzero_si128();
+   __m128i lo   = paeth_epi16_sse2(_mm_unpacklo_epi8(a, zero),
+         _mm_unpacklo_epi8(b, zero), _mm_unpacklo_epi8(c, zero));
+   __m128i hi   = paeth_epi16_sse2(_mm_unpackhi_epi8(a, zero),
+         _mm_unpackhi_epi8(b, zero), _mm_unpackhi_epi8(c, zero));
+   return _mm_packus_epi16(lo, hi);
+}
+
+#define RPNG_LOAD(p)      _mm_loadu_si128((const __m128i*)(p))
+#define RPNG_STORE(p, v)  _mm_storeu_si128((__m128i*)(p), v)
+#define RPNG_SUB(a, b)    _mm_sub_epi8(a, b)
+#define RPNG_AVG(a, b)    avg_floor_sse2(a, b)
+#define RPNG_PAETH        paeth_sse2
+#define RPNG_SAD_INIT()   _mm_setzero_si128()
+#define RPNG_SAD          sad_sse2
+#define RPNG_SAD_SUM      sad_sse2_sum
+typedef __m128i rpng_vec_t;
+typedef __m128i rpng_sad_t;
+#define HAVE_RPNG_SIMD
+#elif defined(HAVE_RPNG_NEON)
+static inline uint32x4_t sad_neon(uint32x4_t acc, uint8x16_t v)
+{
+   uint8x16_t a = vminq_u8(v, vsubq_u8(vdupq_n_u8(0), v));
+   return vpadalq_u16(acc, vpaddlq_u8(a));
+}
+
+static inline unsigned sad_neon_sum(uint32x4_t acc)
+{
+   uint64x2_t sum = vpaddlq_u32(acc);
+   return (unsigned)(vgetq_lane_u64(sum, 0) + vgetq_lane_u64(sum, 1));
+}
+
+static inline uint8x16_t paeth_neon(uint8x16_t a, uint8x16_t b, uint8x16_t c)
+{
+   return vcombine_u8(
+         paeth_half_neon(vget_low_u8(a), vget_low_u8(b), vget_low_u8(c)),
+         paeth_half_neon(vget_high_u8(a), vget_high_u8(b), vget_high_u8(c)));
+}
+
+#define RPNG_LOAD(p)      vld1q_u8(p)
+#define RPNG_STORE(p, v)  vst1q_u8(p, v)
+#define RPNG_SUB(a, b)    vsubq_u8(a, b)
+#define RPNG_AVG(a, b)    vhaddq_u8(a, b)
+#define RPNG_PAETH        paeth_neon
+#define RPNG_SAD_INIT()   vdupq_n_u32(0)
+#define RPNG_SAD          sad_neon
+#define RPNG_SAD_SUM      sad_neon_sum
+typedef uint8x16_t rpng_vec_t;
+typedef uint32x4_t rpng_sad_t;
+#define HAVE_RPNG_SIMD
+#endif
+
+static unsigned count_sad(const uint8_t *data, size_t size)
+{
+   size_t i = 0;
+   unsigned cnt = 0;
+#ifdef HAVE_RPNG_SIMD
+   rpng_sad_t acc = RPNG_SAD_INIT();
+   for (; i + 16 <= size; i += 16)
+      acc = RPNG_SAD(acc, RPNG_LOAD(data + i));
+   cnt = RPNG_SAD_SUM(acc);
+#endif
+   return cnt + count_sad_c(data + i, size - i);
+}
+
 static unsigned filter_up(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i = 0, start, sad = 0;
    width *= bpp;
-   for (i = 0; i < width; i++)
+#ifdef HAVE_RPNG_SIMD
+   {
+      rpng_sad_t acc = RPNG_SAD_INIT();
+      for (; i + 16 <= width; i += 16)
+      {
+         rpng_vec_t v = RPNG_SUB(RPNG_LOAD(line + i), RPNG_LOAD(prev + i));
+         RPNG_STORE(target + i, v);
+         acc = RPNG_SAD(acc, v);
+      }
+      sad = RPNG_SAD_SUM(acc);
+   }
+#endif
+   for (start = i; i < width; i++)
       target[i] = line[i] - prev[i];
 
-   return count_sad(target, width);
+   return sad + count_sad_c(target + start, width - start);
 }
 
 static unsigned filter_sub(uint8_t *target, const uint8_t *line,
       unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i, start, sad = 0;
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i];
-   for (i = bpp; i < width; i++)
+#ifdef HAVE_RPNG_SIMD
+   {
+      rpng_sad_t acc = RPNG_SAD_INIT();
+      for (; i + 16 <= width; i += 16)
+      {
+         rpng_vec_t v = RPNG_SUB(RPNG_LOAD(line + i),
+               RPNG_LOAD(line + i - bpp));
+         RPNG_STORE(target + i, v);
+         acc = RPNG_SAD(acc, v);
+      }
+      sad = RPNG_SAD_SUM(acc);
+   }
+#endif
+   for (start = i; i < width; i++)
       target[i] = line[i] - line[i - bpp];
 
-   return count_sad(target, width);
+   return sad + count_sad_c(target, bpp) +
+      count_sad_c(target + start, width - start);
 }
 
 static unsigned filter_avg(uint8_t *target, const uint8_t *line,
       const uint8_t *prev, unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i, start, sad = 0;
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - (prev[i] >> 1);
-   for (i = bpp; i < width; i++)
+#ifdef HAVE_RPNG_SIMD
+   {
+      rpng_sad_t acc = RPNG_SAD_INIT();
+      for (; i + 16 <= width; i += 16)
+      {
+         rpng_vec_t v = RPNG_SUB(RPNG_LOAD(line + i),
+               RPNG_AVG(RPNG_LOAD(line + i - bpp), RPNG_LOAD(prev + i)));
+         RPNG_STORE(target + i, v);
+         acc = RPNG_SAD(acc, v);
+      }
+      sad = RPNG_SAD_SUM(acc);
+   }
+#endif
+   for (start = i; i < width; i++)
       target[i] = line[i] - ((line[i - bpp] + prev[i]) >> 1);
 
-   return count_sad(target, width);
+   return sad + count_sad_c(target, bpp) +
+      count_sad_c(target + start, width - start);
 }
 
 static unsigned filter_paeth(uint8_t *target,
       const uint8_t *line, const uint8_t *prev,
       unsigned width, unsigned bpp)
 {
-   unsigned i;
+   unsigned i, start, sad = 0;
    width *= bpp;
    for (i = 0; i < bpp; i++)
       target[i] = line[i] - paeth(0, prev[i], 0);
-   for (i = bpp; i < width; i++)
+#ifdef HAVE_RPNG_SIMD
+   {
+      rpng_sad_t acc = RPNG_SAD_INIT();
+      for (; i + 16 <= width; i += 16)
+      {
+         rpng_vec_t v = RPNG_SUB(RPNG_LOAD(line + i),
+               RPNG_PAETH(RPNG_LOAD(line + i - bpp),
+                  RPNG_LOAD(prev + i), RPNG_LOAD(prev + i - bpp)));
+         RPNG_STORE(target + i, v);
+         acc = RPNG_SAD(acc, v);
+      }
+      sad = RPNG_SAD_SUM(acc);
+   }
+#endif
+   for (start = i; i < width; i++)
       target[i] = line[i] - paeth(line[i - bpp], prev[i], prev[i - bpp]);
 
-   return count_sad(target, width);
+   return sad + count_sad_c(target, bpp) +
+      count_sad_c(target + start, width - start);
 }
 
-static bool rpng_save_image(const char *path,
-      const uint8_t *data,
-      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+/* The image is encoded in horizontal stripes of at least this many
+ * bytes of filtered data. Each stripe is filtered and deflated on its
+ * own, so stripes can go to different threads. The stripe layout only
+ * depends on the image size, so the file is the same no matter how
+ * many threads encoded it. */
+#define RPNG_STRIPE_SIZE (256 * 1024)
+
+/* Deflate window. Each stripe gets the tail of the previous one as
+ * its preset dictionary, which keeps the compression ratio close to
+ * a single stream. */
+#define RPNG_WINDOW_SIZE (1 << 15)
+
+struct rpng_encoder;
+
+struct rpng_stripe
 {
-   unsigned h;
-   bool ret = true;
-   struct png_ihdr ihdr = {0};
+   struct rpng_encoder *enc;
+   unsigned first_line;
+   unsigned lines;
 
-   size_t encode_buf_size  = 0;
-   uint8_t *encode_buf     = NULL;
-   uint8_t *deflate_buf    = NULL;
-   uint8_t *rgba_line      = NULL;
-   uint8_t *up_filtered    = NULL;
-   uint8_t *sub_filtered   = NULL;
-   uint8_t *avg_filtered   = NULL;
-   uint8_t *paeth_filtered = NULL;
-   uint8_t *prev_encoded   = NULL;
-   uint8_t *encode_target  = NULL;
+   uint8_t *filtered;   /* Points into rpng_encoder::encode_buf. */
+   size_t filtered_size;
 
-   z_stream stream = {0};
+   uint8_t *deflated;
+   size_t deflated_size;
+   uLong adler;
 
-   FILE *file = fopen(path, "wb");
-   if (!file)
-      GOTO_END_ERROR();
+   bool ok;
+};
 
-   if (fwrite(png_magic, 1, sizeof(png_magic), file) != sizeof(png_magic))
-      GOTO_END_ERROR();
+struct rpng_encoder
+{
+   const uint8_t *data;
+   unsigned width, height, pitch, bpp;
 
-   ihdr.width = width;
-   ihdr.height = height;
-   ihdr.depth = 8;
-   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
-   if (!png_write_ihdr(file, &ihdr))
-      GOTO_END_ERROR();
+   uint8_t *encode_buf;
+   struct rpng_stripe *stripes;
+   unsigned num_stripes;
+   unsigned threads;
+};
 
-   encode_buf_size = (width * bpp + 1) * height;
-   encode_buf = (uint8_t*)malloc(encode_buf_size);
-   if (!encode_buf)
-      GOTO_END_ERROR();
+static void rpng_copy_line(const struct rpng_encoder *enc,
+      uint8_t *dst, unsigned line)
+{
+   const uint8_t *src = enc->data + line * enc->pitch;
+   if (enc->bpp == sizeof(uint32_t))
+      copy_argb_line(dst, (const uint32_t*)src, enc->width);
+   else
+      copy_bgr24_line(dst, src, enc->width);
+}
 
-   prev_encoded = (uint8_t*)calloc(1, width * bpp);
-   if (!prev_encoded)
-      GOTO_END_ERROR();
+static bool rpng_filter_stripe(struct rpng_stripe *stripe)
+{
+   unsigned h;
+   const struct rpng_encoder *enc = stripe->enc;
+   unsigned width  = enc->width;
+   unsigned bpp    = enc->bpp;
+   size_t size     = width * bpp;
+   uint8_t *target = stripe->filtered;
+
+   /* Every line gets its own slot in one allocation. */
+   uint8_t *scratch        = (uint8_t*)malloc(6 * size);
+   uint8_t *rgba_line      = scratch;
+   uint8_t *prev_encoded   = scratch + 1 * size;
+   uint8_t *up_filtered    = scratch + 2 * size;
+   uint8_t *sub_filtered   = scratch + 3 * size;
+   uint8_t *avg_filtered   = scratch + 4 * size;
+   uint8_t *paeth_filtered = scratch + 5 * size;
+
+   if (!scratch)
+      return false;
 
-   rgba_line      = (uint8_t*)malloc(width * bpp);
-   up_filtered    = (uint8_t*)malloc(width * bpp);
-   sub_filtered   = (uint8_t*)malloc(width * bpp);
-   avg_filtered   = (uint8_t*)malloc(width * bpp);
-   paeth_filtered = (uint8_t*)malloc(width * bpp);
-   if (!rgba_line || !up_filtered || !sub_filtered || !avg_filtered || !paeth_filtered)
-      GOTO_END_ERROR();
+   /* Filters look at the unfiltered line above, which for all
+    * but the first stripe belongs to someone else. */
+   if (stripe->first_line)
+      rpng_copy_line(enc, prev_encoded, stripe->first_line - 1);
+   else
+      memset(prev_encoded, 0, size);
 
-   encode_target = encode_buf;
-   for (h = 0; h < height;
-         h++, encode_target += width * bpp, data += pitch)
+   for (h = 0; h < stripe->lines; h++, target += size)
    {
-      if (bpp == sizeof(uint32_t))
-         copy_argb_line(rgba_line, (const uint32_t*)data, width);
-      else
-         copy_bgr24_line(rgba_line, data, width);
+      uint8_t *tmp;
+      unsigned none_score, up_score, sub_score, avg_score, paeth_score;
+      unsigned min_sad;
+      uint8_t filter = 0;
+      const uint8_t *chosen_filtered = NULL;
+
+      rpng_copy_line(enc, rgba_line, stripe->first_line + h);
 
       /* Try every filtering method, and choose the method
        * which has most entries as zero.
@@ -997,15 +1522,14 @@ static bool rpng_save_image(const char *path,
        * This is probably not very optimal, but it's very 
        * simple to implement.
        */
-      unsigned none_score  = count_sad(rgba_line, width * bpp);
-      unsigned up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
-      unsigned sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
-      unsigned avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
-      unsigned paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
+      none_score  = count_sad(rgba_line, size);
+      up_score    = filter_up(up_filtered, rgba_line, prev_encoded, width, bpp);
+      sub_score   = filter_sub(sub_filtered, rgba_line, width, bpp);
+      avg_score   = filter_avg(avg_filtered, rgba_line, prev_encoded, width, bpp);
+      paeth_score = filter_paeth(paeth_filtered, rgba_line, prev_encoded, width, bpp);
 
-      uint8_t filter = 0;
-      unsigned min_sad = none_score;
-      const uint8_t *chosen_filtered = rgba_line;
+      min_sad = none_score;
+      chosen_filtered = rgba_line;
 
       if (sub_score < min_sad)
       {
@@ -1035,32 +1559,244 @@ static bool rpng_save_image(const char *path,
          min_sad = paeth_score;
       }
 
-      *encode_target++ = filter;
-      memcpy(encode_target, chosen_filtered, width * bpp);
+      *target++ = filter;
+      memcpy(target, chosen_filtered, size);
 
-      memcpy(prev_encoded, rgba_line, width * bpp);
+      tmp          = prev_encoded;
+      prev_encoded = rgba_line;
+      rgba_line    = tmp;
    }
 
-   deflate_buf = (uint8_t*)malloc(encode_buf_size * 2); /* Just to be sure. */
-   if (!deflate_buf)
+   free(scratch);
+   return true;
+}
+
+/* Deflates a stripe as raw deflate data ending on a byte boundary
+ * (a sync flush), so the stripes can simply be concatenated. Only
+ * the last stripe finishes the stream. */
+static bool rpng_deflate_stripe(struct rpng_stripe *stripe)
+{
+   const struct rpng_encoder *enc = stripe->enc;
+   bool last = stripe == &enc->stripes[enc->num_stripes - 1];
+   z_stream stream = {0};
+   size_t cap;
+   int ret;
+
+   stripe->adler = adler32(adler32(0, NULL, 0),
+         stripe->filtered, stripe->filtered_size);
+
+   if (deflateInit2(&stream, 9, Z_DEFLATED, -15, 8,
+            Z_DEFAULT_STRATEGY) != Z_OK)
+      return false;
+
+   /* Stripes sit back to back in encode_buf, so the previous
+    * stripe's tail is right in front of this one. */
+   if (stripe != enc->stripes)
+   {
+      const struct rpng_stripe *prev = stripe - 1;
+      size_t dict_size = prev->filtered_size;
+      if (dict_size > RPNG_WINDOW_SIZE)
+         dict_size = RPNG_WINDOW_SIZE;
+
+      if (deflateSetDictionary(&stream,
+               stripe->filtered - dict_size, dict_size) != Z_OK)
+         goto error;
+   }
+
+   /* The sync flush marker and a final empty block on top of the bound. */
+   cap = deflateBound(&stream, stripe->filtered_size) + 16;
+   stripe->deflated = (uint8_t*)malloc(cap);
+   if (!stripe->deflated)
+      goto error;
+
+   stream.next_in   = stripe->filtered;
+   stream.avail_in  = stripe->filtered_size;
+   stream.next_out  = stripe->deflated;
+   stream.avail_out = cap;
+
+   ret = deflate(&stream, last ? Z_FINISH : Z_SYNC_FLUSH);
+   if (last ? ret != Z_STREAM_END :
+         (ret != Z_OK || stream.avail_in || !stream.avail_out))
+      goto error;
+
+   stripe->deflated_size = stream.total_out;
+   deflateEnd(&stream);
+   return true;
+
+error:
+   deflateEnd(&stream);
+   return false;
+}
+
+struct rpng_encode_thread_data
+{
+   struct rpng_encoder *enc;
+   unsigned index;
+   bool (*work)(struct rpng_stripe *stripe);
+};
+
+/* Thread index handles stripes index, index + threads, ... */
+static void rpng_encode_thread_loop(void *data)
+{
+   unsigned i;
+   struct rpng_encode_thread_data *thr =
+      (struct rpng_encode_thread_data*)data;
+   struct rpng_encoder *enc = thr->enc;
+
+   for (i = thr->index; i < enc->num_stripes; i += enc->threads)
+      enc->stripes[i].ok = thr->work(&enc->stripes[i]);
+}
+
+/* Runs work on every stripe. The first share runs on the calling
+ * thread, the rest on threads - 1 workers. */
+static bool rpng_encode_run(struct rpng_encoder *enc,
+      bool (*work)(struct rpng_stripe *stripe))
+{
+   unsigned i;
+   struct rpng_encode_thread_data thread_data[RPNG_MAX_THREADS] = {{0}};
+#ifdef HAVE_THREADS
+   sthread_t *threads[RPNG_MAX_THREADS] = {NULL};
+#endif
+
+   for (i = 0; i < enc->threads; i++)
+   {
+      thread_data[i].enc   = enc;
+      thread_data[i].index = i;
+      thread_data[i].work  = work;
+   }
+
+#ifdef HAVE_THREADS
+   for (i = 1; i < enc->threads; i++)
+      threads[i] = sthread_create(rpng_encode_thread_loop, &thread_data[i]);
+#endif
+
+   rpng_encode_thread_loop(&thread_data[0]);
+
+#ifdef HAVE_THREADS
+   for (i = 1; i < enc->threads; i++)
+   {
+      /* If the thread couldn't be started, do its share here. */
+      if (threads[i])
+         sthread_join(threads[i]);
+      else
+         rpng_encode_thread_loop(&thread_data[i]);
+   }
+#endif
+
+   for (i = 0; i < enc->num_stripes; i++)
+      if (!enc->stripes[i].ok)
+         return false;
+   return true;
+}
+
+static unsigned rpng_encode_threads(unsigned num_stripes)
+{
+   unsigned threads = 1;
+#if defined(HAVE_THREADS) && defined(RARCH_INTERNAL)
+   threads = rarch_get_cpu_cores();
+#endif
+   if (threads > RPNG_MAX_THREADS)
+      threads = RPNG_MAX_THREADS;
+   if (threads > num_stripes)
+      threads = num_stripes;
+   return threads ? threads : 1;
+}
+
+static bool rpng_save_image(const char *path,
+      const uint8_t *data,
+      unsigned width, unsigned height, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   bool ret = true;
+   struct png_ihdr ihdr = {0};
+   struct rpng_encoder enc = {0};
+
+   size_t line_size        = width * bpp + 1;
+   unsigned stripe_lines   = 0;
+   size_t deflate_size     = 0;
+   uLong adler             = adler32(0, NULL, 0);
+   uint8_t *deflate_buf    = NULL;
+   uint8_t *deflate_target = NULL;
+
+   FILE *file = fopen(path, "wb");
+   if (!file)
+      GOTO_END_ERROR();
+
+   if (fwrite(png_magic, 1, sizeof(png_magic), file) != sizeof(png_magic))
+      GOTO_END_ERROR();
+
+   ihdr.width = width;
+   ihdr.height = height;
+   ihdr.depth = 8;
+   ihdr.color_type = bpp == sizeof(uint32_t) ? 6 : 2; /* RGBA or RGB */
+   if (!png_write_ihdr(file, &ihdr))
+      GOTO_END_ERROR();
+
+   enc.data   = data;
+   enc.width  = width;
+   enc.height = height;
+   enc.pitch  = pitch;
+   enc.bpp    = bpp;
+
+   enc.encode_buf = (uint8_t*)malloc(line_size * height);
+   if (!enc.encode_buf)
       GOTO_END_ERROR();
 
-   stream.next_in   = encode_buf;
-   stream.avail_in  = encode_buf_size;
-   stream.next_out  = deflate_buf + 8;
-   stream.avail_out = encode_buf_size * 2;
+   stripe_lines = (RPNG_STRIPE_SIZE + line_size - 1) / line_size;
+   enc.num_stripes = (height + stripe_lines - 1) / stripe_lines;
+   if (!enc.num_stripes)
+      enc.num_stripes = 1;
+   enc.threads = rpng_encode_threads(enc.num_stripes);
 
-   deflateInit(&stream, 9);
-   if (deflate(&stream, Z_FINISH) != Z_STREAM_END)
+   enc.stripes = (struct rpng_stripe*)
+      calloc(enc.num_stripes, sizeof(*enc.stripes));
+   if (!enc.stripes)
+      GOTO_END_ERROR();
+
+   for (i = 0; i < enc.num_stripes; i++)
    {
-      deflateEnd(&stream);
+      struct rpng_stripe *stripe = &enc.stripes[i];
+      stripe->enc           = &enc;
+      stripe->first_line    = i * stripe_lines;
+      stripe->lines         = height - stripe->first_line;
+      if (stripe->lines > stripe_lines)
+         stripe->lines      = stripe_lines;
+      stripe->filtered      = enc.encode_buf + stripe->first_line * line_size;
+      stripe->filtered_size = stripe->lines * line_size;
+   }
+
+   /* Deflating a stripe needs the filtered tail of the stripe
+    * before it, so every stripe has to be filtered first. */
+   if (!rpng_encode_run(&enc, rpng_filter_stripe))
+      GOTO_END_ERROR();
+   if (!rpng_encode_run(&enc, rpng_deflate_stripe))
+      GOTO_END_ERROR();
+
+   /* zlib header (32K window, maximum compression), the raw
+    * stripes back to back, then the Adler-32 of all of them. */
+   deflate_size = 2 + 4;
+   for (i = 0; i < enc.num_stripes; i++)
+      deflate_size += enc.stripes[i].deflated_size;
+
+   deflate_buf = (uint8_t*)malloc(deflate_size + 8);
+   if (!deflate_buf)
       GOTO_END_ERROR();
+
+   deflate_target = deflate_buf + 8;
+   *deflate_target++ = 0x78;
+   *deflate_target++ = 0xda;
+   for (i = 0; i < enc.num_stripes; i++)
+   {
+      const struct rpng_stripe *stripe = &enc.stripes[i];
+      memcpy(deflate_target, stripe->deflated, stripe->deflated_size);
+      deflate_target += stripe->deflated_size;
+      adler = adler32_combine(adler, stripe->adler, stripe->filtered_size);
    }
-   deflateEnd(&stream);
+   dword_write_be(deflate_target, adler);
 
    memcpy(deflate_buf + 4, "IDAT", 4);
-   dword_write_be(deflate_buf + 0, stream.total_out);
-   if (!png_write_idat(file, deflate_buf, stream.total_out + 8))
+   dword_write_be(deflate_buf + 0, deflate_size);
+   if (!png_write_idat(file, deflate_buf, deflate_size + 8))
       GOTO_END_ERROR();
 
    if (!png_write_iend(file))
@@ -1069,14 +1805,14 @@ static bool rpng_save_image(const char *path,
 end:
    if (file)
       fclose(file);
-   free(encode_buf);
+   if (enc.stripes)
+   {
+      for (i = 0; i < enc.num_stripes; i++)
+         free(enc.stripes[i].deflated);
+   }
+   free(enc.stripes);
+   free(enc.encode_buf);
    free(deflate_buf);
-   free(rgba_line);
-   free(prev_encoded);
-   free(up_filtered);
-   free(sub_filtered);
-   free(avg_filtered);
-   free(paeth_filtered);
    return ret;
 }
 
@@ -17,6 +17,7 @@
 #define RPNG_H__
 
 #include <stdint.h>
+#include <stddef.h>
 
 #include <boolean.h>
 
@@ -31,6 +32,27 @@ extern "C" {
 bool rpng_load_image_argb(const char *path, uint32_t **data,
       unsigned *width, unsigned *height);
 
+/* Incremental decoder. The file can be pushed in pieces of any
+ * size as it comes in. Scanlines are inflated and unfiltered as
+ * soon as they are complete, so apart from the image itself only
+ * two scanlines are kept around. */
+typedef struct rpng_decoder rpng_decoder_t;
+
+rpng_decoder_t *rpng_decoder_new(void);
+void rpng_decoder_free(rpng_decoder_t *dec);
+
+/* Returns false if the data is not a PNG rpng can decode.
+ * Anything pushed after IEND is ignored. */
+bool rpng_decoder_push(rpng_decoder_t *dec, const uint8_t *data, size_t size);
+
+/* True once the IEND chunk header has been pushed. */
+bool rpng_decoder_done(const rpng_decoder_t *dec);
+
+/* Hands over the decoded image, which the caller frees. Fails
+ * unless the image is complete. */
+bool rpng_decoder_get_argb(rpng_decoder_t *dec, uint32_t **data,
+      unsigned *width, unsigned *height);
+
 #ifdef HAVE_ZLIB_DEFLATE
 bool rpng_save_image_argb(const char *path, const uint32_t *data,
       unsigned width, unsigned height, unsigned pitch);
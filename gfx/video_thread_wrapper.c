@@ -96,7 +96,21 @@ static void thread_loop(void *data)
       while (thr->send_cmd == CMD_NONE && !thr->frame.updated)
          scond_wait(thr->cond_thread, thr->lock);
       if (thr->frame.updated)
+      {
+         /* Take the newest frame, a dupe just draws front again. */
+         if (thr->frame.middle & THREAD_FRAME_FRESH)
+         {
+            unsigned front    = thr->frame.front;
+            thr->frame.front  = thr->frame.middle & ~THREAD_FRAME_FRESH;
+            thr->frame.middle = front;
+         }
+
+         strlcpy(thr->frame.draw_msg, thr->frame.msg,
+               sizeof(thr->frame.draw_msg));
+         thr->frame.updated = false;
+         thr->frame.drawing = true;
          updated = true;
+      }
 
       /* To avoid race condition where send_cmd is updated 
        * right after the switch is checked. */
@@ -286,6 +300,9 @@ static void thread_loop(void *data)
 
       if (updated)
       {
+         const struct thread_frame_slot *slot =
+            &thr->frame.slots[thr->frame.front];
+
          slock_lock(thr->frame.lock);
 
          thread_update_driver_state(thr);
@@ -297,8 +314,8 @@ static void thread_loop(void *data)
 
          if (thr->driver && thr->driver->frame)
             ret = thr->driver->frame(thr->driver_data,
-               thr->frame.buffer, thr->frame.width, thr->frame.height,
-               thr->frame.pitch, *thr->frame.msg ? thr->frame.msg : NULL);
+               slot->buffer, slot->width, slot->height, slot->pitch,
+               *thr->frame.draw_msg ? thr->frame.draw_msg : NULL);
 
          slock_unlock(thr->frame.lock);
 
@@ -318,7 +335,7 @@ static void thread_loop(void *data)
          thr->alive = alive;
          thr->focus = focus;
          thr->has_windowed = has_windowed;
-         thr->frame.updated = false;
+         thr->frame.drawing = false;
          thr->vp = vp;
          scond_signal(thr->cond_cmd);
          slock_unlock(thr->lock);
@@ -403,7 +420,31 @@ static bool thread_frame(void *data, const void *frame_,
          sizeof(uint32_t) : sizeof(uint16_t));
 
    const uint8_t *src = (const uint8_t*)frame_;
-   uint8_t *dst = thr->frame.buffer;
+   struct thread_frame_slot *slot = &thr->frame.slots[thr->frame.back];
+
+   /* The back slot is ours alone, so fill it before taking the lock.
+    * If the core rendered straight into it there is nothing to do. */
+   if (src == slot->buffer)
+   {
+      slot->width  = width;
+      slot->height = height;
+      slot->pitch  = pitch;
+      thr->zero_copy_count++;
+   }
+   else if (src)
+   {
+      unsigned h;
+      uint8_t *dst = slot->buffer;
+
+      RARCH_PERFORMANCE_INIT(thr_frame_copy);
+      RARCH_PERFORMANCE_START(thr_frame_copy);
+      for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
+         memcpy(dst, src, copy_stride);
+      slot->width  = width;
+      slot->height = height;
+      slot->pitch  = copy_stride;
+      RARCH_PERFORMANCE_STOP(thr_frame_copy);
+   }
 
    slock_lock(thr->lock);
 
@@ -427,40 +468,36 @@ static bool thread_frame(void *data, const void *frame_,
       }
    }
 
-   /* Drop frame if updated flag is still set, as thread is 
-    * still working on last frame. */
-   if (!thr->frame.updated)
+   if (frame_)
    {
-      if (src)
-      {
-         unsigned h;
-         for (h = 0; h < height; h++, src += pitch, dst += copy_stride)
-            memcpy(dst, src, copy_stride);
-      }
+      /* If the thread never picked up the last frame, this one
+       * replaces it and the old slot becomes our back slot. */
+      unsigned middle   = thr->frame.middle;
+      thr->frame.middle = thr->frame.back | THREAD_FRAME_FRESH;
+      thr->frame.back   = middle & ~THREAD_FRAME_FRESH;
+
+      if (middle & THREAD_FRAME_FRESH)
+         thr->miss_count++;
+      else
+         thr->hit_count++;
+   }
 
-      thr->frame.updated = true;
-      thr->frame.width  = width;
-      thr->frame.height = height;
-      thr->frame.pitch  = copy_stride;
+   thr->frame.updated = true;
 
-      if (msg)
-         strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
-      else
-         *thr->frame.msg = '\0';
+   if (msg)
+      strlcpy(thr->frame.msg, msg, sizeof(thr->frame.msg));
+   else
+      *thr->frame.msg = '\0';
 
-      scond_signal(thr->cond_thread);
+   scond_signal(thr->cond_thread);
 
 #if defined(HAVE_MENU)
-      if (thr->texture.enable)
-      {
-         while (thr->frame.updated)
-            scond_wait(thr->cond_cmd, thr->lock);
-      }
-#endif
-      thr->hit_count++;
+   if (thr->texture.enable)
+   {
+      while (thr->frame.updated || thr->frame.drawing)
+         scond_wait(thr->cond_cmd, thr->lock);
    }
-   else
-      thr->miss_count++;
+#endif
 
    slock_unlock(thr->lock);
 
@@ -491,14 +528,25 @@ static bool thread_init(thread_video_t *thr, const video_info_t *info,
    thr->focus = true;
    thr->has_windowed = true;
 
+   unsigned i;
    size_t max_size = info->input_scale * RARCH_SCALE_BASE;
+   thr->frame.max_width  = max_size;
+   thr->frame.max_height = max_size;
    max_size *= max_size;
    max_size *= info->rgb32 ? sizeof(uint32_t) : sizeof(uint16_t);
-   thr->frame.buffer = (uint8_t*)malloc(max_size);
-   if (!thr->frame.buffer)
-      return false;
 
-   memset(thr->frame.buffer, 0x80, max_size);
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+   {
+      thr->frame.slots[i].buffer = (uint8_t*)malloc(max_size);
+      if (!thr->frame.slots[i].buffer)
+         return false;
+
+      memset(thr->frame.slots[i].buffer, 0x80, max_size);
+   }
+
+   thr->frame.front  = 0;
+   thr->frame.middle = 1;
+   thr->frame.back   = 2;
 
    thr->last_time = rarch_get_time_usec();
 
@@ -560,6 +608,7 @@ static bool thread_read_viewport(void *data, uint8_t *buffer)
 
 static void thread_free(void *data)
 {
+   unsigned i;
    thread_video_t *thr = (thread_video_t*)data;
    if (!thr)
       return;
@@ -571,7 +620,8 @@ static void thread_free(void *data)
 #if defined(HAVE_MENU)
    free(thr->texture.frame);
 #endif
-   free(thr->frame.buffer);
+   for (i = 0; i < THREAD_FRAME_SLOTS; i++)
+      free(thr->frame.slots[i].buffer);
    slock_free(thr->frame.lock);
    slock_free(thr->lock);
    scond_free(thr->cond_cmd);
@@ -580,8 +630,9 @@ static void thread_free(void *data)
    free(thr->alpha_mod);
    slock_free(thr->alpha_lock);
 
-   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u.\n",
-         thr->hit_count, thr->miss_count);
+   RARCH_LOG("Threaded video stats: Frames pushed: %u, Frames dropped: %u, "
+         "Zero-copy frames: %u.\n",
+         thr->hit_count, thr->miss_count, thr->zero_copy_count);
 
    free(thr);
 }
@@ -865,3 +916,26 @@ void *rarch_threaded_video_resolve(const video_driver_t **drv)
    return thr->driver_data;
 }
 
+bool rarch_threaded_video_get_framebuffer(struct retro_framebuffer *fb)
+{
+   thread_video_t *thr = (thread_video_t*)driver.video_data;
+   const struct thread_frame_slot *slot;
+
+   if (!thr || !fb)
+      return false;
+
+   if (fb->width > thr->frame.max_width || fb->height > thr->frame.max_height)
+      return false;
+
+   /* frame() only swaps the back slot, which is not touched by the
+    * video thread, so it stays valid until the core hands it back. */
+   slot = &thr->frame.slots[thr->frame.back];
+
+   fb->data         = slot->buffer;
+   fb->pitch        = fb->width * (thr->info.rgb32 ?
+         sizeof(uint32_t) : sizeof(uint16_t));
+   fb->format       = thr->info.rgb32 ?
+      RETRO_PIXEL_FORMAT_XRGB8888 : RETRO_PIXEL_FORMAT_RGB565;
+   fb->memory_flags = RETRO_MEMORY_TYPE_CACHED;
+   return true;
+}
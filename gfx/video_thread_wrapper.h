@@ -30,6 +30,28 @@ bool rarch_threaded_video_init(
 
 void *rarch_threaded_video_resolve(const video_driver_t **drv);
 
+/* Lends the core the frame slot the next frame() call will publish,
+ * so it can render straight into it. Fails if the frame cannot be
+ * passed through untouched. */
+bool rarch_threaded_video_get_framebuffer(struct retro_framebuffer *fb);
+
+/* Frames are handed over through three slots. The caller of frame()
+ * owns the back slot and fills it outside of any lock, the video
+ * thread owns the front slot while drawing it, and the two trade
+ * places with the middle slot under the lock, which only costs an
+ * index swap. */
+#define THREAD_FRAME_SLOTS 3
+/* Set on frame.middle while the slot there has not been drawn. */
+#define THREAD_FRAME_FRESH 0x80
+
+struct thread_frame_slot
+{
+   uint8_t *buffer;
+   unsigned width;
+   unsigned height;
+   unsigned pitch;
+};
+
 enum thread_cmd
 {
    CMD_NONE = 0,
@@ -103,6 +125,7 @@ typedef struct thread_video
    retro_time_t last_time;
    unsigned hit_count;
    unsigned miss_count;
+   unsigned zero_copy_count;
 
    float *alpha_mod;
    unsigned alpha_mods;
@@ -167,13 +190,17 @@ typedef struct thread_video
    struct
    {
       slock_t *lock;
-      uint8_t *buffer;
-      unsigned width;
-      unsigned height;
-      unsigned pitch;
+      struct thread_frame_slot slots[THREAD_FRAME_SLOTS];
+      unsigned back;
+      unsigned middle;
+      unsigned front;
+      unsigned max_width;
+      unsigned max_height;
       bool updated;
+      bool drawing;
       bool within_thread;
       char msg[PATH_MAX];
+      char draw_msg[PATH_MAX];
    } frame;
 
    video_driver_t video_thread;
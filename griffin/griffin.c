@@ -395,6 +395,7 @@ STATE TRACKER
 FIFO BUFFER
 ============================================================ */
 #include "../fifo_buffer.c"
+#include "../spsc_buffer.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -403,6 +404,7 @@ AUDIO RESAMPLER
 #include "../audio/resamplers/sinc.c"
 #include "../audio/resamplers/nearest.c"
 #include "../audio/resamplers/cc_resampler.c"
+#include "../audio/resamplers/polyphase.c"
 
 /*============================================================
 CAMERA
@@ -622,6 +624,7 @@ THREAD
 #include "../libretro-sdk/rthreads/rthreads.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
+#include "../audio/audio_dsp_thread.c"
 #include "../autosave.c"
 #endif
 
@@ -773,6 +776,7 @@ XML
  AUDIO UTILS
 ============================================================ */
 #include "../audio/utils.c"
+#include "../audio/audio_rate_control.c"
 
 #ifdef __cplusplus
 }
@@ -1235,6 +1235,7 @@ const struct input_bind_map input_config_bind_map[RARCH_BIND_LIST_END_NULL] = {
       DECLARE_META_BIND(2, state_slot_increase,   RARCH_STATE_SLOT_PLUS, "State Slot +"),
       DECLARE_META_BIND(2, state_slot_decrease,   RARCH_STATE_SLOT_MINUS, "State slot -"),
       DECLARE_META_BIND(1, rewind,                RARCH_REWIND, "Rewind"),
+      DECLARE_META_BIND(2, rewind_scrub,          RARCH_REWIND_SCRUB, "Rewind Scrub"),
     //  DECLARE_META_BIND(2, pause_toggle,          RARCH_PAUSE_TOGGLE, "Pause Toggle"),
      // DECLARE_META_BIND(2, frame_advance,         RARCH_FRAMEADVANCE, "Frameadvance"),
       DECLARE_META_BIND(2, reset,                 RARCH_RESET, "Reset"),
@@ -28,13 +28,45 @@
 
 #ifdef SCALER_NO_SIMD
 #undef __SSE2__
+#undef __SSSE3__
+#undef __AVX2__
 #endif
 
 #if defined(__SSE2__)
 #include <emmintrin.h>
 #endif
 
-#if defined(__SSE2_)
+/* The SSSE3 and AVX2 versions are built with target attributes so
+ * the rest of the file keeps the baseline ISA. They are only reached
+ * through conv_simd_variant(), which checks the CPU's SIMD mask. */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)) && \
+   (defined(__x86_64__) || defined(__i386__)) && !defined(SCALER_NO_SIMD)
+#include <immintrin.h>
+#define HAVE_PIXCONV_SSSE3
+#define HAVE_PIXCONV_AVX2
+#define PIXCONV_TARGET_SSSE3 __attribute__((target("ssse3")))
+#define PIXCONV_TARGET_AVX2 __attribute__((target("avx2")))
+#elif defined(__AVX2__)
+#include <immintrin.h>
+#define HAVE_PIXCONV_SSSE3
+#define HAVE_PIXCONV_AVX2
+#define PIXCONV_TARGET_SSSE3
+#define PIXCONV_TARGET_AVX2
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define HAVE_PIXCONV_SSSE3
+#define PIXCONV_TARGET_SSSE3
+#endif
+
+/* The NEON paths load and store whole pixels as byte lanes,
+ * which only lines up with the packed formats on little endian. */
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__) && \
+   !defined(SCALER_NO_SIMD) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#include <arm_neon.h>
+#define HAVE_PIXCONV_NEON
+#endif
+
+#if defined(__SSE2__)
 void conv_rgb565_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -54,7 +86,7 @@ void conv_rgb565_0rgb1555(void *output_, const void *input_,
       for (w = 0; w < max_width; w += 8)
       {
          const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
-         __m128i hi = _mm_and_si128(_mm_slli_epi16(in, 1), hi_mask);
+         __m128i hi = _mm_and_si128(_mm_srli_epi16(in, 1), hi_mask);
          __m128i lo = _mm_and_si128(in, lo_mask);
          _mm_storeu_si128((__m128i*)(output + w), _mm_or_si128(hi, lo));
       }
@@ -131,6 +163,43 @@ void conv_0rgb1555_rgb565(void *output_, const void *input_,
       }
    }
 }
+#elif defined(HAVE_PIXCONV_NEON)
+void conv_0rgb1555_rgb565(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output = (uint16_t*)output_;
+
+   int max_width = width - 7;
+
+   const uint16x8_t hi_mask   = vdupq_n_u16((0x1f << 11) | (0x1f << 6));
+   const uint16x8_t lo_mask   = vdupq_n_u16(0x1f);
+   const uint16x8_t glow_mask = vdupq_n_u16(1 << 5);
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const uint16x8_t in = vld1q_u16(input + w);
+         uint16x8_t rg   = vandq_u16(vshlq_n_u16(in, 1), hi_mask);
+         uint16x8_t b    = vandq_u16(in, lo_mask);
+         uint16x8_t glow = vandq_u16(vshrq_n_u16(in, 4), glow_mask);
+         vst1q_u16(output + w, vorrq_u16(rg, vorrq_u16(b, glow)));
+      }
+
+      for (; w < width; w++)
+      {
+         uint16_t col = input[w];
+         uint16_t rg = (col << 1) & ((0x1f << 11) | (0x1f << 6));
+         uint16_t b = col & 0x1f;
+         uint16_t glow = (col >> 4) & (1 << 5);
+         output[w] = rg | b | glow;
+      }
+   }
+}
 #else
 void conv_0rgb1555_rgb565(void *output_, const void *input_,
       int width, int height,
@@ -331,6 +400,60 @@ void conv_rgb565_argb8888(void *output_, const void *input_,
 }
 #endif
 
+#if defined(__SSE2__)
+void conv_rgba4444_argb8888(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m128i nibbles = _mm_set1_epi16(0x0f0f);
+   const __m128i lo_byte = _mm_set1_epi16(0x00ff);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in = _mm_loadu_si128((const __m128i*)(input + w));
+         /* A, G and B, R nibbles in byte lanes, widened to 8 bits. */
+         __m128i ag = _mm_and_si128(in, nibbles);
+         __m128i br = _mm_and_si128(_mm_srli_epi16(in, 4), nibbles);
+         ag = _mm_or_si128(ag, _mm_slli_epi16(ag, 4));
+         br = _mm_or_si128(br, _mm_slli_epi16(br, 4));
+
+         __m128i bg = _mm_or_si128(_mm_and_si128(br, lo_byte),
+               _mm_andnot_si128(lo_byte, ag));
+         __m128i ra = _mm_or_si128(_mm_srli_epi16(br, 8),
+               _mm_slli_epi16(ag, 8));
+
+         _mm_storeu_si128((__m128i*)(output + w + 0),
+               _mm_unpacklo_epi16(bg, ra));
+         _mm_storeu_si128((__m128i*)(output + w + 4),
+               _mm_unpackhi_epi16(bg, ra));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 12) & 0xf;
+         uint32_t g = (col >>  8) & 0xf;
+         uint32_t b = (col >>  4) & 0xf;
+         uint32_t a = (col >>  0) & 0xf;
+         r = (r << 4) | r;
+         g = (g << 4) | g;
+         b = (b << 4) | b;
+         a = (a << 4) | a;
+
+         output[w] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+#else
 void conv_rgba4444_argb8888(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -358,6 +481,7 @@ void conv_rgba4444_argb8888(void *output_, const void *input_,
       }
    }
 }
+#endif
 
 #if defined(__SSE2__)
 /* :( TODO: Make this saner. */
@@ -560,6 +684,122 @@ void conv_rgb565_bgr24(void *output_, const void *input_,
       }
    }
 }
+#elif defined(HAVE_PIXCONV_NEON)
+/* Widens 5 bits to 8 by repeating the top bits, like the C path. */
+static inline uint8x8_t expand5_neon(uint16x8_t v)
+{
+   return vmovn_u16(vorrq_u16(vshlq_n_u16(v, 3), vshrq_n_u16(v, 2)));
+}
+
+static inline uint8x8_t expand6_neon(uint16x8_t v)
+{
+   return vmovn_u16(vorrq_u16(vshlq_n_u16(v, 2), vshrq_n_u16(v, 4)));
+}
+
+void conv_0rgb1555_bgr24(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   const uint16x8_t mask = vdupq_n_u16(0x1f);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         const uint16x8_t in0 = vld1q_u16(input + w + 0);
+         const uint16x8_t in1 = vld1q_u16(input + w + 8);
+         uint8x16x3_t bgr;
+
+         bgr.val[0] = vcombine_u8(
+               expand5_neon(vandq_u16(in0, mask)),
+               expand5_neon(vandq_u16(in1, mask)));
+         bgr.val[1] = vcombine_u8(
+               expand5_neon(vandq_u16(vshrq_n_u16(in0, 5), mask)),
+               expand5_neon(vandq_u16(vshrq_n_u16(in1, 5), mask)));
+         bgr.val[2] = vcombine_u8(
+               expand5_neon(vandq_u16(vshrq_n_u16(in0, 10), mask)),
+               expand5_neon(vandq_u16(vshrq_n_u16(in1, 10), mask)));
+         vst3q_u8(out, bgr);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 10) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 3) | (g >> 2);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+void conv_rgb565_bgr24(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   const uint16x8_t mask5 = vdupq_n_u16(0x1f);
+   const uint16x8_t mask6 = vdupq_n_u16(0x3f);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         const uint16x8_t in0 = vld1q_u16(input + w + 0);
+         const uint16x8_t in1 = vld1q_u16(input + w + 8);
+         uint8x16x3_t bgr;
+
+         bgr.val[0] = vcombine_u8(
+               expand5_neon(vandq_u16(in0, mask5)),
+               expand5_neon(vandq_u16(in1, mask5)));
+         bgr.val[1] = vcombine_u8(
+               expand6_neon(vandq_u16(vshrq_n_u16(in0, 5), mask6)),
+               expand6_neon(vandq_u16(vshrq_n_u16(in1, 5), mask6)));
+         bgr.val[2] = vcombine_u8(
+               expand5_neon(vshrq_n_u16(in0, 11)),
+               expand5_neon(vshrq_n_u16(in1, 11)));
+         vst3q_u8(out, bgr);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t r = (col >> 11) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 2) | (g >> 4);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
 #else
 void conv_0rgb1555_bgr24(void *output_, const void *input_,
       int width, int height,
@@ -642,6 +882,53 @@ void conv_bgr24_argb8888(void *output_, const void *input_,
    }
 }
 
+#if defined(__SSE2__)
+void conv_argb8888_0rgb1555(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m128i mask_r = _mm_set1_epi32(0x1f << 10);
+   const __m128i mask_g = _mm_set1_epi32(0x1f <<  5);
+   const __m128i mask_b = _mm_set1_epi32(0x1f <<  0);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         const __m128i in0 = _mm_loadu_si128((const __m128i*)(input + w + 0));
+         const __m128i in1 = _mm_loadu_si128((const __m128i*)(input + w + 4));
+         __m128i res0 = _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(in0, 9), mask_r),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(in0, 6), mask_g),
+                  _mm_and_si128(_mm_srli_epi32(in0, 3), mask_b)));
+         __m128i res1 = _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(in1, 9), mask_r),
+               _mm_or_si128(_mm_and_si128(_mm_srli_epi32(in1, 6), mask_g),
+                  _mm_and_si128(_mm_srli_epi32(in1, 3), mask_b)));
+
+         /* Results fit in 15 bits, so the signed pack can't saturate. */
+         _mm_storeu_si128((__m128i*)(output + w),
+               _mm_packs_epi32(res0, res1));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint16_t r = (col >> 19) & 0x1f;
+         uint16_t g = (col >> 11) & 0x1f;
+         uint16_t b = (col >>  3) & 0x1f;
+         output[w] = (r << 10) | (g << 5) | (b << 0);
+      }
+   }
+}
+#else
 void conv_argb8888_0rgb1555(void *output_, const void *input_,
       int width, int height,
       int out_stride, int in_stride)
@@ -663,6 +950,7 @@ void conv_argb8888_0rgb1555(void *output_, const void *input_,
       }
    }
 }
+#endif
 
 #if defined(__SSE2__)
 void conv_argb8888_bgr24(void *output_, const void *input_,
@@ -698,6 +986,42 @@ void conv_argb8888_bgr24(void *output_, const void *input_,
       }
    }
 }
+#elif defined(HAVE_PIXCONV_NEON)
+void conv_argb8888_bgr24(void *output_, const void *input_,
+      int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         /* De-interleave into B, G, R, A planes and drop A. */
+         uint8x16x4_t argb = vld4q_u8((const uint8_t*)(input + w));
+         uint8x16x3_t bgr;
+         bgr.val[0] = argb.val[0];
+         bgr.val[1] = argb.val[1];
+         bgr.val[2] = argb.val[2];
+         vst3q_u8(out, bgr);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         *out++ = (uint8_t)(col >>  0);
+         *out++ = (uint8_t)(col >>  8);
+         *out++ = (uint8_t)(col >> 16);
+      }
+   }
+}
 #else
 void conv_argb8888_bgr24(void *output_, const void *input_,
       int width, int height,
@@ -931,3 +1255,928 @@ void conv_copy(void *output_, const void *input_,
       memcpy(output, input, copy_len);
 }
 
+
+#ifdef HAVE_PIXCONV_SSSE3
+/* Packs the B, G, R bytes of 16 ARGB8888 pixels into 48 bytes. */
+static PIXCONV_TARGET_SSSE3 inline void store_bgr24_ssse3(void *output,
+      __m128i a, __m128i b, __m128i c, __m128i d)
+{
+   const __m128i pack = _mm_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+         12, 13, 14, -1, -1, -1, -1);
+   __m128i *out = (__m128i*)output;
+
+   a = _mm_shuffle_epi8(a, pack);
+   b = _mm_shuffle_epi8(b, pack);
+   c = _mm_shuffle_epi8(c, pack);
+   d = _mm_shuffle_epi8(d, pack);
+
+   _mm_storeu_si128(out + 0,
+         _mm_or_si128(a, _mm_slli_si128(b, 12)));
+   _mm_storeu_si128(out + 1,
+         _mm_or_si128(_mm_srli_si128(b, 4), _mm_slli_si128(c, 8)));
+   _mm_storeu_si128(out + 2,
+         _mm_or_si128(_mm_srli_si128(c, 8), _mm_slli_si128(d, 4)));
+}
+
+/* Eight 16-bit pixels to ARGB8888, with the same arithmetic
+ * as the SSE2 converters. */
+static PIXCONV_TARGET_SSSE3 inline void expand_0rgb1555_ssse3(__m128i in,
+      __m128i *lo, __m128i *hi)
+{
+   const __m128i pix_mask_r  = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_gb = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul15_mid   = _mm_set1_epi16(0x4200);
+   const __m128i mul15_hi    = _mm_set1_epi16(0x0210);
+   const __m128i a           = _mm_set1_epi16(0x00ff);
+
+   __m128i r = _mm_mulhi_epi16(_mm_and_si128(in, pix_mask_r), mul15_hi);
+   __m128i g = _mm_mulhi_epi16(_mm_and_si128(in, pix_mask_gb), mul15_mid);
+   __m128i b = _mm_mulhi_epi16(_mm_and_si128(
+            _mm_slli_epi16(in, 5), pix_mask_gb), mul15_mid);
+
+   *lo = _mm_or_si128(_mm_unpacklo_epi8(b, g),
+         _mm_slli_si128(_mm_unpacklo_epi8(r, a), 2));
+   *hi = _mm_or_si128(_mm_unpackhi_epi8(b, g),
+         _mm_slli_si128(_mm_unpackhi_epi8(r, a), 2));
+}
+
+static PIXCONV_TARGET_SSSE3 inline void expand_rgb565_ssse3(__m128i in,
+      __m128i *lo, __m128i *hi)
+{
+   const __m128i pix_mask_r = _mm_set1_epi16(0x1f << 10);
+   const __m128i pix_mask_g = _mm_set1_epi16(0x3f <<  5);
+   const __m128i pix_mask_b = _mm_set1_epi16(0x1f <<  5);
+   const __m128i mul16_r    = _mm_set1_epi16(0x0210);
+   const __m128i mul16_g    = _mm_set1_epi16(0x2080);
+   const __m128i mul16_b    = _mm_set1_epi16(0x4200);
+   const __m128i a          = _mm_set1_epi16(0x00ff);
+
+   __m128i r = _mm_mulhi_epi16(_mm_and_si128(
+            _mm_srli_epi16(in, 1), pix_mask_r), mul16_r);
+   __m128i g = _mm_mulhi_epi16(_mm_and_si128(in, pix_mask_g), mul16_g);
+   __m128i b = _mm_mulhi_epi16(_mm_and_si128(
+            _mm_slli_epi16(in, 5), pix_mask_b), mul16_b);
+
+   *lo = _mm_or_si128(_mm_unpacklo_epi8(b, g),
+         _mm_slli_si128(_mm_unpacklo_epi8(r, a), 2));
+   *hi = _mm_or_si128(_mm_unpackhi_epi8(b, g),
+         _mm_slli_si128(_mm_unpackhi_epi8(r, a), 2));
+}
+
+static PIXCONV_TARGET_SSSE3 void conv_0rgb1555_bgr24_ssse3(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         __m128i a, b, c, d;
+         expand_0rgb1555_ssse3(_mm_loadu_si128(
+                  (const __m128i*)(input + w + 0)), &a, &b);
+         expand_0rgb1555_ssse3(_mm_loadu_si128(
+                  (const __m128i*)(input + w + 8)), &c, &d);
+         store_bgr24_ssse3(out, a, b, c, d);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 10) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 3) | (g >> 2);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static PIXCONV_TARGET_SSSE3 void conv_rgb565_bgr24_ssse3(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         __m128i a, b, c, d;
+         expand_rgb565_ssse3(_mm_loadu_si128(
+                  (const __m128i*)(input + w + 0)), &a, &b);
+         expand_rgb565_ssse3(_mm_loadu_si128(
+                  (const __m128i*)(input + w + 8)), &c, &d);
+         store_bgr24_ssse3(out, a, b, c, d);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t r = (col >> 11) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 2) | (g >> 4);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static PIXCONV_TARGET_SSSE3 void conv_argb8888_bgr24_ssse3(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 2)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 16, out += 48)
+      {
+         store_bgr24_ssse3(out,
+               _mm_loadu_si128((const __m128i*)(input + w +  0)),
+               _mm_loadu_si128((const __m128i*)(input + w +  4)),
+               _mm_loadu_si128((const __m128i*)(input + w +  8)),
+               _mm_loadu_si128((const __m128i*)(input + w + 12)));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         *out++ = (uint8_t)(col >>  0);
+         *out++ = (uint8_t)(col >>  8);
+         *out++ = (uint8_t)(col >> 16);
+      }
+   }
+}
+
+static PIXCONV_TARGET_SSSE3 void conv_bgr24_argb8888_ssse3(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   /* Spreads four BGR24 pixels out to 32 bits. The last block of
+    * a run is loaded 4 bytes early so it can't read past the row. */
+   const __m128i expand    = _mm_setr_epi8(0, 1, 2, -1, 3, 4, 5, -1,
+         6, 7, 8, -1, 9, 10, 11, -1);
+   const __m128i expand_hi = _mm_setr_epi8(4, 5, 6, -1, 7, 8, 9, -1,
+         10, 11, 12, -1, 13, 14, 15, -1);
+   const __m128i alpha     = _mm_set1_epi32((int)0xff000000u);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *inp = input;
+
+      for (w = 0; w < max_width; w += 16, inp += 48)
+      {
+         __m128i a = _mm_shuffle_epi8(_mm_loadu_si128(
+                  (const __m128i*)(inp +  0)), expand);
+         __m128i b = _mm_shuffle_epi8(_mm_loadu_si128(
+                  (const __m128i*)(inp + 12)), expand);
+         __m128i c = _mm_shuffle_epi8(_mm_loadu_si128(
+                  (const __m128i*)(inp + 24)), expand);
+         __m128i d = _mm_shuffle_epi8(_mm_loadu_si128(
+                  (const __m128i*)(inp + 32)), expand_hi);
+
+         _mm_storeu_si128((__m128i*)(output + w +  0), _mm_or_si128(a, alpha));
+         _mm_storeu_si128((__m128i*)(output + w +  4), _mm_or_si128(b, alpha));
+         _mm_storeu_si128((__m128i*)(output + w +  8), _mm_or_si128(c, alpha));
+         _mm_storeu_si128((__m128i*)(output + w + 12), _mm_or_si128(d, alpha));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t b = *inp++;
+         uint32_t g = *inp++;
+         uint32_t r = *inp++;
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+static PIXCONV_TARGET_SSSE3 void conv_argb8888_abgr8888_ssse3(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m128i swap = _mm_setr_epi8(2, 1, 0, 3, 6, 5, 4, 7,
+         10, 9, 8, 11, 14, 13, 12, 15);
+
+   int max_width = width - 7;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 8)
+      {
+         __m128i a = _mm_loadu_si128((const __m128i*)(input + w + 0));
+         __m128i b = _mm_loadu_si128((const __m128i*)(input + w + 4));
+         _mm_storeu_si128((__m128i*)(output + w + 0),
+               _mm_shuffle_epi8(a, swap));
+         _mm_storeu_si128((__m128i*)(output + w + 4),
+               _mm_shuffle_epi8(b, swap));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         output[w] = ((col << 16) & 0xff0000) |
+            ((col >> 16) & 0xff) | (col & 0xff00ff00);
+      }
+   }
+}
+
+/* Pulls Y, U and V out of the YUYV stream with shuffles instead of
+ * masking and repacking, and doubles up the chroma on the way.
+ * Clamping before the interleave gives the same result as the
+ * saturating pack of the SSE2 path. */
+static PIXCONV_TARGET_SSSE3 void conv_yuyv_argb8888_ssse3(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   const __m128i shuf_y = _mm_setr_epi8(0, -1, 2, -1, 4, -1, 6, -1,
+         8, -1, 10, -1, 12, -1, 14, -1);
+   const __m128i shuf_u = _mm_setr_epi8(1, -1, 1, -1, 5, -1, 5, -1,
+         9, -1, 9, -1, 13, -1, 13, -1);
+   const __m128i shuf_v = _mm_setr_epi8(3, -1, 3, -1, 7, -1, 7, -1,
+         11, -1, 11, -1, 15, -1, 15, -1);
+   const __m128i chroma_offset = _mm_set1_epi16(128);
+   const __m128i round_offset  = _mm_set1_epi16(YUV_OFFSET);
+   const __m128i yuv_mul = _mm_set1_epi16(YUV_MAT_Y);
+   const __m128i u_g_mul = _mm_set1_epi16(YUV_MAT_U_G);
+   const __m128i u_b_mul = _mm_set1_epi16(YUV_MAT_U_B);
+   const __m128i v_r_mul = _mm_set1_epi16(YUV_MAT_V_R);
+   const __m128i v_g_mul = _mm_set1_epi16(YUV_MAT_V_G);
+   const __m128i zero    = _mm_setzero_si128();
+   const __m128i max     = _mm_set1_epi16(0xff);
+   const __m128i a       = _mm_set1_epi16((int16_t)0xff00);
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      for (w = 0; w + 8 <= width; w += 8, src += 16, dst += 8)
+      {
+         __m128i yuv = _mm_loadu_si128((const __m128i*)src);
+         __m128i _y  = _mm_mullo_epi16(_mm_shuffle_epi8(yuv, shuf_y), yuv_mul);
+         __m128i u   = _mm_sub_epi16(_mm_shuffle_epi8(yuv, shuf_u), chroma_offset);
+         __m128i v   = _mm_sub_epi16(_mm_shuffle_epi8(yuv, shuf_v), chroma_offset);
+
+         __m128i r = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_y,
+                     _mm_mullo_epi16(v, v_r_mul)), round_offset), YUV_SHIFT);
+         __m128i g = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(
+                     _mm_adds_epi16(_y, _mm_mullo_epi16(v, v_g_mul)),
+                     _mm_mullo_epi16(u, u_g_mul)), round_offset), YUV_SHIFT);
+         __m128i b = _mm_srai_epi16(_mm_adds_epi16(_mm_adds_epi16(_y,
+                     _mm_mullo_epi16(u, u_b_mul)), round_offset), YUV_SHIFT);
+
+         r = _mm_min_epi16(_mm_max_epi16(r, zero), max);
+         g = _mm_min_epi16(_mm_max_epi16(g, zero), max);
+         b = _mm_min_epi16(_mm_max_epi16(b, zero), max);
+
+         __m128i bg = _mm_or_si128(b, _mm_slli_epi16(g, 8));
+         __m128i ra = _mm_or_si128(r, a);
+
+         _mm_storeu_si128((__m128i*)(dst + 0), _mm_unpacklo_epi16(bg, ra));
+         _mm_storeu_si128((__m128i*)(dst + 4), _mm_unpackhi_epi16(bg, ra));
+      }
+
+      for (; w < width; w += 2, src += 4, dst += 2)
+      {
+         int _y0 = src[0];
+         int  u = src[1] - 128;
+         int _y1 = src[2];
+         int  v = src[3] - 128;
+
+         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
+         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+      }
+   }
+}
+#endif
+
+#ifdef HAVE_PIXCONV_AVX2
+/* Most AVX2 shuffles and unpacks stay within 128-bit lanes. The
+ * helpers below put pixels back in memory order before storing.
+ *
+ * The pure byte shuffles (BGR24 <-> ARGB8888, ABGR8888) have no AVX2
+ * version. SSSE3 already runs them at load/store throughput, and
+ * 32-byte accesses only lose to it on the usual 16-byte aligned
+ * buffers, where every other one splits a cache line. */
+
+/* Stores the lane-interleaved halves of an unpack as 16 pixels. */
+static PIXCONV_TARGET_AVX2 inline void store_unpacked_avx2(uint32_t *output,
+      __m256i lo, __m256i hi)
+{
+   _mm256_storeu_si256((__m256i*)(output + 0),
+         _mm256_permute2x128_si256(lo, hi, 0x20));
+   _mm256_storeu_si256((__m256i*)(output + 8),
+         _mm256_permute2x128_si256(lo, hi, 0x31));
+}
+
+/* Packs the B, G, R bytes of 32 ARGB8888 pixels into 96 bytes. */
+static PIXCONV_TARGET_AVX2 inline void store_bgr24_avx2(void *output,
+      __m256i a, __m256i b, __m256i c, __m256i d)
+{
+   const __m256i pack = _mm256_setr_epi8(0, 1, 2, 4, 5, 6, 8, 9, 10,
+         12, 13, 14, -1, -1, -1, -1, 0, 1, 2, 4, 5, 6, 8, 9, 10,
+         12, 13, 14, -1, -1, -1, -1);
+   __m256i *out = (__m256i*)output;
+
+   /* Each lane holds 12 bytes in its low three dwords after the
+    * shuffle. Gather those so the three stores come out as blends. */
+   a = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(a, pack),
+         _mm256_setr_epi32(0, 1, 2, 4, 5, 6, 0, 0));
+   b = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(b, pack),
+         _mm256_setr_epi32(2, 4, 5, 6, 0, 0, 0, 1));
+   c = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(c, pack),
+         _mm256_setr_epi32(5, 6, 0, 0, 0, 1, 2, 4));
+   d = _mm256_permutevar8x32_epi32(_mm256_shuffle_epi8(d, pack),
+         _mm256_setr_epi32(0, 0, 0, 1, 2, 4, 5, 6));
+
+   _mm256_storeu_si256(out + 0, _mm256_blend_epi32(a, b, 0xc0));
+   _mm256_storeu_si256(out + 1, _mm256_blend_epi32(b, c, 0xf0));
+   _mm256_storeu_si256(out + 2, _mm256_blend_epi32(c, d, 0xfc));
+}
+
+/* Sixteen 16-bit pixels to ARGB8888, in memory order. */
+static PIXCONV_TARGET_AVX2 inline void expand_0rgb1555_avx2(__m256i in,
+      __m256i *lo, __m256i *hi)
+{
+   const __m256i pix_mask_r  = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_gb = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul15_mid   = _mm256_set1_epi16(0x4200);
+   const __m256i mul15_hi    = _mm256_set1_epi16(0x0210);
+   const __m256i a           = _mm256_set1_epi16(0x00ff);
+
+   __m256i r = _mm256_mulhi_epi16(_mm256_and_si256(in, pix_mask_r), mul15_hi);
+   __m256i g = _mm256_mulhi_epi16(_mm256_and_si256(in, pix_mask_gb), mul15_mid);
+   __m256i b = _mm256_mulhi_epi16(_mm256_and_si256(
+            _mm256_slli_epi16(in, 5), pix_mask_gb), mul15_mid);
+
+   __m256i res_lo = _mm256_or_si256(_mm256_unpacklo_epi8(b, g),
+         _mm256_slli_si256(_mm256_unpacklo_epi8(r, a), 2));
+   __m256i res_hi = _mm256_or_si256(_mm256_unpackhi_epi8(b, g),
+         _mm256_slli_si256(_mm256_unpackhi_epi8(r, a), 2));
+
+   *lo = _mm256_permute2x128_si256(res_lo, res_hi, 0x20);
+   *hi = _mm256_permute2x128_si256(res_lo, res_hi, 0x31);
+}
+
+static PIXCONV_TARGET_AVX2 inline void expand_rgb565_avx2(__m256i in,
+      __m256i *lo, __m256i *hi)
+{
+   const __m256i pix_mask_r = _mm256_set1_epi16(0x1f << 10);
+   const __m256i pix_mask_g = _mm256_set1_epi16(0x3f <<  5);
+   const __m256i pix_mask_b = _mm256_set1_epi16(0x1f <<  5);
+   const __m256i mul16_r    = _mm256_set1_epi16(0x0210);
+   const __m256i mul16_g    = _mm256_set1_epi16(0x2080);
+   const __m256i mul16_b    = _mm256_set1_epi16(0x4200);
+   const __m256i a          = _mm256_set1_epi16(0x00ff);
+
+   __m256i r = _mm256_mulhi_epi16(_mm256_and_si256(
+            _mm256_srli_epi16(in, 1), pix_mask_r), mul16_r);
+   __m256i g = _mm256_mulhi_epi16(_mm256_and_si256(in, pix_mask_g), mul16_g);
+   __m256i b = _mm256_mulhi_epi16(_mm256_and_si256(
+            _mm256_slli_epi16(in, 5), pix_mask_b), mul16_b);
+
+   __m256i res_lo = _mm256_or_si256(_mm256_unpacklo_epi8(b, g),
+         _mm256_slli_si256(_mm256_unpacklo_epi8(r, a), 2));
+   __m256i res_hi = _mm256_or_si256(_mm256_unpackhi_epi8(b, g),
+         _mm256_slli_si256(_mm256_unpackhi_epi8(r, a), 2));
+
+   *lo = _mm256_permute2x128_si256(res_lo, res_hi, 0x20);
+   *hi = _mm256_permute2x128_si256(res_lo, res_hi, 0x31);
+}
+
+static PIXCONV_TARGET_AVX2 void conv_rgb565_0rgb1555_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i hi_mask = _mm256_set1_epi16(0x7fe0);
+   const __m256i lo_mask = _mm256_set1_epi16(0x1f);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i hi = _mm256_and_si256(_mm256_srli_epi16(in, 1), hi_mask);
+         __m256i lo = _mm256_and_si256(in, lo_mask);
+         _mm256_storeu_si256((__m256i*)(output + w), _mm256_or_si256(hi, lo));
+      }
+
+      for (; w < width; w++)
+      {
+         uint16_t col = input[w];
+         uint16_t hi = (col >> 1) & 0x7fe0;
+         uint16_t lo = col & 0x1f;
+         output[w] = hi | lo;
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_0rgb1555_rgb565_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i hi_mask   = _mm256_set1_epi16(
+         (int16_t)((0x1f << 11) | (0x1f << 6)));
+   const __m256i lo_mask   = _mm256_set1_epi16(0x1f);
+   const __m256i glow_mask = _mm256_set1_epi16(1 << 5);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i rg   = _mm256_and_si256(_mm256_slli_epi16(in, 1), hi_mask);
+         __m256i b    = _mm256_and_si256(in, lo_mask);
+         __m256i glow = _mm256_and_si256(_mm256_srli_epi16(in, 4), glow_mask);
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_or_si256(rg, _mm256_or_si256(b, glow)));
+      }
+
+      for (; w < width; w++)
+      {
+         uint16_t col = input[w];
+         uint16_t rg = (col << 1) & ((0x1f << 11) | (0x1f << 6));
+         uint16_t b = col & 0x1f;
+         uint16_t glow = (col >> 4) & (1 << 5);
+         output[w] = rg | b | glow;
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_0rgb1555_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         __m256i lo, hi;
+         expand_0rgb1555_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w)), &lo, &hi);
+         _mm256_storeu_si256((__m256i*)(output + w + 0), lo);
+         _mm256_storeu_si256((__m256i*)(output + w + 8), hi);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 10) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 3) | (g >> 2);
+         b = (b << 3) | (b >> 2);
+
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_rgb565_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         __m256i lo, hi;
+         expand_rgb565_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w)), &lo, &hi);
+         _mm256_storeu_si256((__m256i*)(output + w + 0), lo);
+         _mm256_storeu_si256((__m256i*)(output + w + 8), hi);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 11) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t b = (col >>  0) & 0x1f;
+         r = (r << 3) | (r >> 2);
+         g = (g << 2) | (g >> 4);
+         b = (b << 3) | (b >> 2);
+
+         output[w] = (0xffu << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_rgba4444_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint32_t *output      = (uint32_t*)output_;
+
+   const __m256i nibbles = _mm256_set1_epi16(0x0f0f);
+   const __m256i lo_byte = _mm256_set1_epi16(0x00ff);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 2, input += in_stride >> 1)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         const __m256i in = _mm256_loadu_si256((const __m256i*)(input + w));
+         __m256i ag = _mm256_and_si256(in, nibbles);
+         __m256i br = _mm256_and_si256(_mm256_srli_epi16(in, 4), nibbles);
+         ag = _mm256_or_si256(ag, _mm256_slli_epi16(ag, 4));
+         br = _mm256_or_si256(br, _mm256_slli_epi16(br, 4));
+
+         __m256i bg = _mm256_or_si256(_mm256_and_si256(br, lo_byte),
+               _mm256_andnot_si256(lo_byte, ag));
+         __m256i ra = _mm256_or_si256(_mm256_srli_epi16(br, 8),
+               _mm256_slli_epi16(ag, 8));
+
+         store_unpacked_avx2(output + w,
+               _mm256_unpacklo_epi16(bg, ra), _mm256_unpackhi_epi16(bg, ra));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t r = (col >> 12) & 0xf;
+         uint32_t g = (col >>  8) & 0xf;
+         uint32_t b = (col >>  4) & 0xf;
+         uint32_t a = (col >>  0) & 0xf;
+         r = (r << 4) | r;
+         g = (g << 4) | g;
+         b = (b << 4) | b;
+         a = (a << 4) | a;
+
+         output[w] = (a << 24) | (r << 16) | (g << 8) | (b << 0);
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_argb8888_0rgb1555_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint32_t *input = (const uint32_t*)input_;
+   uint16_t *output      = (uint16_t*)output_;
+
+   const __m256i mask_r = _mm256_set1_epi32(0x1f << 10);
+   const __m256i mask_g = _mm256_set1_epi32(0x1f <<  5);
+   const __m256i mask_b = _mm256_set1_epi32(0x1f <<  0);
+
+   int max_width = width - 15;
+
+   for (h = 0; h < height;
+         h++, output += out_stride >> 1, input += in_stride >> 2)
+   {
+      for (w = 0; w < max_width; w += 16)
+      {
+         const __m256i in0 = _mm256_loadu_si256((const __m256i*)(input + w + 0));
+         const __m256i in1 = _mm256_loadu_si256((const __m256i*)(input + w + 8));
+         __m256i res0 = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi32(in0, 9), mask_r),
+               _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(in0, 6), mask_g),
+                  _mm256_and_si256(_mm256_srli_epi32(in0, 3), mask_b)));
+         __m256i res1 = _mm256_or_si256(
+               _mm256_and_si256(_mm256_srli_epi32(in1, 9), mask_r),
+               _mm256_or_si256(_mm256_and_si256(_mm256_srli_epi32(in1, 6), mask_g),
+                  _mm256_and_si256(_mm256_srli_epi32(in1, 3), mask_b)));
+
+         /* The pack interleaves the two inputs per lane. */
+         _mm256_storeu_si256((__m256i*)(output + w),
+               _mm256_permute4x64_epi64(_mm256_packs_epi32(res0, res1),
+                  _MM_SHUFFLE(3, 1, 2, 0)));
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint16_t r = (col >> 19) & 0x1f;
+         uint16_t g = (col >> 11) & 0x1f;
+         uint16_t b = (col >>  3) & 0x1f;
+         output[w] = (r << 10) | (g << 5) | (b << 0);
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_0rgb1555_bgr24_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 31;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 32, out += 96)
+      {
+         __m256i a, b, c, d;
+         expand_0rgb1555_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w +  0)), &a, &b);
+         expand_0rgb1555_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w + 16)), &c, &d);
+         store_bgr24_avx2(out, a, b, c, d);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x1f;
+         uint32_t r = (col >> 10) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 3) | (g >> 2);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_rgb565_bgr24_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint16_t *input = (const uint16_t*)input_;
+   uint8_t *output       = (uint8_t*)output_;
+
+   int max_width = width - 31;
+
+   for (h = 0; h < height;
+         h++, output += out_stride, input += in_stride >> 1)
+   {
+      uint8_t *out = output;
+
+      for (w = 0; w < max_width; w += 32, out += 96)
+      {
+         __m256i a, b, c, d;
+         expand_rgb565_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w +  0)), &a, &b);
+         expand_rgb565_avx2(_mm256_loadu_si256(
+                  (const __m256i*)(input + w + 16)), &c, &d);
+         store_bgr24_avx2(out, a, b, c, d);
+      }
+
+      for (; w < width; w++)
+      {
+         uint32_t col = input[w];
+         uint32_t b = (col >>  0) & 0x1f;
+         uint32_t g = (col >>  5) & 0x3f;
+         uint32_t r = (col >> 11) & 0x1f;
+         b = (b << 3) | (b >> 2);
+         g = (g << 2) | (g >> 4);
+         r = (r << 3) | (r >> 2);
+
+         *out++ = b;
+         *out++ = g;
+         *out++ = r;
+      }
+   }
+}
+
+static PIXCONV_TARGET_AVX2 void conv_yuyv_argb8888_avx2(void *output_,
+      const void *input_, int width, int height,
+      int out_stride, int in_stride)
+{
+   int h, w;
+   const uint8_t *input = (const uint8_t*)input_;
+   uint32_t *output     = (uint32_t*)output_;
+
+   const __m256i shuf_y = _mm256_setr_epi8(0, -1, 2, -1, 4, -1, 6, -1,
+         8, -1, 10, -1, 12, -1, 14, -1, 0, -1, 2, -1, 4, -1, 6, -1,
+         8, -1, 10, -1, 12, -1, 14, -1);
+   const __m256i shuf_u = _mm256_setr_epi8(1, -1, 1, -1, 5, -1, 5, -1,
+         9, -1, 9, -1, 13, -1, 13, -1, 1, -1, 1, -1, 5, -1, 5, -1,
+         9, -1, 9, -1, 13, -1, 13, -1);
+   const __m256i shuf_v = _mm256_setr_epi8(3, -1, 3, -1, 7, -1, 7, -1,
+         11, -1, 11, -1, 15, -1, 15, -1, 3, -1, 3, -1, 7, -1, 7, -1,
+         11, -1, 11, -1, 15, -1, 15, -1);
+   const __m256i chroma_offset = _mm256_set1_epi16(128);
+   const __m256i round_offset  = _mm256_set1_epi16(YUV_OFFSET);
+   const __m256i yuv_mul = _mm256_set1_epi16(YUV_MAT_Y);
+   const __m256i u_g_mul = _mm256_set1_epi16(YUV_MAT_U_G);
+   const __m256i u_b_mul = _mm256_set1_epi16(YUV_MAT_U_B);
+   const __m256i v_r_mul = _mm256_set1_epi16(YUV_MAT_V_R);
+   const __m256i v_g_mul = _mm256_set1_epi16(YUV_MAT_V_G);
+   const __m256i zero    = _mm256_setzero_si256();
+   const __m256i max     = _mm256_set1_epi16(0xff);
+   const __m256i a       = _mm256_set1_epi16((int16_t)0xff00);
+
+   for (h = 0; h < height; h++, output += out_stride >> 2, input += in_stride)
+   {
+      const uint8_t *src = input;
+      uint32_t *dst = output;
+
+      for (w = 0; w + 16 <= width; w += 16, src += 32, dst += 16)
+      {
+         __m256i yuv = _mm256_loadu_si256((const __m256i*)src);
+         __m256i _y  = _mm256_mullo_epi16(
+               _mm256_shuffle_epi8(yuv, shuf_y), yuv_mul);
+         __m256i u   = _mm256_sub_epi16(
+               _mm256_shuffle_epi8(yuv, shuf_u), chroma_offset);
+         __m256i v   = _mm256_sub_epi16(
+               _mm256_shuffle_epi8(yuv, shuf_v), chroma_offset);
+
+         __m256i r = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y,
+                     _mm256_mullo_epi16(v, v_r_mul)), round_offset), YUV_SHIFT);
+         __m256i g = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(
+                     _mm256_adds_epi16(_y, _mm256_mullo_epi16(v, v_g_mul)),
+                     _mm256_mullo_epi16(u, u_g_mul)), round_offset), YUV_SHIFT);
+         __m256i b = _mm256_srai_epi16(_mm256_adds_epi16(_mm256_adds_epi16(_y,
+                     _mm256_mullo_epi16(u, u_b_mul)), round_offset), YUV_SHIFT);
+
+         r = _mm256_min_epi16(_mm256_max_epi16(r, zero), max);
+         g = _mm256_min_epi16(_mm256_max_epi16(g, zero), max);
+         b = _mm256_min_epi16(_mm256_max_epi16(b, zero), max);
+
+         __m256i bg = _mm256_or_si256(b, _mm256_slli_epi16(g, 8));
+         __m256i ra = _mm256_or_si256(r, a);
+
+         store_unpacked_avx2(dst,
+               _mm256_unpacklo_epi16(bg, ra), _mm256_unpackhi_epi16(bg, ra));
+      }
+
+      for (; w < width; w += 2, src += 4, dst += 2)
+      {
+         int _y0 = src[0];
+         int  u = src[1] - 128;
+         int _y1 = src[2];
+         int  v = src[3] - 128;
+
+         uint8_t r0 = clamp_8bit((YUV_MAT_Y * _y0 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b0 = clamp_8bit((YUV_MAT_Y * _y0 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         uint8_t r1 = clamp_8bit((YUV_MAT_Y * _y1 +                   YUV_MAT_V_R * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t g1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_G * u + YUV_MAT_V_G * v + YUV_OFFSET) >> YUV_SHIFT);
+         uint8_t b1 = clamp_8bit((YUV_MAT_Y * _y1 + YUV_MAT_U_B * u                   + YUV_OFFSET) >> YUV_SHIFT);
+
+         dst[0] = 0xff000000u | (r0 << 16) | (g0 << 8) | (b0 << 0);
+         dst[1] = 0xff000000u | (r1 << 16) | (g1 << 8) | (b1 << 0);
+      }
+   }
+}
+#endif
+
+#ifdef HAVE_PIXCONV_SSSE3
+#define PIXCONV_SSSE3(conv) conv##_ssse3
+#else
+#define PIXCONV_SSSE3(conv) NULL
+#endif
+
+#ifdef HAVE_PIXCONV_AVX2
+#define PIXCONV_AVX2(conv) conv##_avx2
+#else
+#define PIXCONV_AVX2(conv) NULL
+#endif
+
+/* SSSE3 only helps where pixels get reshuffled byte by byte. The
+ * 16-bit formats are all shifts and masks, which SSE2 covers. */
+static const struct
+{
+   scaler_pixconv_t conv;
+   scaler_pixconv_t ssse3;
+   scaler_pixconv_t avx2;
+} conv_simd_variants[] = {
+   { conv_rgb565_0rgb1555,   NULL,
+      PIXCONV_AVX2(conv_rgb565_0rgb1555) },
+   { conv_0rgb1555_rgb565,   NULL,
+      PIXCONV_AVX2(conv_0rgb1555_rgb565) },
+   { conv_0rgb1555_argb8888, NULL,
+      PIXCONV_AVX2(conv_0rgb1555_argb8888) },
+   { conv_rgb565_argb8888,   NULL,
+      PIXCONV_AVX2(conv_rgb565_argb8888) },
+   { conv_rgba4444_argb8888, NULL,
+      PIXCONV_AVX2(conv_rgba4444_argb8888) },
+   { conv_argb8888_0rgb1555, NULL,
+      PIXCONV_AVX2(conv_argb8888_0rgb1555) },
+   { conv_bgr24_argb8888,    PIXCONV_SSSE3(conv_bgr24_argb8888),
+      NULL },
+   { conv_argb8888_bgr24,    PIXCONV_SSSE3(conv_argb8888_bgr24),
+      NULL },
+   { conv_0rgb1555_bgr24,    PIXCONV_SSSE3(conv_0rgb1555_bgr24),
+      PIXCONV_AVX2(conv_0rgb1555_bgr24) },
+   { conv_rgb565_bgr24,      PIXCONV_SSSE3(conv_rgb565_bgr24),
+      PIXCONV_AVX2(conv_rgb565_bgr24) },
+   { conv_argb8888_abgr8888, PIXCONV_SSSE3(conv_argb8888_abgr8888),
+      NULL },
+   { conv_yuyv_argb8888,     PIXCONV_SSSE3(conv_yuyv_argb8888),
+      PIXCONV_AVX2(conv_yuyv_argb8888) },
+};
+
+scaler_pixconv_t conv_simd_variant(scaler_pixconv_t conv,
+      scaler_simd_mask_t mask)
+{
+   unsigned i;
+
+   for (i = 0; i < sizeof(conv_simd_variants) /
+         sizeof(conv_simd_variants[0]); i++)
+   {
+      if (conv_simd_variants[i].conv != conv)
+         continue;
+
+      if ((mask & SCALER_SIMD_AVX2) && conv_simd_variants[i].avx2)
+         return conv_simd_variants[i].avx2;
+      if ((mask & SCALER_SIMD_SSSE3) && conv_simd_variants[i].ssse3)
+         return conv_simd_variants[i].ssse3;
+      break;
+   }
+
+   return conv;
+}
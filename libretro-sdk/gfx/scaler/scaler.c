@@ -74,50 +74,102 @@ static bool allocate_frames(struct scaler_ctx *ctx)
    return true;
 }
 
-static bool set_direct_pix_conv(struct scaler_ctx *ctx)
+static scaler_pixconv_t find_direct_pix_conv(enum scaler_pix_fmt in_fmt,
+      enum scaler_pix_fmt out_fmt)
 {
-   if (ctx->in_fmt == ctx->out_fmt)
-      ctx->direct_pixconv = conv_copy;
-   else if (ctx->in_fmt == SCALER_FMT_0RGB1555
-         && ctx->out_fmt == SCALER_FMT_ARGB8888)
-      ctx->direct_pixconv = conv_0rgb1555_argb8888;
-   else if (ctx->in_fmt == SCALER_FMT_RGB565
-         && ctx->out_fmt == SCALER_FMT_ARGB8888)
-      ctx->direct_pixconv = conv_rgb565_argb8888;
-   else if (ctx->in_fmt == SCALER_FMT_RGB565
-         && ctx->out_fmt == SCALER_FMT_BGR24)
-      ctx->direct_pixconv = conv_rgb565_bgr24;
-   else if (ctx->in_fmt == SCALER_FMT_0RGB1555
-         && ctx->out_fmt == SCALER_FMT_RGB565)
-      ctx->direct_pixconv = conv_0rgb1555_rgb565;
-   else if (ctx->in_fmt == SCALER_FMT_RGB565
-         && ctx->out_fmt == SCALER_FMT_0RGB1555)
-      ctx->direct_pixconv = conv_rgb565_0rgb1555;
-   else if (ctx->in_fmt == SCALER_FMT_BGR24
-         && ctx->out_fmt == SCALER_FMT_ARGB8888)
-      ctx->direct_pixconv = conv_bgr24_argb8888;
-   else if (ctx->in_fmt == SCALER_FMT_ARGB8888
-         && ctx->out_fmt == SCALER_FMT_0RGB1555)
-      ctx->direct_pixconv = conv_argb8888_0rgb1555;
-   else if (ctx->in_fmt == SCALER_FMT_ARGB8888
-         && ctx->out_fmt == SCALER_FMT_BGR24)
-      ctx->direct_pixconv = conv_argb8888_bgr24;
-   else if (ctx->in_fmt == SCALER_FMT_0RGB1555
-         && ctx->out_fmt == SCALER_FMT_BGR24)
-      ctx->direct_pixconv = conv_0rgb1555_bgr24;
-   else if (ctx->in_fmt == SCALER_FMT_ARGB8888
-         && ctx->out_fmt == SCALER_FMT_ABGR8888)
-      ctx->direct_pixconv = conv_argb8888_abgr8888;
-   else if (ctx->in_fmt == SCALER_FMT_YUYV
-         && ctx->out_fmt == SCALER_FMT_ARGB8888)
-      ctx->direct_pixconv = conv_yuyv_argb8888;
-   else if (ctx->in_fmt == SCALER_FMT_RGBA4444
-         && ctx->out_fmt == SCALER_FMT_ARGB8888)
-      ctx->direct_pixconv = conv_rgba4444_argb8888;
-   else
-      return false;
+   if (in_fmt == out_fmt)
+      return conv_copy;
+   else if (in_fmt == SCALER_FMT_0RGB1555
+         && out_fmt == SCALER_FMT_ARGB8888)
+      return conv_0rgb1555_argb8888;
+   else if (in_fmt == SCALER_FMT_RGB565
+         && out_fmt == SCALER_FMT_ARGB8888)
+      return conv_rgb565_argb8888;
+   else if (in_fmt == SCALER_FMT_RGB565
+         && out_fmt == SCALER_FMT_BGR24)
+      return conv_rgb565_bgr24;
+   else if (in_fmt == SCALER_FMT_0RGB1555
+         && out_fmt == SCALER_FMT_RGB565)
+      return conv_0rgb1555_rgb565;
+   else if (in_fmt == SCALER_FMT_RGB565
+         && out_fmt == SCALER_FMT_0RGB1555)
+      return conv_rgb565_0rgb1555;
+   else if (in_fmt == SCALER_FMT_BGR24
+         && out_fmt == SCALER_FMT_ARGB8888)
+      return conv_bgr24_argb8888;
+   else if (in_fmt == SCALER_FMT_ARGB8888
+         && out_fmt == SCALER_FMT_0RGB1555)
+      return conv_argb8888_0rgb1555;
+   else if (in_fmt == SCALER_FMT_ARGB8888
+         && out_fmt == SCALER_FMT_BGR24)
+      return conv_argb8888_bgr24;
+   else if (in_fmt == SCALER_FMT_0RGB1555
+         && out_fmt == SCALER_FMT_BGR24)
+      return conv_0rgb1555_bgr24;
+   else if (in_fmt == SCALER_FMT_ARGB8888
+         && out_fmt == SCALER_FMT_ABGR8888)
+      return conv_argb8888_abgr8888;
+   else if (in_fmt == SCALER_FMT_YUYV
+         && out_fmt == SCALER_FMT_ARGB8888)
+      return conv_yuyv_argb8888;
+   else if (in_fmt == SCALER_FMT_RGBA4444
+         && out_fmt == SCALER_FMT_ARGB8888)
+      return conv_rgba4444_argb8888;
+
+   return NULL;
+}
 
-   return true;
+#define SCALER_FMT_COUNT (SCALER_FMT_RGBA4444 + 1)
+
+static scaler_pixconv_t lookup_pix_conv(enum scaler_pix_fmt in_fmt,
+      enum scaler_pix_fmt out_fmt, scaler_simd_mask_t mask)
+{
+   scaler_pixconv_t conv = find_direct_pix_conv(in_fmt, out_fmt);
+   return conv ? conv_simd_variant(conv, mask) : NULL;
+}
+
+/* Filled in whole by scaler_set_simd_mask() and only read after
+ * that, so it can be used from any thread without locking. */
+static scaler_pixconv_t pixconv_cache[SCALER_FMT_COUNT][SCALER_FMT_COUNT];
+static bool pixconv_cache_valid;
+
+static scaler_simd_mask_t pixconv_simd_mask = 0
+#if defined(__SSSE3__)
+   | SCALER_SIMD_SSSE3
+#endif
+#if defined(__AVX2__)
+   | SCALER_SIMD_AVX2
+#endif
+   ;
+
+void scaler_set_simd_mask(scaler_simd_mask_t mask)
+{
+   unsigned i, j;
+
+   pixconv_simd_mask = mask;
+   for (i = 0; i < SCALER_FMT_COUNT; i++)
+      for (j = 0; j < SCALER_FMT_COUNT; j++)
+         pixconv_cache[i][j] = lookup_pix_conv((enum scaler_pix_fmt)i,
+               (enum scaler_pix_fmt)j, mask);
+   pixconv_cache_valid = true;
+}
+
+scaler_pixconv_t scaler_get_pixconv(enum scaler_pix_fmt in_fmt,
+      enum scaler_pix_fmt out_fmt)
+{
+   if ((unsigned)in_fmt >= SCALER_FMT_COUNT ||
+         (unsigned)out_fmt >= SCALER_FMT_COUNT)
+      return NULL;
+
+   if (!pixconv_cache_valid)
+      return lookup_pix_conv(in_fmt, out_fmt, pixconv_simd_mask);
+   return pixconv_cache[in_fmt][out_fmt];
+}
+
+static bool set_direct_pix_conv(struct scaler_ctx *ctx)
+{
+   ctx->direct_pixconv = scaler_get_pixconv(ctx->in_fmt, ctx->out_fmt);
+   return ctx->direct_pixconv != NULL;
 }
 
 static bool set_pix_conv(struct scaler_ctx *ctx)
@@ -166,6 +218,11 @@ static bool set_pix_conv(struct scaler_ctx *ctx)
          return false;
    }
 
+   if (ctx->in_pixconv)
+      ctx->in_pixconv  = conv_simd_variant(ctx->in_pixconv, pixconv_simd_mask);
+   if (ctx->out_pixconv)
+      ctx->out_pixconv = conv_simd_variant(ctx->out_pixconv, pixconv_simd_mask);
+
    return true;
 }
 
@@ -184,21 +241,18 @@ bool scaler_ctx_gen_filter(struct scaler_ctx *ctx)
 
    ctx->scaler_special = NULL;
 
+   /* Straight conversions go from input to output in one pass
+    * and don't need any intermediate frames. */
+   if (ctx->unscaled)
+      return set_direct_pix_conv(ctx);
+
    if (!allocate_frames(ctx))
       return false;
 
-   if (ctx->unscaled)
-   {
-      if (!set_direct_pix_conv(ctx))
-         return false;
-   }
-   else
-   {
-      if (!set_pix_conv(ctx))
-         return false;
-   }
+   if (!set_pix_conv(ctx))
+      return false;
 
-   if (!ctx->unscaled && !scaler_gen_filter(ctx))
+   if (!scaler_gen_filter(ctx))
       return false;
 
    return true;
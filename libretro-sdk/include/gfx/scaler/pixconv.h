@@ -23,6 +23,7 @@
 #ifndef __LIBRETRO_SDK_SCALER_PIXCONV_H__
 #define __LIBRETRO_SDK_SCALER_PIXCONV_H__
 
+#include <gfx/scaler/scaler.h>
 #include <gfx/scaler/scaler_common.h>
 
 void conv_0rgb1555_argb8888(void *output, const void *input,
@@ -81,5 +82,10 @@ void conv_copy(void *output, const void *input,
       int width, int height,
       int out_stride, int in_stride);
 
+/* Returns the fastest version of conv that only uses
+ * the SIMD extensions in mask, or conv itself. */
+scaler_pixconv_t conv_simd_variant(scaler_pixconv_t conv,
+      scaler_simd_mask_t mask);
+
 #endif
 
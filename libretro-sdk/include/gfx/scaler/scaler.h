@@ -30,6 +30,12 @@
 
 #define FILTER_UNITY (1 << 14)
 
+/* SIMD extensions the converters may use. Same bits as RETRO_SIMD_*. */
+#define SCALER_SIMD_SSSE3  (1 << 7)
+#define SCALER_SIMD_AVX2   (1 << 12)
+
+typedef uint64_t scaler_simd_mask_t;
+
 enum scaler_pix_fmt
 {
    SCALER_FMT_ARGB8888 = 0,
@@ -106,6 +112,25 @@ struct scaler_ctx
    } output;
 };
 
+typedef void (*scaler_pixconv_t)(void *output, const void *input,
+      int width, int height, int out_stride, int in_stride);
+
+/* Straight pixel conversion between two formats, without going
+ * through a scaler_ctx. Returns NULL if there is no direct path.
+ * After scaler_set_simd_mask() this is a table lookup, cheap
+ * enough to call for every frame and safe from any thread.
+ *
+ * Strides may be negative, which flips the image vertically as
+ * part of the same pass. */
+scaler_pixconv_t scaler_get_pixconv(enum scaler_pix_fmt in_fmt,
+      enum scaler_pix_fmt out_fmt);
+
+/* Tells the converters which SIMD extensions the CPU has and
+ * fills the converter table. Until this is called, only those the
+ * compiler targets are used. Call it before any other thread uses
+ * the scaler; converters handed out earlier stay valid. */
+void scaler_set_simd_mask(scaler_simd_mask_t mask);
+
 bool scaler_ctx_gen_filter(struct scaler_ctx *ctx);
 void scaler_ctx_gen_reset(struct scaler_ctx *ctx);
 
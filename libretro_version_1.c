@@ -28,6 +28,7 @@
 #include "performance.h"
 #include "input/keyboard_line.h"
 #include "audio/utils.h"
+#include "audio/audio_rate_control.h"
 #include "retroarch_logger.h"
 #include "intl/intl.h"
 
@@ -94,58 +95,152 @@ static void video_frame(const void *data, unsigned width,
       driver.video_active = false;
 }
 
-static void readjust_audio_input_rate(void)
+static void readjust_audio_input_rate(size_t frames)
 {
    int avail = driver.audio->write_avail(driver.audio_data);
 
    //RARCH_LOG_OUTPUT("Audio buffer is %u%% full\n",
    //      (unsigned)(100 - (avail * 100) / g_extern.audio_data.driver_buffer_size));
 
-   unsigned write_idx = g_extern.measure_data.buffer_free_samples_count++ &
-      (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
-   int      half_size   = g_extern.audio_data.driver_buffer_size / 2;
-   int      delta_mid   = avail - half_size;
-   double   direction   = (double)delta_mid / half_size;
-   double   adjust      = 1.0 + g_settings.audio.rate_control_delta *
-      direction;
+   unsigned write_idx;
+   unsigned frame_size = g_extern.audio_data.use_float ?
+      2 * sizeof(float) : 2 * sizeof(int16_t);
+   double   half_time  = (double)(g_extern.audio_data.driver_buffer_size / 2) /
+      (frame_size * g_settings.audio.out_rate);
+   double   dt         = g_extern.audio_data.in_rate > 0.0f ?
+      frames / g_extern.audio_data.in_rate : 0.0;
+   double   adjust;
+
+#ifdef HAVE_THREADS
+   /* With audio_dsp_thread this runs on the worker, 
+    * while GET_AUDIO_STATS reads the results. */
+   if (g_extern.audio_data.stats_lock)
+      slock_lock(g_extern.audio_data.stats_lock);
+#endif
 
+   write_idx = g_extern.measure_data.buffer_free_samples_count++ &
+      (AUDIO_BUFFER_FREE_SAMPLES_COUNT - 1);
    g_extern.measure_data.buffer_free_samples[write_idx] = avail;
+
+   if (!driver.nonblock_state)
+   {
+      if (avail >= (int)g_extern.audio_data.driver_buffer_size)
+         g_extern.measure_data.audio_underruns++;
+      else if (avail == 0)
+         g_extern.measure_data.audio_overruns++;
+   }
+
+   /* Fast forward drains or floods the buffer on purpose,
+    * that's not drift. */
+   adjust = audio_rate_control_update(&g_extern.audio_data.rate_controller,
+         g_settings.audio.rate_control_delta,
+         g_settings.audio.rate_control_pi, driver.nonblock_state,
+         avail, g_extern.audio_data.driver_buffer_size, half_time, dt);
+
    g_extern.audio_data.src_ratio = g_extern.audio_data.orig_src_ratio * adjust;
 
+#ifdef HAVE_THREADS
+   if (g_extern.audio_data.stats_lock)
+      slock_unlock(g_extern.audio_data.stats_lock);
+#endif
+
    //RARCH_LOG_OUTPUT("New rate: %lf, Orig rate: %lf\n",
    //      g_extern.audio_data.src_ratio, g_extern.audio_data.orig_src_ratio);
 }
 
-static bool audio_flush(const int16_t *data, size_t samples)
+/* Zero-copy writes into the driver's ring. Only taken when all of
+ * size fits right away, anything else goes through write(), which
+ * knows whether to block or drop. */
+static bool audio_driver_acquire(audio_write_region_t *region, size_t size)
 {
-   const void *output_data        = NULL;
-   unsigned output_frames         = 0;
-   size_t   output_size           = sizeof(float);
-   struct resampler_data src_data = {0};
-   struct rarch_dsp_data dsp_data = {0};
+   if (!driver.audio->write_acquire || !driver.audio->write_commit)
+      return false;
+   return driver.audio->write_acquire(driver.audio_data, region) >= size;
+}
 
- /*  if (driver.recording_data)
-   {
-      struct ffemu_audio_data ffemu_data = {0};
-      ffemu_data.data                    = data;
-      ffemu_data.frames                  = samples / 2;
+/* Ring memory the resampler can write to directly, provided the
+ * most it can produce from input_frames fits without wrapping.
+ * Depending on where the last call left off, that is up to one
+ * input frame's worth more than input_frames * ratio. */
+static void *audio_driver_acquire_frames(size_t input_frames,
+      double ratio, size_t frame_size)
+{
+   audio_write_region_t region = {0};
+   size_t size = ((size_t)((input_frames + 1) * ratio) + 2) * frame_size;
 
-      if (driver.recording && driver.recording->push_audio)
-         driver.recording->push_audio(driver.recording_data, &ffemu_data);
-   }*/
+   if (!audio_driver_acquire(&region, size) || region.size1 < size)
+      return NULL;
+   return region.chunk1;
+}
 
-   if (g_extern.is_paused || g_extern.audio_data.mute)
+/* Integer path for resamplers which work on int16 directly.
+ * Skips both float conversions, so it is only taken when nothing
+ * in between wants float: no DSP filter and an s16 driver. */
+static bool audio_flush_s16(const int16_t *data, size_t samples)
+{
+   struct resampler_data_s16 src_data = {0};
+   int16_t *direct = NULL;
+   /* data can live in conv_outsamples (see audio_sample), so
+    * borrow the float buffer for output. It holds at least
+    * twice the int16 samples needed. */
+   int16_t *output = (int16_t*)g_extern.audio_data.outsamples;
+
+   src_data.data_in      = data;
+   src_data.input_frames = samples >> 1;
+
+   if (g_extern.audio_data.rate_control)
+      readjust_audio_input_rate(src_data.input_frames);
+
+   src_data.ratio = g_extern.audio_data.src_ratio;
+   if (g_extern.is_slowmotion)
+      src_data.ratio *= g_settings.slowmotion_ratio;
+
+   direct = (int16_t*)audio_driver_acquire_frames(src_data.input_frames,
+         src_data.ratio, 2 * sizeof(int16_t));
+   if (direct)
+      output = direct;
+   src_data.data_out = output;
+
+   rarch_resampler_process_s16(driver.resampler,
+         driver.resampler_data, &src_data);
+
+   if (g_extern.audio_data.volume_gain != 1.0f)
+      audio_convert_s16_gain(output, output, src_data.output_frames * 2,
+            g_extern.audio_data.volume_gain);
+
+   if (direct)
+   {
+      driver.audio->write_commit(driver.audio_data,
+            src_data.output_frames * sizeof(int16_t) * 2);
       return true;
-   if (!driver.audio_active || !g_extern.audio_data.data)
+   }
+
+   if (driver.audio->write(driver.audio_data, output,
+            src_data.output_frames * sizeof(int16_t) * 2) < 0)
+   {
+      RARCH_ERR(RETRO_LOG_AUDIO_WRITE_FAILED);
       return false;
+   }
 
-  // RARCH_PERFORMANCE_INIT(audio_convert_s16);
-  // RARCH_PERFORMANCE_START(audio_convert_s16);
-   audio_convert_s16_to_float(g_extern.audio_data.data, data, samples,
-         g_extern.audio_data.volume_gain);
-   //RARCH_PERFORMANCE_STOP(audio_convert_s16);
+   return true;
+}
+
+/* Everything after the s16 -> float conversion. With
+ * audio_dsp_thread enabled this runs on the DSP thread, which
+ * brings its own conv_outsamples since the emulation thread is
+ * still collecting samples in g_extern.audio_data.conv_outsamples. */
+static bool audio_flush_float(float *data, size_t samples,
+      int16_t *conv_outsamples)
+{
+   const void *output_data        = NULL;
+   unsigned output_frames         = 0;
+   size_t   output_size           = sizeof(float);
+   float   *direct                = NULL;
+   audio_write_region_t region    = {0};
+   struct resampler_data src_data = {0};
+   struct rarch_dsp_data dsp_data = {0};
 
-   dsp_data.input                 = g_extern.audio_data.data;
+   dsp_data.input                 = data;
    dsp_data.input_frames          = samples >> 1;
 
    if (g_extern.audio_data.dsp)
@@ -156,20 +251,24 @@ static bool audio_flush(const int16_t *data, size_t samples)
      // RARCH_PERFORMANCE_STOP(audio_dsp);
    }
 
-   src_data.data_in      = dsp_data.output ?
-      dsp_data.output : g_extern.audio_data.data;
+   src_data.data_in      = dsp_data.output ? dsp_data.output : data;
    src_data.input_frames = dsp_data.output ?
       dsp_data.output_frames : (samples >> 1);
 
-   src_data.data_out = g_extern.audio_data.outsamples;
-
    if (g_extern.audio_data.rate_control)
-      readjust_audio_input_rate();
+      readjust_audio_input_rate(src_data.input_frames);
 
    src_data.ratio = g_extern.audio_data.src_ratio;
    if (g_extern.is_slowmotion)
       src_data.ratio *= g_settings.slowmotion_ratio;
 
+   /* Float drivers get resampled into directly. */
+   if (g_extern.audio_data.use_float)
+      direct = (float*)audio_driver_acquire_frames(src_data.input_frames,
+            src_data.ratio, 2 * sizeof(float));
+
+   src_data.data_out = direct ? direct : g_extern.audio_data.outsamples;
+
  //  RARCH_PERFORMANCE_INIT(resampler_proc);
   // RARCH_PERFORMANCE_START(resampler_proc);
    rarch_resampler_process(driver.resampler,
@@ -179,15 +278,44 @@ static bool audio_flush(const int16_t *data, size_t samples)
    output_data   = g_extern.audio_data.outsamples;
    output_frames = src_data.output_frames;
 
+   if (direct)
+   {
+      driver.audio->write_commit(driver.audio_data,
+            output_frames * sizeof(float) * 2);
+      return true;
+   }
+
+   /* s16 drivers get converted into directly, the conversion
+    * doesn't care where the ring wraps. */
+   if (!g_extern.audio_data.use_float && audio_driver_acquire(&region,
+            output_frames * sizeof(int16_t) * 2))
+   {
+      size_t samples = output_frames * 2;
+      size_t first   = region.size1 / sizeof(int16_t);
+
+      if (first > samples)
+         first = samples;
+
+      audio_convert_float_to_s16((int16_t*)region.chunk1,
+            (const float*)output_data, first);
+      if (samples > first)
+         audio_convert_float_to_s16((int16_t*)region.chunk2,
+               (const float*)output_data + first, samples - first);
+
+      driver.audio->write_commit(driver.audio_data,
+            samples * sizeof(int16_t));
+      return true;
+   }
+
    if (!g_extern.audio_data.use_float)
    {
     //  RARCH_PERFORMANCE_INIT(audio_convert_float);
      // RARCH_PERFORMANCE_START(audio_convert_float);
-      audio_convert_float_to_s16(g_extern.audio_data.conv_outsamples,
+      audio_convert_float_to_s16(conv_outsamples,
             (const float*)output_data, output_frames * 2);
     //  RARCH_PERFORMANCE_STOP(audio_convert_float);
 
-      output_data = g_extern.audio_data.conv_outsamples;
+      output_data = conv_outsamples;
       output_size = sizeof(int16_t);
    }
 
@@ -201,17 +329,70 @@ static bool audio_flush(const int16_t *data, size_t samples)
    return true;
 }
 
+#ifdef HAVE_THREADS
+bool retro_process_audio(float *data, size_t samples, void *scratch)
+{
+   return audio_flush_float(data, samples, (int16_t*)scratch);
+}
+#endif
+
+static bool audio_flush(const int16_t *data, size_t samples)
+{
+ /*  if (driver.recording_data)
+   {
+      struct ffemu_audio_data ffemu_data = {0};
+      ffemu_data.data                    = data;
+      ffemu_data.frames                  = samples / 2;
+
+      if (driver.recording && driver.recording->push_audio)
+         driver.recording->push_audio(driver.recording_data, &ffemu_data);
+   }*/
+
+   if (g_extern.is_paused || g_extern.audio_data.mute)
+      return true;
+   if (!driver.audio_active || !g_extern.audio_data.data)
+      return false;
+
+   if (!g_extern.audio_data.use_float && !g_extern.audio_data.dsp &&
+         !g_extern.audio_data.dsp_thread && driver.resampler->process_s16)
+      return audio_flush_s16(data, samples);
+
+  // RARCH_PERFORMANCE_INIT(audio_convert_s16);
+  // RARCH_PERFORMANCE_START(audio_convert_s16);
+   audio_convert_s16_to_float(g_extern.audio_data.data, data, samples,
+         g_extern.audio_data.volume_gain);
+   //RARCH_PERFORMANCE_STOP(audio_convert_s16);
+
+#ifdef HAVE_THREADS
+   if (g_extern.audio_data.dsp_thread)
+      return audio_dsp_thread_push(g_extern.audio_data.dsp_thread,
+            g_extern.audio_data.data, samples,
+            g_settings.audio.sync && !driver.nonblock_state);
+#endif
+
+   return audio_flush_float(g_extern.audio_data.data, samples,
+         g_extern.audio_data.conv_outsamples);
+}
+
 void retro_flush_audio(const int16_t *data, size_t samples)
 {
    driver.audio_active = audio_flush(data, samples) && driver.audio_active;
 }
 
+/* With audio_frame_batch, everything the core hands us during a
+ * frame is collected in conv_outsamples and flushed in one go by
+ * retro_flush_audio_frame(). The buffer only gets flushed early if
+ * a frame brings more than AUDIO_CHUNK_SIZE_NONBLOCKING samples,
+ * the most audio_flush() and setup_rewind_audio() take at once. */
 static void audio_sample(int16_t left, int16_t right)
 {
+   size_t limit = g_extern.audio_data.frame_batch ?
+      AUDIO_CHUNK_SIZE_NONBLOCKING : g_extern.audio_data.chunk_size;
+
    g_extern.audio_data.conv_outsamples[g_extern.audio_data.data_ptr++] = left;
    g_extern.audio_data.conv_outsamples[g_extern.audio_data.data_ptr++] = right;
 
-   if (g_extern.audio_data.data_ptr < g_extern.audio_data.chunk_size)
+   if (g_extern.audio_data.data_ptr < limit)
       return;
 
    driver.audio_active = audio_flush(g_extern.audio_data.conv_outsamples,
@@ -220,17 +401,58 @@ static void audio_sample(int16_t left, int16_t right)
    g_extern.audio_data.data_ptr = 0;
 }
 
+static void audio_sample_batch_append(const int16_t *data, size_t samples)
+{
+   while (samples)
+   {
+      size_t avail = AUDIO_CHUNK_SIZE_NONBLOCKING -
+         g_extern.audio_data.data_ptr;
+      if (avail > samples)
+         avail = samples;
+
+      memcpy(g_extern.audio_data.conv_outsamples +
+            g_extern.audio_data.data_ptr, data, avail * sizeof(int16_t));
+      g_extern.audio_data.data_ptr += avail;
+      data                         += avail;
+      samples                      -= avail;
+
+      if (g_extern.audio_data.data_ptr < AUDIO_CHUNK_SIZE_NONBLOCKING)
+         break;
+
+      driver.audio_active = audio_flush(g_extern.audio_data.conv_outsamples,
+            g_extern.audio_data.data_ptr) && driver.audio_active;
+      g_extern.audio_data.data_ptr = 0;
+   }
+}
+
 static size_t audio_sample_batch(const int16_t *data, size_t frames)
 {
    if (frames > (AUDIO_CHUNK_SIZE_NONBLOCKING >> 1))
       frames = AUDIO_CHUNK_SIZE_NONBLOCKING >> 1;
 
+   if (g_extern.audio_data.frame_batch)
+   {
+      audio_sample_batch_append(data, frames << 1);
+      return frames;
+   }
+
    driver.audio_active = audio_flush(data, frames << 1)
       && driver.audio_active;
 
    return frames;
 }
 
+void retro_flush_audio_frame(void)
+{
+   if (!g_extern.audio_data.frame_batch || !g_extern.audio_data.data_ptr)
+      return;
+
+   driver.audio_active = audio_flush(g_extern.audio_data.conv_outsamples,
+         g_extern.audio_data.data_ptr) && driver.audio_active;
+
+   g_extern.audio_data.data_ptr = 0;
+}
+
 /* Turbo scheme: If turbo button is held, all buttons pressed except
  * for D-pad will go into a turbo mode. Until the button is
  * released again, the input state will be modulated by a periodic pulse
@@ -337,6 +559,39 @@ static size_t audio_sample_batch_rewind(const int16_t *data, size_t frames)
    return frames;
 }
 
+/* Run-ahead frames are thrown away again, so whatever the core
+ * produces while one of them runs must not reach the drivers. */
+
+/* Still caches the frame, so run-ahead can present it
+ * with rarch_render_cached_frame() if it has to bail out. */
+static void video_frame_hidden(const void *data, unsigned width,
+      unsigned height, size_t pitch)
+{
+   if (!driver.video_active)
+      return;
+
+   g_extern.frame_cache.data   = data;
+   g_extern.frame_cache.width  = width;
+   g_extern.frame_cache.height = height;
+   g_extern.frame_cache.pitch  = pitch;
+}
+
+static void audio_sample_hidden(int16_t left, int16_t right)
+{
+   (void)left;
+   (void)right;
+}
+
+static size_t audio_sample_batch_hidden(const int16_t *data, size_t frames)
+{
+   (void)data;
+   return frames;
+}
+
+static void input_poll_hidden(void)
+{
+}
+
 #ifdef HAVE_OVERLAY
 static inline void input_poll_overlay(void)
 {
@@ -522,6 +777,25 @@ void retro_init_libretro_cbs(void *data)
 #endif
 }
 
+void retro_set_runahead_callbacks(unsigned flags)
+{
+   pretro_set_video_refresh((flags & RETRO_RUNAHEAD_HIDE_VIDEO) ?
+         video_frame_hidden : video_frame);
+   pretro_set_input_poll((flags & RETRO_RUNAHEAD_HIDE_POLL) ?
+         input_poll_hidden : input_poll);
+
+   if (flags & RETRO_RUNAHEAD_HIDE_AUDIO)
+   {
+      pretro_set_audio_sample(audio_sample_hidden);
+      pretro_set_audio_sample_batch(audio_sample_batch_hidden);
+   }
+   else
+   {
+      pretro_set_audio_sample(audio_sample);
+      pretro_set_audio_sample_batch(audio_sample_batch);
+   }
+}
+
 void retro_set_rewind_callbacks(void)
 {
    if (g_extern.frame_is_reverse)
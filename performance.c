@@ -311,12 +311,41 @@ static void arm_enable_runfast_mode(void)
 }
 #endif
 
+unsigned rarch_get_cpu_cores(void)
+{
+#if defined(_WIN32) && !defined(_XBOX)
+   SYSTEM_INFO sysinfo;
+   GetSystemInfo(&sysinfo);
+   return sysinfo.dwNumberOfProcessors;
+#elif defined(ANDROID)
+   return android_getCpuCount();
+#elif defined(_SC_NPROCESSORS_ONLN)
+   long ret = sysconf(_SC_NPROCESSORS_ONLN);
+   if (ret <= 0)
+      return 1;
+   return ret;
+#elif defined(BSD) || defined(__APPLE__)
+   int num_cpu = 0;
+   int mib[2];
+   size_t len = sizeof(num_cpu);
+
+   mib[0] = CTL_HW;
+   mib[1] = HW_NCPU;
+   sysctl(mib, 2, &num_cpu, &len, NULL, 0);
+   if (num_cpu < 1)
+      num_cpu = 1;
+   return num_cpu;
+#else
+   return 1;
+#endif
+}
+
 uint64_t rarch_get_cpu_features(void)
 {
    uint64_t cpu = 0;
 
    const unsigned MAX_FEATURES = \
-         sizeof(" MMX MMXEXT SSE SSE2 SSE3 SSSE3 SS4 SSE4.2 AES AVX AVX2 NEON VMX VMX128 VFPU PS");
+         sizeof(" MMX MMXEXT SSE SSE2 SSE3 SSSE3 SS4 SSE4.2 AES AVX AVX2 FMA NEON VMX VMX128 VFPU PS");
    char buf[MAX_FEATURES];
    memset(buf, 0, MAX_FEATURES);
 
@@ -371,7 +400,13 @@ uint64_t rarch_get_cpu_features(void)
          && ((xgetbv_x86(0) & 0x6) == 0x6))
       cpu |= RETRO_SIMD_AVX;
 
-   if (max_flag >= 7)
+   /* FMA3 works on YMM registers as well. */
+   if ((flags[2] & (1 << 12)) && (cpu & RETRO_SIMD_AVX))
+      cpu |= RARCH_SIMD_FMA;
+
+   /* AVX2 uses the same YMM state as AVX, so it needs the
+    * same OS support. */
+   if (max_flag >= 7 && (cpu & RETRO_SIMD_AVX))
    {
       x86_cpuid(7, flags);
       if (flags[1] & (1 << 5))
@@ -425,6 +460,7 @@ uint64_t rarch_get_cpu_features(void)
    if (cpu & RETRO_SIMD_AES)    strlcat(buf, " AES", sizeof(buf));
    if (cpu & RETRO_SIMD_AVX)    strlcat(buf, " AVX", sizeof(buf));
    if (cpu & RETRO_SIMD_AVX2)   strlcat(buf, " AVX2", sizeof(buf));
+   if (cpu & RARCH_SIMD_FMA)    strlcat(buf, " FMA", sizeof(buf));
    if (cpu & RETRO_SIMD_NEON)   strlcat(buf, " NEON", sizeof(buf));
    if (cpu & RETRO_SIMD_VMX)    strlcat(buf, " VMX", sizeof(buf));
    if (cpu & RETRO_SIMD_VMX128) strlcat(buf, " VMX128", sizeof(buf));
@@ -436,3 +472,8 @@ uint64_t rarch_get_cpu_features(void)
 
    return cpu;
 }
+
+uint64_t rarch_get_core_cpu_features(void)
+{
+   return rarch_get_cpu_features() & ~(uint64_t)RARCH_SIMD_PRIVATE;
+}
@@ -66,8 +66,17 @@ static inline void rarch_perf_stop(struct retro_perf_counter *perf)
       perf->total += rarch_get_perf_counter() - perf->start;
 }
 
+/* Feature bits only the frontend knows about. They sit where the
+ * libretro API won't assign anything and are masked off before
+ * cores see the features, see rarch_get_core_cpu_features(). */
+#define RARCH_SIMD_FMA      (1U << 31)
+#define RARCH_SIMD_PRIVATE  RARCH_SIMD_FMA
+
 uint64_t rarch_get_cpu_features(void);
-//unsigned rarch_get_cpu_cores(void);
+
+/* rarch_get_cpu_features() as handed out through the perf interface. */
+uint64_t rarch_get_core_cpu_features(void);
+unsigned rarch_get_cpu_cores(void);
 
 /* Used internally by RetroArch. */
 #define RARCH_PERFORMANCE_INIT(X) \
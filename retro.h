@@ -29,9 +29,23 @@ typedef struct retro_callbacks
    retro_input_poll_t poll_cb;
 } retro_callbacks_t;
 
+/* Flags for retro_set_runahead_callbacks(). */
+#define RETRO_RUNAHEAD_HIDE_VIDEO (1 << 0)
+#define RETRO_RUNAHEAD_HIDE_AUDIO (1 << 1)
+#define RETRO_RUNAHEAD_HIDE_POLL  (1 << 2)
+
 void retro_init_libretro_cbs(void *data);
 void retro_set_default_callbacks(void *data);
 void retro_set_rewind_callbacks(void);
+void retro_set_runahead_callbacks(unsigned flags);
 void retro_flush_audio(const int16_t *data, size_t samples);
 
+/* Flushes the audio collected during the frame when
+ * audio_frame_batch is on. Call after pretro_run(). */
+void retro_flush_audio_frame(void);
+
+/* Runs DSP, resampler and driver write on float samples.
+ * Used as the audio_dsp_thread worker. */
+bool retro_process_audio(float *data, size_t samples, void *scratch);
+
 #endif
@@ -126,9 +126,17 @@ static bool take_screenshot_raw(void)
    /* Negative pitch is needed as screenshot takes bottom-up,
     * but we use top-down.
     */
+#ifdef HAVE_THREADS
+   /* Encoding a PNG takes long enough to cause a hitch,
+    * leave it to the screenshot thread. */
+   return screenshot_dump_async(screenshot_dir,
+         (const uint8_t*)data + (height - 1) * pitch,
+         width, height, -pitch, false);
+#else
    return screenshot_dump(screenshot_dir,
          (const uint8_t*)data + (height - 1) * pitch,
          width, height, -pitch, false);
+#endif
 }
 
 static void take_screenshot(void)
@@ -1138,16 +1146,133 @@ static void init_rewind(void)
    RARCH_LOG(RETRO_MSG_REWIND_INIT "%u MB\n",
          (unsigned)(g_settings.rewind_buffer_size / 1000000));
 
+#ifdef HAVE_MMAP
+   if (g_settings.rewind_file_backed)
+   {
+      char path[PATH_MAX];
+
+      fill_pathname(path, g_extern.savestate_name, ".rewind", sizeof(path));
+      g_extern.state_manager = state_manager_new_file(g_extern.state_size,
+            g_settings.rewind_buffer_size, path, g_settings.rewind_lz);
+
+      if (g_extern.state_manager)
+         RARCH_LOG("Rewind buffer backed by \"%s\".\n", path);
+      else
+         RARCH_WARN("Failed to map rewind buffer \"%s\", using memory.\n",
+               path);
+   }
+
+   if (!g_extern.state_manager)
+#endif
    g_extern.state_manager = state_manager_new(g_extern.state_size,
          g_settings.rewind_buffer_size);
 
    if (!g_extern.state_manager)
+   {
       RARCH_WARN(RETRO_LOG_REWIND_INIT_FAILED);
+      return;
+   }
+
+   if (g_settings.rewind_lz &&
+         !state_manager_enable_lz(g_extern.state_manager))
+      RARCH_WARN("Failed to enable rewind LZ compression.\n");
+
+   if (!state_manager_set_keyframes(g_extern.state_manager,
+            g_settings.rewind_keyframe_interval, g_settings.rewind_keyframes))
+      RARCH_WARN("Failed to allocate rewind keyframes.\n");
+
+#ifdef HAVE_THREADS
+   if (g_settings.rewind_threaded &&
+         !state_manager_start_thread(g_extern.state_manager))
+      RARCH_WARN("Failed to start rewind compression thread.\n");
+#endif
 
    state_manager_push_where(g_extern.state_manager, &state);
    pretro_serialize(state, g_extern.state_size);
    state_manager_push_do(g_extern.state_manager);
 }
+
+/* How much history each MB of rewind buffer bought,
+ * to help tune rewind_buffer_size and rewind_lz. */
+static void log_rewind_depth(void)
+{
+   unsigned entries = 0;
+   size_t bytes = 0;
+   double seconds;
+   unsigned granularity = g_settings.rewind_granularity ?
+      g_settings.rewind_granularity : 1;
+
+   state_manager_capacity(g_extern.state_manager, &entries, &bytes, NULL);
+   if (!bytes || g_extern.system.av_info.timing.fps <= 0.0)
+      return;
+
+   seconds = entries * granularity / g_extern.system.av_info.timing.fps;
+   RARCH_LOG("Rewind buffer held %.1f seconds in %.2f MB "
+         "(%.2f seconds per MB).\n",
+         seconds, bytes / 1000000.0, seconds / (bytes / 1000000.0));
+}
+
+static void rewind_scrub(void)
+{
+   char msg[PATH_MAX];
+   const void *buf = NULL;
+   unsigned entries = 0;
+   unsigned granularity = g_settings.rewind_granularity ?
+      g_settings.rewind_granularity : 1;
+   unsigned frames = (unsigned)(g_settings.rewind_scrub_seconds *
+         g_extern.system.av_info.timing.fps / granularity);
+
+   state_manager_capacity(g_extern.state_manager, &entries, NULL, NULL);
+   if (frames > entries)
+      frames = entries;
+
+   msg_queue_clear(g_extern.msg_queue);
+
+   if (!frames || !state_manager_seek(g_extern.state_manager, frames, &buf))
+   {
+      msg_queue_push(g_extern.msg_queue,
+            RETRO_MSG_REWIND_REACHED_END, 0, 30);
+      return;
+   }
+
+   pretro_unserialize(buf, g_extern.state_size);
+
+   snprintf(msg, sizeof(msg), "Rewound %.1f seconds.",
+         frames * granularity / g_extern.system.av_info.timing.fps);
+   msg_queue_push(g_extern.msg_queue, msg, 1, 60);
+   RARCH_LOG("%s\n", msg);
+}
+
+static void init_runahead(void)
+{
+   if (!g_settings.run_ahead_frames || g_extern.runahead.state)
+      return;
+
+   g_extern.runahead.state_size = pretro_serialize_size();
+   if (!g_extern.runahead.state_size)
+   {
+      RARCH_ERR("Implementation does not support save states. "
+            "Cannot use run-ahead.\n");
+      return;
+   }
+
+   g_extern.runahead.state = malloc(g_extern.runahead.state_size);
+   if (!g_extern.runahead.state)
+   {
+      RARCH_WARN("Failed to allocate run-ahead state buffer.\n");
+      return;
+   }
+
+   RARCH_LOG("Running %u frame(s) ahead.\n", g_settings.run_ahead_frames);
+}
+
+static void deinit_runahead(void)
+{
+   free(g_extern.runahead.state);
+   g_extern.runahead.state = NULL;
+   g_extern.runahead.state_size = 0;
+}
+
 /*
 static void init_movie(void)
 {
@@ -1959,6 +2084,7 @@ int rarch_main_init(int argc, char *argv[])
    }
 
    validate_cpu_features();
+   scaler_set_simd_mask(rarch_get_cpu_features());
    config_load();
 
    init_libretro_sym(g_extern.libretro_dummy);
@@ -1972,6 +2098,7 @@ int rarch_main_init(int argc, char *argv[])
    rarch_main_command(RARCH_CMD_DRIVERS_INIT);
    rarch_main_command(RARCH_CMD_COMMAND_INIT);
    rarch_main_command(RARCH_CMD_REWIND_INIT);
+   rarch_main_command(RARCH_CMD_RUNAHEAD_INIT);
    rarch_main_command(RARCH_CMD_CONTROLLERS_INIT);
   // rarch_main_command(RARCH_CMD_RECORD_INIT);
   // rarch_main_command(RARCH_CMD_CHEATS_INIT);
@@ -2322,12 +2449,27 @@ bool rarch_main_command(unsigned cmd)
             return false;
 #endif
          if (g_extern.state_manager)
+         {
+            log_rewind_depth();
             state_manager_free(g_extern.state_manager);
+         }
          g_extern.state_manager = NULL;
          break;
       case RARCH_CMD_REWIND_INIT:
          init_rewind();
          break;
+      case RARCH_CMD_REWIND_SCRUB:
+         if (!g_extern.state_manager)
+            return false;
+         rewind_scrub();
+         break;
+      case RARCH_CMD_RUNAHEAD_DEINIT:
+         deinit_runahead();
+         break;
+      case RARCH_CMD_RUNAHEAD_INIT:
+         deinit_runahead();
+         init_runahead();
+         break;
       case RARCH_CMD_REWIND_TOGGLE:
          if (g_settings.rewind_enable)
             rarch_main_command(RARCH_CMD_REWIND_INIT);
@@ -2354,6 +2496,9 @@ bool rarch_main_command(unsigned cmd)
          if (!driver.audio->alive(driver.audio_data))
             return false;
 
+#ifdef HAVE_THREADS
+         audio_dsp_thread_flush(g_extern.audio_data.dsp_thread);
+#endif
          driver.audio->stop(driver.audio_data);
          break;
       case RARCH_CMD_AUDIO_START:
@@ -2416,6 +2561,9 @@ bool rarch_main_command(unsigned cmd)
 #endif
          break;
       case RARCH_CMD_DSP_FILTER_DEINIT:
+#ifdef HAVE_THREADS
+         audio_dsp_thread_flush(g_extern.audio_data.dsp_thread);
+#endif
          if (g_extern.audio_data.dsp)
             rarch_dsp_filter_free(g_extern.audio_data.dsp);
          g_extern.audio_data.dsp = NULL;
@@ -2581,6 +2729,9 @@ bool rarch_main_command(unsigned cmd)
       case RARCH_CMD_AUDIO_SET_NONBLOCKING_STATE:
          boolean = true; /* fall-through */
       case RARCH_CMD_AUDIO_SET_BLOCKING_STATE:
+#ifdef HAVE_THREADS
+         audio_dsp_thread_flush(g_extern.audio_data.dsp_thread);
+#endif
          if (driver.audio && driver.audio->set_nonblock_state)
             driver.audio->set_nonblock_state(driver.audio_data, boolean);
          break;
@@ -2892,6 +3043,7 @@ void rarch_main_deinit(void)
    rarch_main_command(RARCH_CMD_SAVEFILES);
 
    rarch_main_command(RARCH_CMD_REWIND_DEINIT);
+   rarch_main_command(RARCH_CMD_RUNAHEAD_DEINIT);
   // rarch_main_command(RARCH_CMD_CHEATS_DEINIT);
   // rarch_main_command(RARCH_CMD_BSV_MOVIE_DEINIT);
 
@@ -2903,5 +3055,9 @@ void rarch_main_deinit(void)
    rarch_main_command(RARCH_CMD_SUBSYSTEM_FULLPATHS_DEINIT);
    rarch_main_command(RARCH_CMD_SAVEFILES_DEINIT);
 
+#ifdef HAVE_THREADS
+   screenshot_deinit();
+#endif
+
    g_extern.main_is_init = false;
 }
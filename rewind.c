@@ -21,6 +21,17 @@
 #include <stdint.h>
 #include <string.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
+#ifdef HAVE_MMAP
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
 #ifndef UINT16_MAX
 #define UINT16_MAX 0xffff
 #endif
@@ -38,6 +49,9 @@
 #define NO_UNALIGNED_MEM
 #endif
 
+/* Widest load done by find_change()/find_same(). */
+#define STATE_BLOCK_PADDING 32
+
 /* Format per frame (pseudocode): */
 #if 0
 size nextstart;
@@ -93,6 +107,57 @@ static inline size_t read_size_t(const void *ptr)
    return ret;
 }
 
+/* A full copy of the state pushed as number 'serial', along with
+ * the ring offset 'head' had right after it was pushed. Popping from
+ * there walks the same delta chain as popping from the real head. */
+struct state_keyframe
+{
+   uint8_t *data;
+   uint64_t serial;
+   size_t head;
+   bool valid;
+};
+
+#ifdef HAVE_MMAP
+/* File-backed mode lays out the file as one page of header, three
+ * state slots and the ring, all mapped at once. Ring pointers are
+ * stored as offsets already, so the mapping can move between runs. */
+#define STATE_FILE_MAGIC   0x444e5752 /* "RWND" */
+#define STATE_FILE_VERSION 1
+
+/* Granularity of the madvise() hints on the ring. */
+#define STATE_FILE_CHUNK   (4 << 20)
+
+struct state_file_header
+{
+   uint32_t magic;
+   uint32_t version;
+   /* Set while the ring and header disagree, i.e. mid-push. 
+    * A file left dirty by a crash is discarded on reopen. This only
+    * orders our own stores, the kernel may still write pages back 
+    * in any order, see state_manager_check_file(). */
+   uint32_t dirty;
+   uint32_t lz;
+   uint64_t blocksize;
+   uint64_t capacity;
+   uint64_t head;
+   uint64_t tail;
+   uint64_t serial;
+   uint32_t entries;
+   uint32_t thisblock_slot;
+   uint32_t thisblock_valid;
+};
+
+/* Each slot keeps its own sentinel for good, see state_manager_new(). */
+static const uint16_t state_file_sentinels[3] = { 0xFFFF, 0x0000, 0x5555 };
+
+#if defined(__GNUC__)
+#define STATE_FILE_BARRIER() __asm__ __volatile__("" ::: "memory")
+#else
+#define STATE_FILE_BARRIER()
+#endif
+#endif
+
 struct state_manager
 {
    uint8_t *data;
@@ -113,16 +178,58 @@ struct state_manager
     * (yes, the math is a bit ugly). */
    size_t maxcompsize;
 
+   /* Optional LZ stage on top of the delta. Entries are then stored as
+    * a uint32 length followed by the LZ-compressed delta, which is
+    * built in and decoded to 'scratch'. */
+   uint8_t *scratch;
+   size_t scratch_size;
+   uint32_t *lz_table;
+
    unsigned entries;
    bool thisblock_valid;
+
+   size_t (*find_change)(const uint16_t *a, const uint16_t *b);
+   size_t (*find_same)(const uint16_t *a, const uint16_t *b);
+
+   /* Number of the state in thisblock, counted in pushes. */
+   uint64_t serial;
+
+   struct state_keyframe *keyframes;
+   unsigned num_keyframes;
+   unsigned keyframe_interval;
+
+#ifdef HAVE_THREADS
+   /* Threaded mode: the run loop serializes into nextblock, push_do
+    * swaps it with pending and the worker compresses pending against
+    * thisblock. Everything behind head/tail belongs to the worker
+    * while busy is set. */
+   uint8_t *pending;
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool busy;
+   bool quit;
+#endif
+
+#ifdef HAVE_MMAP
+   int fd;
+   uint8_t *map;
+   size_t map_size;
+   struct state_file_header *header;
+   uint8_t *slots[3];
+   size_t write_chunk;
+   size_t read_chunk;
+#endif
 };
 
-state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
-{
-   state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
-   if (!state)
-      return NULL;
+static struct retro_perf_counter gen_deltas = {"gen_deltas"};
+static struct retro_perf_counter lz_deltas  = {"lz_deltas"};
 
+static void state_manager_select_scanners(state_manager_t *state);
+
+static void state_manager_init_sizes(state_manager_t *state,
+      size_t state_size)
+{
    size_t newblocksize = ((state_size - 1) | (sizeof(uint16_t) - 1)) + 1;
    state->blocksize = newblocksize;
 
@@ -130,13 +237,36 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    const int maxcblks = (state->blocksize + maxcblkcover - 1) / maxcblkcover;
    state->maxcompsize = state->blocksize + maxcblks * sizeof(uint16_t) * 2 +
       sizeof(uint16_t) + sizeof(uint32_t) + sizeof(size_t) * 2;
+}
+
+static void state_manager_init_common(state_manager_t *state)
+{
+   state_manager_select_scanners(state);
+
+   /* Registered here rather than on first use, as they may be
+    * first hit from the compression thread. */
+   rarch_perf_register(&gen_deltas);
+   rarch_perf_register(&lz_deltas);
+}
+
+state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
+{
+   state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
+   if (!state)
+      return NULL;
+
+#ifdef HAVE_MMAP
+   state->fd = -1;
+#endif
+
+   state_manager_init_sizes(state, state_size);
 
    state->data = (uint8_t*)malloc(buffer_size);
 
    state->thisblock = (uint8_t*)
-      calloc(state->blocksize + sizeof(uint16_t) * 4 + 16, 1);
+      calloc(state->blocksize + sizeof(uint16_t) * 4 + STATE_BLOCK_PADDING, 1);
    state->nextblock = (uint8_t*)
-      calloc(state->blocksize + sizeof(uint16_t) * 4 + 16, 1);
+      calloc(state->blocksize + sizeof(uint16_t) * 4 + STATE_BLOCK_PADDING, 1);
    if (!state->data || !state->thisblock || !state->nextblock)
       goto error;
 
@@ -149,8 +279,8 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
     * There is also some padding at the end. This is so we don't 
     * read outside the buffer end if we're reading in large blocks;
     *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get 
-    * Valgrind happy is worth it. */
+    * It doesn't make any difference to us, but sacrificing a few bytes to
+    * get Valgrind happy is worth it. */
    *(uint16_t*)(state->thisblock + state->blocksize + sizeof(uint16_t) * 3) =
       0xFFFF;
    *(uint16_t*)(state->nextblock + state->blocksize + sizeof(uint16_t) * 3) =
@@ -161,6 +291,8 @@ state_manager_t *state_manager_new(size_t state_size, size_t buffer_size)
    state->head = state->data + sizeof(size_t);
    state->tail = state->data + sizeof(size_t);
 
+   state_manager_init_common(state);
+
    return state;
 
 error:
@@ -168,156 +300,909 @@ error:
    return NULL;
 }
 
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data);
+
+bool state_manager_start_thread(state_manager_t *state)
+{
+   if (state->thread)
+      return true;
+
+   /* File-backed states already have their third slot. */
+   if (!state->pending)
+   {
+      state->pending = (uint8_t*)
+         calloc(state->blocksize + sizeof(uint16_t) * 4 + STATE_BLOCK_PADDING, 1);
+      if (!state->pending)
+         return false;
+
+      /* Needs a sentinel distinct from both other blocks,
+       * as any two of the three may end up being compared. */
+      *(uint16_t*)(state->pending + state->blocksize + sizeof(uint16_t) * 3) =
+         0x5555;
+   }
+
+   state->lock = slock_new();
+   state->cond = scond_new();
+   if (!state->lock || !state->cond)
+      goto error;
+
+   state->thread = sthread_create(state_manager_thread, state);
+   if (!state->thread)
+      goto error;
+
+   return true;
+
+error:
+   if (state->lock)
+      slock_free(state->lock);
+   if (state->cond)
+      scond_free(state->cond);
+   state->lock    = NULL;
+   state->cond    = NULL;
+   return false;
+}
+
+static void state_manager_stop_thread(state_manager_t *state)
+{
+   if (!state->thread)
+      return;
+
+   slock_lock(state->lock);
+   state->quit = true;
+   scond_signal(state->cond);
+   slock_unlock(state->lock);
+
+   sthread_join(state->thread);
+   slock_free(state->lock);
+   scond_free(state->cond);
+
+   state->thread  = NULL;
+   state->lock    = NULL;
+   state->cond    = NULL;
+}
+#endif
+
+/* Waits until the compression thread is done with the ring. */
+static void state_manager_sync(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (!state->thread)
+      return;
+
+   slock_lock(state->lock);
+   while (state->busy)
+      scond_wait(state->cond, state->lock);
+   slock_unlock(state->lock);
+#endif
+}
+
 void state_manager_free(state_manager_t *state)
 {
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   state_manager_stop_thread(state);
+#endif
+
+   if (state->keyframes)
+   {
+      unsigned i;
+      for (i = 0; i < state->num_keyframes; i++)
+         free(state->keyframes[i].data);
+      free(state->keyframes);
+   }
+
+   free(state->scratch);
+   free(state->lz_table);
+
+#ifdef HAVE_MMAP
+   if (state->map)
+   {
+      munmap(state->map, state->map_size);
+      close(state->fd);
+      free(state);
+      return;
+   }
+   if (state->fd >= 0)
+      close(state->fd);
+#endif
+
+#ifdef HAVE_THREADS
+   free(state->pending);
+#endif
    free(state->data);
    free(state->thisblock);
    free(state->nextblock);
    free(state);
 }
 
-bool state_manager_pop(state_manager_t *state, const void **data)
+/* Brackets every change to the ring, so a file-backed buffer is only
+ * trusted on reopen if the last change went through completely. */
+static void state_manager_begin_update(state_manager_t *state)
 {
-   *data = NULL;
+#ifdef HAVE_MMAP
+   if (!state->header)
+      return;
+   state->header->dirty = 1;
+   STATE_FILE_BARRIER();
+#endif
+}
 
-   if (state->thisblock_valid)
+static void state_manager_end_update(state_manager_t *state)
+{
+#ifdef HAVE_MMAP
+   unsigned i;
+   struct state_file_header *header = state->header;
+
+   if (!header)
+      return;
+
+   header->head            = state->head - state->data;
+   header->tail            = state->tail - state->data;
+   header->serial          = state->serial;
+   header->entries         = state->entries;
+   header->thisblock_valid = state->thisblock_valid;
+
+   for (i = 0; i < 3; i++)
    {
-      state->thisblock_valid = false;
-      state->entries--;
-      *data = state->thisblock;
-      return true;
+      if (state->thisblock == state->slots[i])
+         header->thisblock_slot = i;
    }
 
-   if (state->head == state->tail)
-      return false;
+   STATE_FILE_BARRIER();
+   header->dirty = 0;
+#endif
+}
 
-   size_t start = read_size_t(state->head - sizeof(size_t));
-   state->head = state->data + start;
+#ifdef HAVE_MMAP
+/* Pages behind the write head won't be touched again until a rewind,
+ * so they're dropped from our mapping to keep RSS flat. They stay in 
+ * the page cache and get written back as usual. */
+static void state_manager_advise_write(state_manager_t *state)
+{
+   size_t chunk = (state->head - state->data) / STATE_FILE_CHUNK;
+   size_t start, len;
 
-   const uint8_t *compressed = state->data + start + sizeof(size_t);
-   uint8_t *out = state->thisblock;
+   if (chunk == state->write_chunk)
+      return;
 
-   /* Begin decompression code
-    * out is the last pushed (or returned) state */
-   const uint16_t *compressed16 = (const uint16_t*)compressed;
-   uint16_t *out16 = (uint16_t*)out;
+   start = state->write_chunk * STATE_FILE_CHUNK;
+   len   = STATE_FILE_CHUNK;
+   if (start + len > state->capacity)
+      len = state->capacity - start;
 
-   for (;;)
+   madvise(state->data + start, len, MADV_DONTNEED);
+   state->write_chunk = chunk;
+}
+
+/* Rewinding reads the ring backwards, which readahead can't guess. 
+ * Ask for the chunk under the head and the one below it instead. */
+static void state_manager_advise_read(state_manager_t *state)
+{
+   size_t chunk = (state->head - state->data) / STATE_FILE_CHUNK;
+   size_t start, len;
+
+   if (chunk == state->read_chunk)
+      return;
+
+   start = (chunk ? chunk - 1 : 0) * STATE_FILE_CHUNK;
+   len   = 2 * STATE_FILE_CHUNK;
+   if (start + len > state->capacity)
+      len = state->capacity - start;
+
+   madvise(state->data + start, len, MADV_WILLNEED);
+   state->read_chunk = chunk;
+}
+
+static void state_manager_assign_slots(state_manager_t *state,
+      unsigned thisblock_slot)
+{
+   state->thisblock = state->slots[thisblock_slot];
+   state->nextblock = state->slots[(thisblock_slot + 1) % 3];
+#ifdef HAVE_THREADS
+   state->pending   = state->slots[(thisblock_slot + 2) % 3];
+#endif
+}
+
+/* A clean header only means the last update went through in memory.
+ * After an OS crash or a torn write the ring pages can be older than
+ * the header, so the entries from tail to head have to link up and 
+ * add up to the header's count before any of them is trusted. */
+static bool state_manager_check_file(state_manager_t *state)
+{
+   unsigned i;
+   unsigned count = 0;
+   const struct state_file_header *header = state->header;
+   size_t pos = header->tail;
+
+   for (i = 0; i < 3; i++)
    {
-      uint16_t i;
-      uint16_t numchanged = *(compressed16++);
-      if (numchanged)
-      {
-         out16 += *compressed16++;
+      if (*(const uint16_t*)(state->slots[i] + state->blocksize +
+               sizeof(uint16_t) * 3) != state_file_sentinels[i])
+         return false;
+   }
 
-         /* We could do memcpy, but it seems that memcpy has a 
-          * constant-per-call overhead that actually shows up.
-          *
-          * Our average size in here seems to be 8 or something.
-          * Therefore, we do something with lower overhead. */
-         for (i = 0; i < numchanged; i++)
-            out16[i] = compressed16[i];
+   while (pos != header->head)
+   {
+      size_t next;
 
-         compressed16 += numchanged;
-         out16 += numchanged;
-      }
-      else
-      {
-         uint32_t numunchanged = compressed16[0] | (compressed16[1] << 16);
-         if (!numunchanged)
-            break;
-         compressed16 += 2;
-         out16 += numunchanged;
-      }
+      if (pos > state->capacity - sizeof(size_t) || 
+            ++count > header->entries)
+         return false;
+
+      /* Entries only go up, except for one wrapping to the bottom. */
+      next = read_size_t(state->data + pos);
+      if (next > state->capacity || (next != sizeof(size_t) &&
+               next < pos + sizeof(size_t) * 2) ||
+            read_size_t(state->data + next - sizeof(size_t)) != pos)
+         return false;
+
+      pos = next;
    }
-   /* End decompression code */
 
-   state->entries--;
-   *data = state->thisblock;
+   return count + header->thisblock_valid == header->entries;
+}
+
+static bool state_manager_load_header(state_manager_t *state, bool lz)
+{
+   const struct state_file_header *header = state->header;
+
+   if (header->magic != STATE_FILE_MAGIC ||
+         header->version != STATE_FILE_VERSION ||
+         header->dirty ||
+         header->lz != (lz ? 1 : 0) ||
+         header->blocksize != state->blocksize ||
+         header->capacity != state->capacity ||
+         header->head < sizeof(size_t) ||
+         header->head >= state->capacity ||
+         header->tail < sizeof(size_t) ||
+         header->tail >= state->capacity ||
+         header->thisblock_slot >= 3 ||
+         header->thisblock_valid > 1 ||
+         !state_manager_check_file(state))
+      return false;
+
+   state_manager_assign_slots(state, header->thisblock_slot);
+
+   state->head            = state->data + header->head;
+   state->tail            = state->data + header->tail;
+   state->serial          = header->serial;
+   state->entries         = header->entries;
+   state->thisblock_valid = header->thisblock_valid;
    return true;
 }
 
-void state_manager_push_where(state_manager_t *state, void **data)
+static void state_manager_reset_file(state_manager_t *state, bool lz,
+      size_t slot_size)
 {
-   /* We need to ensure we have an uncompressed copy of the last
-    * pushed state, or we could end up applying a 'patch' to wrong 
-    * savestate, and that'd blow up rather quickly. */
+   unsigned i;
+   struct state_file_header *header = state->header;
 
-   if (!state->thisblock_valid) 
+   for (i = 0; i < 3; i++)
    {
-      const void *ignored;
-      if (state_manager_pop(state, &ignored))
-      {
-         state->thisblock_valid = true;
-         state->entries++;
-      }
+      memset(state->slots[i] + state->blocksize, 0,
+            slot_size - state->blocksize);
+      *(uint16_t*)(state->slots[i] + state->blocksize +
+            sizeof(uint16_t) * 3) = state_file_sentinels[i];
    }
-   
-   *data = state->nextblock;
+
+   state_manager_assign_slots(state, 0);
+   state->head = state->data + sizeof(size_t);
+   state->tail = state->data + sizeof(size_t);
+
+   memset(header, 0, sizeof(*header));
+   header->magic     = STATE_FILE_MAGIC;
+   header->version   = STATE_FILE_VERSION;
+   header->lz        = lz ? 1 : 0;
+   header->blocksize = state->blocksize;
+   header->capacity  = state->capacity;
+   state_manager_end_update(state);
 }
 
-#if __SSE2__
-#if defined(__GNUC__)
-static inline int compat_ctz(unsigned x)
+state_manager_t *state_manager_new_file(size_t state_size,
+      size_t buffer_size, const char *path, bool lz)
 {
-   return __builtin_ctz(x);
-}
-#else
+   unsigned i;
+   struct stat st;
+   bool reopen;
+   size_t page, slot_size;
+   state_manager_t *state = (state_manager_t*)calloc(1, sizeof(*state));
+   if (!state)
+      return NULL;
 
-/* Only checks at nibble granularity, 
- * because that's what we need. */
+   state->fd = -1;
+   state_manager_init_sizes(state, state_size);
 
-static inline int compat_ctz(unsigned x)
-{
-   if (x & 0x000f)
-      return 0;
-   if (x & 0x00f0)
-      return 4;
-   if (x & 0x0f00)
-      return 8;
-   if (x & 0xf000)
-      return 12;
-   return 16;
+   page      = sysconf(_SC_PAGESIZE);
+   slot_size = (state->blocksize + sizeof(uint16_t) * 4 +
+         STATE_BLOCK_PADDING + page - 1) & ~(page - 1);
+
+   state->capacity = buffer_size;
+   state->map_size = page + 3 * slot_size + buffer_size;
+
+   state->fd = open(path, O_RDWR | O_CREAT, 0644);
+   if (state->fd < 0 || fstat(state->fd, &st) < 0)
+      goto error;
+
+   /* Anything of the wrong size is from another core or setting. 
+    * Truncating leaves a sparse file, so only touched pages 
+    * ever take up space. */
+   reopen = (size_t)st.st_size == state->map_size;
+   if (!reopen && (ftruncate(state->fd, 0) < 0 ||
+            ftruncate(state->fd, state->map_size) < 0))
+      goto error;
+
+   state->map = (uint8_t*)mmap(NULL, state->map_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED, state->fd, 0);
+   if (state->map == MAP_FAILED)
+   {
+      state->map = NULL;
+      goto error;
+   }
+
+   state->header = (struct state_file_header*)state->map;
+   for (i = 0; i < 3; i++)
+      state->slots[i] = state->map + page + i * slot_size;
+   state->data = state->map + page + 3 * slot_size;
+
+   if (lz && !state_manager_enable_lz(state))
+      goto error;
+
+   if (!reopen || !state_manager_load_header(state, lz))
+      state_manager_reset_file(state, lz, slot_size);
+
+   madvise(state->data, state->capacity, MADV_RANDOM);
+   state->write_chunk = (state->head - state->data) / STATE_FILE_CHUNK;
+   state->read_chunk  = (size_t)-1;
+
+   state_manager_init_common(state);
+
+   return state;
+
+error:
+   state_manager_free(state);
+   return NULL;
 }
 #endif
 
-#include <emmintrin.h>
-/* There's no equivalent in libc, you'd think so ...
- * std::mismatch exists, but it's not optimized at all. */
+/* LZ4-style byte codec for the second stage. Each sequence is a token
+ * (literal count << 4 | match length - 4), extension bytes for either
+ * nibble at 15, the literals and a little endian 16-bit match offset.
+ * The last sequence carries literals only. */
+
+#define LZ_HASH_LOG  12
+#define LZ_MIN_MATCH 4
+#define LZ_MAX_SIZE(n) ((n) + (n) / 255 + 16)
 
-static inline size_t find_change(const uint16_t *a, const uint16_t *b)
+static inline uint32_t lz_read32(const uint8_t *ptr)
 {
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
-	
-   for (;;)
-   {
-      __m128i v0 = _mm_loadu_si128(a128);
-      __m128i v1 = _mm_loadu_si128(b128);
-      __m128i c = _mm_cmpeq_epi32(v0, v1);
+   uint32_t val;
+   memcpy(&val, ptr, sizeof(val));
+   return val;
+}
 
-      uint32_t mask = _mm_movemask_epi8(c);
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask))) >> 1;
-			return ret | (a[ret] == b[ret]);
-      }
+static inline uint32_t lz_hash(uint32_t seq)
+{
+   return (seq * 2654435761u) >> (32 - LZ_HASH_LOG);
+}
 
-      a128++;
-      b128++;
-   }
+static uint8_t *lz_put_length(uint8_t *out, size_t len)
+{
+   for (; len >= 255; len -= 255)
+      *out++ = 255;
+   *out++ = len;
+   return out;
 }
-#else
-static inline size_t find_change(const uint16_t *a, const uint16_t *b)
+
+static uint8_t *lz_put_sequence(uint8_t *out, const uint8_t *literals,
+      size_t num_literals, size_t offset, size_t match)
 {
-   const uint16_t *a_org = a;
-#ifdef NO_UNALIGNED_MEM
-   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
-   {
+   uint8_t *token = out++;
+
+   *token = (num_literals >= 15 ? 15 : num_literals) << 4;
+   if (num_literals >= 15)
+      out = lz_put_length(out, num_literals - 15);
+
+   memcpy(out, literals, num_literals);
+   out += num_literals;
+
+   if (!match)
+      return out;
+
+   *out++ = offset;
+   *out++ = offset >> 8;
+
+   match -= LZ_MIN_MATCH;
+   *token |= match >= 15 ? 15 : match;
+   if (match >= 15)
+      out = lz_put_length(out, match - 15);
+
+   return out;
+}
+
+/* Returns the compressed size, at most LZ_MAX_SIZE(in_size). */
+static size_t lz_compress(uint32_t *table,
+      const uint8_t *in, size_t in_size, uint8_t *out)
+{
+   size_t ip = 0, anchor = 0;
+   uint8_t *out_start = out;
+
+   memset(table, 0, sizeof(*table) << LZ_HASH_LOG);
+
+   if (in_size > 12)
+   {
+      /* Don't start matches too close to the end,
+       * keeps the match loop free of bounds checks on 'ref'. */
+      size_t limit      = in_size - 12;
+      size_t matchlimit = in_size - 5;
+
+      while (ip < limit)
+      {
+         uint32_t seq = lz_read32(in + ip);
+         uint32_t h   = lz_hash(seq);
+         size_t ref   = table[h];
+
+         table[h] = ip;
+
+         if (ref < ip && ip - ref <= 0xffff && lz_read32(in + ref) == seq)
+         {
+            size_t len = LZ_MIN_MATCH;
+            while (ip + len < matchlimit && in[ref + len] == in[ip + len])
+               len++;
+
+            out = lz_put_sequence(out, in + anchor, ip - anchor,
+                  ip - ref, len);
+            ip += len;
+            anchor = ip;
+         }
+         else /* Skip faster through data that doesn't compress. */
+            ip += 1 + ((ip - anchor) >> 6);
+      }
+   }
+
+   out = lz_put_sequence(out, in + anchor, in_size - anchor, 0, 0);
+   return out - out_start;
+}
+
+/* Returns the decompressed size, or 0 if the input is malformed. */
+static size_t lz_decompress(const uint8_t *in, size_t in_size,
+      uint8_t *out, size_t out_size)
+{
+   const uint8_t *in_end = in + in_size;
+   uint8_t *out_start    = out;
+   uint8_t *out_end      = out + out_size;
+
+   while (in < in_end)
+   {
+      size_t i, offset;
+      uint8_t token = *in++;
+      size_t len    = token >> 4;
+
+      if (len == 15)
+      {
+         uint8_t b;
+         do
+         {
+            if (in >= in_end)
+               return 0;
+            b = *in++;
+            len += b;
+         } while (b == 255);
+      }
+
+      if (len > (size_t)(in_end - in) || len > (size_t)(out_end - out))
+         return 0;
+      memcpy(out, in, len);
+      in  += len;
+      out += len;
+
+      if (in == in_end)
+         break;
+
+      if (in_end - in < 2)
+         return 0;
+      offset = in[0] | (in[1] << 8);
+      in    += 2;
+
+      len = token & 15;
+      if (len == 15)
+      {
+         uint8_t b;
+         do
+         {
+            if (in >= in_end)
+               return 0;
+            b = *in++;
+            len += b;
+         } while (b == 255);
+      }
+      len += LZ_MIN_MATCH;
+
+      if (!offset || offset > (size_t)(out - out_start) ||
+            len > (size_t)(out_end - out))
+         return 0;
+
+      /* Byte by byte, matches may overlap their own output. */
+      for (i = 0; i < len; i++)
+         out[i] = out[i - offset];
+      out += len;
+   }
+
+   return out - out_start;
+}
+
+bool state_manager_enable_lz(state_manager_t *state)
+{
+   state_manager_sync(state);
+
+   /* Entries are either all raw or all LZ. */
+   if (state->entries || state->scratch)
+      return !!state->scratch;
+
+   state->scratch_size = state->maxcompsize;
+   state->scratch  = (uint8_t*)malloc(state->scratch_size);
+   state->lz_table = (uint32_t*)malloc(sizeof(uint32_t) << LZ_HASH_LOG);
+   if (!state->scratch || !state->lz_table)
+   {
+      free(state->scratch);
+      free(state->lz_table);
+      state->scratch  = NULL;
+      state->lz_table = NULL;
+      return false;
+   }
+
+   state->maxcompsize = LZ_MAX_SIZE(state->scratch_size) + sizeof(uint32_t);
+   return true;
+}
+
+/* Applies the entry ending at ring offset *head to out, turning
+ * it into the state pushed before it, and moves *head to the start
+ * of the entry. Returns false if the entry is malformed, in which
+ * case out may already be partially patched. */
+static bool state_manager_decompress(state_manager_t *state,
+      size_t *head, uint8_t *out)
+{
+   size_t start, end, size;
+   bool wrapped = *head == sizeof(size_t);
+   const uint8_t *compressed;
+
+   if (*head < sizeof(size_t) || *head > state->capacity)
+      return false;
+
+   /* The entry ends right below head, unless it was the last one 
+    * before the ring wrapped and only its trailer moved down. */
+   start = read_size_t(state->data + *head - sizeof(size_t));
+   end   = wrapped ? state->capacity : *head - sizeof(size_t);
+
+   if (start > end || end - start < sizeof(size_t) ||
+         read_size_t(state->data + start) != *head)
+      return false;
+
+   compressed = state->data + start + sizeof(size_t);
+   size       = end - start - sizeof(size_t);
+
+   if (state->scratch)
+   {
+      uint32_t lz_size;
+
+      if (size < sizeof(lz_size))
+         return false;
+      memcpy(&lz_size, compressed, sizeof(lz_size));
+      if (lz_size > size - sizeof(lz_size) ||
+            (!wrapped && lz_size != size - sizeof(lz_size)))
+         return false;
+
+      RARCH_PERFORMANCE_START(lz_deltas);
+      size = lz_decompress(compressed + sizeof(lz_size), lz_size,
+            state->scratch, state->scratch_size);
+      RARCH_PERFORMANCE_STOP(lz_deltas);
+
+      compressed = state->scratch;
+      wrapped    = false;
+   }
+
+   /* Begin decompression code
+    * out is the last pushed (or returned) state */
+   const uint16_t *compressed16 = (const uint16_t*)compressed;
+   const uint16_t *compressed16_end = compressed16 + size / sizeof(uint16_t);
+   uint16_t *out16 = (uint16_t*)out;
+   uint16_t *out16_end = out16 + state->blocksize / sizeof(uint16_t);
+
+   for (;;)
+   {
+      uint16_t i;
+      uint16_t numchanged;
+
+      /* Every run, and the terminator, is at least three words. */
+      if (compressed16_end - compressed16 < 3)
+         return false;
+
+      numchanged = *(compressed16++);
+      if (numchanged)
+      {
+         if (numchanged > compressed16_end - compressed16 - 1 ||
+               *compressed16 + numchanged > out16_end - out16)
+            return false;
+
+         out16 += *compressed16++;
+
+         /* We could do memcpy, but it seems that memcpy has a 
+          * constant-per-call overhead that actually shows up.
+          *
+          * Our average size in here seems to be 8 or something.
+          * Therefore, we do something with lower overhead. */
+         for (i = 0; i < numchanged; i++)
+            out16[i] = compressed16[i];
+
+         compressed16 += numchanged;
+         out16 += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = compressed16[0] |
+            ((uint32_t)compressed16[1] << 16);
+         if (!numunchanged)
+            break;
+         if (numunchanged > (size_t)(out16_end - out16))
+            return false;
+         compressed16 += 2;
+         out16 += numunchanged;
+      }
+   }
+   /* End decompression code */
+
+   /* The delta has to fill the entry exactly. A raw entry that
+    * wrapped has no known end, only the ring's. */
+   if (!wrapped && compressed16 + 2 != compressed16_end)
+      return false;
+
+   *head = start;
+   return true;
+}
+
+/* Anything behind an entry that won't decode is unreachable,
+ * so the whole history goes. Called inside an update. */
+static void state_manager_discard(state_manager_t *state)
+{
+   unsigned i;
+
+   state->tail            = state->head;
+   state->entries         = 0;
+   state->thisblock_valid = false;
+
+   for (i = 0; i < state->num_keyframes; i++)
+      state->keyframes[i].valid = false;
+}
+
+/* Keyframes newer than the current state describe a future that
+ * is about to be overwritten. */
+static void state_manager_drop_keyframes(state_manager_t *state)
+{
+   unsigned i;
+
+   for (i = 0; i < state->num_keyframes; i++)
+   {
+      if (state->keyframes[i].serial > state->serial)
+         state->keyframes[i].valid = false;
+   }
+}
+
+static void state_manager_capture_keyframe(state_manager_t *state)
+{
+   unsigned i;
+   struct state_keyframe *kf = NULL;
+
+   if (!state->keyframe_interval || state->serial % state->keyframe_interval)
+      return;
+
+   /* Reuse a dropped slot if there is one, otherwise the oldest. */
+   for (i = 0; i < state->num_keyframes; i++)
+   {
+      struct state_keyframe *cur = &state->keyframes[i];
+
+      if (!cur->valid)
+      {
+         kf = cur;
+         break;
+      }
+
+      if (!kf || cur->serial < kf->serial)
+         kf = cur;
+   }
+
+   memcpy(kf->data, state->thisblock, state->blocksize);
+   kf->serial = state->serial;
+   kf->head   = state->head - state->data;
+   kf->valid  = true;
+}
+
+bool state_manager_set_keyframes(state_manager_t *state,
+      unsigned interval, unsigned count)
+{
+   unsigned i;
+
+   state_manager_sync(state);
+
+   if (!interval || !count)
+      return true;
+
+   state->keyframes = (struct state_keyframe*)
+      calloc(count, sizeof(*state->keyframes));
+   if (!state->keyframes)
+      return false;
+
+   state->num_keyframes = count;
+
+   for (i = 0; i < count; i++)
+   {
+      state->keyframes[i].data = (uint8_t*)malloc(state->blocksize);
+      if (!state->keyframes[i].data)
+         return false;
+   }
+
+   state->keyframe_interval = interval;
+   return true;
+}
+
+bool state_manager_pop(state_manager_t *state, const void **data)
+{
+   size_t head;
+
+   *data = NULL;
+
+   state_manager_sync(state);
+
+   if (state->thisblock_valid)
+   {
+      state_manager_begin_update(state);
+      state->thisblock_valid = false;
+      state->entries--;
+      state_manager_end_update(state);
+      *data = state->thisblock;
+      return true;
+   }
+
+   if (state->head == state->tail)
+      return false;
+
+   state_manager_begin_update(state);
+
+   head = state->head - state->data;
+   if (!state_manager_decompress(state, &head, state->thisblock))
+   {
+      state_manager_discard(state);
+      state_manager_end_update(state);
+      return false;
+   }
+
+   state->head = state->data + head;
+   state->serial--;
+   state_manager_drop_keyframes(state);
+
+   state->entries--;
+   state_manager_end_update(state);
+#ifdef HAVE_MMAP
+   if (state->map)
+      state_manager_advise_read(state);
+#endif
+   *data = state->thisblock;
+   return true;
+}
+
+bool state_manager_seek(state_manager_t *state,
+      unsigned frames_back, const void **data)
+{
+   unsigned i;
+   uint64_t target;
+   size_t head;
+   const struct state_keyframe *kf = NULL;
+
+   *data = NULL;
+
+   state_manager_sync(state);
+
+   if (!frames_back || frames_back > state->entries)
+      return false;
+
+   /* The state the frames_back-th pop would have returned. */
+   target = state->serial - frames_back + (state->thisblock_valid ? 1 : 0);
+
+   for (i = 0; i < state->num_keyframes; i++)
+   {
+      const struct state_keyframe *cur = &state->keyframes[i];
+
+      if (!cur->valid || cur->serial < target || cur->serial > state->serial)
+         continue;
+      if (!kf || cur->serial < kf->serial)
+         kf = cur;
+   }
+
+   /* No keyframe in range, or it's further away than just popping. */
+   if (!kf || kf->serial - target >= frames_back)
+   {
+      while (frames_back--)
+      {
+         if (!state_manager_pop(state, data))
+            return false;
+      }
+      return true;
+   }
+
+   RARCH_PERFORMANCE_INIT(rewind_seek);
+   RARCH_PERFORMANCE_START(rewind_seek);
+
+   state_manager_begin_update(state);
+
+   memcpy(state->thisblock, kf->data, state->blocksize);
+   head = kf->head;
+   for (i = 0; i < kf->serial - target; i++)
+   {
+      if (!state_manager_decompress(state, &head, state->thisblock))
+      {
+         state_manager_discard(state);
+         state_manager_end_update(state);
+         RARCH_PERFORMANCE_STOP(rewind_seek);
+         return false;
+      }
+   }
+
+   state->head            = state->data + head;
+   state->serial          = target;
+   state->entries        -= frames_back;
+   state->thisblock_valid = false;
+   state_manager_drop_keyframes(state);
+
+   state_manager_end_update(state);
+#ifdef HAVE_MMAP
+   if (state->map)
+      state_manager_advise_read(state);
+#endif
+
+   RARCH_PERFORMANCE_STOP(rewind_seek);
+
+   *data = state->thisblock;
+   return true;
+}
+
+void state_manager_push_where(state_manager_t *state, void **data)
+{
+   /* We need to ensure we have an uncompressed copy of the last
+    * pushed state, or we could end up applying a 'patch' to wrong 
+    * savestate, and that'd blow up rather quickly. */
+
+   if (!state->thisblock_valid) 
+   {
+      const void *ignored;
+      if (state_manager_pop(state, &ignored))
+      {
+         state_manager_begin_update(state);
+         state->thisblock_valid = true;
+         state->entries++;
+         state_manager_end_update(state);
+      }
+   }
+   
+   *data = state->nextblock;
+}
+
+/* There's no equivalent in libc, you'd think so ...
+ * std::mismatch exists, but it's not optimized at all.
+ *
+ * find_change() returns the index of the first differing uint16,
+ * find_same() the index where the next run of (usually) two or more
+ * identical uint16s begins. Both rely on the sentinels set up in
+ * state_manager_new() to terminate, so the vector versions may read
+ * up to STATE_BLOCK_PADDING bytes past the block. The implementation
+ * is picked at runtime in state_manager_new(). */
+
+static size_t find_change_generic(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+#ifdef NO_UNALIGNED_MEM
+   while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
+   {
       a++;
       b++;
    }
@@ -343,9 +1228,8 @@ static inline size_t find_change(const uint16_t *a, const uint16_t *b)
    }
    return a - a_org;
 }
-#endif
 
-static inline size_t find_same(const uint16_t *a, const uint16_t *b)
+static size_t find_same_generic(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -385,118 +1269,437 @@ static inline size_t find_same(const uint16_t *a, const uint16_t *b)
    return a - a_org;
 }
 
-void state_manager_push_do(state_manager_t *state)
+/* The vector find_same() versions compare the same uint32 words as
+ * the generic one, so all of them produce identical output. */
+static inline size_t find_same_backstep(const uint16_t *a,
+      const uint16_t *b, size_t ret)
 {
-   if (state->thisblock_valid)
-   {
-      if (state->capacity < sizeof(size_t) + state->maxcompsize)
-         return;
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
 
-recheckcapacity:;
+#if __SSE2__
+#if defined(__GNUC__)
+static inline int compat_ctz(unsigned x)
+{
+   return __builtin_ctz(x);
+}
+#else
 
-      size_t headpos = state->head - state->data;
-      size_t tailpos = state->tail - state->data;
-      size_t remaining = (tailpos + state->capacity -
-            sizeof(size_t) - headpos - 1) % state->capacity + 1;
+/* Only checks at nibble granularity, 
+ * because that's what we need. */
 
-      if (remaining <= state->maxcompsize)
+static inline int compat_ctz(unsigned x)
+{
+   if (x & 0x000f)
+      return 0;
+   if (x & 0x00f0)
+      return 4;
+   if (x & 0x0f00)
+      return 8;
+   if (x & 0xf000)
+      return 12;
+   return 16;
+}
+#endif
+
+#include <emmintrin.h>
+
+static size_t find_change_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+	
+   for (;;)
+   {
+      __m128i v0 = _mm_loadu_si128(a128);
+      __m128i v1 = _mm_loadu_si128(b128);
+      __m128i c = _mm_cmpeq_epi32(v0, v1);
+
+      uint32_t mask = _mm_movemask_epi8(c);
+      if (mask != 0xffff) /* Something has changed, figure out where. */
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
-         goto recheckcapacity;
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask))) >> 1;
+			return ret | (a[ret] == b[ret]);
       }
 
-      RARCH_PERFORMANCE_INIT(gen_deltas);
-      RARCH_PERFORMANCE_START(gen_deltas);
+      a128++;
+      b128++;
+   }
+}
 
-      const uint8_t *oldb = state->thisblock;
-      const uint8_t *newb = state->nextblock;
-      uint8_t *compressed = state->head + sizeof(size_t);
+static size_t find_same_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
 
-      /* Begin compression code; 'compressed' will point to 
-       * the end of the compressed data (excluding the prev pointer). */
-      const uint16_t *old16 = (const uint16_t*)oldb;
-      const uint16_t *new16 = (const uint16_t*)newb;
-      uint16_t *compressed16 = (uint16_t*)compressed;
-      size_t num16s = state->blocksize / sizeof(uint16_t);
+   for (;;)
+   {
+      __m128i v0 = _mm_loadu_si128(a128);
+      __m128i v1 = _mm_loadu_si128(b128);
+      __m128i c = _mm_cmpeq_epi32(v0, v1);
 
-      while (num16s)
-      {
-         size_t i;
-         size_t skip = find_change(old16, new16);
+      uint32_t mask = _mm_movemask_epi8(c);
+      if (mask)
+         return find_same_backstep(a, b,
+               (((uint8_t*)a128 - (uint8_t*)a) | compat_ctz(mask)) >> 1);
 
-         if (skip >= num16s)
-            break;
+      a128++;
+      b128++;
+   }
+}
+
+/* AVX2 is built with a function attribute rather than -mavx2, so
+ * the rest of the binary still runs on hosts without it. */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9))
+#define HAVE_REWIND_AVX2
+#include <immintrin.h>
+
+__attribute__((target("avx2")))
+static size_t find_change_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0 = _mm256_loadu_si256(a256);
+      __m256i v1 = _mm256_loadu_si256(b256);
+      __m256i c = _mm256_cmpeq_epi16(v0, v1);
+
+      uint32_t mask = _mm256_movemask_epi8(c);
+      if (mask != 0xffffffff)
+         return (((uint8_t*)a256 - (uint8_t*)a) +
+               __builtin_ctz(~mask)) >> 1;
+
+      a256++;
+      b256++;
+   }
+}
+
+__attribute__((target("avx2")))
+static size_t find_same_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0 = _mm256_loadu_si256(a256);
+      __m256i v1 = _mm256_loadu_si256(b256);
+      __m256i c = _mm256_cmpeq_epi32(v0, v1);
+
+      uint32_t mask = _mm256_movemask_epi8(c);
+      if (mask)
+         return find_same_backstep(a, b,
+               (((uint8_t*)a256 - (uint8_t*)a) + __builtin_ctz(mask)) >> 1);
+
+      a256++;
+      b256++;
+   }
+}
+#endif
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && defined(__GNUC__)
+#define HAVE_REWIND_NEON
+#include <arm_neon.h>
+
+/* No movemask on NEON; narrowing the compare result gives one byte
+ * per uint16 lane (or one uint16 per uint32 lane) in a 64-bit word. */
+
+static size_t find_change_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
 
-         old16 += skip;
-         new16 += skip;
-         num16s -= skip;
+   for (;;)
+   {
+      uint16x8_t c = vceqq_u16(vld1q_u16(a), vld1q_u16(b));
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u8(
+               vshrn_n_u16(c, 4)), 0);
+
+      if (mask != ~UINT64_C(0))
+         return (a - a_org) + (__builtin_ctzll(~mask) >> 3);
+
+      a += 8;
+      b += 8;
+   }
+}
+
+static size_t find_same_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+   const uint16_t *b_org = b;
+
+   for (;;)
+   {
+      uint32x4_t c = vceqq_u32(
+            vreinterpretq_u32_u16(vld1q_u16(a)),
+            vreinterpretq_u32_u16(vld1q_u16(b)));
+      uint64_t mask = vget_lane_u64(vreinterpret_u64_u16(
+               vshrn_n_u32(c, 16)), 0);
+
+      if (mask)
+         return find_same_backstep(a_org, b_org,
+               (a - a_org) + (__builtin_ctzll(mask) >> 3));
+
+      a += 8;
+      b += 8;
+   }
+}
+#endif
+
+static void state_manager_select_scanners(state_manager_t *state)
+{
+   uint64_t cpu = rarch_get_cpu_features();
+
+   state->find_change = find_change_generic;
+   state->find_same   = find_same_generic;
+
+#if __SSE2__
+   if (cpu & RETRO_SIMD_SSE2)
+   {
+      state->find_change = find_change_sse2;
+      state->find_same   = find_same_sse2;
+   }
+#endif
+#ifdef HAVE_REWIND_AVX2
+   if (cpu & RETRO_SIMD_AVX2)
+   {
+      state->find_change = find_change_avx2;
+      state->find_same   = find_same_avx2;
+   }
+#endif
+#ifdef HAVE_REWIND_NEON
+   if (cpu & RETRO_SIMD_NEON)
+   {
+      state->find_change = find_change_neon;
+      state->find_same   = find_same_neon;
+   }
+#endif
+
+   (void)cpu;
+}
+
+/* Compresses *newblock against thisblock into the ring and makes
+ * it the new thisblock. *newblock receives the old thisblock. */
+static void state_manager_commit(state_manager_t *state, uint8_t **newblock)
+{
+   uint8_t *swap;
+
+   if (state->capacity < sizeof(size_t) + state->maxcompsize)
+      return;
+
+   state_manager_begin_update(state);
+
+recheckcapacity:;
+
+   size_t headpos = state->head - state->data;
+   size_t tailpos = state->tail - state->data;
+   size_t remaining = (tailpos + state->capacity -
+         sizeof(size_t) - headpos - 1) % state->capacity + 1;
+
+   if (remaining <= state->maxcompsize)
+   {
+      state->tail = state->data + read_size_t(state->tail);
+      state->entries--;
+      goto recheckcapacity;
+   }
+
+   RARCH_PERFORMANCE_START(gen_deltas);
+
+   const uint8_t *oldb = state->thisblock;
+   const uint8_t *newb = *newblock;
+   uint8_t *compressed = state->scratch ? state->scratch :
+      state->head + sizeof(size_t);
+
+   /* Begin compression code; 'compressed' will point to 
+    * the end of the compressed data (excluding the prev pointer). */
+   const uint16_t *old16 = (const uint16_t*)oldb;
+   const uint16_t *new16 = (const uint16_t*)newb;
+   uint16_t *compressed16 = (uint16_t*)compressed;
+   size_t num16s = state->blocksize / sizeof(uint16_t);
+
+   while (num16s)
+   {
+      size_t i;
+      size_t skip = state->find_change(old16, new16);
+
+      if (skip >= num16s)
+         break;
+
+      old16 += skip;
+      new16 += skip;
+      num16s -= skip;
 
-         if (skip > UINT16_MAX)
+      if (skip > UINT16_MAX)
+      {
+         if (skip > UINT32_MAX)
          {
-            if (skip > UINT32_MAX)
-            {
-               /* This will make it scan the entire thing again, 
-                * but it only hits on 8GB unchanged data anyways,
-                * and if you're doing that, you've got bigger problems. */
-               skip = UINT32_MAX;
-            }
-            *compressed16++ = 0;
-            *compressed16++ = skip;
-            *compressed16++ = skip >> 16;
-            skip = 0;
-            continue;
+            /* This will make it scan the entire thing again, 
+             * but it only hits on 8GB unchanged data anyways,
+             * and if you're doing that, you've got bigger problems. */
+            skip = UINT32_MAX;
          }
+         *compressed16++ = 0;
+         *compressed16++ = skip;
+         *compressed16++ = skip >> 16;
+         skip = 0;
+         continue;
+      }
 
-         size_t changed = find_same(old16, new16);
-         if (changed > UINT16_MAX)
-            changed = UINT16_MAX;
+      size_t changed = state->find_same(old16, new16);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
 
-         *compressed16++ = changed;
-         *compressed16++ = skip;
+      *compressed16++ = changed;
+      *compressed16++ = skip;
 
-         for (i = 0; i < changed; i++)
-            compressed16[i] = old16[i];
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[i];
 
-         old16 += changed;
-         new16 += changed;
-         num16s -= changed;
-         compressed16 += changed;
-      }
+      old16 += changed;
+      new16 += changed;
+      num16s -= changed;
+      compressed16 += changed;
+   }
+
+   compressed16[0] = 0;
+   compressed16[1] = 0;
+   compressed16[2] = 0;
+   compressed = (uint8_t*)(compressed16 + 3);
+   /* End compression code. */
 
-      compressed16[0] = 0;
-      compressed16[1] = 0;
-      compressed16[2] = 0;
-      compressed = (uint8_t*)(compressed16 + 3);
-      /* End compression code. */
+   RARCH_PERFORMANCE_STOP(gen_deltas);
 
-      if (compressed - state->data + state->maxcompsize > state->capacity)
+   if (state->scratch)
+   {
+      uint32_t lz_size;
+      uint8_t *lz_out = state->head + sizeof(size_t);
+
+      RARCH_PERFORMANCE_START(lz_deltas);
+      lz_size = lz_compress(state->lz_table, state->scratch,
+            compressed - state->scratch, lz_out + sizeof(lz_size));
+      RARCH_PERFORMANCE_STOP(lz_deltas);
+
+      memcpy(lz_out, &lz_size, sizeof(lz_size));
+      compressed = lz_out + sizeof(lz_size) + lz_size;
+   }
+
+   if (compressed - state->data + state->maxcompsize > state->capacity)
+   {
+      compressed = state->data;
+      if (state->tail == state->data + sizeof(size_t))
       {
-         compressed = state->data;
-         if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+         state->tail = state->data + read_size_t(state->tail);
+         state->entries--;
       }
-      write_size_t(compressed, state->head-state->data);
-      compressed += sizeof(size_t);
-      write_size_t(state->head, compressed-state->data);
-      state->head = compressed;
+   }
+   write_size_t(compressed, state->head-state->data);
+   compressed += sizeof(size_t);
+   write_size_t(state->head, compressed-state->data);
+   state->head = compressed;
+
+   swap = state->thisblock;
+   state->thisblock = *newblock;
+   *newblock = swap;
+
+   state->entries++;
+   state->serial++;
+   state_manager_capture_keyframe(state);
+
+   state_manager_end_update(state);
+#ifdef HAVE_MMAP
+   if (state->map)
+      state_manager_advise_write(state);
+#endif
+}
+
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->lock);
+
+   for (;;)
+   {
+      while (!state->busy && !state->quit)
+         scond_wait(state->cond, state->lock);
+
+      /* Finish a pending push before quitting,
+       * a file-backed ring would lose it otherwise. */
+      if (!state->busy)
+         break;
+
+      slock_unlock(state->lock);
+      state_manager_commit(state, &state->pending);
+      slock_lock(state->lock);
 
-      RARCH_PERFORMANCE_STOP(gen_deltas);
+      state->busy = false;
+      scond_signal(state->cond);
    }
-   else
-      state->thisblock_valid = true;
+
+   slock_unlock(state->lock);
+}
+#endif
+
+void state_manager_push_do(state_manager_t *state)
+{
+   if (state->thisblock_valid)
+   {
+#ifdef HAVE_THREADS
+      if (state->thread)
+      {
+         uint8_t *swap;
+
+         RARCH_PERFORMANCE_INIT(rewind_handoff);
+         RARCH_PERFORMANCE_START(rewind_handoff);
+
+         /* Only blocks if the previous state is still being
+          * compressed, i.e. compression takes longer than
+          * rewind_granularity frames. */
+         slock_lock(state->lock);
+         while (state->busy)
+            scond_wait(state->cond, state->lock);
+
+         swap = state->pending;
+         state->pending = state->nextblock;
+         state->nextblock = swap;
+
+         state->busy = true;
+         scond_signal(state->cond);
+         slock_unlock(state->lock);
+
+         RARCH_PERFORMANCE_STOP(rewind_handoff);
+         return;
+      }
+#endif
+      state_manager_commit(state, &state->nextblock);
+      return;
+   }
+
+   state_manager_begin_update(state);
 
    uint8_t *swap = state->thisblock;
    state->thisblock = state->nextblock;
    state->nextblock = swap;
 
+   state->thisblock_valid = true;
    state->entries++;
-   return;
+   state->serial++;
+   state_manager_capture_keyframe(state);
+
+   state_manager_end_update(state);
 }
 
 void state_manager_capacity(state_manager_t *state,
       unsigned *entries, size_t *bytes, bool *full)
 {
+   state_manager_sync(state);
+
    size_t headpos = state->head - state->data;
    size_t tailpos = state->tail - state->data;
    size_t remaining = (tailpos + state->capacity -
@@ -23,10 +23,39 @@ typedef struct state_manager state_manager_t;
 
 state_manager_t *state_manager_new(size_t state_size, size_t buffer_size);
 
+#ifdef HAVE_MMAP
+/* Keeps the ring in a memory-mapped sparse file at path instead of
+ * RAM. If path holds the buffer of a previous run with the same
+ * state size, buffer size and lz setting, its history is picked up
+ * again. lz is as state_manager_enable_lz(). */
+state_manager_t *state_manager_new_file(size_t state_size,
+      size_t buffer_size, const char *path, bool lz);
+#endif
+
 void state_manager_free(state_manager_t *state);
 
+#ifdef HAVE_THREADS
+/* Moves delta compression in state_manager_push_do() onto a
+ * worker thread. Pop and capacity queries wait for it. */
+bool state_manager_start_thread(state_manager_t *state);
+#endif
+
+/* Runs every delta through an additional LZ pass, trading CPU time
+ * for rewind depth. Must be called before the first push. */
+bool state_manager_enable_lz(state_manager_t *state);
+
+/* Keeps a full copy of every interval-th pushed state in one of
+ * count slots, so state_manager_seek() never has to apply more than
+ * interval deltas. */
+bool state_manager_set_keyframes(state_manager_t *state,
+      unsigned interval, unsigned count);
+
 bool state_manager_pop(state_manager_t *state, const void **data);
 
+/* Same as calling state_manager_pop() frames_back times. */
+bool state_manager_seek(state_manager_t *state,
+      unsigned frames_back, const void **data);
+
 void state_manager_push_where(state_manager_t *state, void **data);
 
 void state_manager_push_do(state_manager_t *state);
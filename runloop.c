@@ -204,7 +204,10 @@ static void check_rewind(bool pressed)
          pretro_serialize(state, g_extern.state_size);
          RARCH_PERFORMANCE_STOP(rewind_serialize);
 
+         RARCH_PERFORMANCE_INIT(rewind_push);
+         RARCH_PERFORMANCE_START(rewind_push);
          state_manager_push_do(g_extern.state_manager);
+         RARCH_PERFORMANCE_STOP(rewind_push);
       }
    }
 
@@ -424,6 +427,9 @@ static int do_state_checks(
 
    check_rewind_func(input);
 
+   if (BIT64_GET(trigger_input, RARCH_REWIND_SCRUB))
+      rarch_main_command(RARCH_CMD_REWIND_SCRUB);
+
    check_slowmotion_func(input);
 
   // if (BIT64_GET(trigger_input, RARCH_MOVIE_RECORD_TOGGLE))
@@ -641,6 +647,84 @@ static bool input_flush(retro_input_t *input)
    return true;
 }
 
+static bool runahead_available(void)
+{
+   if (!g_settings.run_ahead_frames || !g_extern.runahead.state)
+      return false;
+   if (g_extern.frame_is_reverse || driver.nonblock_state)
+      return false;
+   if (g_extern.bsv.movie || driver.recording_data)
+      return false;
+#ifdef HAVE_NETPLAY
+   if (driver.netplay_data)
+      return false;
+#endif
+   return true;
+}
+
+/*
+ * Runs the real frame with its video hidden and snapshots the core.
+ * The next run_ahead_frames frames then run with audio hidden, only
+ * the last of them is shown, and the core is rolled back to the
+ * snapshot. Input that the game would only react to N frames later
+ * is visible on screen right away.
+ *
+ * The snapshot goes into the arena allocated by RARCH_CMD_RUNAHEAD_INIT,
+ * so nothing is allocated per frame.
+ */
+
+static void run_ahead(void)
+{
+   unsigned i;
+   void *state = g_extern.runahead.state;
+   size_t state_size = g_extern.runahead.state_size;
+
+   RARCH_PERFORMANCE_INIT(runahead_frame);
+   RARCH_PERFORMANCE_INIT(runahead_serialize);
+   RARCH_PERFORMANCE_INIT(runahead_unserialize);
+   RARCH_PERFORMANCE_START(runahead_frame);
+
+   retro_set_runahead_callbacks(RETRO_RUNAHEAD_HIDE_VIDEO);
+   pretro_run();
+
+   RARCH_PERFORMANCE_START(runahead_serialize);
+   if (!pretro_serialize(state, state_size))
+   {
+      RARCH_PERFORMANCE_STOP(runahead_serialize);
+      RARCH_WARN("Core failed to serialize, disabling run-ahead.\n");
+      retro_set_runahead_callbacks(0);
+      rarch_main_command(RARCH_CMD_RUNAHEAD_DEINIT);
+      /* The real frame went to the hidden callback, show it now. */
+      rarch_render_cached_frame();
+      RARCH_PERFORMANCE_STOP(runahead_frame);
+      return;
+   }
+   RARCH_PERFORMANCE_STOP(runahead_serialize);
+
+   retro_set_runahead_callbacks(RETRO_RUNAHEAD_HIDE_VIDEO |
+         RETRO_RUNAHEAD_HIDE_AUDIO | RETRO_RUNAHEAD_HIDE_POLL);
+   for (i = 1; i < g_settings.run_ahead_frames; i++)
+      pretro_run();
+
+   retro_set_runahead_callbacks(RETRO_RUNAHEAD_HIDE_AUDIO |
+         RETRO_RUNAHEAD_HIDE_POLL);
+   pretro_run();
+   retro_set_runahead_callbacks(0);
+
+   RARCH_PERFORMANCE_START(runahead_unserialize);
+   if (!pretro_unserialize(state, state_size))
+   {
+      RARCH_PERFORMANCE_STOP(runahead_unserialize);
+      RARCH_WARN("Core failed to unserialize, disabling run-ahead.\n");
+      rarch_main_command(RARCH_CMD_RUNAHEAD_DEINIT);
+      RARCH_PERFORMANCE_STOP(runahead_frame);
+      return;
+   }
+   RARCH_PERFORMANCE_STOP(runahead_unserialize);
+
+   RARCH_PERFORMANCE_STOP(runahead_frame);
+}
+
 /*
  * RetroArch's main iteration loop.
  *
@@ -734,7 +818,11 @@ int rarch_main_iterate(void)
 
 
    /* Run libretro for one frame. */
-   pretro_run();
+   if (runahead_available())
+      run_ahead();
+   else
+      pretro_run();
+   retro_flush_audio_frame();
    /* Optionally boot to the menu when loading states. */
    if ((g_settings.autoload_safe && g_settings.stateload_pause && g_settings.savestate_auto_load) ||
           (g_settings.regular_load_safe && g_settings.regular_state_pause)) {
@@ -23,6 +23,11 @@
 #include "general.h"
 #include <file/file_path.h>
 #include "gfx/scaler/scaler.h"
+#include "screenshot.h"
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #ifdef HAVE_CONFIG_H
 #include "config.h"
@@ -104,7 +109,7 @@ static void dump_line_32(uint8_t *line, const uint32_t *src, unsigned width)
 }
 
 static void dump_content(FILE *file, const void *frame,
-      int width, int height, int pitch, bool bgr24)
+      int width, int height, int pitch, enum scaler_pix_fmt fmt)
 {
    int i, j;
    union
@@ -128,12 +133,12 @@ static void dump_content(FILE *file, const void *frame,
          goto end;
    }
 
-   if (bgr24) /* BGR24 byte order. Can directly copy. */
+   if (fmt == SCALER_FMT_BGR24) /* BGR24 byte order. Can directly copy. */
    {
       for (j = 0; j < height; j++, u.u8 += pitch)
          dump_line_bgr(lines[j], u.u8, width);
    }
-   else if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+   else if (fmt == SCALER_FMT_ARGB8888)
    {
       for (j = 0; j < height; j++, u.u8 += pitch)
          dump_line_32(lines[j], u.u32, width);
@@ -153,48 +158,29 @@ end:
 }
 #endif
 
-/* Take frame bottom-up. */
-bool screenshot_dump(const char *folder, const void *frame,
-      unsigned width, unsigned height, int pitch, bool bgr24)
+static enum scaler_pix_fmt screenshot_pix_fmt(bool bgr24)
 {
-   char filename[PATH_MAX];
-   char shotname[PATH_MAX];
-
-#ifdef HAVE_ZLIB_DEFLATE
-#define IMG_EXT "png"
-#else
-#define IMG_EXT "bmp"
-#endif
-
-   fill_dated_filename(shotname, IMG_EXT, sizeof(shotname));
-   fill_pathname_join(filename, folder, shotname, sizeof(filename));
+   if (bgr24)
+      return SCALER_FMT_BGR24;
+   else if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
+      return SCALER_FMT_ARGB8888;
+   return SCALER_FMT_RGB565;
+}
 
+/* Doesn't touch any global state, so the worker can use it. */
+static bool screenshot_dump_file(const char *filename, const void *frame,
+      unsigned width, unsigned height, int pitch, enum scaler_pix_fmt fmt)
+{
 #ifdef HAVE_ZLIB_DEFLATE
-   uint8_t *out_buffer = (uint8_t*)malloc(width * height * 3);
+   scaler_pixconv_t conv = scaler_get_pixconv(fmt, SCALER_FMT_BGR24);
+   uint8_t *out_buffer   = (uint8_t*)malloc(width * height * 3);
    if (!out_buffer)
       return false;
 
-   struct scaler_ctx scaler = {0};
-   scaler.in_width   = width;
-   scaler.in_height  = height;
-   scaler.out_width  = width;
-   scaler.out_height = height;
-   scaler.in_stride  = -pitch;
-   scaler.out_stride = width * 3;
-   scaler.out_fmt = SCALER_FMT_BGR24;
-   scaler.scaler_type = SCALER_TYPE_POINT;
-
-   if (bgr24)
-      scaler.in_fmt = SCALER_FMT_BGR24;
-   else if (g_extern.system.pix_fmt == RETRO_PIXEL_FORMAT_XRGB8888)
-      scaler.in_fmt = SCALER_FMT_ARGB8888;
-   else
-      scaler.in_fmt = SCALER_FMT_RGB565;
-
-   scaler_ctx_gen_filter(&scaler);
-   scaler_ctx_scale(&scaler, out_buffer,
-         (const uint8_t*)frame + ((int)height - 1) * pitch);
-   scaler_ctx_gen_reset(&scaler);
+   /* frame is bottom-up, converting with a negative stride
+    * flips it into packed top-down BGR24 in the same pass. */
+   conv(out_buffer, (const uint8_t*)frame + ((int)height - 1) * pitch,
+         width, height, width * 3, -pitch);
 
    RARCH_LOG("Using RPNG for PNG screenshots.\n");
    bool ret = rpng_save_image_bgr24(filename,
@@ -214,7 +200,7 @@ bool screenshot_dump(const char *folder, const void *frame,
    bool ret = write_header_bmp(file, width, height);
 
    if (ret)
-      dump_content(file, frame, width, height, pitch, bgr24);
+      dump_content(file, frame, width, height, pitch, fmt);
    else
       RARCH_ERR("Failed to write image header.\n");
 
@@ -223,3 +209,179 @@ bool screenshot_dump(const char *folder, const void *frame,
 #endif
 }
 
+static void screenshot_filename(char *filename, size_t size,
+      const char *folder)
+{
+   char shotname[PATH_MAX];
+
+#ifdef HAVE_ZLIB_DEFLATE
+#define IMG_EXT "png"
+#else
+#define IMG_EXT "bmp"
+#endif
+
+   fill_dated_filename(shotname, IMG_EXT, sizeof(shotname));
+   fill_pathname_join(filename, folder, shotname, size);
+}
+
+/* Take frame bottom-up. */
+bool screenshot_dump(const char *folder, const void *frame,
+      unsigned width, unsigned height, int pitch, bool bgr24)
+{
+   char filename[PATH_MAX];
+
+   screenshot_filename(filename, sizeof(filename), folder);
+   return screenshot_dump_file(filename, frame, width, height, pitch,
+         screenshot_pix_fmt(bgr24));
+}
+
+#ifdef HAVE_THREADS
+struct screenshot_job
+{
+   char filename[PATH_MAX];
+   uint8_t *frame; /* Top-down copy, pitch bytes per line. */
+   size_t pitch;
+   unsigned width;
+   unsigned height;
+   enum scaler_pix_fmt fmt;
+};
+
+/* Only the emulation thread queues jobs, so it can fill in the
+ * slot after head + count without the lock. The worker only ever
+ * takes jobs from head. */
+static struct
+{
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool alive;
+
+   struct screenshot_job jobs[SCREENSHOT_QUEUE_SIZE];
+   unsigned head;
+   unsigned count; /* Includes the job being encoded. */
+} screenshot_worker;
+
+static void screenshot_worker_loop(void *data)
+{
+   (void)data;
+
+   for (;;)
+   {
+      struct screenshot_job *job = NULL;
+
+      slock_lock(screenshot_worker.lock);
+      while (screenshot_worker.alive && !screenshot_worker.count)
+         scond_wait(screenshot_worker.cond, screenshot_worker.lock);
+
+      /* Whatever is still queued gets written before we quit. */
+      if (!screenshot_worker.count)
+      {
+         slock_unlock(screenshot_worker.lock);
+         break;
+      }
+      job = &screenshot_worker.jobs[screenshot_worker.head];
+      slock_unlock(screenshot_worker.lock);
+
+      screenshot_dump_file(job->filename,
+            job->frame + (job->height - 1) * job->pitch,
+            job->width, job->height, -(int)job->pitch, job->fmt);
+      free(job->frame);
+      job->frame = NULL;
+
+      slock_lock(screenshot_worker.lock);
+      screenshot_worker.head = (screenshot_worker.head + 1)
+         % SCREENSHOT_QUEUE_SIZE;
+      screenshot_worker.count--;
+      slock_unlock(screenshot_worker.lock);
+   }
+}
+
+static bool screenshot_worker_init(void)
+{
+   screenshot_worker.lock  = slock_new();
+   screenshot_worker.cond  = scond_new();
+   screenshot_worker.alive = true;
+
+   if (screenshot_worker.lock && screenshot_worker.cond)
+      screenshot_worker.thread = sthread_create(
+            screenshot_worker_loop, NULL);
+
+   if (!screenshot_worker.thread)
+   {
+      RARCH_WARN("Failed to start screenshot thread, "
+            "taking screenshots synchronously.\n");
+      screenshot_deinit();
+      return false;
+   }
+
+   return true;
+}
+
+void screenshot_deinit(void)
+{
+   if (screenshot_worker.thread)
+   {
+      slock_lock(screenshot_worker.lock);
+      screenshot_worker.alive = false;
+      scond_signal(screenshot_worker.cond);
+      slock_unlock(screenshot_worker.lock);
+
+      sthread_join(screenshot_worker.thread);
+   }
+
+   if (screenshot_worker.lock)
+      slock_free(screenshot_worker.lock);
+   if (screenshot_worker.cond)
+      scond_free(screenshot_worker.cond);
+
+   memset(&screenshot_worker, 0, sizeof(screenshot_worker));
+}
+
+bool screenshot_dump_async(const char *folder, const void *frame,
+      unsigned width, unsigned height, int pitch, bool bgr24)
+{
+   unsigned i, slot;
+   struct screenshot_job *job = NULL;
+   enum scaler_pix_fmt fmt    = screenshot_pix_fmt(bgr24);
+   size_t line_size           = width * (fmt == SCALER_FMT_BGR24 ? 3 :
+         fmt == SCALER_FMT_ARGB8888 ? 4 : 2);
+   /* frame points at the bottom line, walk it top-down. */
+   const uint8_t *src         = (const uint8_t*)frame +
+      ((int)height - 1) * pitch;
+
+   if (!screenshot_worker.thread && !screenshot_worker_init())
+      return screenshot_dump(folder, frame, width, height, pitch, bgr24);
+
+   slock_lock(screenshot_worker.lock);
+   slot = (screenshot_worker.head + screenshot_worker.count)
+      % SCREENSHOT_QUEUE_SIZE;
+   if (screenshot_worker.count == SCREENSHOT_QUEUE_SIZE)
+   {
+      slock_unlock(screenshot_worker.lock);
+      RARCH_WARN("Still writing out earlier screenshots, "
+            "dropping this one.\n");
+      return false;
+   }
+   slock_unlock(screenshot_worker.lock);
+
+   job = &screenshot_worker.jobs[slot];
+   if (!(job->frame = (uint8_t*)malloc(line_size * height)))
+      return false;
+
+   for (i = 0; i < height; i++, src -= pitch)
+      memcpy(job->frame + i * line_size, src, line_size);
+
+   screenshot_filename(job->filename, sizeof(job->filename), folder);
+   job->pitch  = line_size;
+   job->width  = width;
+   job->height = height;
+   job->fmt    = fmt;
+
+   slock_lock(screenshot_worker.lock);
+   screenshot_worker.count++;
+   scond_signal(screenshot_worker.cond);
+   slock_unlock(screenshot_worker.lock);
+
+   return true;
+}
+#endif
@@ -25,4 +25,19 @@ bool screenshot_dump(const char *folder, const void *frame,
 
 void screenshot_generate_filename(char *filename, size_t size);
 
+#ifdef HAVE_THREADS
+/* Most screenshots waiting for screenshot_dump_async()'s worker. */
+#define SCREENSHOT_QUEUE_SIZE 4
+
+/* Same as screenshot_dump(), but only copies the frame and leaves
+ * conversion, encoding and writing the file to a worker thread.
+ * Fails if SCREENSHOT_QUEUE_SIZE screenshots are still pending. */
+bool screenshot_dump_async(const char *folder, const void *frame,
+      unsigned width, unsigned height, int pitch, bool bgr24);
+
+/* Waits for pending screenshots to be written out and stops
+ * the worker. It gets started again on demand. */
+void screenshot_deinit(void);
+#endif
+
 #endif
@@ -291,11 +291,13 @@ static void config_set_defaults(void)
       g_settings.video.refresh_rate = g_defaults.settings.video_refresh_rate;
 
    g_settings.video.post_filter_record = post_filter_record;
+   g_settings.video.filter_threads = video_filter_threads;
    g_settings.video.gpu_record = gpu_record;
    //g_settings.video.gpu_screenshot = gpu_screenshot;
    g_settings.video.rotation = ORIENTATION_NORMAL;
 
    g_settings.audio.sinc_taps = sinc_taps;
+   *g_settings.audio.resampler_quality = '\0';
    g_settings.audio.enable = audio_enable;
    //g_settings.audio.mute_frames = mute_frames;
    g_settings.audio.out_rate = out_rate;
@@ -312,12 +314,22 @@ static void config_set_defaults(void)
    g_settings.audio.sync = audio_sync;
    g_settings.audio.rate_control = rate_control;
    g_settings.audio.rate_control_delta = rate_control_delta;
+   g_settings.audio.rate_control_pi = rate_control_pi;
+   g_settings.audio.frame_batch = audio_frame_batch;
+   g_settings.audio.dsp_thread = audio_dsp_thread;
    g_settings.audio.volume = audio_volume;
    g_extern.audio_data.volume_gain = db_to_gain(g_settings.audio.volume);
 
    g_settings.rewind_enable = rewind_enable;
    g_settings.rewind_buffer_size = rewind_buffer_size;
    g_settings.rewind_granularity = rewind_granularity;
+   g_settings.rewind_threaded = rewind_threaded;
+   g_settings.rewind_lz = rewind_lz;
+   g_settings.rewind_file_backed = rewind_file_backed;
+   g_settings.rewind_keyframe_interval = rewind_keyframe_interval;
+   g_settings.rewind_keyframes = rewind_keyframes;
+   g_settings.rewind_scrub_seconds = rewind_scrub_seconds;
+   g_settings.run_ahead_frames = run_ahead_frames;
    g_settings.slowmotion_ratio = slowmotion_ratio;
    g_settings.fastforward_ratio = fastforward_ratio;
    g_settings.fastforward_ratio_throttle_enable = fastforward_ratio_throttle_enable;
@@ -1021,8 +1033,12 @@ static bool config_load_file(const char *path, bool set_defaults)
    CONFIG_GET_BOOL(audio.sync, "audio_sync");
    CONFIG_GET_BOOL(audio.rate_control, "audio_rate_control");
    CONFIG_GET_FLOAT(audio.rate_control_delta, "audio_rate_control_delta");
+   CONFIG_GET_BOOL(audio.rate_control_pi, "audio_rate_control_pi");
+   CONFIG_GET_BOOL(audio.frame_batch, "audio_frame_batch");
+   CONFIG_GET_BOOL(audio.dsp_thread, "audio_dsp_thread");
    CONFIG_GET_FLOAT(audio.volume, "audio_volume");
    CONFIG_GET_STRING(audio.resampler, "audio_resampler");
+   CONFIG_GET_STRING(audio.resampler_quality, "audio_resampler_quality");
    CONFIG_GET_INT(audio.sinc_taps, "audio_sinc_taps");
   // CONFIG_GET_INT(audio.mute_frames, "audio_mute_frames");
    g_extern.audio_data.volume_gain = db_to_gain(g_settings.audio.volume);
@@ -1038,6 +1054,9 @@ static bool config_load_file(const char *path, bool set_defaults)
   // CONFIG_GET_STRING(video.context_driver, "video_context_driver");
    CONFIG_GET_STRING(audio.driver, "audio_driver");
    CONFIG_GET_PATH(video.softfilter_plugin, "video_filter");
+   CONFIG_GET_INT(video.filter_threads, "video_filter_threads");
+   if (g_settings.video.filter_threads > 32)
+      g_settings.video.filter_threads = 32;
    CONFIG_GET_PATH(audio.dsp_plugin, "audio_dsp_plugin");
    CONFIG_GET_STRING(input.driver, "input_driver");
    CONFIG_GET_STRING(input.joypad_driver, "input_joypad_driver");
@@ -1125,6 +1144,15 @@ static bool config_load_file(const char *path, bool set_defaults)
       g_settings.rewind_buffer_size = buffer_size * UINT64_C(1000000);
 
    CONFIG_GET_INT(rewind_granularity, "rewind_granularity");
+   CONFIG_GET_BOOL(rewind_threaded, "rewind_threaded");
+   CONFIG_GET_BOOL(rewind_lz, "rewind_lz");
+   CONFIG_GET_BOOL(rewind_file_backed, "rewind_file_backed");
+   CONFIG_GET_INT(rewind_keyframe_interval, "rewind_keyframe_interval");
+   CONFIG_GET_INT(rewind_keyframes, "rewind_keyframes");
+   CONFIG_GET_INT(rewind_scrub_seconds, "rewind_scrub_seconds");
+   CONFIG_GET_INT(run_ahead_frames, "run_ahead_frames");
+   if (g_settings.run_ahead_frames > 4)
+      g_settings.run_ahead_frames = 4;
    CONFIG_GET_FLOAT(slowmotion_ratio, "slowmotion_ratio");
    if (g_settings.slowmotion_ratio < 1.0f)
       g_settings.slowmotion_ratio = 1.0f;
@@ -1636,6 +1664,15 @@ bool config_save_file(const char *path)
    config_set_bool(conf,  "audio_sync",    g_settings.audio.sync);
   // config_set_int(conf,   "audio_block_frames", g_settings.audio.block_frames);
    config_set_int(conf,   "rewind_granularity", g_settings.rewind_granularity);
+   config_set_bool(conf,  "rewind_threaded", g_settings.rewind_threaded);
+   config_set_bool(conf,  "rewind_lz", g_settings.rewind_lz);
+   config_set_bool(conf,  "rewind_file_backed", g_settings.rewind_file_backed);
+   config_set_int(conf,   "rewind_keyframe_interval",
+         g_settings.rewind_keyframe_interval);
+   config_set_int(conf,   "rewind_keyframes", g_settings.rewind_keyframes);
+   config_set_int(conf,   "rewind_scrub_seconds",
+         g_settings.rewind_scrub_seconds);
+   config_set_int(conf,   "run_ahead_frames", g_settings.run_ahead_frames);
   // config_set_path(conf,  "video_shader", g_settings.video.shader_path);
    //config_set_bool(conf,  "video_shader_enable",
      //    g_settings.video.shader_enable);
@@ -1703,12 +1740,18 @@ bool config_save_file(const char *path)
          g_settings.screenshot_directory : "default");
   // config_set_string(conf, "audio_device", g_settings.audio.device);
    config_set_string(conf, "video_filter", g_settings.video.softfilter_plugin);
+   config_set_int(conf,   "video_filter_threads",
+         g_settings.video.filter_threads);
    config_set_string(conf, "audio_dsp_plugin", g_settings.audio.dsp_plugin);
   // config_set_string(conf, "camera_device", g_settings.camera.device);
   // config_set_bool(conf, "camera_allow", g_settings.camera.allow);
    config_set_bool(conf, "audio_rate_control", g_settings.audio.rate_control);
    config_set_float(conf, "audio_rate_control_delta",
          g_settings.audio.rate_control_delta);
+   config_set_bool(conf, "audio_rate_control_pi",
+         g_settings.audio.rate_control_pi);
+   config_set_bool(conf, "audio_frame_batch", g_settings.audio.frame_batch);
+   config_set_bool(conf, "audio_dsp_thread", g_settings.audio.dsp_thread);
    config_set_float(conf, "audio_volume", g_settings.audio.volume);
   // config_set_string(conf, "video_context_driver", g_settings.video.context_driver);
    config_set_string(conf, "audio_driver", g_settings.audio.driver);
@@ -1728,6 +1771,8 @@ bool config_save_file(const char *path)
   // config_set_path(conf, "resampler_directory",
     //     g_settings.resampler_directory);
    config_set_string(conf, "audio_resampler", g_settings.audio.resampler);
+   config_set_string(conf, "audio_resampler_quality",
+         g_settings.audio.resampler_quality);
    config_set_int(conf, "audio_sinc_taps", g_settings.audio.sinc_taps);
    //config_set_int(conf, "audio_mute_frames", g_settings.audio.mute_frames);
    config_set_path(conf, "savefile_directory",
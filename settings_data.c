@@ -1745,6 +1745,18 @@ int setting_data_get_description(const char *label, char *msg,
             " \n"
             "Maximum is 15.");
    }
+   else if (!strcmp(label, "run_ahead_frames"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Runs the core this many frames\n"
+            "ahead and rolls back afterwards.\n"
+            "\n"
+            "Removes input lag built into the game,\n"
+            "but the core runs N + 1 times a frame.\n"
+            "Needs save state support.\n"
+            " \n"
+            "Maximum is 4.");
+   }
    else if (!strcmp(label, "audio_rate_control_delta"))
    {
       snprintf(msg, sizeof_msg,
@@ -2360,6 +2372,12 @@ int setting_data_get_description(const char *label, char *msg,
             " -- Hold button down to rewind.\n"
             " \n"
             "Rewind must be enabled.");*/
+   else if (!strcmp(label, "rewind_scrub"))
+      snprintf(msg, sizeof_msg,
+            " -- Jumps back a few seconds at once.\n"
+            " \n"
+            "Rewind must be enabled. The distance\n"
+            "is set by rewind_scrub_seconds.");
    else if (!strcmp(label, "load_state"))
       snprintf(msg, sizeof_msg,
             " -- Loads state.");
@@ -4636,6 +4654,19 @@ static bool setting_data_append_list_video_options(
          general_write_handler,
          general_read_handler);
    settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
+
+   CONFIG_UINT(
+         g_settings.run_ahead_frames,
+         "run_ahead_frames",
+         "Run-Ahead Frames",
+         run_ahead_frames,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 4, 1, true, true);
+   settings_list_current_add_cmd(list, list_info, RARCH_CMD_RUNAHEAD_INIT);
+   settings_data_list_current_add_flags(list, list_info, SD_FLAG_CMD_APPLY_AUTO);
 /*
 #if !defined(RARCH_MOBILE)
    CONFIG_BOOL(
@@ -4930,7 +4961,7 @@ static bool setting_data_append_list_audio_options(
          subgroup_info.name,
          general_write_handler,
          general_read_handler);
-	settings_list_current_add_range(list, list_info, 2, 256, 2, true, true);
+	settings_list_current_add_range(list, list_info, 0, 256, 2, true, true);
 
    CONFIG_BOOL(
          g_extern.audio_data.mute,
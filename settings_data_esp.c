@@ -1784,6 +1784,18 @@ int setting_data_get_description(const char *label, char *msg,
             " \n"
             "El max es 15.");
    }
+   else if (!strcmp(label, "run_ahead_frames"))
+   {
+      snprintf(msg, sizeof_msg,
+            " -- Corre el nucleo estos frames\n"
+            "por adelantado y luego vuelve atras.\n"
+            "\n"
+            "Quita el retraso de control del juego,\n"
+            "pero el nucleo corre N + 1 veces por frame.\n"
+            "Requiere soporte de estados.\n"
+            " \n"
+            "El max es 4.");
+   }
    else if (!strcmp(label, "audio_rate_control_delta"))
    {
       snprintf(msg, sizeof_msg,
@@ -2357,6 +2369,12 @@ int setting_data_get_description(const char *label, char *msg,
             " -- Hold button down to rewind.\n"
             " \n"
             "Rewind must be enabled.");*/
+   else if (!strcmp(label, "rewind_scrub"))
+      snprintf(msg, sizeof_msg,
+            " -- Retrocede varios segundos de golpe.\n"
+            " \n"
+            "Requiere rebobinado activado. La\n"
+            "distancia se ajusta con rewind_scrub_seconds.");
  /*  else if (!strcmp(label, "load_state"))
       snprintf(msg, sizeof_msg,
             " -- Loads state.");
@@ -4570,6 +4588,19 @@ static bool setting_data_append_list_video_options(
          general_write_handler,
          general_read_handler);
    settings_list_current_add_range(list, list_info, 0, 15, 1, true, true);
+
+   CONFIG_UINT(
+         g_settings.run_ahead_frames,
+         "run_ahead_frames",
+         "Frames de adelanto",
+         run_ahead_frames,
+         group_info.name,
+         subgroup_info.name,
+         general_write_handler,
+         general_read_handler);
+   settings_list_current_add_range(list, list_info, 0, 4, 1, true, true);
+   settings_list_current_add_cmd(list, list_info, RARCH_CMD_RUNAHEAD_INIT);
+   settings_data_list_current_add_flags(list, list_info, SD_FLAG_CMD_APPLY_AUTO);
 /*
 #if !defined(RARCH_MOBILE)
    CONFIG_BOOL(
@@ -4864,7 +4895,7 @@ static bool setting_data_append_list_audio_options(
          subgroup_info.name,
          general_write_handler,
          general_read_handler);
-	settings_list_current_add_range(list, list_info, 2, 256, 2, true, true);
+	settings_list_current_add_range(list, list_info, 0, 256, 2, true, true);
 
    CONFIG_BOOL(
          g_extern.audio_data.mute,
@@ -0,0 +1,168 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2014 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "spsc_buffer.h"
+
+#if defined(_XBOX)
+#include <xtl.h>
+#elif defined(_MSC_VER)
+#include <windows.h>
+#endif
+
+/* The consumer must see the data before the new head, and the
+ * producer must be done reading the old tail before it overwrites
+ * what was behind it. Acquire loads and release stores are enough. */
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7))
+#define spsc_load_acquire(ptr)       __atomic_load_n(ptr, __ATOMIC_ACQUIRE)
+#define spsc_store_release(ptr, val) __atomic_store_n(ptr, val, __ATOMIC_RELEASE)
+#elif defined(__GNUC__)
+static inline size_t spsc_load_acquire(const size_t *ptr)
+{
+   size_t val = *(const volatile size_t*)ptr;
+   __sync_synchronize();
+   return val;
+}
+
+static inline void spsc_store_release(size_t *ptr, size_t val)
+{
+   __sync_synchronize();
+   *(volatile size_t*)ptr = val;
+}
+#elif defined(_MSC_VER)
+static __inline size_t spsc_load_acquire(const size_t *ptr)
+{
+   size_t val = *(const volatile size_t*)ptr;
+   MemoryBarrier();
+   return val;
+}
+
+static __inline void spsc_store_release(size_t *ptr, size_t val)
+{
+   MemoryBarrier();
+   *(volatile size_t*)ptr = val;
+}
+#else
+#error "No memory barriers for this compiler."
+#endif
+
+spsc_buffer_t *spsc_new(size_t size)
+{
+   size_t storage = 1;
+   spsc_buffer_t *buf = (spsc_buffer_t*)calloc(1, sizeof(*buf));
+   if (!buf)
+      return NULL;
+
+   while (storage < size)
+      storage <<= 1;
+
+   buf->buffer = (uint8_t*)calloc(1, storage);
+   if (!buf->buffer)
+   {
+      free(buf);
+      return NULL;
+   }
+
+   buf->capacity = size;
+   buf->mask     = storage - 1;
+
+   return buf;
+}
+
+void spsc_free(spsc_buffer_t *buffer)
+{
+   if (!buffer)
+      return;
+
+   free(buffer->buffer);
+   free(buffer);
+}
+
+size_t spsc_read_avail(spsc_buffer_t *buffer)
+{
+   return spsc_load_acquire(&buffer->head) - buffer->tail;
+}
+
+size_t spsc_write_avail(spsc_buffer_t *buffer)
+{
+   return buffer->capacity -
+      (buffer->head - spsc_load_acquire(&buffer->tail));
+}
+
+void spsc_write(spsc_buffer_t *buffer, const void *in_buf, size_t size)
+{
+   size_t pos         = buffer->head & buffer->mask;
+   size_t first_write = size;
+   size_t rest_write  = 0;
+
+   if (pos + size > buffer->mask + 1)
+   {
+      first_write = buffer->mask + 1 - pos;
+      rest_write  = size - first_write;
+   }
+
+   memcpy(buffer->buffer + pos, in_buf, first_write);
+   memcpy(buffer->buffer, (const uint8_t*)in_buf + first_write, rest_write);
+
+   spsc_store_release(&buffer->head, buffer->head + size);
+}
+
+size_t spsc_write_acquire(spsc_buffer_t *buffer,
+      void **chunk1, size_t *size1, void **chunk2, size_t *size2)
+{
+   size_t pos   = buffer->head & buffer->mask;
+   size_t avail = spsc_write_avail(buffer);
+
+   *chunk1 = buffer->buffer + pos;
+   *size1  = avail;
+   *chunk2 = NULL;
+   *size2  = 0;
+
+   if (pos + avail > buffer->mask + 1)
+   {
+      *size1  = buffer->mask + 1 - pos;
+      *chunk2 = buffer->buffer;
+      *size2  = avail - *size1;
+   }
+
+   return avail;
+}
+
+void spsc_write_commit(spsc_buffer_t *buffer, size_t size)
+{
+   spsc_store_release(&buffer->head, buffer->head + size);
+}
+
+void spsc_read(spsc_buffer_t *buffer, void *in_buf, size_t size)
+{
+   size_t pos        = buffer->tail & buffer->mask;
+   size_t first_read = size;
+   size_t rest_read  = 0;
+
+   if (pos + size > buffer->mask + 1)
+   {
+      first_read = buffer->mask + 1 - pos;
+      rest_read  = size - first_read;
+   }
+
+   memcpy(in_buf, buffer->buffer + pos, first_read);
+   memcpy((uint8_t*)in_buf + first_read, buffer->buffer, rest_read);
+
+   spsc_store_release(&buffer->tail, buffer->tail + size);
+}
@@ -0,0 +1,82 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *  Copyright (C) 2011-2014 - Daniel De Matteis
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+#ifndef __SPSC_BUFFER_H
+#define __SPSC_BUFFER_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* Ring buffer for exactly one producer and one consumer thread,
+ * which can then use it without any locking, e.g. an audio driver
+ * and the callback thread feeding the sound card.
+ *
+ * Only the producer may call spsc_write(), spsc_write_acquire(),
+ * spsc_write_commit() and spsc_write_avail(), only the consumer
+ * spsc_read() and spsc_read_avail(). */
+
+#define SPSC_CACHE_LINE 64
+
+struct spsc_buffer
+{
+   uint8_t *buffer;
+   size_t capacity;
+   size_t mask;
+
+   /* Both counters run freely and are only masked on access.
+    * Keep them on separate cache lines so the two threads
+    * don't keep stealing the line from each other. */
+   uint8_t pad0[SPSC_CACHE_LINE];
+   size_t head; /* Bytes written so far, owned by the producer. */
+   uint8_t pad1[SPSC_CACHE_LINE - sizeof(size_t)];
+   size_t tail; /* Bytes read so far, owned by the consumer. */
+   uint8_t pad2[SPSC_CACHE_LINE - sizeof(size_t)];
+};
+
+typedef struct spsc_buffer spsc_buffer_t;
+
+/* Holds exactly size bytes. Storage is rounded up to a power of two. */
+spsc_buffer_t *spsc_new(size_t size);
+
+void spsc_free(spsc_buffer_t *buffer);
+
+void spsc_write(spsc_buffer_t *buffer, const void *in_buf, size_t size);
+
+void spsc_read(spsc_buffer_t *buffer, void *in_buf, size_t size);
+
+size_t spsc_read_avail(spsc_buffer_t *buffer);
+
+/* Zero-copy alternative to spsc_write(). Hands out all free space
+ * as chunk1 and, if it wraps around the end of the storage, chunk2,
+ * and returns their total size. The producer fills them in place and
+ * then publishes the first size bytes with spsc_write_commit(). */
+size_t spsc_write_acquire(spsc_buffer_t *buffer,
+      void **chunk1, size_t *size1, void **chunk2, size_t *size2);
+
+void spsc_write_commit(spsc_buffer_t *buffer, size_t size);
+
+size_t spsc_write_avail(spsc_buffer_t *buffer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
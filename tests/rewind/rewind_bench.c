@@ -0,0 +1,239 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Replays a sequence of save states through the rewind buffer once per
+ * find_change()/find_same() implementation and reports the scan rate.
+ *
+ * The input is a raw dump of consecutive retro_serialize() outputs,
+ * all of the same size. Without one, a synthetic sequence is used. */
+
+#include "../../general.h"
+#include "../../performance.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+struct global g_extern;
+
+static uint64_t bench_cpu;
+
+uint64_t rarch_get_cpu_features(void)
+{
+   return bench_cpu;
+}
+
+retro_perf_tick_t rarch_get_perf_counter(void)
+{
+   return 0;
+}
+
+void rarch_perf_register(struct retro_perf_counter *perf)
+{
+   perf->registered = true;
+}
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* Mostly static RAM with a few hot areas, roughly what 16-bit
+ * era cores look like from frame to frame. */
+static uint8_t *gen_states(size_t state_size, unsigned frames)
+{
+   unsigned f;
+   size_t i;
+   uint8_t *states = (uint8_t*)malloc(state_size * frames);
+
+   if (!states)
+      return NULL;
+
+   for (i = 0; i < state_size; i++)
+      states[i] = rand();
+
+   for (f = 1; f < frames; f++)
+   {
+      uint8_t *cur = states + f * state_size;
+      memcpy(cur, cur - state_size, state_size);
+
+      for (i = 0; i < state_size / 64; i++)
+         cur[rand() % state_size] = rand();
+      for (i = 0; i < 256; i++)
+         cur[i] = f + i;
+   }
+
+   return states;
+}
+
+static bool run(const char *name, uint64_t cpu, bool lz,
+      const uint8_t *states, size_t state_size, unsigned frames,
+      size_t *out_bytes)
+{
+   unsigned f;
+   size_t bytes = 0;
+   double total = 0.0;
+   const void *data = NULL;
+   state_manager_t *state;
+
+   bench_cpu = cpu;
+   state = state_manager_new(state_size, (state_size + 64) * (frames + 2));
+   if (!state)
+      return false;
+
+   if (lz && !state_manager_enable_lz(state))
+   {
+      state_manager_free(state);
+      return false;
+   }
+
+   for (f = 0; f < frames; f++)
+   {
+      void *where = NULL;
+      double start;
+
+      state_manager_push_where(state, &where);
+      memcpy(where, states + f * state_size, state_size);
+
+      start = get_time();
+      state_manager_push_do(state);
+      total += get_time() - start;
+   }
+
+   state_manager_capacity(state, NULL, &bytes, NULL);
+
+   for (f = frames; f-- > 0; )
+   {
+      if (!state_manager_pop(state, &data) ||
+            memcmp(data, states + f * state_size, state_size))
+      {
+         fprintf(stderr, "%s: state %u does not match.\n", name, f);
+         state_manager_free(state);
+         return false;
+      }
+   }
+
+   printf("%-8s %3s %8.3f GB/s  %10u bytes  (%.2f%%, %.1f states/MB)\n",
+         name, lz ? "+lz" : "",
+         (double)state_size * (frames - 1) / total / 1e9,
+         (unsigned)bytes, 100.0 * bytes / ((double)state_size * frames),
+         frames / (bytes / 1000000.0));
+
+   *out_bytes = bytes;
+   state_manager_free(state);
+   return true;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   size_t state_size = 256 * 1024;
+   unsigned frames   = 600;
+   uint8_t *states   = NULL;
+   size_t ref_bytes  = 0;
+   bool ok           = true;
+   static const struct
+   {
+      const char *name;
+      uint64_t cpu;
+   } impls[] = {
+      { "generic", 0 },
+#if defined(__x86_64__) || defined(__i386__)
+      { "sse2",    RETRO_SIMD_SSE2 },
+      { "avx2",    RETRO_SIMD_SSE2 | RETRO_SIMD_AVX2 },
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+      { "neon",    RETRO_SIMD_NEON },
+#endif
+   };
+
+   if (argc == 3)
+   {
+      long len;
+      FILE *file = fopen(argv[2], "rb");
+
+      state_size = strtoul(argv[1], NULL, 0);
+      if (!file || !state_size)
+      {
+         fprintf(stderr, "Cannot open \"%s\".\n", argv[2]);
+         return 1;
+      }
+
+      fseek(file, 0, SEEK_END);
+      len = ftell(file);
+      rewind(file);
+
+      frames = len / state_size;
+      states = (uint8_t*)malloc(state_size * frames);
+      if (!states || fread(states, state_size, frames, file) != frames)
+      {
+         fprintf(stderr, "Failed to read states.\n");
+         return 1;
+      }
+      fclose(file);
+   }
+   else if (argc == 1)
+      states = gen_states(state_size, frames);
+   else
+   {
+      fprintf(stderr, "Usage: %s [<state size> <state dump>]\n", argv[0]);
+      return 1;
+   }
+
+   if (!states || frames < 2)
+      return 1;
+
+   printf("%u states of %u bytes.\n", frames, (unsigned)state_size);
+
+   for (i = 0; i < sizeof(impls) / sizeof(impls[0]); i++)
+   {
+      size_t bytes = 0;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+      if ((impls[i].cpu & RETRO_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+         continue;
+#endif
+
+      if (!run(impls[i].name, impls[i].cpu, false,
+               states, state_size, frames, &bytes))
+         ok = false;
+      else if (i && bytes != ref_bytes)
+      {
+         fprintf(stderr, "%s: output differs from generic.\n", impls[i].name);
+         ok = false;
+      }
+      else
+         ref_bytes = bytes;
+   }
+
+   /* The LZ stage is independent of the scanners,
+    * run it once on top of the last one. */
+   if (ok)
+   {
+      size_t bytes = 0;
+      i--;
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+      if ((impls[i].cpu & RETRO_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+         i--;
+#endif
+      ok = run(impls[i].name, impls[i].cpu, true,
+            states, state_size, frames, &bytes);
+   }
+
+   free(states);
+   return ok ? 0 : 1;
+}
@@ -0,0 +1,202 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Runs every direct pixel conversion at a few common core resolutions,
+ * once per converter the SIMD masks below pick, and reports the rate
+ * in GB/s, counting both the bytes read and the bytes written. SIMD
+ * versions must produce the same output as the baseline one.
+ *
+ * Frames are converted bottom-up with a negative input stride, the
+ * way the screenshot and recording paths flip GL readbacks. */
+
+#include <gfx/scaler/scaler.h>
+#include <boolean.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+/* Roughly 200 640x480 frames worth of pixels per run. */
+#define PIXELS  (640 * 480 * 200)
+#define BATCHES 5
+
+static const struct
+{
+   unsigned width;
+   unsigned height;
+} sizes[] = {
+   { 256, 224 },
+   { 320, 240 },
+   { 640, 480 },
+};
+
+static const struct
+{
+   enum scaler_pix_fmt in_fmt;
+   enum scaler_pix_fmt out_fmt;
+   const char *name;
+} convs[] = {
+   { SCALER_FMT_0RGB1555, SCALER_FMT_ARGB8888, "0RGB1555 -> ARGB8888" },
+   { SCALER_FMT_RGB565,   SCALER_FMT_ARGB8888, "RGB565 -> ARGB8888" },
+   { SCALER_FMT_RGBA4444, SCALER_FMT_ARGB8888, "RGBA4444 -> ARGB8888" },
+   { SCALER_FMT_BGR24,    SCALER_FMT_ARGB8888, "BGR24 -> ARGB8888" },
+   { SCALER_FMT_YUYV,     SCALER_FMT_ARGB8888, "YUYV -> ARGB8888" },
+   { SCALER_FMT_0RGB1555, SCALER_FMT_RGB565,   "0RGB1555 -> RGB565" },
+   { SCALER_FMT_RGB565,   SCALER_FMT_0RGB1555, "RGB565 -> 0RGB1555" },
+   { SCALER_FMT_ARGB8888, SCALER_FMT_0RGB1555, "ARGB8888 -> 0RGB1555" },
+   { SCALER_FMT_ARGB8888, SCALER_FMT_ABGR8888, "ARGB8888 -> ABGR8888" },
+   { SCALER_FMT_ARGB8888, SCALER_FMT_BGR24,    "ARGB8888 -> BGR24" },
+   { SCALER_FMT_RGB565,   SCALER_FMT_BGR24,    "RGB565 -> BGR24" },
+   { SCALER_FMT_0RGB1555, SCALER_FMT_BGR24,    "0RGB1555 -> BGR24" },
+};
+
+static const struct
+{
+   const char *name;
+   scaler_simd_mask_t simd;
+} impls[] = {
+   { "baseline", 0 },
+#if defined(__x86_64__) || defined(__i386__)
+   { "ssse3",    SCALER_SIMD_SSSE3 },
+   { "avx2",     SCALER_SIMD_SSSE3 | SCALER_SIMD_AVX2 },
+#endif
+};
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+static unsigned fmt_bpp(enum scaler_pix_fmt fmt)
+{
+   switch (fmt)
+   {
+      case SCALER_FMT_ARGB8888:
+      case SCALER_FMT_ABGR8888:
+         return 4;
+      case SCALER_FMT_BGR24:
+         return 3;
+      default:
+         return 2;
+   }
+}
+
+static double run(scaler_pixconv_t conv, void *output, const void *input,
+      unsigned width, unsigned height, int out_stride, int in_stride)
+{
+   unsigned f, batch;
+   unsigned frames = PIXELS / (width * height) / BATCHES;
+   double best     = 0.0;
+   const uint8_t *bottom = (const uint8_t*)input + (height - 1) * in_stride;
+
+   /* Best of a few batches, a single run is too noisy on a busy box. */
+   for (batch = 0; batch < BATCHES; batch++)
+   {
+      double start = get_time();
+
+      for (f = 0; f < frames; f++)
+         conv(output, bottom, width, height, out_stride, -in_stride);
+
+      start = get_time() - start;
+      if (!batch || start < best)
+         best = start;
+   }
+
+   return (double)frames * height * (abs(in_stride) + abs(out_stride))
+      / best / 1e9;
+}
+
+int main(void)
+{
+   unsigned i, j, k;
+   size_t n;
+   bool ok = true;
+   size_t max_size = 640 * 480 * 4;
+   uint8_t *input  = (uint8_t*)malloc(max_size);
+   uint8_t *ref    = (uint8_t*)malloc(max_size);
+   uint8_t *output = (uint8_t*)malloc(max_size);
+
+   if (!input || !ref || !output)
+      return 1;
+
+   srand(1);
+   for (n = 0; n < max_size; n++)
+      input[n] = rand();
+
+   for (k = 0; k < sizeof(sizes) / sizeof(sizes[0]); k++)
+   {
+      unsigned width  = sizes[k].width;
+      unsigned height = sizes[k].height;
+
+      printf("%ux%u:\n", width, height);
+
+      for (i = 0; i < sizeof(convs) / sizeof(convs[0]); i++)
+      {
+         scaler_pixconv_t last = NULL;
+         int in_stride  = width * fmt_bpp(convs[i].in_fmt);
+         int out_stride = width * fmt_bpp(convs[i].out_fmt);
+         size_t out_size = (size_t)out_stride * height;
+
+         for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++)
+         {
+            double gbps;
+            scaler_pixconv_t conv;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            if ((impls[j].simd & SCALER_SIMD_SSSE3) && !__builtin_cpu_supports("ssse3"))
+               continue;
+            if ((impls[j].simd & SCALER_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+               continue;
+#endif
+
+            scaler_set_simd_mask(impls[j].simd);
+            conv = scaler_get_pixconv(convs[i].in_fmt, convs[i].out_fmt);
+            if (!conv)
+            {
+               fprintf(stderr, "%s: no converter.\n", convs[i].name);
+               ok = false;
+               break;
+            }
+
+            if (j && conv == last)
+               continue;
+            last = conv;
+
+            memset(output, 0, out_size);
+            gbps = run(conv, output, input, width, height,
+                  out_stride, in_stride);
+            printf("  %-22s %-8s %7.2f GB/s\n",
+                  convs[i].name, impls[j].name, gbps);
+
+            if (!j)
+               memcpy(ref, output, out_size);
+            else if (memcmp(output, ref, out_size))
+            {
+               fprintf(stderr, "%s (%s): output differs from baseline.\n",
+                     convs[i].name, impls[j].name);
+               ok = false;
+            }
+         }
+      }
+   }
+
+   free(input);
+   free(ref);
+   free(output);
+   return ok ? 0 : 1;
+}
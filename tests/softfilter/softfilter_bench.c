@@ -0,0 +1,310 @@
+/*  RetroArch - A frontend for libretro.
+ *  Copyright (C) 2010-2014 - Hans-Kristian Arntzen
+ *
+ *  RetroArch is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  RetroArch is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with RetroArch.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Pushes 256x224 frames through every builtin software filter, once
+ * per implementation the filter offers for the SIMD masks below, and
+ * reports the rate in input megapixels per second. SIMD versions must
+ * produce the same output as the generic one.
+ *
+ * Filters run single-threaded here, gfx/filter.c takes care of
+ * spreading packets over cores. */
+
+#include "softfilter.h"
+#include <boolean.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <time.h>
+
+#define WIDTH  256
+#define HEIGHT 224
+/* Most filters look one or two pixels past the frame edges. */
+#define PAD    4
+#define FRAMES 300
+#define BATCHES 5
+
+extern const struct softfilter_implementation *blargg_ntsc_snes_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *lq2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *phosphor2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *twoxbr_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *epx_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *twoxsai_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *supereagle_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *supertwoxsai_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *darken_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *scale2x_get_implementation(softfilter_simd_mask_t simd);
+extern const struct softfilter_implementation *normal2x_get_implementation(softfilter_simd_mask_t simd);
+
+static const softfilter_get_implementation_t filters[] = {
+   blargg_ntsc_snes_get_implementation,
+   lq2x_get_implementation,
+   phosphor2x_get_implementation,
+   twoxbr_get_implementation,
+   darken_get_implementation,
+   twoxsai_get_implementation,
+   supertwoxsai_get_implementation,
+   supereagle_get_implementation,
+   epx_get_implementation,
+   scale2x_get_implementation,
+   normal2x_get_implementation,
+};
+
+static const struct
+{
+   const char *name;
+   softfilter_simd_mask_t simd;
+} impls[] = {
+   { "generic", 0 },
+#if defined(__x86_64__) || defined(__i386__)
+   { "sse2",    SOFTFILTER_SIMD_SSE2 },
+   { "avx2",    SOFTFILTER_SIMD_SSE2 | SOFTFILTER_SIMD_AVX2 },
+#endif
+#if defined(__ARM_NEON__) || defined(__ARM_NEON)
+   { "neon",    SOFTFILTER_SIMD_NEON },
+#endif
+};
+
+/* Every key falls back to the filter's default. */
+static int config_get_float(void *userdata, const char *key,
+      float *value, float default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+static int config_get_int(void *userdata, const char *key,
+      int *value, int default_value)
+{
+   *value = default_value;
+   return 0;
+}
+
+static int config_get_float_array(void *userdata, const char *key,
+      float **values, unsigned *out_num_values,
+      const float *default_values, unsigned num_default_values)
+{
+   *values = (float*)calloc(num_default_values, sizeof(float));
+   memcpy(*values, default_values, num_default_values * sizeof(float));
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+static int config_get_int_array(void *userdata, const char *key,
+      int **values, unsigned *out_num_values,
+      const int *default_values, unsigned num_default_values)
+{
+   *values = (int*)calloc(num_default_values, sizeof(int));
+   memcpy(*values, default_values, num_default_values * sizeof(int));
+   *out_num_values = num_default_values;
+   return 0;
+}
+
+static int config_get_string(void *userdata, const char *key,
+      char **output, const char *default_output)
+{
+   *output = strdup(default_output);
+   return 0;
+}
+
+static const struct softfilter_config config = {
+   config_get_float,
+   config_get_int,
+   config_get_float_array,
+   config_get_int_array,
+   config_get_string,
+   free,
+};
+
+static double get_time(void)
+{
+   struct timespec tv;
+   clock_gettime(CLOCK_MONOTONIC, &tv);
+   return tv.tv_sec + tv.tv_nsec / 1000000000.0;
+}
+
+/* Tiled background with flat sky, a gradient band and a few
+ * sprites, which keeps the edge detectors honest. */
+static void gen_frame(uint32_t *xrgb, uint16_t *rgb565,
+      unsigned stride)
+{
+   unsigned x, y;
+   static const uint32_t palette[] = {
+      0x000000, 0xf8f8f8, 0x2038ec, 0x58d854,
+      0xa81000, 0xfcbcb0, 0x7c7c7c, 0xf8b800,
+   };
+
+   srand(1);
+
+   for (y = 0; y < HEIGHT + 2 * PAD; y++)
+   {
+      for (x = 0; x < WIDTH + 2 * PAD; x++)
+      {
+         uint32_t c;
+
+         if (y < 64)
+            c = 0x5c94fc;
+         else if (y < 96)
+            c = ((y - 64) * 8) << 16 | ((x & 0xff) << 8) | 0x40;
+         else
+         {
+            /* Flat 8x8 tiles with an outline, plus a busy one now
+             * and then. */
+            unsigned tile = ((x >> 3) * 7 + (y >> 3) * 13) & 15;
+            if (tile == 0)
+               c = palette[(x ^ y) & 7];
+            else if ((x & 7) == 0 || (y & 7) == 0)
+               c = palette[0];
+            else
+               c = palette[tile & 7];
+         }
+
+         if ((rand() & 255) == 0)
+            c = palette[rand() & 7];
+
+         c &= 0xf8fcf8;
+         xrgb[y * stride + x]   = c;
+         rgb565[y * stride + x] = (c >> 8 & 0xf800) |
+            (c >> 5 & 0x07e0) | (c >> 3 & 0x001f);
+      }
+   }
+}
+
+static double run(const struct softfilter_implementation *impl,
+      softfilter_simd_mask_t simd, unsigned fmt,
+      const void *input, size_t in_stride,
+      void **output, size_t *output_size)
+{
+   unsigned f, i, batch, threads, out_width, out_height;
+   size_t bpp = fmt == SOFTFILTER_FMT_RGB565 ? 2 : 4;
+   size_t out_stride;
+   struct softfilter_work_packet *packets;
+   double best = 0.0;
+   void *data = impl->create(&config, fmt, fmt, WIDTH, HEIGHT, 1, simd, NULL);
+
+   if (!data)
+      return 0.0;
+
+   impl->query_output_size(data, &out_width, &out_height, WIDTH, HEIGHT);
+   out_stride = out_width * bpp;
+
+   threads = impl->query_num_threads(data);
+   packets = (struct softfilter_work_packet*)calloc(threads, sizeof(*packets));
+   *output      = calloc(out_height, out_stride);
+   *output_size = out_height * out_stride;
+
+   /* Best of a few batches, a single run is too noisy on a busy box. */
+   for (batch = 0; batch < BATCHES; batch++)
+   {
+      double start = get_time();
+
+      for (f = 0; f < FRAMES / BATCHES; f++)
+      {
+         impl->get_work_packets(data, packets, *output, out_stride,
+               (const uint8_t*)input + PAD * in_stride + PAD * bpp,
+               WIDTH, HEIGHT, in_stride);
+
+         for (i = 0; i < threads; i++)
+            packets[i].work(data, packets[i].thread_data);
+      }
+
+      start = get_time() - start;
+      if (!batch || start < best)
+         best = start;
+   }
+
+   free(packets);
+   impl->destroy(data);
+   return (double)WIDTH * HEIGHT * (FRAMES / BATCHES) / best / 1e6;
+}
+
+int main(void)
+{
+   unsigned i, j, k;
+   bool ok = true;
+   unsigned stride = WIDTH + 2 * PAD;
+   uint32_t *xrgb   = (uint32_t*)calloc(stride * (HEIGHT + 2 * PAD), sizeof(uint32_t));
+   uint16_t *rgb565 = (uint16_t*)calloc(stride * (HEIGHT + 2 * PAD), sizeof(uint16_t));
+   static const unsigned fmts[] = { SOFTFILTER_FMT_RGB565, SOFTFILTER_FMT_XRGB8888 };
+
+   if (!xrgb || !rgb565)
+      return 1;
+
+   gen_frame(xrgb, rgb565, stride);
+   printf("%u frames of %ux%u.\n", FRAMES, WIDTH, HEIGHT);
+
+   for (i = 0; i < sizeof(filters) / sizeof(filters[0]); i++)
+   {
+      for (k = 0; k < sizeof(fmts) / sizeof(fmts[0]); k++)
+      {
+         void *ref = NULL;
+         size_t ref_size = 0;
+         const struct softfilter_implementation *generic = filters[i](0);
+         const struct softfilter_implementation *last    = NULL;
+         unsigned fmt = fmts[k];
+         const void *input = fmt == SOFTFILTER_FMT_RGB565 ?
+            (const void*)rgb565 : (const void*)xrgb;
+         size_t in_stride = stride * (fmt == SOFTFILTER_FMT_RGB565 ? 2 : 4);
+
+         if (!(generic->query_input_formats() & fmt))
+            continue;
+
+         for (j = 0; j < sizeof(impls) / sizeof(impls[0]); j++)
+         {
+            void *out = NULL;
+            size_t out_size = 0;
+            double mpix;
+            const struct softfilter_implementation *impl =
+               filters[i](impls[j].simd);
+
+            if (j && impl == last)
+               continue;
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+            if ((impls[j].simd & SOFTFILTER_SIMD_AVX2) && !__builtin_cpu_supports("avx2"))
+               continue;
+#endif
+
+            last = impl;
+            mpix = run(impl, impls[j].simd, fmt, input, in_stride,
+                  &out, &out_size);
+            printf("%-28s %-8s %-7s %9.1f Mpix/s\n", impl->ident,
+                  fmt == SOFTFILTER_FMT_RGB565 ? "RGB565" : "XRGB8888",
+                  impls[j].name, mpix);
+
+            if (!j)
+            {
+               ref      = out;
+               ref_size = out_size;
+               continue;
+            }
+
+            if (out_size != ref_size || memcmp(out, ref, ref_size))
+            {
+               fprintf(stderr, "%s (%s): output differs from generic.\n",
+                     impl->ident, impls[j].name);
+               ok = false;
+            }
+            free(out);
+         }
+
+         free(ref);
+      }
+   }
+
+   free(xrgb);
+   free(rgb565);
+   return ok ? 0 : 1;
+}